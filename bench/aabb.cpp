@@ -0,0 +1,61 @@
+#include <vector>
+
+#include "../math/aabb.hpp"
+#include "bench.hpp"
+
+/* one query box against 1M boxes, the way a broadphase or culling pass
+ * does it: an array of aabbf one at a time against the SoA-streams. The
+ * same for transforming all of them by a mat4
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t count = 1 << 20;
+   const std::size_t iters = bench_iters (argc, argv, 50);
+
+   std::vector<aabbf> boxes (count), out (count);
+   for (std::size_t i = 0; i < count; i++) {
+      const vec3 c = vec3 ((i * 7919) % 1000 * 0.1f, (i * 104729) % 1000 * 0.1f, (i * 15485863) % 1000 * 0.1f);
+      boxes[i]     = aabbf::from_center (c, vec3 (0.5f + i % 3, 1.0f, 0.25f));
+   }
+   aabb_soa soa (boxes), soa_out;
+   const aabbf                query = aabbf (vec3 (20, 30, 40), vec3 (40, 50, 60));
+   const mat4                 m     = mat4::translate (1, 2, 3) * mat4::rotate (norm (vec3 (1, 2, 3)), 0.5f);
+   std::vector<std::uint32_t> hits;
+   hits.reserve (count);
+
+   printf ("%zu x %zu boxes\n", iters, count);
+
+   bench_run ("overlap, one at a time", iters, [&] (std::size_t) {
+      hits.clear ();
+      for (std::size_t i = 0; i < count; i++) {
+         if (overlap (query, boxes[i])) {
+            hits.push_back (std::uint32_t (i));
+         }
+      }
+      do_not_optimize (hits.size ());
+   });
+   bench_run ("overlaps (aabb_soa)", iters, [&] (std::size_t) {
+      hits.clear ();
+      overlaps (query, soa, hits);
+      do_not_optimize (hits.size ());
+   });
+   bench_run ("count_overlaps (aabb_soa)", iters, [&] (std::size_t) {
+      do_not_optimize (count_overlaps (query, soa));
+   });
+   printf ("%zu overlaps per query\n", hits.size ());
+   bench_run ("transform, one at a time", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         out[i] = transform (m, boxes[i]);
+      }
+      do_not_optimize (out[0]);
+   });
+   bench_run ("transform (aabb_soa)", iters, [&] (std::size_t) {
+      transform (m, soa, soa_out);
+      do_not_optimize (soa_out.min.x ()[0]);
+   });
+   bench_run ("bounds (aabb_soa)", iters, [&] (std::size_t) {
+      do_not_optimize (bounds (soa));
+   });
+
+   return 0;
+}
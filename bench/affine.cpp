@@ -0,0 +1,58 @@
+#include <vector>
+
+#include "../math/affine.hpp"
+#include "bench.hpp"
+
+/* composing and inverting 64k transformations, mat4 against affine3.
+ * small enough to stay in L2, bigger arrays only measure the memory
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t count = 1 << 16;
+   const std::size_t iters = bench_iters (argc, argv, 100);
+
+   std::vector<mat4>     m (count), mr (count);
+   std::vector<affine3f> a (count), ar (count);
+   for (std::size_t i = 0; i < count; i++) {
+      m[i] = mat4::translate (i * 0.5f, 1.0f, -2.0f) * mat4::rotate (norm (vec3 (1, 2, i % 7)), i * 0.01f)
+             * mat4::scale (1.0f + (i % 5) * 0.1f, 2.0f, 0.5f);
+      a[i] = affine3f (m[i]);
+   }
+
+   printf ("%zu x %zu transformations, %zu / %zu bytes each\n", iters, count, sizeof (mat4), sizeof (affine3f));
+
+   bench_run ("mat4 * mat4", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i + 1 < count; i++) {
+         mr[i] = m[i] * m[i + 1];
+      }
+      do_not_optimize (mr[0]);
+   });
+   bench_run ("affine3 * affine3", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i + 1 < count; i++) {
+         ar[i] = a[i] * a[i + 1];
+      }
+      do_not_optimize (ar[0]);
+   });
+   bench_run ("batch_compose (affine3)", iters, [&] (std::size_t) {
+      batch_compose (a.data (), a.data () + 1, ar.data (), count - 1);
+      do_not_optimize (ar[0]);
+   });
+   bench_run ("inverse_affine (mat4)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         mr[i] = inverse_affine (m[i]);
+      }
+      do_not_optimize (mr[0]);
+   });
+   bench_run ("inverse (affine3)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         ar[i] = inverse (a[i]);
+      }
+      do_not_optimize (ar[0]);
+   });
+   bench_run ("batch_inverse (affine3)", iters, [&] (std::size_t) {
+      batch_inverse (a.data (), ar.data (), count);
+      do_not_optimize (ar[0]);
+   });
+
+   return 0;
+}
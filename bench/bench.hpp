@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/* tiny timing helpers for the benchmarks.
+ * a header-only library shouldn't need a benchmark framework, so we just
+ * run a lambda n times and print the time per call.
+ */
+
+/* keep the compiler from optimizing away a result we never read
+ */
+template <typename T>
+inline void do_not_optimize (const T &val)
+{
+   asm volatile ("" : : "g"(&val) : "memory");
+}
+
+/* iteration count can be scaled from the command line, so the meson
+ * benchmark-target stays fast but a longer run is still possible
+ */
+inline auto bench_iters (int argc, char **argv, std::size_t iters) -> std::size_t
+{
+   if (argc > 1) {
+      return iters * std::strtoul (argv[1], nullptr, 10);
+   }
+   return iters;
+}
+
+template <typename F>
+inline auto bench_run (const char *name, std::size_t iters, F &&f) -> double
+{
+   auto start = std::chrono::steady_clock::now ();
+   for (std::size_t i = 0; i < iters; i++) {
+      f (i);
+   }
+   auto   end = std::chrono::steady_clock::now ();
+   double ns  = std::chrono::duration<double, std::nano> (end - start).count () / iters;
+   printf ("%-48s %10.3f ns/op\n", name, ns);
+   return ns;
+}
@@ -0,0 +1,40 @@
+#include <vector>
+
+#include "../math/bvh.hpp"
+#include "bench.hpp"
+#include "meshes.hpp"
+
+/* building a bvh over generated meshes of about 1M triangles: a closed,
+ * bumpy surface and a soup of small random triangles. Prints the build
+ * rate and the SAH cost of the tree, single-threaded and with all
+ * threads. argv[2] limits the threads
+ */
+static void run (const char *name, const std::vector<vec3> &vertices, std::size_t iters, std::size_t threads)
+{
+   const std::vector<aabbf> boxes = triangle_bounds (vertices);
+   printf ("%s, %zu triangles\n", name, boxes.size ());
+
+   bvh tree;
+   for (std::size_t t : { std::size_t (1), threads }) {
+      parallel_max_threads () = t;
+      char label[64];
+      snprintf (label, sizeof (label), "  build, %zu threads", parallel_threads ());
+      const double ns = bench_run (label, iters, [&] (std::size_t) {
+         tree = bvh (boxes);
+         do_not_optimize (tree.nodes[0]);
+      });
+      printf ("  %.1f Mtriangles/s\n", boxes.size () / ns * 1e3);
+   }
+   printf ("  %zu nodes, SAH cost %.2f\n", tree.nodes.size (), sah_cost (tree));
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters   = bench_iters (argc, argv, 5);
+   const std::size_t threads = argc > 2 ? std::strtoul (argv[2], nullptr, 10) : 0;
+
+   run ("surface", make_surface (500, 1000), iters, threads);
+   run ("soup", make_soup (1000000, 0, 100, 1), iters, threads);
+
+   return 0;
+}
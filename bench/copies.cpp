@@ -0,0 +1,189 @@
+#include <cstdlib>
+#include <new>
+
+#include "../math/dynamic.hpp"
+#include "bench.hpp"
+
+/* element copies and heap allocations of chained operators, before and
+ * after they took const references and reused temporaries.
+ * The "by value" lines call helpers with the old signatures. vec and
+ * mat are trivially copyable, so their copies are counted through an
+ * element type that counts its own copies and moves. The bytes are
+ * those copies and moves plus everything allocated on the heap.
+ */
+struct counted
+{
+   static inline std::size_t copies = 0;
+   static inline std::size_t moves  = 0;
+
+   double v = 0;
+
+   counted () = default;
+   counted (double v)
+   : v (v)
+   {
+   }
+   counted (const counted &o)
+   : v (o.v)
+   {
+      copies++;
+   }
+   counted (counted &&o)
+   : v (o.v)
+   {
+      moves++;
+   }
+   auto operator= (const counted &o) -> counted &
+   {
+      copies++;
+      v = o.v;
+      return *this;
+   }
+   auto operator= (counted &&o) -> counted &
+   {
+      moves++;
+      v = o.v;
+      return *this;
+   }
+
+   auto operator+= (const counted &o) -> counted &
+   {
+      v += o.v;
+      return *this;
+   }
+   auto operator-= (const counted &o) -> counted &
+   {
+      v -= o.v;
+      return *this;
+   }
+   auto operator*= (const counted &o) -> counted &
+   {
+      v *= o.v;
+      return *this;
+   }
+   auto operator/= (const counted &o) -> counted &
+   {
+      v /= o.v;
+      return *this;
+   }
+};
+
+inline auto operator+ (const counted &a, const counted &b) -> counted
+{
+   return counted (a.v + b.v);
+}
+
+inline auto operator* (const counted &a, const counted &b) -> counted
+{
+   return counted (a.v * b.v);
+}
+
+inline auto operator- (const counted &a) -> counted
+{
+   return counted (-a.v);
+}
+
+static std::size_t allocations = 0;
+static std::size_t allocated   = 0;
+
+/* vecX allocates through the aligned operator new, so that is the one
+ * we count
+ */
+auto operator new (std::size_t size, std::align_val_t align) -> void *
+{
+   allocations++;
+   allocated += size;
+   const std::size_t a = std::size_t (align);
+   return std::aligned_alloc (a, (size + a - 1) / a * a);
+}
+
+void operator delete (void *p, std::align_val_t) noexcept
+{
+   std::free (p);
+}
+
+void operator delete (void *p, std::size_t, std::align_val_t) noexcept
+{
+   std::free (p);
+}
+
+/* the old signatures
+ */
+template <typename V>
+static auto add_by_value (V v1, V v2) -> V
+{
+   return V (v1) += v2;
+}
+
+template <typename V>
+static auto sub_by_value (V v1, V v2) -> V
+{
+   return V (v1) -= v2;
+}
+
+template <typename M>
+static auto mul_by_value (const M &m1, M m2) -> M
+{
+   return m1 * m2;
+}
+
+template <typename F>
+static void count (const char *name, F &&f)
+{
+   counted::copies = counted::moves = 0;
+   allocations = allocated = 0;
+   f ();
+   const std::size_t bytes = (counted::copies + counted::moves) * sizeof (double) + allocated;
+   printf ("%-40s %6zu copies %6zu moves %4zu allocs %8zu bytes\n", name, counted::copies, counted::moves,
+           allocations, bytes);
+}
+
+typedef vec<counted, 8>    cvec;
+typedef mat<counted, 8, 8> cmat;
+
+int main ()
+{
+   cvec a (1.0), b (2.0), c (3.0), d (4.0);
+   count ("a + b + c + d (by value)", [&] () {
+      cvec r = add_by_value (add_by_value (add_by_value (a, b), c), d);
+      do_not_optimize (r);
+   });
+   count ("a + b + c + d", [&] () {
+      cvec r = a + b + c + d;
+      do_not_optimize (r);
+   });
+   count ("(a + b) * (c + d) * 2", [&] () {
+      cvec r = (a + b) * (c + d) * 2.0;
+      do_not_optimize (r);
+   });
+
+   cmat m1, m2, m3;
+   count ("m1 + m2 + m3 (by value)", [&] () {
+      cmat r = add_by_value (add_by_value (m1, m2), m3);
+      do_not_optimize (r);
+   });
+   count ("m1 + m2 + m3", [&] () {
+      cmat r = m1 + m2 + m3;
+      do_not_optimize (r);
+   });
+   count ("m1 * m2 * m3 (by value)", [&] () {
+      cmat r = mul_by_value (mul_by_value (m1, m2), m3);
+      do_not_optimize (r);
+   });
+   count ("m1 * m2 * m3", [&] () {
+      cmat r = m1 * m2 * m3;
+      do_not_optimize (r);
+   });
+
+   vecXd x (1024, 1.0), y (1024, 2.0), z (1024, 3.0);
+   count ("x + y + z - x (vecX, by value)", [&] () {
+      vecXd r = sub_by_value (add_by_value (add_by_value (x, y), z), x);
+      do_not_optimize (r);
+   });
+   count ("x + y + z - x (vecX)", [&] () {
+      vecXd r = x + y + z - x;
+      do_not_optimize (r);
+   });
+
+   return 0;
+}
@@ -0,0 +1,93 @@
+#include <cmath>
+#include <vector>
+
+#include "../math/deforming_bvh.hpp"
+#include "../math/lbvh.hpp"
+#include "../math/wide_bvh.hpp"
+#include "bench.hpp"
+#include "meshes.hpp"
+
+/* keeping a bvh up to date over an animation of a mesh of 100K
+ * triangles, which twists further and further around its axis and
+ * ripples: a full SAH rebuild and a linear bvh every frame, against
+ * refitting the first tree and refitting with partial rebuilds. Prints
+ * the time per frame, and after the last frame the SAH cost of the tree
+ * and how fast rays go through it, collapsed into a wide_bvh8
+ */
+static auto deform (const std::vector<vec3> &rest, float t) -> std::vector<vec3>
+{
+   std::vector<vec3> result (rest.size ());
+   for (std::size_t i = 0; i < rest.size (); i++) {
+      const vec3 &v = rest[i];
+      const float a = 2.5f * t * v.y, c = std::cos (a), s = std::sin (a);
+      const float r = 1 + 0.1f * t * std::sin (6 * v.y + 10 * t);
+      result[i]     = vec3 ((c * v.x - s * v.z) * r, v.y, (s * v.x + c * v.z) * r);
+   }
+   return result;
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t              frames = 24;
+   const std::vector<vec3>        rest   = make_surface (200, 250);
+   std::vector<std::vector<vec3>> animation;
+   for (std::size_t f = 0; f < frames; f++) {
+      animation.push_back (deform (rest, f / (frames - 1.0f)));
+   }
+   const std::size_t iters = bench_iters (argc, argv, 1) * frames;
+   printf ("%zu triangles, %zu frames\n", rest.size () / 3, frames);
+
+   // rays from a camera at the mesh
+   std::vector<ray> rays;
+   const vec3       eye (0.3f, 0.8f, 3.0f);
+   for (std::size_t y = 0; y < 256; y++) {
+      for (std::size_t x = 0; x < 256; x++) {
+         rays.push_back (ray (eye, vec3 (x / 128.0f - 1, 1 - y / 128.0f, 0) - eye));
+      }
+   }
+
+   auto report = [&] (const char *label, auto &&frame) {
+      const bvh *tree = nullptr;
+      bench_run (label, iters, [&] (std::size_t i) {
+         tree = &frame (animation[i % frames]);
+         do_not_optimize (tree->nodes[0]);
+      });
+      const std::vector<vec3> &last = animation[(iters - 1) % frames];
+      const wide_bvh8          wide (*tree, last);
+      const double             ns = bench_run ("    tracing", 1, [&] (std::size_t) {
+         for (const ray &r : rays) {
+            do_not_optimize (wide.intersect (r));
+         }
+      });
+      printf ("    SAH cost %.2f, %.2f Mrays/s\n", sah_cost (*tree), rays.size () / ns * 1e3);
+   };
+
+   bvh sah;
+   report ("  SAH rebuild", [&] (const std::vector<vec3> &v) -> const bvh & {
+      sah = bvh (triangle_bounds (v));
+      return sah;
+   });
+
+   bvh          linear;
+   lbvh_builder builder;
+   report ("  linear bvh rebuild", [&] (const std::vector<vec3> &v) -> const bvh & {
+      builder.build (triangle_bounds (v), linear);
+      return linear;
+   });
+
+   deforming_bvh refit (triangle_bounds (animation[0]));
+   report ("  refit", [&] (const std::vector<vec3> &v) -> const bvh & {
+      refit.refit (v);
+      return refit.tree ();
+   });
+
+   deforming_bvh updated (triangle_bounds (animation[0]));
+   std::size_t   rebuilt = 0;
+   report ("  refit, partial rebuilds", [&] (const std::vector<vec3> &v) -> const bvh & {
+      rebuilt += updated.update (v);
+      return updated.tree ();
+   });
+   printf ("    %zu of %zu subtrees rebuilt over %zu frames\n", rebuilt, updated.subtrees (), iters);
+
+   return 0;
+}
@@ -0,0 +1,43 @@
+#include <vector>
+
+#include "../math/dispatch.hpp"
+#include "bench.hpp"
+
+int main (int argc, char **argv)
+{
+   const std::size_t count = 1 << 16;
+   const std::size_t iters = bench_iters (argc, argv, 200);
+   const simd_tier   tiers[] = { simd_tier::scalar, simd_tier::sse2, simd_tier::avx2, simd_tier::avx512 };
+
+   std::vector<vec3>  a (count), b (count), r3 (count);
+   std::vector<vec4>  v (count), r4 (count);
+   std::vector<float> rd (count);
+   for (std::size_t i = 0; i < count; i++) {
+      a[i] = vec3 (i * 0.5f, 1.0f, -2.0f);
+      b[i] = vec3 (3.0f, i * 0.25f, 1.0f);
+      v[i] = vec4 (a[i].x, a[i].y, a[i].z, 1.0f);
+   }
+   mat4 m = mat4::translate (1.0f, 2.0f, 3.0f);
+
+   printf ("detected tier: %s, %zu elements per call\n", simd_tier_name (detect_simd_tier ()), count);
+   for (simd_tier tier : tiers) {
+      if (!force_simd_tier (tier)) {
+         continue;
+      }
+      char name[64];
+      printf ("\n");
+      snprintf (name, sizeof (name), "%s transform", simd_tier_name (tier));
+      bench_run (name, iters, [&] (std::size_t) { batch_transform (m, v.data (), r4.data (), count); });
+      snprintf (name, sizeof (name), "%s dot", simd_tier_name (tier));
+      bench_run (name, iters, [&] (std::size_t) { batch_dot (a.data (), b.data (), rd.data (), count); });
+      snprintf (name, sizeof (name), "%s norm", simd_tier_name (tier));
+      bench_run (name, iters, [&] (std::size_t) { batch_norm (a.data (), r3.data (), count); });
+      snprintf (name, sizeof (name), "%s cross", simd_tier_name (tier));
+      bench_run (name, iters, [&] (std::size_t) { batch_cross (a.data (), b.data (), r3.data (), count); });
+   }
+   do_not_optimize (r3);
+   do_not_optimize (r4);
+   do_not_optimize (rd);
+
+   return 0;
+}
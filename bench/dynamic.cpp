@@ -0,0 +1,137 @@
+#include "../math/dynamic.hpp"
+#include "bench.hpp"
+
+/* the BLAS-style kernels of matX/vecX against plain reference loops.
+ * GEMM uses every hardware-thread, pass a second argument to limit
+ * them, e.g. "dynamic_bench 1 1" for a single thread
+ */
+static void naive_gemm (const matXf &a, const matXf &b, matXf &c)
+{
+   for (std::size_t j = 0; j < c.cols (); j++) {
+      for (std::size_t i = 0; i < c.rows (); i++) {
+         float value = 0;
+         for (std::size_t k = 0; k < a.cols (); k++) {
+            value += a[k][i] * b[j][k];
+         }
+         c[j][i] = value;
+      }
+   }
+}
+
+static void naive_gemv (const matXf &a, const vecXf &x, vecXf &y)
+{
+   for (std::size_t i = 0; i < a.rows (); i++) {
+      float value = 0;
+      for (std::size_t j = 0; j < a.cols (); j++) {
+         value += a[j][i] * x[j];
+      }
+      y[i] = value;
+   }
+}
+
+static auto naive_dot (const vecXf &x, const vecXf &y) -> float
+{
+   float sum = 0;
+   for (std::size_t i = 0; i < x.size (); i++) {
+      sum += x[i] * y[i];
+   }
+   return sum;
+}
+
+static auto make_mat (std::size_t rows, std::size_t cols) -> matXf
+{
+   matXf m (rows, cols);
+   for (std::size_t j = 0; j < cols; j++) {
+      for (std::size_t i = 0; i < rows; i++) {
+         m[j][i] = float ((i * 7 + j * 3) % 11) * 0.25f;
+      }
+   }
+   return m;
+}
+
+static auto make_vec (std::size_t size) -> vecXf
+{
+   vecXf v (size);
+   for (std::size_t i = 0; i < size; i++) {
+      v[i] = float (i % 13) * 0.125f;
+   }
+   return v;
+}
+
+static void print_rate (double ns, double flops)
+{
+   printf ("%-48s %10.2f GFLOP/s\n", "", flops / ns);
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters = bench_iters (argc, argv, 1);
+   if (argc > 2) {
+      parallel_max_threads () = std::strtoul (argv[2], nullptr, 10);
+   }
+   printf ("%zu threads\n", parallel_threads ());
+
+   char name[64];
+   for (std::size_t n : { 256, 512, 1024 }) {
+      matXf a = make_mat (n, n), b = make_mat (n, n), c (n, n);
+      const double flops = 2.0 * n * n * n;
+      // the naive loops take seconds at 1024
+      if (n <= 512) {
+         snprintf (name, sizeof (name), "naive gemm %zu", n);
+         print_rate (bench_run (name, iters, [&] (std::size_t) {
+                        naive_gemm (a, b, c);
+                        do_not_optimize (c);
+                     }),
+                     flops);
+      }
+      snprintf (name, sizeof (name), "gemm %zu", n);
+      print_rate (bench_run (name, iters * 4, [&] (std::size_t) {
+                     gemm (1.0f, a, b, 0.0f, c);
+                     do_not_optimize (c);
+                  }),
+                  flops);
+   }
+
+   {
+      const std::size_t n = 4096;
+      matXf             a = make_mat (n, n);
+      vecXf             x = make_vec (n), y (n);
+      snprintf (name, sizeof (name), "naive gemv %zu", n);
+      print_rate (bench_run (name, iters * 10, [&] (std::size_t) {
+                     naive_gemv (a, x, y);
+                     do_not_optimize (y);
+                  }),
+                  2.0 * n * n);
+      snprintf (name, sizeof (name), "gemv %zu", n);
+      print_rate (bench_run (name, iters * 10, [&] (std::size_t) {
+                     gemv (1.0f, a, x, 0.0f, y);
+                     do_not_optimize (y);
+                  }),
+                  2.0 * n * n);
+   }
+
+   {
+      const std::size_t n = 1 << 16;
+      vecXf             x = make_vec (n), y = make_vec (n);
+      snprintf (name, sizeof (name), "naive axpy %zu", n);
+      print_rate (bench_run (name, iters * 1000, [&] (std::size_t) {
+                     for (std::size_t i = 0; i < n; i++) {
+                        y[i] += 0.5f * x[i];
+                     }
+                     do_not_optimize (y);
+                  }),
+                  2.0 * n);
+      snprintf (name, sizeof (name), "axpy %zu", n);
+      print_rate (bench_run (name, iters * 1000, [&] (std::size_t) {
+                     axpy (0.5f, x, y);
+                     do_not_optimize (y);
+                  }),
+                  2.0 * n);
+      snprintf (name, sizeof (name), "naive dot %zu", n);
+      print_rate (bench_run (name, iters * 1000, [&] (std::size_t) { do_not_optimize (naive_dot (x, y)); }), 2.0 * n);
+      snprintf (name, sizeof (name), "dot %zu", n);
+      print_rate (bench_run (name, iters * 1000, [&] (std::size_t) { do_not_optimize (dot (x, y)); }), 2.0 * n);
+   }
+
+   return 0;
+}
@@ -0,0 +1,48 @@
+#include <vector>
+
+#include "../math/vector.hpp"
+#include "bench.hpp"
+
+/* a * s + b * t - c over an array of vectors.
+ * built twice by meson, once with MRN_MATH_EXPR_TEMPLATES and once
+ * without, so the two runs can be compared directly
+ */
+#ifdef MRN_MATH_EXPR_TEMPLATES
+#define MODE "expr"
+#else
+#define MODE "eager"
+#endif
+
+template <std::size_t n>
+static void run (const char *name, std::size_t count, std::size_t iters)
+{
+   std::vector<vec<float, n>> a (count), b (count), c (count), r (count);
+   for (std::size_t i = 0; i < count; i++) {
+      for (std::size_t j = 0; j < n; j++) {
+         a[i][j] = i * 0.5f + j;
+         b[i][j] = 1.0f - j * 0.25f;
+         c[i][j] = i * 0.125f;
+      }
+   }
+
+   float s = 0.5f, t = 2.0f;
+   bench_run (name, iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = a[i] * s + b[i] * t - c[i];
+      }
+      do_not_optimize (r[0]);
+   });
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters = bench_iters (argc, argv, 2000);
+
+   printf ("%s: r = a * s + b * t - c\n", MODE);
+   run<3> ("vec3 (x1024)", 1024, iters);
+   run<4> ("vec4 (x1024)", 1024, iters);
+   run<16> ("vec<float, 16> (x256)", 256, iters);
+   run<256> ("vec<float, 256> (x16)", 16, iters);
+
+   return 0;
+}
@@ -0,0 +1,44 @@
+#include "../math/vector.hpp"
+
+/* compile-time benchmark for the expression templates: a lot of
+ * different expression shapes, so every one of them has to be
+ * instantiated. Only compiled, never run, see expr_compile_time.sh
+ */
+#define EXPRS(T, n)                                            \
+   {                                                           \
+      vec<T, n> a (T (1)), b (T (2)), c (T (3)), d (T (4));    \
+      vec<T, n> r = a + b;                                     \
+      r           = a * T (2) + b * T (3) - c;                 \
+      r           = (a - b) / (c + d) * T (4);                 \
+      r           = -(a * b) + c * d - a / d;                  \
+      r           = a + b + c + d + a + b + c + d;             \
+      r           = ((a * b + c) * d + a) * (b - c * d + a);   \
+      out += dot (r, a + b) + len (r - c);                     \
+   }
+
+float use_float (float out)
+{
+   EXPRS (float, 2)
+   EXPRS (float, 3)
+   EXPRS (float, 4)
+   EXPRS (float, 5)
+   EXPRS (float, 8)
+   EXPRS (float, 16)
+   return out;
+}
+
+double use_double (double out)
+{
+   EXPRS (double, 2)
+   EXPRS (double, 3)
+   EXPRS (double, 4)
+   EXPRS (double, 5)
+   EXPRS (double, 8)
+   EXPRS (double, 16)
+   return out;
+}
+
+int main ()
+{
+   return int (use_float (0) + use_double (0));
+}
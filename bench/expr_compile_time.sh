@@ -0,0 +1,15 @@
+#!/bin/sh
+# compile bench/expr_compile.cpp with and without expression templates
+# and print the time for each. Usage: expr_compile_time.sh <compiler> [flags...]
+src="$(dirname "$0")/expr_compile.cpp"
+cxx="${1:-c++}"
+[ $# -gt 0 ] && shift
+
+for mode in eager expr; do
+	def=""
+	[ "$mode" = expr ] && def="-DMRN_MATH_EXPR_TEMPLATES"
+	start=$(date +%s.%N)
+	"$cxx" -std=c++2a -O2 -Werror -Wall -Wno-error=unused-function "$@" $def -c "$src" -o /dev/null || exit 1
+	end=$(date +%s.%N)
+	awk -v m="$mode" -v s="$start" -v e="$end" 'BEGIN { printf "%-6s %.2f s\n", m ":", e - s }'
+done
@@ -0,0 +1,74 @@
+#include <vector>
+
+#include "../math/frustum.hpp"
+#include "bench.hpp"
+
+/* 2M instances on a grid around a turning camera, in grid order so that
+ * neighbours in memory are neighbours in space. The baseline tests one
+ * sphere at a time against the 6 planes
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t side  = 128;
+   const std::size_t count = side * side * side - 97152;
+   const std::size_t iters = bench_iters (argc, argv, 20);
+
+   vec4_soa           spheres (count);
+   std::vector<aabbf> box_list (count);
+   for (std::size_t i = 0; i < count; i++) {
+      const vec3 c = vec3 (float (i % side), float (i / side % side), float (i / side / side)) - vec3 (side * 0.5f);
+      spheres.set (i, vec4 (c.x, c.y, c.z, 0.5f));
+      box_list[i] = aabbf::from_center (c, vec3 (0.4f, 0.3f, 0.2f));
+   }
+   const aabb_soa boxes (box_list);
+
+   const mat4 proj = mat4::perspective (1.0472f, 1.5f, 0.1f, 100.0f);
+   auto view_frustum = [&] (std::size_t it) {
+      return frustum::from_mat (proj * mat4::rotate (vec3 (0, 1, 0), it * 0.01f));
+   };
+
+   std::vector<std::uint32_t> visible_list;
+   std::vector<std::uint8_t>  mask, cache;
+   visible_list.reserve (count);
+
+   printf ("%zu x %zu instances\n", iters, count);
+
+   bench_run ("spheres, one at a time", iters, [&] (std::size_t it) {
+      const frustum fr = view_frustum (it);
+      visible_list.clear ();
+      for (std::size_t i = 0; i < count; i++) {
+         const vec4 s = spheres.get (i);
+         if (visible (fr, vec3 (s.x, s.y, s.z), s.w)) {
+            visible_list.push_back (std::uint32_t (i));
+         }
+      }
+      do_not_optimize (visible_list.size ());
+   });
+   printf ("%zu visible\n", visible_list.size ());
+   bench_run ("cull_indices (spheres)", iters, [&] (std::size_t it) {
+      visible_list.clear ();
+      cull_indices (view_frustum (it), spheres, visible_list);
+      do_not_optimize (visible_list.size ());
+   });
+   bench_run ("cull_indices (spheres), cached", iters, [&] (std::size_t it) {
+      visible_list.clear ();
+      cull_indices (view_frustum (it), spheres, visible_list, &cache);
+      do_not_optimize (visible_list.size ());
+   });
+   bench_run ("cull_mask (spheres), cached", iters, [&] (std::size_t it) {
+      do_not_optimize (cull_mask (view_frustum (it), spheres, mask, &cache));
+   });
+   cache.clear ();
+   bench_run ("cull_indices (boxes)", iters, [&] (std::size_t it) {
+      visible_list.clear ();
+      cull_indices (view_frustum (it), boxes, visible_list);
+      do_not_optimize (visible_list.size ());
+   });
+   bench_run ("cull_indices (boxes), cached", iters, [&] (std::size_t it) {
+      visible_list.clear ();
+      cull_indices (view_frustum (it), boxes, visible_list, &cache);
+      do_not_optimize (visible_list.size ());
+   });
+
+   return 0;
+}
@@ -0,0 +1,71 @@
+#include <memory>
+
+#include "../math/matrix.hpp"
+#include "bench.hpp"
+
+/* GFLOP/s of mat * mat across sizes, the blocked kernel against the
+ * plain triple loop it replaces. The matrices are heap-allocated, a
+ * mat<double, 128, 128> is 128 KB
+ */
+template <typename T, std::size_t n>
+static void naive_mul (const mat<T, n, n> &a, const mat<T, n, n> &b, mat<T, n, n> &c)
+{
+   for (std::size_t j = 0; j < n; j++) {
+      for (std::size_t i = 0; i < n; i++) {
+         T value = {};
+         for (std::size_t k = 0; k < n; k++) {
+            value += a[k][i] * b[j][k];
+         }
+         c[j][i] = value;
+      }
+   }
+}
+
+template <typename T, std::size_t n>
+static void bench_size (const char *type, std::size_t iters)
+{
+   auto a = std::make_unique<mat<T, n, n>> ();
+   auto b = std::make_unique<mat<T, n, n>> ();
+   auto c = std::make_unique<mat<T, n, n>> ();
+   for (std::size_t j = 0; j < n; j++) {
+      for (std::size_t i = 0; i < n; i++) {
+         (*a)[j][i] = T ((i * 7 + j * 3) % 11) * T (0.25);
+         (*b)[j][i] = T ((i * 5 + j) % 13) * T (0.125);
+      }
+   }
+
+   // scale the iterations so every size does about the same work
+   iters = iters * 16 * 16 * 16 / (n * n * n) + 1;
+   const double flops = 2.0 * n * n * n;
+   char         name[64];
+
+   snprintf (name, sizeof (name), "naive %s %zux%zu", type, n, n);
+   double ns = bench_run (name, iters, [&] (std::size_t) {
+      naive_mul (*a, *b, *c);
+      do_not_optimize (*c);
+   });
+   printf ("%-48s %10.2f GFLOP/s\n", "", flops / ns);
+
+   snprintf (name, sizeof (name), "operator* %s %zux%zu", type, n, n);
+   ns = bench_run (name, iters, [&] (std::size_t) {
+      *c = *a * *b;
+      do_not_optimize (*c);
+   });
+   printf ("%-48s %10.2f GFLOP/s\n", "", flops / ns);
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters = bench_iters (argc, argv, 20000);
+
+   bench_size<float, 16> ("float", iters);
+   bench_size<float, 32> ("float", iters);
+   bench_size<float, 64> ("float", iters);
+   bench_size<float, 128> ("float", iters);
+   bench_size<double, 16> ("double", iters);
+   bench_size<double, 32> ("double", iters);
+   bench_size<double, 64> ("double", iters);
+   bench_size<double, 128> ("double", iters);
+
+   return 0;
+}
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../math/hash_grid.hpp"
+#include "bench.hpp"
+#include "meshes.hpp"
+
+/* neighbour search over 1M particles in a unit cube, with a radius that
+ * gives each about 30 neighbours and cells as large as the radius: the
+ * grid is rebuilt in place like every step of a simulation, and queried
+ * with the particles themselves, once as a batch and once as all pairs.
+ * The baseline sorts the particles by their cells with std::sort.
+ * Prints the time per step, single-threaded and with all threads.
+ * argv[2] limits the threads
+ */
+static auto make_particles (std::size_t count) -> std::vector<vec3>
+{
+   std::vector<vec3> particles (count);
+   lcg               rng (12345);
+   for (vec3 &p : particles) {
+      const float x = rng.unit (), y = rng.unit ();
+      p             = vec3 (x, y, rng.unit ());
+   }
+   return particles;
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters   = bench_iters (argc, argv, 3);
+   const std::size_t threads = argc > 2 ? std::strtoul (argv[2], nullptr, 10) : 0;
+
+   const std::size_t       n         = 1000000;
+   const std::vector<vec3> particles = make_particles (n);
+   const float             radius    = std::cbrt (30 / (4.18879f * n));
+   printf ("%zu particles, radius %.4f\n", n, radius);
+
+   hash_grid                  grid (particles, radius);
+   std::vector<std::uint32_t> counts (n);
+   auto                       report = [&] (const char *name, auto &&step) {
+      for (std::size_t t : { std::size_t (1), threads }) {
+         parallel_max_threads () = t;
+         char label[64];
+         snprintf (label, sizeof (label), "  %s, %zu threads", name, parallel_threads ());
+         const double ns = bench_run (label, iters, [&] (std::size_t) { step (); });
+         printf ("  %.2f ms\n", ns * 1e-6);
+      }
+   };
+
+   std::vector<std::pair<std::uint64_t, std::uint32_t>> sorted (n);
+   report ("std::sort by cell", [&] () {
+      for (std::size_t i = 0; i < n; i++) {
+         const vec3 c = particles[i] * (1 / radius);
+         sorted[i]    = { morton_code (std::uint64_t (c.x), std::uint64_t (c.y), std::uint64_t (c.z)), std::uint32_t (i) };
+      }
+      std::sort (sorted.begin (), sorted.end ());
+      do_not_optimize (sorted[0]);
+   });
+   report ("rebuild", [&] () {
+      grid.build (particles, radius);
+      do_not_optimize (grid);
+   });
+   report ("batched query", [&] () {
+      grid.for_each_neighbor (particles, radius, [&] (std::size_t q, std::uint32_t, float) { counts[q]++; });
+      do_not_optimize (counts[0]);
+   });
+   report ("all pairs", [&] () {
+      grid.for_each_pair (radius, [&] (std::uint32_t i, std::uint32_t, float) { counts[i]++; });
+      do_not_optimize (counts[0]);
+   });
+   report ("rebuild + all pairs", [&] () {
+      grid.build (particles, radius);
+      grid.for_each_pair (radius, [&] (std::uint32_t i, std::uint32_t, float) { counts[i]++; });
+      do_not_optimize (counts[0]);
+   });
+
+   std::fill (counts.begin (), counts.end (), 0);
+   grid.for_each_pair (radius, [&] (std::uint32_t i, std::uint32_t, float) { counts[i]++; });
+   std::size_t total = 0;
+   for (std::uint32_t c : counts) {
+      total += c;
+   }
+   printf ("  %.1f neighbours per particle\n", double (total) / n);
+
+   return 0;
+}
@@ -0,0 +1,55 @@
+#include <vector>
+
+#include "../math/hierarchy.hpp"
+#include "bench.hpp"
+
+/* a 500k-node hierarchy where 5% of the local matrices change every
+ * frame. The baseline recomputes parent * local for every node, in the
+ * order they were added. argv[2] limits the threads of update()
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t count   = 500000;
+   const std::size_t changes = count / 20;
+   const std::size_t iters   = bench_iters (argc, argv, 20);
+   if (argc > 2) {
+      parallel_max_threads () = std::strtoul (argv[2], nullptr, 10);
+   }
+
+   transform_hierarchy      h;
+   std::vector<std::size_t> parents (count);
+   std::vector<mat4>        local (count), world (count);
+   for (std::size_t i = 0; i < count; i++) {
+      // a few children per node on average, about 10 levels deep
+      parents[i] = i == 0 ? transform_hierarchy::none : (i * 2654435761u) % (i / 3 + 1);
+      local[i]   = mat4::translate (0.1f * (i % 7), 1.0f, 0.0f) * mat4::rotate (norm (vec3 (1.0f, i % 5, 2.0f)), i * 0.01f)
+                 * mat4::scale (1.0f, 1.0f + (i % 3) * 0.01f, 1.0f);
+      h.add (parents[i], local[i]);
+   }
+   h.update ();
+
+   printf ("%zu nodes, %zu changed per frame, %zu threads\n", count, changes, parallel_threads ());
+
+   bench_run ("every node, parent * local", iters, [&] (std::size_t it) {
+      for (std::size_t k = 0; k < changes; k++) {
+         const std::size_t i = (k * 40503 + it * 7) % count;
+         local[i]            = mat4::rotate (vec3 (0, 1, 0), it * 0.01f);
+      }
+      for (std::size_t i = 0; i < count; i++) {
+         world[i] = parents[i] == transform_hierarchy::none ? local[i] : world[parents[i]] * local[i];
+      }
+      do_not_optimize (world[0]);
+   });
+
+   std::size_t updated = 0;
+   bench_run ("transform_hierarchy::update", iters, [&] (std::size_t it) {
+      for (std::size_t k = 0; k < changes; k++) {
+         h.set_local ((k * 40503 + it * 7) % count, mat4::rotate (vec3 (0, 1, 0), it * 0.01f));
+      }
+      updated += h.update ();
+      do_not_optimize (h.worlds ()[0]);
+   });
+   printf ("%zu nodes recomputed per frame\n", updated / iters);
+
+   return 0;
+}
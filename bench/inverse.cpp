@@ -0,0 +1,85 @@
+#include <vector>
+
+#include "../math/transform.hpp"
+#include "bench.hpp"
+
+/* throughput of the matrix inverses, 256 matrices per call. mat4d has
+ * no SIMD-path, so it stands in for the plain cofactor-formulas
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t count = 256;
+   const std::size_t iters = bench_iters (argc, argv, 2000);
+
+   std::vector<mat4>  m (count), r (count);
+   std::vector<mat4d> md (count), rd (count);
+   std::vector<mat3>  m3 (count), r3 (count);
+   std::vector<mat2>  m2 (count), r2 (count);
+   for (std::size_t i = 0; i < count; i++) {
+      m[i] = mat4::translate (i * 0.5f, 1.0f, -2.0f) * mat4::rotate (vec3 (1, 2, 3), i * 0.01f)
+             * mat4::scale (1.0f + i * 0.01f, 2.0f, 0.5f);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t j = 0; j < 4; j++) {
+            md[i][c][j] = m[i][c][j];
+         }
+      }
+      m3[i] = mat3 ({ { 2.0f + i, 1, 0 }, { 1, 3, 1 }, { 0, 1, 4 } });
+      m2[i] = mat2 ({ { 2.0f + i, 1 }, { 1, 3 } });
+   }
+
+   printf ("%zu x %zu matrices each\n", iters, count);
+
+   bench_run ("inverse (mat4d, scalar)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         rd[i] = inverse (md[i]);
+      }
+      do_not_optimize (rd[0]);
+   });
+   bench_run ("inverse (mat4)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = inverse (m[i]);
+      }
+      do_not_optimize (r[0]);
+   });
+   bench_run ("batch_inverse (mat4)", iters, [&] (std::size_t) {
+      batch_inverse (m.data (), r.data (), count);
+      do_not_optimize (r[0]);
+   });
+   bench_run ("inverse_affine (mat4)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = inverse_affine (m[i]);
+      }
+      do_not_optimize (r[0]);
+   });
+   bench_run ("batch_inverse_affine (mat4)", iters, [&] (std::size_t) {
+      batch_inverse_affine (m.data (), r.data (), count);
+      do_not_optimize (r[0]);
+   });
+   bench_run ("inverse (mat3)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r3[i] = inverse (m3[i]);
+      }
+      do_not_optimize (r3[0]);
+   });
+   bench_run ("inverse (mat2)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r2[i] = inverse (m2[i]);
+      }
+      do_not_optimize (r2[0]);
+   });
+   bench_run ("determinant (mat4)", iters, [&] (std::size_t) {
+      float sum = 0;
+      for (std::size_t i = 0; i < count; i++) {
+         sum += determinant (m[i]);
+      }
+      do_not_optimize (sum);
+   });
+   bench_run ("transpose (mat4)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = transpose (m[i]);
+      }
+      do_not_optimize (r[0]);
+   });
+
+   return 0;
+}
@@ -0,0 +1,50 @@
+#include <vector>
+
+#include "../math/lbvh.hpp"
+#include "bench.hpp"
+#include "meshes.hpp"
+
+/* building bvhs over the same meshes as bench/bvh.cpp, about 1M
+ * triangles: linear bvhs from 30- and 63-bit Morton codes against the
+ * SAH builder. The linear bvhs are rebuilt like every frame, by the same
+ * builder into the same tree. Prints the build rate and the SAH cost of
+ * the trees, single-threaded and with all threads. argv[2] limits the
+ * threads
+ */
+static void run (const char *name, const std::vector<vec3> &vertices, std::size_t iters, std::size_t threads)
+{
+   const std::vector<aabbf> boxes = triangle_bounds (vertices);
+   printf ("%s, %zu triangles\n", name, boxes.size ());
+
+   auto report = [&] (const char *builder, auto &&build) {
+      bvh tree;
+      build (tree);
+      for (std::size_t t : { std::size_t (1), threads }) {
+         parallel_max_threads () = t;
+         char label[64];
+         snprintf (label, sizeof (label), "  %s, %zu threads", builder, parallel_threads ());
+         const double ns = bench_run (label, iters, [&] (std::size_t) {
+            build (tree);
+            do_not_optimize (tree.nodes[0]);
+         });
+         printf ("  %.1f Mtriangles/s\n", boxes.size () / ns * 1e3);
+      }
+      printf ("  %zu nodes, SAH cost %.2f\n", tree.nodes.size (), sah_cost (tree));
+   };
+   lbvh_builder<std::uint32_t> builder30;
+   lbvh_builder<std::uint64_t> builder63;
+   report ("sah", [&] (bvh &tree) { tree = bvh (boxes); });
+   report ("lbvh 30-bit", [&] (bvh &tree) { builder30.build (boxes, tree); });
+   report ("lbvh 63-bit", [&] (bvh &tree) { builder63.build (boxes, tree); });
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters   = bench_iters (argc, argv, 5);
+   const std::size_t threads = argc > 2 ? std::strtoul (argv[2], nullptr, 10) : 0;
+
+   run ("surface", make_surface (500, 1000), iters, threads);
+   run ("soup", make_soup (1000000, 0, 100, 1), iters, threads);
+
+   return 0;
+}
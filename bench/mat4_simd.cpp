@@ -0,0 +1,96 @@
+#include <vector>
+
+#include "../math/matrix.hpp"
+#include "bench.hpp"
+
+/* the generic loops of mat<T, _cols, _rows>, on plain arrays so
+ * they can't pick up the SIMD specialization
+ */
+struct naive_mat4
+{
+   float data[4][4];
+};
+
+struct naive_vec4
+{
+   float data[4];
+};
+
+static auto naive_mul (const naive_mat4 &m, const naive_vec4 &v) -> naive_vec4
+{
+   naive_vec4 result = {};
+   for (std::size_t i = 0; i < 4; i++) {
+      for (std::size_t j = 0; j < 4; j++) {
+         result.data[i] += m.data[j][i] * v.data[j];
+      }
+   }
+   return result;
+}
+
+static auto naive_mul (const naive_mat4 &m1, const naive_mat4 &m2) -> naive_mat4
+{
+   naive_mat4 result;
+   for (std::size_t i = 0; i < 4; i++) {
+      for (std::size_t j = 0; j < 4; j++) {
+         float value = {};
+         for (std::size_t k = 0; k < 4; k++) {
+            value += m1.data[k][i] * m2.data[j][k];
+         }
+         result.data[j][i] = value;
+      }
+   }
+   return result;
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t count = 256;
+   const std::size_t iters = bench_iters (argc, argv, 20000);
+
+   std::vector<mat4>       m (count);
+   std::vector<vec4>       v (count);
+   std::vector<naive_mat4> nm (count);
+   std::vector<naive_vec4> nv (count);
+   for (std::size_t i = 0; i < count; i++) {
+      m[i] = mat4::translate (i * 0.5f, 1.0f, -2.0f) * mat4::rotate (vec3 (0, 1, 0), i * 0.01f);
+      v[i] = vec4 (i * 0.1f, 2.0f, 3.0f, 1.0f);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t r = 0; r < 4; r++) {
+            nm[i].data[c][r] = m[i][c][r];
+         }
+         nv[i].data[c] = v[i][c];
+      }
+   }
+
+   printf ("%zu x %zu operations each\n", iters, count);
+
+   double naive = bench_run ("naive mat4 * vec4 (x256)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         naive_vec4 r = naive_mul (nm[i], nv[i]);
+         do_not_optimize (r);
+      }
+   });
+   double simd = bench_run ("mat4 * vec4 (x256)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         vec4 r = m[i] * v[i];
+         do_not_optimize (r);
+      }
+   });
+   printf ("speedup: %.2fx\n\n", naive / simd);
+
+   naive = bench_run ("naive mat4 * mat4 (x256)", iters, [&] (std::size_t) {
+      for (std::size_t i = 1; i < count; i++) {
+         naive_mat4 r = naive_mul (nm[i - 1], nm[i]);
+         do_not_optimize (r);
+      }
+   });
+   simd = bench_run ("mat4 * mat4 (x256)", iters, [&] (std::size_t) {
+      for (std::size_t i = 1; i < count; i++) {
+         mat4 r = m[i - 1] * m[i];
+         do_not_optimize (r);
+      }
+   });
+   printf ("speedup: %.2fx\n", naive / simd);
+
+   return 0;
+}
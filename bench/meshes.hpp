@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "../tests/meshes.hpp"
+
+/* generated meshes for the benchmarks of the bvhs and ray queries
+ */
+
+/* a closed surface, the sphere of the tests with higher bumps
+ */
+inline auto make_surface (std::size_t rings, std::size_t segments) -> std::vector<vec3>
+{
+   return make_sphere (rings, segments, 0.2f, 7, 5);
+}
+
+/* count small random triangles, with corners up to size / 2 from their
+ * centers in the cube from lo to hi
+ */
+inline auto make_soup (std::size_t count, float lo, float hi, float size) -> std::vector<vec3>
+{
+   std::vector<vec3> vertices (3 * count);
+   lcg               rng (12345);
+   for (std::size_t i = 0; i < count; i++) {
+      const float x = rng.unit (), y = rng.unit ();
+      const vec3  c = vec3 (x, y, rng.unit ()) * (hi - lo) + vec3 (lo);
+      for (std::size_t k = 0; k < 3; k++) {
+         const float dx = rng.unit (), dy = rng.unit ();
+         vertices[3 * i + k] = c + (vec3 (dx, dy, rng.unit ()) - vec3 (0.5f)) * size;
+      }
+   }
+   return vertices;
+}
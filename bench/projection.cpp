@@ -0,0 +1,51 @@
+#include <vector>
+
+#include "../math/transform.hpp"
+#include "bench.hpp"
+
+/* a 1920x1080 depth buffer back to view-space, the first step of SSAO
+ * or deferred lighting. The baseline multiplies every sample by the
+ * general inverse of the projection and divides by w
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t width = 1920, height = 1080;
+   const std::size_t iters = bench_iters (argc, argv, 20);
+
+   std::vector<float> depth (width * height);
+   for (std::size_t i = 0; i < depth.size (); i++) {
+      depth[i] = 0.5f + 0.49f * ((i * 7919) % 1000) / 1000.0f;
+   }
+   const mat4 proj = mat4::perspective (1.0472f, 16.0f / 9.0f, 0.1f, 100.0f,
+                                        projection_zero_to_one | projection_reversed_z | projection_infinite);
+   vec3_soa   out (width * height);
+
+   printf ("%zu x %zu samples\n", iters, depth.size ());
+
+   bench_run ("inverse, one at a time", iters, [&] (std::size_t) {
+      const mat4 inv = inverse (proj);
+      for (std::size_t y = 0; y < height; y++) {
+         for (std::size_t x = 0; x < width; x++) {
+            const vec4 p = inv * vec4 ((x + 0.5f) / width * 2 - 1, (y + 0.5f) / height * 2 - 1, depth[y * width + x], 1);
+            out.set (y * width + x, vec3 (p.x, p.y, p.z) / p.w);
+         }
+      }
+      do_not_optimize (out.x ()[0]);
+   });
+   bench_run ("inverse_perspective, one at a time", iters, [&] (std::size_t) {
+      const mat4 inv = inverse_perspective (proj);
+      for (std::size_t y = 0; y < height; y++) {
+         for (std::size_t x = 0; x < width; x++) {
+            const vec4 p = inv * vec4 ((x + 0.5f) / width * 2 - 1, (y + 0.5f) / height * 2 - 1, depth[y * width + x], 1);
+            out.set (y * width + x, vec3 (p.x, p.y, p.z) / p.w);
+         }
+      }
+      do_not_optimize (out.x ()[0]);
+   });
+   bench_run ("unproject_depth", iters, [&] (std::size_t) {
+      unproject_depth (proj, depth.data (), width, height, out, projection_zero_to_one);
+      do_not_optimize (out.x ()[0]);
+   });
+
+   return 0;
+}
@@ -0,0 +1,105 @@
+#include <vector>
+
+#include "../math/quaternion.hpp"
+#include "bench.hpp"
+
+/* blending rotations, 1024 per call: one at a time against the batched
+ * SoA-functions, and the old way through mat4::rotate()
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t count = 1024;
+   const std::size_t iters = bench_iters (argc, argv, 500);
+
+   std::vector<quatf> a (count), b (count), r (count);
+   std::vector<vec3>  axes (count), v (count), rv (count);
+   std::vector<float> angles (count);
+   std::vector<mat4>  m (count);
+   for (std::size_t i = 0; i < count; i++) {
+      axes[i]   = norm (vec3 (1.0f + i % 7, 2.0f - i % 5, 0.5f + i % 3));
+      angles[i] = -3.0f + (i % 61) * 0.1f;
+      a[i]      = quatf::axis_angle (axes[i], angles[i]);
+      b[i]      = quatf::axis_angle (axes[(i * 7) % count], angles[(i * 3) % count]);
+      v[i]      = vec3 (i * 0.5f, 1.0f, -2.0f);
+   }
+   std::vector<vec4> av (count), bv (count);
+   for (std::size_t i = 0; i < count; i++) {
+      av[i] = a[i].v;
+      bv[i] = b[i].v;
+   }
+   vec4_soa qa (av), qb (bv), qr (count);
+   vec3_soa va (v), vr (count);
+
+   printf ("%zu x %zu rotations each\n", iters, count);
+
+   bench_run ("mat4::rotate", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         m[i] = mat4::rotate (axes[i], angles[i]);
+      }
+      do_not_optimize (m[0]);
+   });
+   bench_run ("to_mat4 (quat)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         m[i] = to_mat4 (a[i]);
+      }
+      do_not_optimize (m[0]);
+   });
+   bench_run ("batch_to_mat4", iters, [&] (std::size_t) {
+      batch_to_mat4 (qa, m.data ());
+      do_not_optimize (m[0]);
+   });
+   bench_run ("quat * quat", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = a[i] * b[i];
+      }
+      do_not_optimize (r[0]);
+   });
+   bench_run ("batch_multiply", iters, [&] (std::size_t) {
+      batch_multiply (qa, qb, qr);
+      do_not_optimize (qr.x ()[0]);
+   });
+   bench_run ("rotate (quat, vec3)", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         rv[i] = rotate (a[i], v[i]);
+      }
+      do_not_optimize (rv[0]);
+   });
+   bench_run ("batch_rotate", iters, [&] (std::size_t) {
+      batch_rotate (qa, va, vr);
+      do_not_optimize (vr.x ()[0]);
+   });
+   bench_run ("nlerp", iters, [&] (std::size_t it) {
+      const float t = (it % 100) * 0.01f;
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = nlerp (a[i], b[i], t);
+      }
+      do_not_optimize (r[0]);
+   });
+   bench_run ("batch_nlerp", iters, [&] (std::size_t it) {
+      batch_nlerp (qa, qb, (it % 100) * 0.01f, qr);
+      do_not_optimize (qr.x ()[0]);
+   });
+   bench_run ("slerp (quatd, acos/sin)", iters, [&] (std::size_t it) {
+      const double t = (it % 100) * 0.01;
+      double       s = 0;
+      for (std::size_t i = 0; i < count; i++) {
+         quatd ad = quatd (a[i].v.x, a[i].v.y, a[i].v.z, a[i].v.w);
+         quatd bd = quatd (b[i].v.x, b[i].v.y, b[i].v.z, b[i].v.w);
+         s += slerp (ad, bd, t).v.w;
+      }
+      do_not_optimize (s);
+   });
+   bench_run ("slerp", iters, [&] (std::size_t it) {
+      const float t = (it % 100) * 0.01f;
+      for (std::size_t i = 0; i < count; i++) {
+         r[i] = slerp (a[i], b[i], t);
+      }
+      do_not_optimize (r[0]);
+   });
+   bench_run ("batch_slerp", iters, [&] (std::size_t it) {
+      batch_slerp (qa, qb, (it % 100) * 0.01f, qr);
+      do_not_optimize (qr.x ()[0]);
+   });
+
+   return 0;
+}
@@ -0,0 +1,58 @@
+#include <cmath>
+#include <vector>
+
+#include "../math/ray.hpp"
+#include "bench.hpp"
+#include "meshes.hpp"
+
+/* picking: the closest of all triangles of a mesh of 250K triangles
+ * under a few rays, without any hierarchy. One triangle at a time with
+ * Möller-Trumbore, against 8 at a time in packets, with Möller-Trumbore
+ * and with the watertight test
+ */
+static auto intersect_scalar (const std::vector<vec3> &vertices, const ray &r) -> ray_hit
+{
+   ray_hit hit;
+   ray     nearest = r;
+   for (std::size_t i = 0; i < vertices.size () / 3; i++) {
+      float t, u, v;
+      if (intersect (nearest, vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2], t, u, v)) {
+         nearest.t_max = hit.t = t;
+         hit.u                 = u;
+         hit.v                 = v;
+         hit.prim              = std::uint32_t (i);
+      }
+   }
+   return hit;
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t            iters    = bench_iters (argc, argv, 5);
+   const std::vector<vec3>      vertices = make_surface (250, 500);
+   const std::vector<triangle8> packets  = pack_triangles (vertices);
+   const std::size_t            count    = vertices.size () / 3;
+   printf ("%zu triangles\n", count);
+
+   // from a camera through a few pixels, and from inside out
+   std::vector<ray> rays;
+   for (std::size_t i = 0; i < 8; i++) {
+      rays.push_back (ray (vec3 (0.3f, 0.8f, 3.0f), vec3 (0.1f * i - 0.4f, -0.3f, -1.0f)));
+      rays.push_back (ray (vec3 (0.0f), vec3 (std::cos (0.7f * i), 0.3f, std::sin (0.7f * i))));
+   }
+
+   auto report = [&] (const char *label, auto &&pick) {
+      const double ns = bench_run (label, iters, [&] (std::size_t) {
+         for (const ray &r : rays) {
+            do_not_optimize (pick (r));
+         }
+      });
+      printf ("  %.1f Mtests/s\n", rays.size () * count / ns * 1e3);
+   };
+
+   report ("scalar", [&] (const ray &r) { return intersect_scalar (vertices, r); });
+   report ("packets", [&] (const ray &r) { return intersect (r, packets); });
+   report ("packets, watertight", [&] (const ray &r) { return intersect (watertight_ray (r), packets); });
+
+   return 0;
+}
@@ -0,0 +1,73 @@
+#include <vector>
+
+#include "../math/skinning.hpp"
+#include "bench.hpp"
+
+/* 1M vertices with 4 influences each against a 128-bone palette,
+ * positions and normals. The baseline is linear blend skinning the way
+ * it is done without a kernel: blend 4 mat4 per vertex, then transform.
+ * argv[2] limits the threads of the skinning kernels
+ */
+int main (int argc, char **argv)
+{
+   const std::size_t count = 1 << 20;
+   const std::size_t bones = 128;
+   const std::size_t iters = bench_iters (argc, argv, 5);
+   if (argc > 2) {
+      parallel_max_threads () = std::strtoul (argv[2], nullptr, 10);
+   }
+
+   std::vector<mat4>       mats (bones);
+   std::vector<dual_quatf> dqs (bones);
+   for (std::size_t i = 0; i < bones; i++) {
+      mats[i] = mat4::translate (i * 0.1f, 1.0f, -0.5f * i) * mat4::rotate (norm (vec3 (1.0f, i * 0.3f, 2.0f)), i * 0.05f);
+      dqs[i]  = dual_quatf::from_mat (mats[i]);
+   }
+
+   skin_bones b (count);
+   vec4_soa   w (count);
+   vec3_soa   pos (count), nrm (count), out_pos (count), out_nrm (count);
+   for (std::size_t i = 0; i < count; i++) {
+      b.set (i, vec4i (i % bones, (i * 7 + 1) % bones, (i * 13 + 2) % bones, (i * 31 + 3) % bones));
+      w.set (i, vec4 (0.4f, 0.3f, 0.2f, 0.1f));
+      pos.set (i, vec3 (i * 1e-6f, 1.0f, -1.0f));
+      nrm.set (i, vec3 (0.0f, 1.0f, 0.0f));
+   }
+
+   printf ("%zu vertices, %zu bones, %zu threads\n", count, bones, parallel_threads ());
+
+   bench_run ("linear blend, mat4 per vertex", iters, [&] (std::size_t) {
+      for (std::size_t i = 0; i < count; i++) {
+         const vec4i bi = b.get (i);
+         const vec4  wi = w.get (i);
+         mat4        m;
+         for (std::size_t c = 0; c < 4; c++) {
+            m[c] = mats[bi[0]][c] * wi[0] + mats[bi[1]][c] * wi[1] + mats[bi[2]][c] * wi[2] + mats[bi[3]][c] * wi[3];
+         }
+         const vec3 p = pos.get (i), n = nrm.get (i);
+         const vec4 rp = m * vec4 (p.x, p.y, p.z, 1);
+         const vec4 rn = m * vec4 (n.x, n.y, n.z, 0);
+         out_pos.set (i, vec3 (rp.x, rp.y, rp.z));
+         out_nrm.set (i, vec3 (rn.x, rn.y, rn.z));
+      }
+      do_not_optimize (out_pos.x ()[0]);
+   });
+   bench_run ("skin_linear, positions", iters, [&] (std::size_t) {
+      skin_linear (mats, b, w, pos, out_pos);
+      do_not_optimize (out_pos.x ()[0]);
+   });
+   bench_run ("skin_linear, positions and normals", iters, [&] (std::size_t) {
+      skin_linear (mats, b, w, pos, nrm, out_pos, out_nrm);
+      do_not_optimize (out_pos.x ()[0]);
+   });
+   bench_run ("dual quaternion, positions", iters, [&] (std::size_t) {
+      skin_dual_quat (dqs, b, w, pos, out_pos);
+      do_not_optimize (out_pos.x ()[0]);
+   });
+   bench_run ("dual quaternion, positions and normals", iters, [&] (std::size_t) {
+      skin_dual_quat (dqs, b, w, pos, nrm, out_pos, out_nrm);
+      do_not_optimize (out_pos.x ()[0]);
+   });
+
+   return 0;
+}
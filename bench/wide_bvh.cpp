@@ -0,0 +1,156 @@
+#include <vector>
+
+#include "../math/wide_bvh.hpp"
+#include "bench.hpp"
+#include "meshes.hpp"
+
+/* tracing rays through wide bvhs over generated meshes of 250K
+ * triangles, a bumpy surface and a soup of small random triangles:
+ * primary rays from a camera, in packets of 4 x 2 pixels, shadow rays
+ * from where they hit towards a light, and incoherent rays in random
+ * directions. The baseline is a plain stack traversal of the binary
+ * bvh, one box at a time
+ */
+static auto intersect_binary (const bvh &tree, const std::vector<vec3> &vertices, const ray &r) -> ray_hit
+{
+   ray_hit    hit;
+   ray        nearest = r;
+   const vec3 inv (1 / r.direction.x, 1 / r.direction.y, 1 / r.direction.z);
+   auto       slabs = [&] (const bvh_node &n) {
+      float t_near = nearest.t_min, t_far = nearest.t_max;
+      for (std::size_t a = 0; a < 3; a++) {
+         const float t0 = (n.min[a] - r.origin[a]) * inv[a], t1 = (n.max[a] - r.origin[a]) * inv[a];
+         t_near         = std::max (t_near, std::min (t0, t1));
+         t_far          = std::min (t_far, std::max (t0, t1));
+      }
+      return t_near <= t_far ? t_near : std::numeric_limits<float>::infinity ();
+   };
+   std::uint32_t stack[128];
+   std::size_t   top = 0;
+   stack[top++]      = 0;
+   while (top > 0) {
+      const bvh_node &n = tree.nodes[stack[--top]];
+      if (n.leaf ()) {
+         for (std::uint32_t i = n.first; i < n.first + n.count; i++) {
+            const std::uint32_t prim = tree.indices[i];
+            float               t, u, v;
+            if (intersect (nearest, vertices[3 * prim], vertices[3 * prim + 1], vertices[3 * prim + 2], t, u, v)) {
+               nearest.t_max = hit.t = t;
+               hit.u                 = u;
+               hit.v                 = v;
+               hit.prim              = prim;
+            }
+         }
+         continue;
+      }
+      const float t0 = slabs (tree.nodes[n.first]), t1 = slabs (tree.nodes[n.first + 1]);
+      const bool  swap = t1 < t0;
+      if (std::max (t0, t1) < std::numeric_limits<float>::infinity ()) {
+         stack[top++] = n.first + !swap;
+      }
+      if (std::min (t0, t1) < std::numeric_limits<float>::infinity ()) {
+         stack[top++] = n.first + swap;
+      }
+   }
+   return hit;
+}
+
+static void run (const char *name, const std::vector<vec3> &vertices, std::size_t iters)
+{
+   const bvh       tree (triangle_bounds (vertices));
+   const wide_bvh4 tree4 (tree, vertices);
+   const wide_bvh8 tree8 (tree, vertices);
+   printf ("%s, %zu triangles\n", name, vertices.size () / 3);
+
+   // a camera looking at the origin, with the packets in 4 x 2 tiles
+   const std::size_t width = 512, height = 256;
+   const vec3        eye = vec3 (0.3f, 0.8f, 3.0f), light = vec3 (4, 5, 2);
+   const mat4        inv_view = inverse_look_at (mat4::look_at (eye, vec3 (0.0f), vec3 (0, 1, 0)));
+   std::vector<ray>  primary;
+   for (std::size_t ty = 0; ty < height; ty += 2) {
+      for (std::size_t tx = 0; tx < width; tx += 4) {
+         for (std::size_t k = 0; k < 8; k++) {
+            const float x = (tx + k % 4 + 0.5f) / width * 2 - 1, y = 1 - (ty + k / 4 + 0.5f) / height * 2;
+            const vec4  d = inv_view * vec4 (x * 0.8f, y * 0.4f, -1, 0);
+            primary.push_back (ray (eye, vec3 (d.x, d.y, d.z)));
+         }
+      }
+   }
+   std::vector<ray_hit> hits (primary.size ());
+   std::vector<ray>     shadow, incoherent;
+   lcg                  rng (12345);
+   for (std::size_t i = 0; i < primary.size (); i++) {
+      hits[i]      = tree8.intersect (primary[i]);
+      const ray &r = primary[i];
+      // rays that miss become shadow rays from the origin, to keep the packets
+      const vec3 p = hits[i] ? r.origin + r.direction * (hits[i].t * 0.9999f) : vec3 (0.0f);
+      shadow.push_back (ray (p, light - p, 0, 1));
+      const vec3 from = rng.signed_vec3 ();
+      incoherent.push_back (ray (from, rng.signed_vec3 () * 0.5f));
+   }
+
+   auto report = [&] (const char *label, const std::vector<ray> &rays, auto &&trace) {
+      const double ns = bench_run (label, iters, [&] (std::size_t) {
+         for (std::size_t i = 0; i < rays.size (); i += 8) {
+            trace (&rays[i]);
+         }
+      });
+      printf ("  %.2f Mrays/s\n", rays.size () / ns * 1e3);
+   };
+   auto single = [&] (const auto &t) {
+      return [&] (const ray *r) {
+         for (std::size_t k = 0; k < 8; k++) {
+            do_not_optimize (t.intersect (r[k]));
+         }
+      };
+   };
+   auto packet = [&] (const auto &t) {
+      return [&] (const ray *r) {
+         ray_hit8 h;
+         t.intersect (ray8 (r), h);
+         do_not_optimize (h);
+      };
+   };
+   auto shadow_single = [&] (const auto &t) {
+      return [&] (const ray *r) {
+         for (std::size_t k = 0; k < 8; k++) {
+            do_not_optimize (t.occluded (r[k]));
+         }
+      };
+   };
+   auto shadow_packet = [&] (const auto &t) {
+      return [&] (const ray *r) {
+         do_not_optimize (t.occluded (ray8 (r)));
+      };
+   };
+
+   report ("  primary, binary bvh", primary, [&] (const ray *r) {
+      for (std::size_t k = 0; k < 8; k++) {
+         do_not_optimize (intersect_binary (tree, vertices, r[k]));
+      }
+   });
+   report ("  primary, wide_bvh4", primary, single (tree4));
+   report ("  primary, wide_bvh8", primary, single (tree8));
+   report ("  primary, wide_bvh4, packets", primary, packet (tree4));
+   report ("  primary, wide_bvh8, packets", primary, packet (tree8));
+   report ("  shadow, wide_bvh4", shadow, shadow_single (tree4));
+   report ("  shadow, wide_bvh8", shadow, shadow_single (tree8));
+   report ("  shadow, wide_bvh8, packets", shadow, shadow_packet (tree8));
+   report ("  incoherent, binary bvh", incoherent, [&] (const ray *r) {
+      for (std::size_t k = 0; k < 8; k++) {
+         do_not_optimize (intersect_binary (tree, vertices, r[k]));
+      }
+   });
+   report ("  incoherent, wide_bvh4", incoherent, single (tree4));
+   report ("  incoherent, wide_bvh8", incoherent, single (tree8));
+}
+
+int main (int argc, char **argv)
+{
+   const std::size_t iters = bench_iters (argc, argv, 2);
+
+   run ("surface", make_surface (250, 500), iters);
+   run ("soup", make_soup (250000, -1, 1, 0.02f), iters);
+
+   return 0;
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "affine.hpp"
+#include "packet.hpp"
+#include "soa.hpp"
+
+/* axis-aligned bounding boxes.
+ * aabb<T> is the box from min to max, both inclusive. The default box
+ * is empty, min = +inf and max = -inf, so merging anything into it gives
+ * that thing's bounds.
+ * aabb_soa holds many float boxes as SoA-streams, the batched functions
+ * below test or transform 8 of them per step in simd_float8 lanes. That
+ * is what broadphases and culling need: one query box against a lot of
+ * boxes.
+ */
+
+template <typename T>
+class aabb
+{
+ public:
+   vec<T, 3> min;
+   vec<T, 3> max;
+
+   /* empty
+    */
+   constexpr aabb ()
+   : min (std::numeric_limits<T>::infinity ()), max (-std::numeric_limits<T>::infinity ())
+   {
+   }
+
+   constexpr aabb (const vec<T, 3> &min, const vec<T, 3> &max) : min (min), max (max) {}
+
+   /* the box center +- extent
+    */
+   static constexpr auto from_center (const vec<T, 3> &center, const vec<T, 3> &extent) -> aabb
+   {
+      return aabb (center - extent, center + extent);
+   }
+};
+
+typedef aabb<float>  aabbf;
+typedef aabb<double> aabbd;
+
+/* Functions for bounding boxes
+ * ----------------------------
+ */
+template <typename T>
+constexpr auto empty (const aabb<T> &b) -> bool
+{
+   return b.min.x > b.max.x || b.min.y > b.max.y || b.min.z > b.max.z;
+}
+
+/* the smallest box around both
+ */
+template <typename T>
+constexpr auto merge (const aabb<T> &a, const aabb<T> &b) -> aabb<T>
+{
+   aabb<T> result;
+   for (std::size_t i = 0; i < 3; i++) {
+      result.min[i] = std::min (a.min[i], b.min[i]);
+      result.max[i] = std::max (a.max[i], b.max[i]);
+   }
+   return result;
+}
+
+/* the smallest box around b and the point p
+ */
+template <typename T>
+constexpr auto expand (const aabb<T> &b, const vec<T, 3> &p) -> aabb<T>
+{
+   return merge (b, aabb<T> (p, p));
+}
+
+/* b grown by margin on every side
+ */
+template <typename T>
+constexpr auto expand (const aabb<T> &b, std::type_identity_t<T> margin) -> aabb<T>
+{
+   const vec<T, 3> m = vec<T, 3> (margin);
+   return aabb<T> (b.min - m, b.max + m);
+}
+
+template <typename T>
+constexpr auto center (const aabb<T> &b) -> vec<T, 3>
+{
+   return (b.min + b.max) * T (0.5);
+}
+
+/* half the size, the box is center +- extent
+ */
+template <typename T>
+constexpr auto extent (const aabb<T> &b) -> vec<T, 3>
+{
+   return (b.max - b.min) * T (0.5);
+}
+
+/* the cost-metric of SAH-builders, 0 for an empty box
+ */
+template <typename T>
+constexpr auto surface_area (const aabb<T> &b) -> T
+{
+   if (empty (b)) {
+      return T (0);
+   }
+   const vec<T, 3> d = b.max - b.min;
+   return T (2) * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+template <typename T>
+constexpr auto contains (const aabb<T> &b, const vec<T, 3> &p) -> bool
+{
+   return b.min.x <= p.x && p.x <= b.max.x && b.min.y <= p.y && p.y <= b.max.y && b.min.z <= p.z && p.z <= b.max.z;
+}
+
+/* touching boxes overlap
+ */
+template <typename T>
+constexpr auto overlap (const aabb<T> &a, const aabb<T> &b) -> bool
+{
+   return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y && a.min.z <= b.max.z
+          && b.min.z <= a.max.z;
+}
+
+/* the bounds of the transformed box, Arvo's method in center-extent form:
+ * the center goes through m, the extent through the absolute values of
+ * its upper 3x3. b must not be empty
+ */
+template <typename T>
+constexpr auto transform (const mat<T, 4, 4> &m, const aabb<T> &b) -> aabb<T>
+{
+   const vec<T, 3> c = center (b), e = extent (b);
+   vec<T, 3>       rc, re = vec<T, 3> (T (0));
+   for (std::size_t i = 0; i < 3; i++) {
+      rc[i] = m[0][i] * c.x + m[1][i] * c.y + m[2][i] * c.z + m[3][i];
+      for (std::size_t j = 0; j < 3; j++) {
+         re[i] += (m[j][i] < 0 ? -m[j][i] : m[j][i]) * e[j];
+      }
+   }
+   return aabb<T>::from_center (rc, re);
+}
+
+template <typename T>
+constexpr auto transform (const affine3<T> &a, const aabb<T> &b) -> aabb<T>
+{
+   const vec<T, 3> c = center (b), e = extent (b);
+   vec<T, 3>       rc, re = vec<T, 3> (T (0));
+   for (std::size_t i = 0; i < 3; i++) {
+      const vec<T, 4> &r = a.row (i);
+      rc[i]              = r[0] * c.x + r[1] * c.y + r[2] * c.z + r[3];
+      for (std::size_t j = 0; j < 3; j++) {
+         re[i] += (r[j] < 0 ? -r[j] : r[j]) * e[j];
+      }
+   }
+   return aabb<T>::from_center (rc, re);
+}
+
+/* Streams of bounding boxes
+ * -------------------------
+ * the padding behind the last box is kept empty, so the batched
+ * functions run over the whole padded streams without a tail: an empty
+ * box overlaps no finite box and merges into nothing
+ */
+class aabb_soa
+{
+ public:
+   vec_soa<float, 3> min;
+   vec_soa<float, 3> max;
+
+   aabb_soa () = default;
+
+   explicit aabb_soa (std::size_t count)
+   {
+      resize (count);
+   }
+
+   aabb_soa (const std::vector<aabbf> &boxes)
+   {
+      resize (boxes.size ());
+      for (std::size_t i = 0; i < boxes.size (); i++) {
+         set (i, boxes[i]);
+      }
+   }
+
+   inline auto size () const -> std::size_t
+   {
+      return min.size ();
+   }
+
+   inline auto padded_size () const -> std::size_t
+   {
+      return min.padded_size ();
+   }
+
+   /* new boxes are empty
+    */
+   void resize (std::size_t count)
+   {
+      const std::size_t old = size ();
+      min.resize (count);
+      max.resize (count);
+      clear (count < old ? count : old);
+   }
+
+   inline void set (std::size_t i, const aabbf &b)
+   {
+      min.set (i, b.min);
+      max.set (i, b.max);
+   }
+
+   inline auto get (std::size_t i) const -> aabbf
+   {
+      return aabbf (min.get (i), max.get (i));
+   }
+
+   /* make every box from begin to the end of the padding empty
+    */
+   void clear (std::size_t begin)
+   {
+      for (std::size_t c = 0; c < 3; c++) {
+         std::fill (min.stream (c) + begin, min.stream (c) + padded_size (), std::numeric_limits<float>::infinity ());
+         std::fill (max.stream (c) + begin, max.stream (c) + padded_size (), -std::numeric_limits<float>::infinity ());
+      }
+   }
+};
+
+/* Batched bounding boxes
+ * ----------------------
+ */
+
+/* one bit per box of the 8 at i that overlap b
+ */
+inline auto overlap_bits (const aabb<simd_float8> &b, const aabb_soa &boxes, std::size_t i) -> int
+{
+   simd_mask8 m = true;
+   for (std::size_t c = 0; c < 3; c++) {
+      m = m & (simd_float8::load (boxes.min.stream (c) + i) <= b.max[c])
+          & (b.min[c] <= simd_float8::load (boxes.max.stream (c) + i));
+   }
+   return m.bits ();
+}
+
+inline auto splat (const aabbf &b) -> aabb<simd_float8>
+{
+   aabb<simd_float8> result;
+   for (std::size_t c = 0; c < 3; c++) {
+      result.min[c] = simd_float8 (b.min[c]);
+      result.max[c] = simd_float8 (b.max[c]);
+   }
+   return result;
+}
+
+/* appends the indices of the boxes that overlap b to hits, returns how
+ * many there were
+ */
+inline auto overlaps (const aabbf &b, const aabb_soa &boxes, std::vector<std::uint32_t> &hits) -> std::size_t
+{
+   const aabb<simd_float8> p     = splat (b);
+   const std::size_t       start = hits.size ();
+   for (std::size_t i = 0; i < boxes.padded_size (); i += 8) {
+      for (int bits = overlap_bits (p, boxes, i); bits; bits &= bits - 1) {
+         hits.push_back (std::uint32_t (i + std::countr_zero (unsigned (bits))));
+      }
+   }
+   return hits.size () - start;
+}
+
+/* a flat loop over the streams, the compiler vectorizes it for any
+ * instruction set
+ */
+inline auto count_overlaps (const aabbf &b, const aabb_soa &boxes) -> std::size_t
+{
+   const float *min_x = boxes.min.stream (0), *min_y = boxes.min.stream (1), *min_z = boxes.min.stream (2);
+   const float *max_x = boxes.max.stream (0), *max_y = boxes.max.stream (1), *max_z = boxes.max.stream (2);
+   const std::size_t n     = boxes.padded_size ();
+   std::size_t       count = 0;
+   for (std::size_t i = 0; i < n; i++) {
+      count += (min_x[i] <= b.max.x) & (b.min.x <= max_x[i]) & (min_y[i] <= b.max.y) & (b.min.y <= max_y[i])
+               & (min_z[i] <= b.max.z) & (b.min.z <= max_z[i]);
+   }
+   return count;
+}
+
+/* the bounds of all boxes
+ */
+inline auto bounds (const aabb_soa &boxes) -> aabbf
+{
+   aabb<simd_float8> acc = splat (aabbf ());
+   for (std::size_t i = 0; i < boxes.padded_size (); i += 8) {
+      for (std::size_t c = 0; c < 3; c++) {
+         acc.min[c] = min (acc.min[c], simd_float8::load (boxes.min.stream (c) + i));
+         acc.max[c] = max (acc.max[c], simd_float8::load (boxes.max.stream (c) + i));
+      }
+   }
+   aabbf result;
+   for (std::size_t c = 0; c < 3; c++) {
+      for (std::size_t l = 0; l < 8; l++) {
+         result.min[c] = std::min (result.min[c], acc.min[c][l]);
+         result.max[c] = std::max (result.max[c], acc.max[c][l]);
+      }
+   }
+   return result;
+}
+
+/* every box through m like transform (), out may be in. Empty boxes
+ * stay empty
+ */
+inline void transform (const mat4 &m, const aabb_soa &in, aabb_soa &out)
+{
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   simd_float8 col[4][3], abs_col[3][3];
+   for (std::size_t j = 0; j < 4; j++) {
+      for (std::size_t i = 0; i < 3; i++) {
+         col[j][i] = simd_float8 (m[j][i]);
+         if (j < 3) {
+            abs_col[j][i] = abs (col[j][i]);
+         }
+      }
+   }
+   const simd_float8 half (0.5f);
+   for (std::size_t k = 0; k < in.padded_size (); k += 8) {
+      vec3x8 c, e;
+      for (std::size_t j = 0; j < 3; j++) {
+         const simd_float8 lo = simd_float8::load (in.min.stream (j) + k);
+         const simd_float8 hi = simd_float8::load (in.max.stream (j) + k);
+         c[j]                 = (lo + hi) * half;
+         e[j]                 = (hi - lo) * half;
+      }
+      const simd_float8 zero (0.0f);
+      const simd_mask8  empty_box = (e.x < zero) | (e.y < zero) | (e.z < zero);
+      for (std::size_t i = 0; i < 3; i++) {
+         const simd_float8 rc = fmadd (col[0][i], c.x, fmadd (col[1][i], c.y, fmadd (col[2][i], c.z, col[3][i])));
+         const simd_float8 re = fmadd (abs_col[0][i], e.x, fmadd (abs_col[1][i], e.y, abs_col[2][i] * e.z));
+         select (empty_box, simd_float8 (std::numeric_limits<float>::infinity ()), rc - re)
+           .store (out.min.stream (i) + k);
+         select (empty_box, simd_float8 (-std::numeric_limits<float>::infinity ()), rc + re)
+           .store (out.max.stream (i) + k);
+      }
+   }
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <type_traits>
+
+#include "matrix.hpp"
+#include "packet.hpp"
+#include "soa.hpp"
+
+/* affine transformations as 3x4 matrices.
+ * a mat<T, 4, 4> from translate(), scale(), rotate() and their products
+ * always has (0 0 0 1) as its last row. affine3 leaves it out: 48 bytes
+ * for float instead of 64, and the products only touch the 12 elements
+ * that aren't constant, 36 multiplications for a composition instead of
+ * 64.
+ * Unlike mat it is stored by rows, 3 vec<T, 4> with the translation in
+ * w. That keeps every row an aligned SSE register (columns of 3 floats
+ * wouldn't be), and it is the layout shaders take 3x4 matrices in.
+ * a * b is still b followed by a, like mat.
+ */
+
+template <typename T>
+class affine3
+{
+ private:
+   vec<T, 4> rows[3];
+
+ public:
+   /* identity
+    */
+   constexpr affine3 ()
+   : rows {}
+   {
+      for (std::size_t i = 0; i < 3; i++) {
+         rows[i] = vec<T, 4> (T (0));
+         rows[i][i] = T (1);
+      }
+   }
+
+   constexpr affine3 (const vec<T, 4> &r0, const vec<T, 4> &r1, const vec<T, 4> &r2)
+   : rows { r0, r1, r2 }
+   {
+   }
+
+   constexpr affine3 (const mat<T, 3, 3> &linear, const vec<T, 3> &translation)
+   : rows {}
+   {
+      for (std::size_t i = 0; i < 3; i++) {
+         rows[i] = vec<T, 4> (linear[0][i], linear[1][i], linear[2][i], translation[i]);
+      }
+   }
+
+   /* the last row of m is dropped, it has to be (0 0 0 1)
+    */
+   constexpr explicit affine3 (const mat<T, 4, 4> &m)
+   : rows {}
+   {
+      for (std::size_t i = 0; i < 3; i++) {
+         rows[i] = vec<T, 4> (m[0][i], m[1][i], m[2][i], m[3][i]);
+      }
+   }
+
+   constexpr auto row (std::size_t i) -> vec<T, 4> &
+   {
+      return rows[i];
+   }
+
+   constexpr auto row (std::size_t i) const -> const vec<T, 4> &
+   {
+      return rows[i];
+   }
+
+   /* column j like mat[j], 3 is the translation
+    */
+   constexpr auto col (std::size_t j) const -> vec<T, 3>
+   {
+      return vec<T, 3> (rows[0][j], rows[1][j], rows[2][j]);
+   }
+
+   constexpr auto translation () const -> vec<T, 3>
+   {
+      return col (3);
+   }
+
+   constexpr auto linear () const -> mat<T, 3, 3>
+   {
+      mat<T, 3, 3> result;
+      for (std::size_t j = 0; j < 3; j++) {
+         result[j] = col (j);
+      }
+      return result;
+   }
+
+   constexpr auto operator*= (const affine3 &a) -> affine3 &
+   {
+      *this = *this * a;
+      return *this;
+   }
+
+   /* the same transformations as the mat-versions
+    */
+   static constexpr auto translate (const T x, const T y, const T z) -> affine3
+   {
+      affine3 result;
+      result.rows[0][3] = x;
+      result.rows[1][3] = y;
+      result.rows[2][3] = z;
+      return result;
+   }
+
+   static constexpr auto translate (const vec<T, 3> &v) -> affine3
+   {
+      return translate (v.x, v.y, v.z);
+   }
+
+   static constexpr auto scale (const T x, const T y, const T z) -> affine3
+   {
+      affine3 result;
+      result.rows[0][0] = x;
+      result.rows[1][1] = y;
+      result.rows[2][2] = z;
+      return result;
+   }
+
+   static constexpr auto scale (const vec<T, 3> &v) -> affine3
+   {
+      return scale (v.x, v.y, v.z);
+   }
+
+   static constexpr auto rotate (const vec<T, 3> axis, T rad) -> affine3
+   {
+      return affine3 (mat<T, 4, 4>::rotate (axis, rad));
+   }
+};
+
+typedef affine3<float>       affine3f;
+typedef affine3<double>      affine3d;
+typedef affine3<simd_float8> affine3x8;
+
+#ifdef MRN_SIMD_SSE2
+/* SSE kernels for affine3<float>.
+ * a row of a * b is the rows of b scaled by the elements of that row of
+ * a, plus its w: 3 multiply-adds per row
+ */
+inline auto simd_affine3_mul (__m128 a, const vec<float, 4> *b) -> __m128
+{
+   const __m128 w = _mm_and_ps (a, _mm_castsi128_ps (_mm_setr_epi32 (0, 0, 0, -1)));
+   __m128       r = simd_fmadd (simd_splat<0> (a), b[0].simd, w);
+   r              = simd_fmadd (simd_splat<1> (a), b[1].simd, r);
+   return simd_fmadd (simd_splat<2> (a), b[2].simd, r);
+}
+
+/* the columns of the inverse 3x3 are the cross products of the rows
+ * over the determinant. Transposed together with the rotated-back
+ * translation they are the rows of the result
+ */
+inline void simd_affine3_inverse (const vec<float, 4> *rows, vec<float, 4> *result)
+{
+   // the translations out of w first, the cross products only cancel
+   // them if the compiler doesn't fuse their multiply-subtracts
+   const __m128 xyz = _mm_castsi128_ps (_mm_setr_epi32 (-1, -1, -1, 0));
+   const __m128 r0  = _mm_and_ps (rows[0].simd, xyz);
+   const __m128 r1  = _mm_and_ps (rows[1].simd, xyz);
+   const __m128 r2  = _mm_and_ps (rows[2].simd, xyz);
+
+   __m128       c0  = simd_cross (r1, r2);
+   const __m128 inv = _mm_div_ps (_mm_set1_ps (1.0f), simd_dot4 (c0, r0));
+   c0               = _mm_mul_ps (c0, inv);
+   __m128 c1        = _mm_mul_ps (simd_cross (r2, r0), inv);
+   __m128 c2        = _mm_mul_ps (simd_cross (r0, r1), inv);
+
+   // the result's translation is -inverse * t
+   __m128 lo = _mm_mul_ps (c0, simd_splat<3> (rows[0].simd));
+   __m128 hi = _mm_mul_ps (c2, simd_splat<3> (rows[2].simd));
+   lo        = simd_fmadd (c1, simd_splat<3> (rows[1].simd), lo);
+   __m128 c3 = _mm_sub_ps (_mm_setzero_ps (), _mm_add_ps (lo, hi));
+
+   _MM_TRANSPOSE4_PS (c0, c1, c2, c3);
+   result[0].simd = c0;
+   result[1].simd = c1;
+   result[2].simd = c2;
+}
+#endif
+
+/* Operators for affine transformations
+ * ------------------------------------
+ * (A a) * (B b) = (A B, A b + a), 27 + 9 multiplications
+ */
+template <typename T>
+constexpr auto operator* (const affine3<T> &a, const affine3<T> &b) -> affine3<T>
+{
+   affine3<T> result;
+#ifdef MRN_SIMD_SSE2
+   if constexpr (std::is_same_v<T, float>) {
+      if (!std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 3; i++) {
+            result.row (i).simd = simd_affine3_mul (a.row (i).simd, &b.row (0));
+         }
+         return result;
+      }
+   }
+#endif
+   for (std::size_t i = 0; i < 3; i++) {
+      const vec<T, 4> &r = a.row (i);
+      for (std::size_t j = 0; j < 4; j++) {
+         result.row (i)[j] = r[0] * b.row (0)[j] + r[1] * b.row (1)[j] + r[2] * b.row (2)[j];
+      }
+      result.row (i)[3] += r[3];
+   }
+   return result;
+}
+
+/* Other functions for affine transformations
+ * ------------------------------------------
+ */
+template <typename T>
+constexpr auto transform_point (const affine3<T> &a, const vec<T, 3> &p) -> vec<T, 3>
+{
+   vec<T, 3> result;
+   for (std::size_t i = 0; i < 3; i++) {
+      const vec<T, 4> &r = a.row (i);
+      result[i]          = r[0] * p.x + r[1] * p.y + r[2] * p.z + r[3];
+   }
+   return result;
+}
+
+template <typename T>
+constexpr auto transform_vector (const affine3<T> &a, const vec<T, 3> &v) -> vec<T, 3>
+{
+   vec<T, 3> result;
+   for (std::size_t i = 0; i < 3; i++) {
+      const vec<T, 4> &r = a.row (i);
+      result[i]          = r[0] * v.x + r[1] * v.y + r[2] * v.z;
+   }
+   return result;
+}
+
+template <typename T>
+constexpr auto to_mat4 (const affine3<T> &a) -> mat<T, 4, 4>
+{
+   mat<T, 4, 4> result;
+   for (std::size_t j = 0; j < 4; j++) {
+      for (std::size_t i = 0; i < 3; i++) {
+         result[j][i] = a.row (i)[j];
+      }
+   }
+   return result;
+}
+
+template <typename T>
+constexpr auto determinant (const affine3<T> &a) -> T
+{
+   return dot (a.col (0), cross (a.col (1), a.col (2)));
+}
+
+template <typename T>
+constexpr auto inverse (const affine3<T> &a) -> affine3<T>
+{
+   affine3<T> result;
+#ifdef MRN_SIMD_SSE2
+   if constexpr (std::is_same_v<T, float>) {
+      if (!std::is_constant_evaluated ()) {
+         simd_affine3_inverse (&a.row (0), &result.row (0));
+         return result;
+      }
+   }
+#endif
+   const vec<T, 3> r0  = vec<T, 3> (a.row (0).x, a.row (0).y, a.row (0).z);
+   const vec<T, 3> r1  = vec<T, 3> (a.row (1).x, a.row (1).y, a.row (1).z);
+   const vec<T, 3> r2  = vec<T, 3> (a.row (2).x, a.row (2).y, a.row (2).z);
+   const vec<T, 3> c0  = cross (r1, r2);
+   const vec<T, 3> c1  = cross (r2, r0);
+   const vec<T, 3> c2  = cross (r0, r1);
+   const T         inv = T (1) / dot (r0, c0);
+   const vec<T, 3> t   = a.translation ();
+
+   for (std::size_t i = 0; i < 3; i++) {
+      vec<T, 4> &r = result.row (i);
+      r[0]         = c0[i] * inv;
+      r[1]         = c1[i] * inv;
+      r[2]         = c2[i] * inv;
+      r[3]         = -(r[0] * t.x + r[1] * t.y + r[2] * t.z);
+   }
+   return result;
+}
+
+/* Packets of affine transformations
+ * ---------------------------------
+ * 12 floats in a row, just like a mat<float, 4, 3>, so they go through
+ * its pack() and unpack()
+ */
+static_assert (sizeof (affine3f) == sizeof (mat<float, 4, 3>));
+static_assert (sizeof (affine3x8) == sizeof (mat<simd_float8, 4, 3>));
+
+inline auto pack (const affine3f *src) -> affine3x8
+{
+   const mat<simd_float8, 4, 3> m = pack (reinterpret_cast<const mat<float, 4, 3> *> (src));
+   const simd_float8           *e = reinterpret_cast<const simd_float8 *> (&m);
+   return affine3x8 (vec4x8 (e[0], e[1], e[2], e[3]), vec4x8 (e[4], e[5], e[6], e[7]), vec4x8 (e[8], e[9], e[10], e[11]));
+}
+
+inline void unpack (const affine3x8 &p, affine3f *dst)
+{
+   unpack (reinterpret_cast<const mat<simd_float8, 4, 3> &> (p), reinterpret_cast<mat<float, 4, 3> *> (dst));
+}
+
+/* Batched affine transformations
+ * ------------------------------
+ * count transformations from in to out, which may be the same array.
+ * With AVX 8 at a time in simd_float8 lanes, the rest (or all of them
+ * without AVX) through the SSE kernels one by one
+ */
+inline void batch_compose (const affine3f *a, const affine3f *b, affine3f *out, std::size_t count)
+{
+   std::size_t packed = 0;
+#ifdef MRN_SIMD_AVX
+   packed = count / 8 * 8;
+   for (std::size_t i = 0; i < packed; i += 8) {
+      unpack (pack (&a[i]) * pack (&b[i]), &out[i]);
+   }
+#endif
+   for (std::size_t i = packed; i < count; i++) {
+      out[i] = a[i] * b[i];
+   }
+}
+
+/* the same a in front of every b, e.g. a parent and all of its children
+ */
+inline void batch_compose (const affine3f &a, const affine3f *b, affine3f *out, std::size_t count)
+{
+   std::size_t packed = 0;
+#ifdef MRN_SIMD_AVX
+   affine3x8 pa;
+   for (std::size_t i = 0; i < 3; i++) {
+      for (std::size_t j = 0; j < 4; j++) {
+         pa.row (i)[j] = simd_float8 (a.row (i)[j]);
+      }
+   }
+   packed = count / 8 * 8;
+   for (std::size_t i = 0; i < packed; i += 8) {
+      unpack (pa * pack (&b[i]), &out[i]);
+   }
+#endif
+   for (std::size_t i = packed; i < count; i++) {
+      out[i] = a * b[i];
+   }
+}
+
+inline void batch_inverse (const affine3f *in, affine3f *out, std::size_t count)
+{
+   std::size_t packed = 0;
+#ifdef MRN_SIMD_AVX
+   packed = count / 8 * 8;
+   for (std::size_t i = 0; i < packed; i += 8) {
+      unpack (inverse (pack (&in[i])), &out[i]);
+   }
+#endif
+   for (std::size_t i = packed; i < count; i++) {
+      out[i] = inverse (in[i]);
+   }
+}
+
+/* whole SoA-streams of points and vectors, like transform.hpp
+ */
+template <typename T>
+inline void transform_points (const affine3<T> &a, const vec_soa<T, 3> &in, vec_soa<T, 3> &out)
+{
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   const vec<T, 4> r0 = a.row (0), r1 = a.row (1), r2 = a.row (2);
+   const T        *ix = in.x (), *iy = in.y (), *iz = in.z ();
+   T              *ox = out.x (), *oy = out.y (), *oz = out.z ();
+   for (std::size_t i = 0; i < in.padded_size (); i++) {
+      const T x = ix[i], y = iy[i], z = iz[i];
+      ox[i]     = r0.x * x + r0.y * y + r0.z * z + r0.w;
+      oy[i]     = r1.x * x + r1.y * y + r1.z * z + r1.w;
+      oz[i]     = r2.x * x + r2.y * y + r2.z * z + r2.w;
+   }
+}
+
+template <typename T>
+inline void transform_vectors (const affine3<T> &a, const vec_soa<T, 3> &in, vec_soa<T, 3> &out)
+{
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   const vec<T, 4> r0 = a.row (0), r1 = a.row (1), r2 = a.row (2);
+   const T        *ix = in.x (), *iy = in.y (), *iz = in.z ();
+   T              *ox = out.x (), *oy = out.y (), *oz = out.z ();
+   for (std::size_t i = 0; i < in.padded_size (); i++) {
+      const T x = ix[i], y = iy[i], z = iz[i];
+      ox[i]     = r0.x * x + r0.y * y + r0.z * z;
+      oy[i]     = r1.x * x + r1.y * y + r1.z * z;
+      oz[i]     = r2.x * x + r2.y * y + r2.z * z;
+   }
+}
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "aabb.hpp"
+#include "parallel.hpp"
+
+/* bounding volume hierarchies.
+ * a bvh is a binary tree over the boxes of primitives, usually
+ * triangles, in one array of 32-byte nodes. A node is its box and
+ * either two children, which are stored next to each other at first and
+ * first + 1, or a leaf of count primitives: indices[first] to
+ * indices[first + count - 1]. The primitives themselves are never
+ * reordered. nodes[0] is the root, an empty tree has no nodes.
+ * The builder splits every node with the surface area heuristic (SAH),
+ * evaluated at the borders of a fixed number of bins along each axis.
+ * Nodes come from a pool that is allocated once, for the worst case of
+ * 2n - 1 nodes, and handed out in pairs by an atomic counter.
+ * The top of the tree is split on the calling thread, with the large
+ * nodes binned by all threads, until there are enough independent
+ * subtrees. The threads then take those, biggest first (see
+ * parallel.hpp)
+ */
+
+struct bvh_node
+{
+   vec3          min;
+   std::uint32_t first;
+   vec3          max;
+   // 0 for an inner node
+   std::uint32_t count;
+
+   // uninitialized, so the node pool costs nothing until it is used
+   bvh_node () {}
+
+   auto bounds () const -> aabbf
+   {
+      return aabbf (min, max);
+   }
+
+   auto leaf () const -> bool
+   {
+      return count != 0;
+   }
+};
+
+static_assert (sizeof (bvh_node) == 32, "bvh nodes must fit two to a cache-line");
+
+class bvh
+{
+ public:
+   // the costs of the SAH, relative to each other
+   static constexpr float traversal_cost    = 1.0f;
+   static constexpr float intersection_cost = 1.0f;
+
+   static constexpr std::size_t bins = 16;
+
+   // nodes with more primitives than this are binned by all threads
+   static constexpr std::size_t parallel_grain = 1 << 16;
+
+   std::vector<bvh_node>      nodes;
+   std::vector<std::uint32_t> indices;
+
+   bvh () = default;
+
+   /* a tree over the boxes of the primitives, with at most max_leaf
+    * primitives per leaf. Leaves are made smaller than that if the SAH
+    * says splitting them is cheaper
+    */
+   explicit bvh (std::span<const aabbf> boxes, std::size_t max_leaf = 4)
+   {
+      assert (("Too many primitives for a bvh\n" && boxes.size () < std::numeric_limits<std::uint32_t>::max () / 2));
+      assert (("A leaf needs room for a primitive\n" && max_leaf > 0));
+      const std::size_t n = boxes.size ();
+      if (n == 0) {
+         return;
+      }
+
+      context ctx (n, max_leaf);
+      nodes.resize (2 * n - 1);
+      indices.resize (n);
+      std::iota (indices.begin (), indices.end (), std::uint32_t (0));
+
+      // the boxes into registers and the bounds of the root in one pass
+      const std::size_t chunks = (n + parallel_grain - 1) / parallel_grain;
+      std::vector<box4> partial_bounds (chunks), partial_centroids (chunks);
+      parallel_for (n, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         box4 &b = partial_bounds[begin / parallel_grain], &c = partial_centroids[begin / parallel_grain];
+         for (std::size_t i = begin; i < end; i++) {
+            box4 &p = ctx.prims[i];
+            p.min   = vec4 (boxes[i].min.x, boxes[i].min.y, boxes[i].min.z, 0);
+            p.max   = vec4 (boxes[i].max.x, boxes[i].max.y, boxes[i].max.z, 0);
+            b.grow (p);
+            const vec4 centroid = p.centroid ();
+            c.grow (centroid, centroid);
+         }
+      });
+      task root = { 0, 0, std::uint32_t (n), box4 (), box4 () };
+      for (std::size_t i = 0; i < chunks; i++) {
+         root.bounds.grow (partial_bounds[i]);
+         root.centroids.grow (partial_centroids[i]);
+      }
+
+      /* split the top on this thread, until the subtrees are small
+       * enough to keep all threads busy
+       */
+      const std::size_t threads    = parallel_threads ();
+      const std::size_t split_size = threads > 1 ? std::max (n / (4 * threads), parallel_grain / 16) : n;
+      std::vector<task> pending (1, root), subtrees;
+      bin_set           set;
+      while (!pending.empty ()) {
+         const task t = pending.back ();
+         pending.pop_back ();
+         task children[2];
+         if (t.end - t.begin <= split_size) {
+            subtrees.push_back (t);
+         } else if (split (ctx, t, set, children, true)) {
+            pending.push_back (children[0]);
+            pending.push_back (children[1]);
+         }
+      }
+      std::sort (subtrees.begin (), subtrees.end (),
+                 [] (const task &a, const task &b) { return a.end - a.begin > b.end - b.begin; });
+
+      std::atomic<std::size_t> next = 0;
+      parallel_for (std::min (threads, subtrees.size ()), 1, [&] (std::size_t, std::size_t) {
+         for (std::size_t i; (i = next++) < subtrees.size ();) {
+            build (ctx, subtrees[i]);
+         }
+      });
+      nodes.resize (ctx.used);
+   }
+
+   auto empty () const -> bool
+   {
+      return nodes.empty ();
+   }
+
+   auto bounds () const -> aabbf
+   {
+      return nodes.empty () ? aabbf () : nodes[0].bounds ();
+   }
+
+ private:
+   /* a box in two vec4, which the inner loops of the builder grow with
+    * a single SSE min and max. w is unused
+    */
+   struct box4
+   {
+      vec4 min = vec4 (std::numeric_limits<float>::infinity ());
+      vec4 max = vec4 (-std::numeric_limits<float>::infinity ());
+
+      void grow (const vec4 &lo, const vec4 &hi)
+      {
+#ifdef MRN_SIMD_SSE2
+         min.simd = _mm_min_ps (min.simd, lo.simd);
+         max.simd = _mm_max_ps (max.simd, hi.simd);
+#else
+         for (std::size_t c = 0; c < 4; c++) {
+            min[c] = std::min (min[c], lo[c]);
+            max[c] = std::max (max[c], hi[c]);
+         }
+#endif
+      }
+
+      void grow (const box4 &b)
+      {
+         grow (b.min, b.max);
+      }
+
+      auto centroid () const -> vec4
+      {
+         return (min + max) * 0.5f;
+      }
+
+      // like surface_area (), 0 for an empty box
+      auto area () const -> float
+      {
+         const vec4 d = max - min;
+         return d.x < 0 ? 0 : 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+      }
+   };
+
+   // the bins of all three axes, only the first n are used
+   struct bin_set
+   {
+      box4          bounds[3][bins];
+      std::uint32_t counts[3][bins];
+
+      void clear (std::size_t n)
+      {
+         for (std::size_t a = 0; a < 3; a++) {
+            std::fill (bounds[a], bounds[a] + n, box4 ());
+            std::fill (counts[a], counts[a] + n, 0);
+         }
+      }
+   };
+
+   // a node whose primitives are indices[begin, end)
+   struct task
+   {
+      std::uint32_t node, begin, end;
+      box4          bounds, centroids;
+   };
+
+   struct context
+   {
+      std::vector<box4>          prims;
+      std::size_t                max_leaf;
+      std::atomic<std::uint32_t> used = 1;
+
+      context (std::size_t n, std::size_t max_leaf) : prims (n), max_leaf (max_leaf) {}
+   };
+
+   /* maps the centroids of a node to n bins along all three axes at
+    * once. Small nodes get fewer bins than bins, one per primitive.
+    * Binning and partitioning both go through this, so they always
+    * agree on the side of a primitive
+    */
+   struct binning
+   {
+      std::size_t n;
+      vec4        lo, scale;
+
+      binning (const box4 &centroids, std::size_t count)
+      : n (std::min (count, bins)), lo (centroids.min), scale (0.0f)
+      {
+         for (std::size_t a = 0; a < 3; a++) {
+            // 0 also if the extent is too small to divide by
+            const float e = centroids.max[a] - centroids.min[a];
+            scale[a]      = e > 0 && n / e < std::numeric_limits<float>::infinity () ? n / e : 0;
+         }
+      }
+
+      void operator() (const vec4 &c, std::int32_t index[4]) const
+      {
+#ifdef MRN_SIMD_SSE2
+         const __m128 f = _mm_min_ps (_mm_mul_ps (_mm_sub_ps (c.simd, lo.simd), scale.simd), _mm_set1_ps (n - 1.0f));
+         _mm_storeu_si128 (reinterpret_cast<__m128i *> (index), _mm_cvttps_epi32 (f));
+#else
+         for (std::size_t a = 0; a < 4; a++) {
+            index[a] = std::int32_t (std::min ((c[a] - lo[a]) * scale[a], n - 1.0f));
+         }
+#endif
+      }
+   };
+
+   void bin_range (const context &ctx, const binning &b, std::size_t begin, std::size_t end, bin_set &result) const
+   {
+      for (std::size_t i = begin; i < end; i++) {
+         const box4  &p = ctx.prims[i];
+         std::int32_t k[4];
+         b (p.centroid (), k);
+         for (std::size_t a = 0; a < 3; a++) {
+            result.bounds[a][k[a]].grow (p);
+            result.counts[a][k[a]]++;
+         }
+      }
+   }
+
+   /* writes the node of t, and returns true with its two children if it
+    * is split, false if it's a leaf
+    */
+   auto split (context &ctx, const task &t, bin_set &set, task children[2], bool parallel) -> bool
+   {
+      bvh_node         &node  = nodes[t.node];
+      const std::size_t count = t.end - t.begin;
+      node.min                = vec3 (t.bounds.min.x, t.bounds.min.y, t.bounds.min.z);
+      node.max                = vec3 (t.bounds.max.x, t.bounds.max.y, t.bounds.max.z);
+      node.first              = t.begin;
+      node.count              = std::uint32_t (count);
+      if (count == 1) {
+         return false;
+      }
+
+      const binning b (t.centroids, count);
+      set.clear (b.n);
+      if (parallel && count > parallel_grain) {
+         std::vector<bin_set> partial ((count + parallel_grain - 1) / parallel_grain);
+         parallel_for (count, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+            bin_set &p = partial[begin / parallel_grain];
+            p.clear (b.n);
+            bin_range (ctx, b, t.begin + begin, t.begin + end, p);
+         });
+         for (const bin_set &p : partial) {
+            for (std::size_t a = 0; a < 3; a++) {
+               for (std::size_t k = 0; k < b.n; k++) {
+                  set.bounds[a][k].grow (p.bounds[a][k]);
+                  set.counts[a][k] += p.counts[a][k];
+               }
+            }
+         }
+      } else {
+         bin_range (ctx, b, t.begin, t.end, set);
+      }
+
+      /* the cost of splitting after bin k is the area times the count on
+       * either side. The right sides are summed up from the back first.
+       * The first and the last bin hold the extreme centroids, so
+       * neither side is ever empty
+       */
+      float       best      = std::numeric_limits<float>::infinity ();
+      std::size_t best_axis = 3, best_bin = 0;
+      for (std::size_t a = 0; a < 3; a++) {
+         if (b.scale[a] == 0) {
+            continue;
+         }
+         float       right_cost[bins];
+         box4        acc;
+         std::size_t n = 0;
+         for (std::size_t k = b.n - 1; k > 0; k--) {
+            acc.grow (set.bounds[a][k]);
+            n            += set.counts[a][k];
+            right_cost[k] = acc.area () * n;
+         }
+         acc = box4 ();
+         n   = 0;
+         for (std::size_t k = 0; k + 1 < b.n; k++) {
+            acc.grow (set.bounds[a][k]);
+            n               += set.counts[a][k];
+            const float cost = acc.area () * n + right_cost[k + 1];
+            if (cost < best) {
+               best      = cost;
+               best_axis = a;
+               best_bin  = k;
+            }
+         }
+      }
+
+      // flat nodes have no area, splitting them can't pay off
+      const float area       = t.bounds.area ();
+      const float split_cost = traversal_cost + intersection_cost * (area > 0 ? best / area : count);
+      if (count <= ctx.max_leaf && (best_axis == 3 || intersection_cost * count <= split_cost)) {
+         return false;
+      }
+
+      task &left = children[0], &right = children[1];
+      left = right = task {};
+      std::size_t l = t.begin, r = t.end;
+      if (best_axis < 3) {
+         // partition, and the centroid-bounds of both sides on the way
+         while (l < r) {
+            const vec4   c = ctx.prims[l].centroid ();
+            std::int32_t k[4];
+            b (c, k);
+            if (std::size_t (k[best_axis]) <= best_bin) {
+               left.centroids.grow (c, c);
+               l++;
+            } else {
+               right.centroids.grow (c, c);
+               r--;
+               std::swap (indices[l], indices[r]);
+               std::swap (ctx.prims[l], ctx.prims[r]);
+            }
+         }
+         for (std::size_t k = 0; k < b.n; k++) {
+            (k <= best_bin ? left : right).bounds.grow (set.bounds[best_axis][k]);
+         }
+      } else {
+         // all centroids in one point, any split is as good as another
+         r = t.begin + count / 2;
+         for (std::size_t i = t.begin; i < t.end; i++) {
+            task      &side = i < r ? left : right;
+            const vec4 c    = ctx.prims[i].centroid ();
+            side.bounds.grow (ctx.prims[i]);
+            side.centroids.grow (c, c);
+         }
+      }
+
+      const std::uint32_t mid   = std::uint32_t (r);
+      const std::uint32_t first = ctx.used.fetch_add (2);
+      node.first                = first;
+      node.count                = 0;
+      left.node                 = first;
+      left.begin                = t.begin;
+      left.end                  = mid;
+      right.node                = first + 1;
+      right.begin               = mid;
+      right.end                 = t.end;
+      return true;
+   }
+
+   void build (context &ctx, const task &root)
+   {
+      std::vector<task> stack (1, root);
+      bin_set           set;
+      while (!stack.empty ()) {
+         const task t = stack.back ();
+         stack.pop_back ();
+         task children[2];
+         if (split (ctx, t, set, children, false)) {
+            stack.push_back (children[1]);
+            stack.push_back (children[0]);
+         }
+      }
+   }
+};
+
+/* Primitives
+ * ----------
+ * the boxes of a triangle soup, three vertices per triangle
+ */
+inline auto triangle_bounds (std::span<const vec3> vertices) -> std::vector<aabbf>
+{
+   std::vector<aabbf> boxes (vertices.size () / 3);
+   for (std::size_t i = 0; i < boxes.size (); i++) {
+      boxes[i] = expand (expand (aabbf (vertices[3 * i], vertices[3 * i]), vertices[3 * i + 1]), vertices[3 * i + 2]);
+   }
+   return boxes;
+}
+
+/* indexed triangles, three indices per triangle
+ */
+inline auto triangle_bounds (std::span<const vec3> vertices, std::span<const std::uint32_t> indices)
+  -> std::vector<aabbf>
+{
+   std::vector<aabbf> boxes (indices.size () / 3);
+   for (std::size_t i = 0; i < boxes.size (); i++) {
+      const vec3 &a = vertices[indices[3 * i]];
+      boxes[i]      = expand (expand (aabbf (a, a), vertices[indices[3 * i + 1]]), vertices[indices[3 * i + 2]]);
+   }
+   return boxes;
+}
+
+/* Tree quality
+ * ------------
+ * the expected cost of a random ray through the root, as the SAH
+ * estimates it: every node costs its surface area relative to the root
+ * times traversal_cost, every leaf that times intersection_cost for
+ * each primitive. Lower is better
+ */
+inline auto sah_cost (const bvh &tree) -> float
+{
+   if (tree.empty ()) {
+      return 0;
+   }
+   double cost = 0;
+   for (const bvh_node &node : tree.nodes) {
+      const double area = surface_area (node.bounds ());
+      cost += node.leaf () ? area * node.count * bvh::intersection_cost : area * bvh::traversal_cost;
+   }
+   return float (cost / surface_area (tree.bounds ()));
+}
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "bvh.hpp"
+
+/* bounding volume hierarchies over deforming meshes.
+ * deforming_bvh keeps a bvh over primitives that move, like the
+ * triangles of a skinned mesh, by refitting it: the tree stays the
+ * same, and only the boxes are recomputed bottom-up from the new
+ * positions. That is a lot cheaper than a rebuild, but the tree gets
+ * worse the further the primitives move from where it was built.
+ * So the tree is cut into subtrees of about 1/64 of the primitives
+ * below a small top, and update() compares the SAH cost of every
+ * subtree to its cost right after it was built. Subtrees that got worse
+ * by more than tolerance are rebuilt with the SAH builder over their own
+ * primitives. If the whole tree is still worse than that afterwards,
+ * the top is the problem, and it is all rebuilt.
+ * The primitives below a node are always a contiguous range of indices,
+ * with both the SAH and the linear builder, so a subtree is rebuilt in
+ * its own range. Subtrees are refit in parallel, the top after them on
+ * the calling thread
+ */
+
+class deforming_bvh
+{
+ public:
+   // the subtrees are cut to about this many, and at least this big
+   static constexpr std::size_t subtree_count = 64;
+   static constexpr std::size_t subtree_min   = 256;
+
+   // how much worse than when it was built a subtree may get, 0.25 is 25%
+   float tolerance = 0.25f;
+
+   deforming_bvh () = default;
+
+   /* takes over a tree built by any builder, max_leaf is for the
+    * rebuilds
+    */
+   explicit deforming_bvh (bvh tree, std::size_t max_leaf = 4) : _tree (std::move (tree)), _max_leaf (max_leaf)
+   {
+      assert (("A leaf needs room for a primitive\n" && max_leaf > 0));
+      reset ();
+   }
+
+   explicit deforming_bvh (std::span<const aabbf> boxes, std::size_t max_leaf = 4)
+   : deforming_bvh (bvh (boxes, max_leaf), max_leaf)
+   {
+   }
+
+   auto tree () const -> const bvh &
+   {
+      return _tree;
+   }
+
+   /* the SAH cost of the tree as of the last refit, the same as
+    * sah_cost (tree ())
+    */
+   auto cost () const -> float
+   {
+      return _tree.empty () ? 0 : _cost[0] / surface_area (_tree.bounds ());
+   }
+
+   auto subtrees () const -> std::size_t
+   {
+      return _subtrees.size ();
+   }
+
+   /* the boxes of the new positions of the primitives, and nothing
+    * rebuilt
+    */
+   void refit (std::span<const aabbf> boxes)
+   {
+      refit_with ([&] (std::uint32_t prim) -> const aabbf & { return boxes[prim]; });
+   }
+
+   /* triangle soups, three vertices per triangle
+    */
+   void refit (std::span<const vec3> vertices)
+   {
+      refit_with ([&] (std::uint32_t prim) { return triangle (&vertices[3 * prim], 0, 1, 2); });
+   }
+
+   void refit (std::span<const vec3> vertices, std::span<const std::uint32_t> indices)
+   {
+      refit_with ([&] (std::uint32_t prim) {
+         return triangle (vertices.data (), indices[3 * prim], indices[3 * prim + 1], indices[3 * prim + 2]);
+      });
+   }
+
+   /* refits, and rebuilds what got too much worse. Returns the number of
+    * subtrees rebuilt, all of them if the whole tree was
+    */
+   auto update (std::span<const aabbf> boxes) -> std::size_t
+   {
+      return update_with ([&] (std::uint32_t prim) -> const aabbf & { return boxes[prim]; });
+   }
+
+   auto update (std::span<const vec3> vertices) -> std::size_t
+   {
+      return update_with ([&] (std::uint32_t prim) { return triangle (&vertices[3 * prim], 0, 1, 2); });
+   }
+
+   auto update (std::span<const vec3> vertices, std::span<const std::uint32_t> indices) -> std::size_t
+   {
+      return update_with ([&] (std::uint32_t prim) {
+         return triangle (vertices.data (), indices[3 * prim], indices[3 * prim + 1], indices[3 * prim + 2]);
+      });
+   }
+
+ private:
+   /* the nodes of a subtree are order[begin, end) in depth-first order,
+    * its primitives indices[first, last). built is its cost right after
+    * it was built, relative to the area of its root
+    */
+   struct subtree
+   {
+      std::uint32_t root, begin, end, first, last;
+      float         built;
+   };
+
+   bvh                        _tree;
+   std::size_t                _max_leaf = 4;
+   std::vector<subtree>       _subtrees;
+   // the nodes of all subtrees, and those of the top, depth-first
+   std::vector<std::uint32_t> _order, _top;
+   // the unnormalized SAH cost of each node and everything below it
+   std::vector<float>         _cost;
+   float                      _built = 0;
+
+   static auto triangle (const vec3 *v, std::uint32_t a, std::uint32_t b, std::uint32_t c) -> aabbf
+   {
+      aabbf box;
+      for (std::size_t k = 0; k < 3; k++) {
+         box.min[k] = std::min (std::min (v[a][k], v[b][k]), v[c][k]);
+         box.max[k] = std::max (std::max (v[a][k], v[b][k]), v[c][k]);
+      }
+      return box;
+   }
+
+   auto relative_cost (std::uint32_t node) const -> float
+   {
+      const float area = surface_area (_tree.nodes[node].bounds ());
+      return area > 0 ? _cost[node] / area : 0;
+   }
+
+   /* the boxes and costs of nodes, in reverse, so children come before
+    * their parents. leaf_bounds gives the box of a leaf
+    */
+   template <typename F>
+   void refit_nodes (const std::uint32_t *begin, const std::uint32_t *end, F &&leaf_bounds)
+   {
+      for (const std::uint32_t *k = end; k != begin;) {
+         bvh_node &node = _tree.nodes[*--k];
+         aabbf     box;
+         float     cost;
+         if (node.leaf ()) {
+            box  = leaf_bounds (node);
+            cost = surface_area (box) * node.count * bvh::intersection_cost;
+         } else {
+            const bvh_node &l = _tree.nodes[node.first], &r = _tree.nodes[node.first + 1];
+            for (std::size_t c = 0; c < 3; c++) {
+               box.min[c] = std::min (l.min[c], r.min[c]);
+               box.max[c] = std::max (l.max[c], r.max[c]);
+            }
+            cost = surface_area (box) * bvh::traversal_cost + _cost[node.first] + _cost[node.first + 1];
+         }
+         node.min = box.min;
+         node.max = box.max;
+         _cost[*k] = cost;
+      }
+   }
+
+   template <typename F>
+   void refit_all (F &&leaf_bounds)
+   {
+      std::atomic<std::size_t> next = 0;
+      parallel_for (std::min (parallel_threads (), _subtrees.size ()), 1, [&] (std::size_t, std::size_t) {
+         for (std::size_t i; (i = next++) < _subtrees.size ();) {
+            refit_nodes (&_order[_subtrees[i].begin], &_order[0] + _subtrees[i].end, leaf_bounds);
+         }
+      });
+      refit_nodes (_top.data (), _top.data () + _top.size (), leaf_bounds);
+   }
+
+   template <typename BoxOf>
+   void refit_with (BoxOf &&box_of)
+   {
+      refit_all ([&] (const bvh_node &leaf) {
+         aabbf box;
+         for (std::uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+            const aabbf &b = box_of (_tree.indices[i]);
+            for (std::size_t c = 0; c < 3; c++) {
+               box.min[c] = std::min (box.min[c], b.min[c]);
+               box.max[c] = std::max (box.max[c], b.max[c]);
+            }
+         }
+         return box;
+      });
+   }
+
+   template <typename BoxOf>
+   auto update_with (BoxOf &&box_of) -> std::size_t
+   {
+      refit_with (box_of);
+      std::vector<bvh> rebuilt (_subtrees.size ());
+      std::size_t      count = 0;
+      for (std::size_t i = 0; i < _subtrees.size (); i++) {
+         const subtree &s = _subtrees[i];
+         if (relative_cost (s.root) > (1 + tolerance) * s.built) {
+            // the builder uses all threads itself
+            std::vector<aabbf> boxes (s.last - s.first);
+            for (std::size_t p = 0; p < boxes.size (); p++) {
+               boxes[p] = box_of (_tree.indices[s.first + p]);
+            }
+            rebuilt[i] = bvh (boxes, _max_leaf);
+            count++;
+         }
+      }
+      if (count > 0) {
+         splice (rebuilt);
+      }
+      if (cost () > (1 + tolerance) * _built) {
+         std::vector<aabbf> boxes (_tree.indices.size ());
+         for (std::size_t p = 0; p < boxes.size (); p++) {
+            boxes[p] = box_of (std::uint32_t (p));
+         }
+         _tree = bvh (boxes, _max_leaf);
+         reset ();
+         return _subtrees.size ();
+      }
+      return count;
+   }
+
+   /* the costs of the boxes as they are, as the costs they were built with
+    */
+   void reset ()
+   {
+      partition ();
+      refit_all ([] (const bvh_node &leaf) { return leaf.bounds (); });
+      for (subtree &s : _subtrees) {
+         s.built = relative_cost (s.root);
+      }
+      _built = cost ();
+   }
+
+   /* cuts the tree into the subtrees and the top above them
+    */
+   void partition ()
+   {
+      _subtrees.clear ();
+      _order.clear ();
+      _top.clear ();
+      _cost.resize (_tree.nodes.size ());
+      if (_tree.empty ()) {
+         return;
+      }
+
+      // all nodes depth-first, and the primitives and number of nodes below them
+      const std::size_t          nodes = _tree.nodes.size ();
+      std::vector<std::uint32_t> position (nodes), first (nodes), last (nodes), size (nodes);
+      std::vector<std::uint32_t> stack (1, 0);
+      _order.reserve (nodes);
+      while (!stack.empty ()) {
+         const std::uint32_t k = stack.back ();
+         stack.pop_back ();
+         position[k] = std::uint32_t (_order.size ());
+         _order.push_back (k);
+         if (!_tree.nodes[k].leaf ()) {
+            stack.push_back (_tree.nodes[k].first + 1);
+            stack.push_back (_tree.nodes[k].first);
+         }
+      }
+      for (std::size_t i = nodes; i-- > 0;) {
+         const std::uint32_t k    = _order[i];
+         const bvh_node     &node = _tree.nodes[k];
+         if (node.leaf ()) {
+            first[k] = node.first;
+            last[k]  = node.first + node.count;
+            size[k]  = 1;
+         } else {
+            assert (("The primitives of a subtree must be contiguous\n" && last[node.first] == first[node.first + 1]));
+            first[k] = first[node.first];
+            last[k]  = last[node.first + 1];
+            size[k]  = 1 + size[node.first] + size[node.first + 1];
+         }
+      }
+
+      const std::size_t cut = std::max (_tree.indices.size () / subtree_count, subtree_min);
+      stack.assign (1, 0);
+      while (!stack.empty ()) {
+         const std::uint32_t k = stack.back ();
+         stack.pop_back ();
+         if (last[k] - first[k] <= cut || _tree.nodes[k].leaf ()) {
+            _subtrees.push_back ({ k, position[k], position[k] + size[k], first[k], last[k], 0 });
+         } else {
+            _top.push_back (k);
+            stack.push_back (_tree.nodes[k].first + 1);
+            stack.push_back (_tree.nodes[k].first);
+         }
+      }
+   }
+
+   /* lays the tree out again with the rebuilt subtrees in place of the
+    * old ones, which keeps the children of every node next to each other
+    * without holes. The cut stays the same, and so do the costs the
+    * other subtrees were built with
+    */
+   void splice (const std::vector<bvh> &rebuilt)
+   {
+      std::vector<std::pair<std::uint32_t, std::uint32_t>> roots;
+      for (std::size_t i = 0; i < _subtrees.size (); i++) {
+         roots.push_back ({ _subtrees[i].root, std::uint32_t (i) });
+      }
+      std::sort (roots.begin (), roots.end ());
+
+      /* a node of the old tree or of a rebuilt subtree, where it goes,
+       * and what to add to its primitives. Only the top is looked up
+       */
+      struct entry
+      {
+         const bvh    *source;
+         std::uint32_t from, to, offset;
+         bool          top;
+      };
+      std::vector<bvh_node> nodes (1);
+      nodes.reserve (_tree.nodes.size ());
+      std::vector<entry> stack (1, entry { &_tree, 0, 0, 0, true });
+      while (!stack.empty ()) {
+         entry e = stack.back ();
+         stack.pop_back ();
+         if (e.top) {
+            const auto it = std::lower_bound (roots.begin (), roots.end (), std::make_pair (e.from, std::uint32_t (0)));
+            if (it != roots.end () && it->first == e.from) {
+               const subtree &s = _subtrees[it->second];
+               const bvh     &b = rebuilt[it->second];
+               e.top            = false;
+               if (!b.empty ()) {
+                  e = { &b, 0, e.to, s.first, false };
+                  std::vector<std::uint32_t> old (_tree.indices.begin () + s.first, _tree.indices.begin () + s.last);
+                  for (std::size_t p = 0; p < old.size (); p++) {
+                     _tree.indices[s.first + p] = old[b.indices[p]];
+                  }
+               }
+            }
+         }
+         bvh_node node = e.source->nodes[e.from];
+         if (node.leaf ()) {
+            node.first += e.offset;
+         } else {
+            const std::uint32_t first = std::uint32_t (nodes.size ());
+            nodes.resize (first + 2);
+            stack.push_back ({ e.source, node.first + 1, first + 1, e.offset, e.top });
+            stack.push_back ({ e.source, node.first, first, e.offset, e.top });
+            node.first = first;
+         }
+         nodes[e.to] = node;
+      }
+      _tree.nodes = std::move (nodes);
+
+      std::vector<float> built (_subtrees.size ());
+      for (std::size_t i = 0; i < _subtrees.size (); i++) {
+         built[i] = _subtrees[i].built;
+      }
+      const float whole = _built;
+      reset ();
+      for (std::size_t i = 0; i < _subtrees.size (); i++) {
+         if (rebuilt[i].empty ()) {
+            _subtrees[i].built = built[i];
+         }
+      }
+      _built = whole;
+   }
+};
@@ -0,0 +1,515 @@
+#pragma once
+
+#include <cstddef>
+
+#include "matrix.hpp"
+
+/* runtime CPU dispatch for the bulk kernels.
+ * the headers themselves are compiled for whatever -m flags the user
+ * passes, but a binary that ships to different CPUs can't rely on that.
+ * So the batch functions below go through a table of function pointers,
+ * filled once with the best versions the CPU we run on supports.
+ * The SIMD versions are compiled with target-attributes, independent of
+ * the global compiler flags.
+ */
+
+#if defined(MRN_SIMD_SSE2) && defined(__GNUC__)
+#define MRN_DISPATCH_X86 1
+#define MRN_TARGET_AVX2   __attribute__ ((target ("avx2,fma")))
+#define MRN_TARGET_AVX512 __attribute__ ((target ("avx512f,avx2,fma")))
+#endif
+
+enum class simd_tier
+{
+   scalar,
+   sse2,
+   avx2,
+   avx512,
+};
+
+struct kernel_table
+{
+   // out[i] = m * in[i]
+   void (*transform) (const mat4 &m, const vec4 *in, vec4 *out, std::size_t count);
+   // out[i] = dot (a[i], b[i])
+   void (*dot) (const vec3 *a, const vec3 *b, float *out, std::size_t count);
+   // out[i] = norm (in[i])
+   void (*norm) (const vec3 *in, vec3 *out, std::size_t count);
+   // out[i] = cross (a[i], b[i])
+   void (*cross) (const vec3 *a, const vec3 *b, vec3 *out, std::size_t count);
+};
+
+/* Scalar kernels
+ * --------------
+ * reference versions, and the tails of the SIMD versions
+ */
+inline void scalar_transform (const mat4 &m, const vec4 *in, vec4 *out, std::size_t count)
+{
+   const float *c = reinterpret_cast<const float *> (&m);
+   for (std::size_t i = 0; i < count; i++) {
+      const float *v = reinterpret_cast<const float *> (&in[i]);
+      float        r[4];
+      for (std::size_t row = 0; row < 4; row++) {
+         r[row] = c[row] * v[0] + c[4 + row] * v[1] + c[8 + row] * v[2] + c[12 + row] * v[3];
+      }
+      out[i] = vec4 (r[0], r[1], r[2], r[3]);
+   }
+}
+
+inline void scalar_dot (const vec3 *a, const vec3 *b, float *out, std::size_t count)
+{
+   for (std::size_t i = 0; i < count; i++) {
+      out[i] = a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z;
+   }
+}
+
+inline void scalar_norm (const vec3 *in, vec3 *out, std::size_t count)
+{
+   for (std::size_t i = 0; i < count; i++) {
+      float length = sqrt (in[i].x * in[i].x + in[i].y * in[i].y + in[i].z * in[i].z);
+      out[i]       = vec3 (in[i].x / length, in[i].y / length, in[i].z / length);
+   }
+}
+
+inline void scalar_cross (const vec3 *a, const vec3 *b, vec3 *out, std::size_t count)
+{
+   for (std::size_t i = 0; i < count; i++) {
+      out[i] = vec3 (a[i].y * b[i].z - a[i].z * b[i].y,
+                     a[i].z * b[i].x - a[i].x * b[i].z,
+                     a[i].x * b[i].y - a[i].y * b[i].x);
+   }
+}
+
+#ifdef MRN_DISPATCH_X86
+static_assert (sizeof (vec3) == 3 * sizeof (float), "vec3 arrays must be packed floats");
+static_assert (sizeof (vec4) == 4 * sizeof (float), "vec4 arrays must be packed floats");
+
+/* split 4 packed vec3 (12 floats) into x-, y- and z-registers
+ */
+inline void simd_load3 (const float *p, __m128 &x, __m128 &y, __m128 &z)
+{
+   const __m128 a0 = _mm_loadu_ps (p);     // x0 y0 z0 x1
+   const __m128 a1 = _mm_loadu_ps (p + 4); // y1 z1 x2 y2
+   const __m128 a2 = _mm_loadu_ps (p + 8); // z2 x3 y3 z3
+   const __m128 t  = _mm_shuffle_ps (a1, a2, _MM_SHUFFLE (2, 1, 3, 2)); // x2 y2 x3 y3
+   const __m128 u  = _mm_shuffle_ps (a0, a1, _MM_SHUFFLE (1, 0, 2, 1)); // y0 z0 y1 z1
+   x               = _mm_shuffle_ps (a0, t, _MM_SHUFFLE (2, 0, 3, 0));
+   y               = _mm_shuffle_ps (u, t, _MM_SHUFFLE (3, 1, 2, 0));
+   z               = _mm_shuffle_ps (u, a2, _MM_SHUFFLE (3, 0, 3, 1));
+}
+
+/* inverse of simd_load3
+ */
+inline void simd_store3 (float *p, __m128 x, __m128 y, __m128 z)
+{
+   const __m128 xy0 = _mm_unpacklo_ps (x, y);                          // x0 y0 x1 y1
+   const __m128 xy1 = _mm_unpackhi_ps (x, y);                          // x2 y2 x3 y3
+   const __m128 m   = _mm_shuffle_ps (z, xy0, _MM_SHUFFLE (3, 2, 1, 0)); // z0 z1 x1 y1
+   const __m128 n   = _mm_shuffle_ps (z, xy1, _MM_SHUFFLE (3, 2, 3, 2)); // z2 z3 x3 y3
+   _mm_storeu_ps (p, _mm_shuffle_ps (xy0, m, _MM_SHUFFLE (2, 0, 1, 0)));
+   _mm_storeu_ps (p + 4, _mm_shuffle_ps (m, xy1, _MM_SHUFFLE (1, 0, 1, 3)));
+   _mm_storeu_ps (p + 8, _mm_shuffle_ps (n, n, _MM_SHUFFLE (1, 3, 2, 0)));
+}
+
+/* SSE2 kernels
+ * ------------
+ */
+inline void sse2_transform (const mat4 &m, const vec4 *in, vec4 *out, std::size_t count)
+{
+   const float *c  = reinterpret_cast<const float *> (&m);
+   const __m128 c0 = _mm_loadu_ps (c);
+   const __m128 c1 = _mm_loadu_ps (c + 4);
+   const __m128 c2 = _mm_loadu_ps (c + 8);
+   const __m128 c3 = _mm_loadu_ps (c + 12);
+   for (std::size_t i = 0; i < count; i++) {
+      const __m128 v  = _mm_loadu_ps (reinterpret_cast<const float *> (&in[i]));
+      const __m128 lo = _mm_add_ps (_mm_mul_ps (c0, simd_splat<0> (v)), _mm_mul_ps (c1, simd_splat<1> (v)));
+      const __m128 hi = _mm_add_ps (_mm_mul_ps (c2, simd_splat<2> (v)), _mm_mul_ps (c3, simd_splat<3> (v)));
+      _mm_storeu_ps (reinterpret_cast<float *> (&out[i]), _mm_add_ps (lo, hi));
+   }
+}
+
+inline void sse2_dot (const vec3 *a, const vec3 *b, float *out, std::size_t count)
+{
+   const float *pa = reinterpret_cast<const float *> (a);
+   const float *pb = reinterpret_cast<const float *> (b);
+   std::size_t  i  = 0;
+   for (; i + 4 <= count; i += 4) {
+      __m128 ax, ay, az, bx, by, bz;
+      simd_load3 (pa + 3 * i, ax, ay, az);
+      simd_load3 (pb + 3 * i, bx, by, bz);
+      __m128 d = _mm_mul_ps (ax, bx);
+      d        = _mm_add_ps (d, _mm_mul_ps (ay, by));
+      d        = _mm_add_ps (d, _mm_mul_ps (az, bz));
+      _mm_storeu_ps (out + i, d);
+   }
+   scalar_dot (a + i, b + i, out + i, count - i);
+}
+
+inline void sse2_norm (const vec3 *in, vec3 *out, std::size_t count)
+{
+   const float *p = reinterpret_cast<const float *> (in);
+   float *      q = reinterpret_cast<float *> (out);
+   std::size_t  i = 0;
+   for (; i + 4 <= count; i += 4) {
+      __m128 x, y, z;
+      simd_load3 (p + 3 * i, x, y, z);
+      __m128 l = _mm_add_ps (_mm_mul_ps (x, x), _mm_add_ps (_mm_mul_ps (y, y), _mm_mul_ps (z, z)));
+      l        = _mm_sqrt_ps (l);
+      simd_store3 (q + 3 * i, _mm_div_ps (x, l), _mm_div_ps (y, l), _mm_div_ps (z, l));
+   }
+   scalar_norm (in + i, out + i, count - i);
+}
+
+inline void sse2_cross (const vec3 *a, const vec3 *b, vec3 *out, std::size_t count)
+{
+   const float *pa = reinterpret_cast<const float *> (a);
+   const float *pb = reinterpret_cast<const float *> (b);
+   float *      q  = reinterpret_cast<float *> (out);
+   std::size_t  i  = 0;
+   for (; i + 4 <= count; i += 4) {
+      __m128 ax, ay, az, bx, by, bz;
+      simd_load3 (pa + 3 * i, ax, ay, az);
+      simd_load3 (pb + 3 * i, bx, by, bz);
+      simd_store3 (q + 3 * i,
+                   _mm_sub_ps (_mm_mul_ps (ay, bz), _mm_mul_ps (az, by)),
+                   _mm_sub_ps (_mm_mul_ps (az, bx), _mm_mul_ps (ax, bz)),
+                   _mm_sub_ps (_mm_mul_ps (ax, by), _mm_mul_ps (ay, bx)));
+   }
+   scalar_cross (a + i, b + i, out + i, count - i);
+}
+
+/* AVX2 kernels
+ * ------------
+ * 8 vec3 or 2 vec4 per register
+ */
+MRN_TARGET_AVX2 inline void avx2_load3 (const float *p, __m256 &x, __m256 &y, __m256 &z)
+{
+   __m128 x0, y0, z0, x1, y1, z1;
+   simd_load3 (p, x0, y0, z0);
+   simd_load3 (p + 12, x1, y1, z1);
+   x = _mm256_set_m128 (x1, x0);
+   y = _mm256_set_m128 (y1, y0);
+   z = _mm256_set_m128 (z1, z0);
+}
+
+MRN_TARGET_AVX2 inline void avx2_store3 (float *p, __m256 x, __m256 y, __m256 z)
+{
+   simd_store3 (p, _mm256_castps256_ps128 (x), _mm256_castps256_ps128 (y), _mm256_castps256_ps128 (z));
+   simd_store3 (p + 12, _mm256_extractf128_ps (x, 1), _mm256_extractf128_ps (y, 1), _mm256_extractf128_ps (z, 1));
+}
+
+MRN_TARGET_AVX2 inline void avx2_transform (const mat4 &m, const vec4 *in, vec4 *out, std::size_t count)
+{
+   const float *c  = reinterpret_cast<const float *> (&m);
+   const __m256 c0 = _mm256_broadcast_ps (reinterpret_cast<const __m128 *> (c));
+   const __m256 c1 = _mm256_broadcast_ps (reinterpret_cast<const __m128 *> (c + 4));
+   const __m256 c2 = _mm256_broadcast_ps (reinterpret_cast<const __m128 *> (c + 8));
+   const __m256 c3 = _mm256_broadcast_ps (reinterpret_cast<const __m128 *> (c + 12));
+   std::size_t  i  = 0;
+   for (; i + 2 <= count; i += 2) {
+      const __m256 v = _mm256_loadu_ps (reinterpret_cast<const float *> (&in[i]));
+      __m256       lo = _mm256_mul_ps (c0, _mm256_permute_ps (v, 0x00));
+      __m256       hi = _mm256_mul_ps (c2, _mm256_permute_ps (v, 0xaa));
+      lo              = _mm256_fmadd_ps (c1, _mm256_permute_ps (v, 0x55), lo);
+      hi              = _mm256_fmadd_ps (c3, _mm256_permute_ps (v, 0xff), hi);
+      _mm256_storeu_ps (reinterpret_cast<float *> (&out[i]), _mm256_add_ps (lo, hi));
+   }
+   scalar_transform (m, in + i, out + i, count - i);
+}
+
+MRN_TARGET_AVX2 inline void avx2_dot (const vec3 *a, const vec3 *b, float *out, std::size_t count)
+{
+   const float *pa = reinterpret_cast<const float *> (a);
+   const float *pb = reinterpret_cast<const float *> (b);
+   std::size_t  i  = 0;
+   for (; i + 8 <= count; i += 8) {
+      __m256 ax, ay, az, bx, by, bz;
+      avx2_load3 (pa + 3 * i, ax, ay, az);
+      avx2_load3 (pb + 3 * i, bx, by, bz);
+      __m256 d = _mm256_mul_ps (ax, bx);
+      d        = _mm256_fmadd_ps (ay, by, d);
+      d        = _mm256_fmadd_ps (az, bz, d);
+      _mm256_storeu_ps (out + i, d);
+   }
+   scalar_dot (a + i, b + i, out + i, count - i);
+}
+
+MRN_TARGET_AVX2 inline void avx2_norm (const vec3 *in, vec3 *out, std::size_t count)
+{
+   const float *p = reinterpret_cast<const float *> (in);
+   float *      q = reinterpret_cast<float *> (out);
+   std::size_t  i = 0;
+   for (; i + 8 <= count; i += 8) {
+      __m256 x, y, z;
+      avx2_load3 (p + 3 * i, x, y, z);
+      __m256 l = _mm256_mul_ps (x, x);
+      l        = _mm256_fmadd_ps (y, y, l);
+      l        = _mm256_fmadd_ps (z, z, l);
+      l        = _mm256_sqrt_ps (l);
+      avx2_store3 (q + 3 * i, _mm256_div_ps (x, l), _mm256_div_ps (y, l), _mm256_div_ps (z, l));
+   }
+   scalar_norm (in + i, out + i, count - i);
+}
+
+MRN_TARGET_AVX2 inline void avx2_cross (const vec3 *a, const vec3 *b, vec3 *out, std::size_t count)
+{
+   const float *pa = reinterpret_cast<const float *> (a);
+   const float *pb = reinterpret_cast<const float *> (b);
+   float *      q  = reinterpret_cast<float *> (out);
+   std::size_t  i  = 0;
+   for (; i + 8 <= count; i += 8) {
+      __m256 ax, ay, az, bx, by, bz;
+      avx2_load3 (pa + 3 * i, ax, ay, az);
+      avx2_load3 (pb + 3 * i, bx, by, bz);
+      avx2_store3 (q + 3 * i,
+                   _mm256_fmsub_ps (ay, bz, _mm256_mul_ps (az, by)),
+                   _mm256_fmsub_ps (az, bx, _mm256_mul_ps (ax, bz)),
+                   _mm256_fmsub_ps (ax, by, _mm256_mul_ps (ay, bx)));
+   }
+   scalar_cross (a + i, b + i, out + i, count - i);
+}
+
+/* AVX-512 kernels
+ * ---------------
+ * 16 vec3 or 4 vec4 per register
+ */
+// GCC 12 warns about _mm512_undefined_ps() inside its own intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+/* permute-indices for (de)interleaving 16 packed vec3 in three
+ * registers. each direction takes two two-source permutes per
+ * register, see make_avx512_lanes3
+ */
+struct avx512_lanes3
+{
+   alignas (64) int load1[3][16];
+   alignas (64) int load2[3][16];
+   alignas (64) int store1[3][16];
+   alignas (64) int store2[3][16];
+};
+
+constexpr auto make_avx512_lanes3 () -> avx512_lanes3
+{
+   avx512_lanes3 lanes = {};
+   for (int c = 0; c < 3; c++) {
+      for (int i = 0; i < 16; i++) {
+         // component c of vector i sits at float 3i+c of the 48 we load
+         const int src     = 3 * i + c;
+         lanes.load1[c][i] = src < 32 ? src : 0;
+         lanes.load2[c][i] = src < 32 ? i : 16 + src - 32;
+
+         // float i of output register c belongs to vector g/3
+         const int g        = 16 * c + i;
+         lanes.store1[c][i] = g % 3 == 1 ? 16 + g / 3 : g / 3;
+         lanes.store2[c][i] = g % 3 == 2 ? 16 + g / 3 : i;
+      }
+   }
+   return lanes;
+}
+
+inline constexpr avx512_lanes3 lanes3 = make_avx512_lanes3 ();
+
+MRN_TARGET_AVX512 inline void avx512_load3 (const float *p, __m512 &x, __m512 &y, __m512 &z)
+{
+   const __m512 r0 = _mm512_loadu_ps (p);
+   const __m512 r1 = _mm512_loadu_ps (p + 16);
+   const __m512 r2 = _mm512_loadu_ps (p + 32);
+   __m512      *out[3] = { &x, &y, &z };
+   for (int c = 0; c < 3; c++) {
+      const __m512i i1 = _mm512_load_si512 (lanes3.load1[c]);
+      const __m512i i2 = _mm512_load_si512 (lanes3.load2[c]);
+      *out[c]          = _mm512_permutex2var_ps (_mm512_permutex2var_ps (r0, i1, r1), i2, r2);
+   }
+}
+
+MRN_TARGET_AVX512 inline void avx512_store3 (float *p, __m512 x, __m512 y, __m512 z)
+{
+   for (int c = 0; c < 3; c++) {
+      const __m512i i1 = _mm512_load_si512 (lanes3.store1[c]);
+      const __m512i i2 = _mm512_load_si512 (lanes3.store2[c]);
+      _mm512_storeu_ps (p + 16 * c, _mm512_permutex2var_ps (_mm512_permutex2var_ps (x, i1, y), i2, z));
+   }
+}
+
+MRN_TARGET_AVX512 inline void avx512_transform (const mat4 &m, const vec4 *in, vec4 *out, std::size_t count)
+{
+   const float *c  = reinterpret_cast<const float *> (&m);
+   const __m512 c0 = _mm512_broadcast_f32x4 (_mm_loadu_ps (c));
+   const __m512 c1 = _mm512_broadcast_f32x4 (_mm_loadu_ps (c + 4));
+   const __m512 c2 = _mm512_broadcast_f32x4 (_mm_loadu_ps (c + 8));
+   const __m512 c3 = _mm512_broadcast_f32x4 (_mm_loadu_ps (c + 12));
+   std::size_t  i  = 0;
+   for (; i + 4 <= count; i += 4) {
+      const __m512 v  = _mm512_loadu_ps (reinterpret_cast<const float *> (&in[i]));
+      __m512       lo = _mm512_mul_ps (c0, _mm512_shuffle_ps (v, v, 0x00));
+      __m512       hi = _mm512_mul_ps (c2, _mm512_shuffle_ps (v, v, 0xaa));
+      lo              = _mm512_fmadd_ps (c1, _mm512_shuffle_ps (v, v, 0x55), lo);
+      hi              = _mm512_fmadd_ps (c3, _mm512_shuffle_ps (v, v, 0xff), hi);
+      _mm512_storeu_ps (reinterpret_cast<float *> (&out[i]), _mm512_add_ps (lo, hi));
+   }
+   avx2_transform (m, in + i, out + i, count - i);
+}
+
+MRN_TARGET_AVX512 inline void avx512_dot (const vec3 *a, const vec3 *b, float *out, std::size_t count)
+{
+   const float *pa = reinterpret_cast<const float *> (a);
+   const float *pb = reinterpret_cast<const float *> (b);
+   std::size_t  i  = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m512 ax, ay, az, bx, by, bz;
+      avx512_load3 (pa + 3 * i, ax, ay, az);
+      avx512_load3 (pb + 3 * i, bx, by, bz);
+      __m512 d = _mm512_mul_ps (ax, bx);
+      d        = _mm512_fmadd_ps (ay, by, d);
+      d        = _mm512_fmadd_ps (az, bz, d);
+      _mm512_storeu_ps (out + i, d);
+   }
+   avx2_dot (a + i, b + i, out + i, count - i);
+}
+
+MRN_TARGET_AVX512 inline void avx512_norm (const vec3 *in, vec3 *out, std::size_t count)
+{
+   const float *p = reinterpret_cast<const float *> (in);
+   float *      q = reinterpret_cast<float *> (out);
+   std::size_t  i = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m512 x, y, z;
+      avx512_load3 (p + 3 * i, x, y, z);
+      __m512 l = _mm512_mul_ps (x, x);
+      l        = _mm512_fmadd_ps (y, y, l);
+      l        = _mm512_fmadd_ps (z, z, l);
+      l        = _mm512_sqrt_ps (l);
+      avx512_store3 (q + 3 * i, _mm512_div_ps (x, l), _mm512_div_ps (y, l), _mm512_div_ps (z, l));
+   }
+   avx2_norm (in + i, out + i, count - i);
+}
+
+MRN_TARGET_AVX512 inline void avx512_cross (const vec3 *a, const vec3 *b, vec3 *out, std::size_t count)
+{
+   const float *pa = reinterpret_cast<const float *> (a);
+   const float *pb = reinterpret_cast<const float *> (b);
+   float *      q  = reinterpret_cast<float *> (out);
+   std::size_t  i  = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m512 ax, ay, az, bx, by, bz;
+      avx512_load3 (pa + 3 * i, ax, ay, az);
+      avx512_load3 (pb + 3 * i, bx, by, bz);
+      avx512_store3 (q + 3 * i,
+                     _mm512_fmsub_ps (ay, bz, _mm512_mul_ps (az, by)),
+                     _mm512_fmsub_ps (az, bx, _mm512_mul_ps (ax, bz)),
+                     _mm512_fmsub_ps (ax, by, _mm512_mul_ps (ay, bx)));
+   }
+   avx2_cross (a + i, b + i, out + i, count - i);
+}
+#pragma GCC diagnostic pop
+#endif
+
+/* Dispatch
+ * --------
+ */
+inline auto simd_tier_name (simd_tier tier) -> const char *
+{
+   switch (tier) {
+   case simd_tier::sse2:
+      return "sse2";
+   case simd_tier::avx2:
+      return "avx2";
+   case simd_tier::avx512:
+      return "avx512";
+   default:
+      return "scalar";
+   }
+}
+
+/* best tier the CPU (and OS) we are running on supports
+ */
+inline auto detect_simd_tier () -> simd_tier
+{
+#ifdef MRN_DISPATCH_X86
+   __builtin_cpu_init ();
+   if (__builtin_cpu_supports ("avx512f")) {
+      return simd_tier::avx512;
+   }
+   if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+      return simd_tier::avx2;
+   }
+   return simd_tier::sse2;
+#else
+   return simd_tier::scalar;
+#endif
+}
+
+inline auto kernels_for (simd_tier tier) -> const kernel_table &
+{
+   static const kernel_table scalar = { scalar_transform, scalar_dot, scalar_norm, scalar_cross };
+#ifdef MRN_DISPATCH_X86
+   static const kernel_table sse2   = { sse2_transform, sse2_dot, sse2_norm, sse2_cross };
+   static const kernel_table avx2   = { avx2_transform, avx2_dot, avx2_norm, avx2_cross };
+   static const kernel_table avx512 = { avx512_transform, avx512_dot, avx512_norm, avx512_cross };
+
+   switch (tier) {
+   case simd_tier::sse2:
+      return sse2;
+   case simd_tier::avx2:
+      return avx2;
+   case simd_tier::avx512:
+      return avx512;
+   default:
+      break;
+   }
+#endif
+   return scalar;
+}
+
+/* the tier in use. detection runs once, on first use
+ */
+inline auto active_simd_tier () -> simd_tier &
+{
+   static simd_tier tier = detect_simd_tier ();
+   return tier;
+}
+
+inline auto active_kernels () -> const kernel_table *&
+{
+   static const kernel_table *table = &kernels_for (active_simd_tier ());
+   return table;
+}
+
+/* force a specific tier, for testing and benchmarking.
+ * returns false (and changes nothing) if the CPU can't run it
+ */
+inline auto force_simd_tier (simd_tier tier) -> bool
+{
+   if (tier > detect_simd_tier ()) {
+      return false;
+   }
+   active_simd_tier () = tier;
+   active_kernels ()   = &kernels_for (tier);
+   return true;
+}
+
+/* Batch operations
+ * ----------------
+ * in and out may be the same array
+ */
+inline void batch_transform (const mat4 &m, const vec4 *in, vec4 *out, std::size_t count)
+{
+   active_kernels ()->transform (m, in, out, count);
+}
+
+inline void batch_dot (const vec3 *a, const vec3 *b, float *out, std::size_t count)
+{
+   active_kernels ()->dot (a, b, out, count);
+}
+
+inline void batch_norm (const vec3 *in, vec3 *out, std::size_t count)
+{
+   active_kernels ()->norm (in, out, count);
+}
+
+inline void batch_cross (const vec3 *a, const vec3 *b, vec3 *out, std::size_t count)
+{
+   active_kernels ()->cross (a, b, out, count);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "quaternion.hpp"
+
+/* dual quaternions for rigid transformations.
+ * real is the rotation, dual = 0.5 * t * real encodes the translation t
+ * that follows it. Unlike matrices they can be blended: a weighted sum
+ * of rigid transformations, normalized, is again a rigid transformation
+ * somewhere in between, which is what dual quaternion skinning is built
+ * on.
+ * 8 floats in total, so dual_quat<float> is exactly one AVX-register
+ * and dual_quat<simd_float8> 8 of them, one per lane.
+ */
+
+template <typename T>
+class dual_quat
+{
+ public:
+   quat<T> real;
+   quat<T> dual;
+
+   /* identity
+    */
+   constexpr dual_quat () : real (), dual (T (0), T (0), T (0), T (0)) {}
+
+   constexpr dual_quat (const quat<T> &real, const quat<T> &dual) : real (real), dual (dual) {}
+
+   /* the rotation r (a unit quaternion) followed by a translation by t
+    */
+   static constexpr auto rigid (const quat<T> &r, const vec<T, 3> &t) -> dual_quat
+   {
+      return dual_quat (r, quat<T> (t.x, t.y, t.z, T (0)) * r * T (0.5));
+   }
+
+   /* m must be rotation and translation only
+    */
+   static constexpr auto from_mat (const mat<T, 4, 4> &m) -> dual_quat
+   {
+      return rigid (quat<T>::from_mat (m), vec<T, 3> (m[3][0], m[3][1], m[3][2]));
+   }
+};
+
+typedef dual_quat<float>       dual_quatf;
+typedef dual_quat<double>      dual_quatd;
+typedef dual_quat<simd_float8> dual_quatx8;
+
+/* Operators for dual quaternions
+ * ------------------------------
+ * dq1 * dq2 is dq2 followed by dq1, like quaternions and matrices
+ */
+template <typename T>
+constexpr auto operator* (const dual_quat<T> &dq1, const dual_quat<T> &dq2) -> dual_quat<T>
+{
+   return dual_quat<T> (dq1.real * dq2.real, dq1.real * dq2.dual + dq1.dual * dq2.real);
+}
+
+/* for blending, see norm()
+ */
+template <typename T>
+constexpr auto operator+ (const dual_quat<T> &dq1, const dual_quat<T> &dq2) -> dual_quat<T>
+{
+   return dual_quat<T> (dq1.real + dq2.real, dq1.dual + dq2.dual);
+}
+
+template <typename T>
+constexpr auto operator* (const dual_quat<T> &dq, std::type_identity_t<T> scalar) -> dual_quat<T>
+{
+   return dual_quat<T> (dq.real * scalar, dq.dual * scalar);
+}
+
+template <typename T>
+constexpr auto operator* (std::type_identity_t<T> scalar, const dual_quat<T> &dq) -> dual_quat<T>
+{
+   return dual_quat<T> (dq.real * scalar, dq.dual * scalar);
+}
+
+/* Other functions for dual quaternions
+ * ------------------------------------
+ */
+
+/* the opposite transformation of a unit dual quaternion
+ */
+template <typename T>
+constexpr auto conjugate (const dual_quat<T> &dq) -> dual_quat<T>
+{
+   return dual_quat<T> (conjugate (dq.real), conjugate (dq.dual));
+}
+
+/* back to unit length after blending. Dividing both parts by the length
+ * of the real part is enough as long as the blended transformations are
+ * rigid themselves
+ */
+template <typename T>
+constexpr auto norm (const dual_quat<T> &dq) -> dual_quat<T>
+{
+   const T inv = T (1) / len (dq.real.v);
+   return dual_quat<T> (dq.real * inv, dq.dual * inv);
+}
+
+/* t = 2 * dual * conjugate (real), only the vector-part of the product
+ */
+template <typename T>
+constexpr auto translation (const dual_quat<T> &dq) -> vec<T, 3>
+{
+   const vec<T, 3> r = vec<T, 3> (dq.real.v.x, dq.real.v.y, dq.real.v.z);
+   const vec<T, 3> d = vec<T, 3> (dq.dual.v.x, dq.dual.v.y, dq.dual.v.z);
+   return (d * dq.real.v.w - r * dq.dual.v.w + cross (r, d)) * T (2);
+}
+
+template <typename T>
+constexpr auto transform_point (const dual_quat<T> &dq, const vec<T, 3> &p) -> vec<T, 3>
+{
+   return rotate (dq.real, p) + translation (dq);
+}
+
+template <typename T>
+constexpr auto transform_vector (const dual_quat<T> &dq, const vec<T, 3> &v) -> vec<T, 3>
+{
+   return rotate (dq.real, v);
+}
+
+template <typename T>
+constexpr auto to_mat4 (const dual_quat<T> &dq) -> mat<T, 4, 4>
+{
+   mat<T, 4, 4>    m = to_mat4 (dq.real);
+   const vec<T, 3> t = translation (dq);
+   m[3][0]           = t.x;
+   m[3][1]           = t.y;
+   m[3][2]           = t.z;
+   return m;
+}
+
+/* Packets of dual quaternions
+ * ---------------------------
+ * palette[idx[i]] into lane i. With AVX one load per dual quaternion and
+ * an 8x8 transpose
+ */
+inline auto gather (const dual_quatf *palette, const int *idx) -> dual_quatx8
+{
+   dual_quatx8  result;
+   simd_float8 *dst = reinterpret_cast<simd_float8 *> (&result);
+#ifdef MRN_SIMD_AVX
+   __m256 r[8];
+   for (std::size_t i = 0; i < 8; i++) {
+      r[i] = _mm256_loadu_ps (reinterpret_cast<const float *> (&palette[idx[i]]));
+   }
+   simd_transpose8 (r);
+   for (std::size_t c = 0; c < 8; c++) {
+      dst[c].v = r[c];
+   }
+#else
+   for (std::size_t c = 0; c < 8; c++) {
+      for (std::size_t i = 0; i < 8; i++) {
+         dst[c][i] = reinterpret_cast<const float *> (&palette[idx[i]])[c];
+      }
+   }
+#endif
+   return result;
+}
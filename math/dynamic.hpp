@@ -0,0 +1,754 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gemm.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+
+/* vectors and matrices with a size known only at runtime.
+ * vecX<T> and matX<T> keep their elements on the heap, aligned to a
+ * cache-line. matX is column-major like mat: column j starts at
+ * data () + j * ld (). The leading dimension ld is the row-count rounded
+ * up to a cache-line, so every column is aligned as well.
+ *
+ * vecX_view<T> and matX_view<T> point into elements that belong to
+ * someone else: a vecX/matX, a fixed-size vec/mat or plain memory.
+ * Slices and blocks are views too, nothing is copied. Like std::span a
+ * view of const T is read-only, and a view of T converts to one.
+ */
+
+/* Views
+ * -----
+ */
+template <typename T>
+class vecX_view
+{
+ public:
+   typedef std::remove_const_t<T> value_type;
+
+   vecX_view () = default;
+
+   /* size elements, stride apart. A row of a matrix has the stride ld
+    */
+   vecX_view (T *data, std::size_t size, std::size_t stride = 1)
+   : _data (data), _size (size), _stride (stride)
+   {
+   }
+
+   template <typename U>
+   requires std::is_same_v<const U, T>
+   vecX_view (const vecX_view<U> &v)
+   : vecX_view (v.data (), v.size (), v.stride ())
+   {
+   }
+
+   template <std::size_t n>
+   vecX_view (vec<value_type, n> &v)
+   : vecX_view (&v[0], n)
+   {
+   }
+
+   template <std::size_t n>
+   requires std::is_const_v<T>
+   vecX_view (const vec<value_type, n> &v)
+   : vecX_view (&v[0], n)
+   {
+   }
+
+   inline auto data () const -> T *
+   {
+      return _data;
+   }
+
+   inline auto size () const -> std::size_t
+   {
+      return _size;
+   }
+
+   inline auto stride () const -> std::size_t
+   {
+      return _stride;
+   }
+
+   inline auto operator[] (std::size_t idx) const -> T &
+   {
+      assert (("Index out of range\n" && idx < _size));
+      return _data[idx * _stride];
+   }
+
+   /* count elements from offset on
+    */
+   inline auto slice (std::size_t offset, std::size_t count) const -> vecX_view
+   {
+      assert (("Slice out of range\n" && offset + count <= _size));
+      return vecX_view (_data + offset * _stride, count, _stride);
+   }
+
+ private:
+   T          *_data   = nullptr;
+   std::size_t _size   = 0;
+   std::size_t _stride = 1;
+};
+
+template <typename T>
+class matX_view
+{
+ public:
+   typedef std::remove_const_t<T> value_type;
+
+   matX_view () = default;
+
+   /* column-major, ld elements from one column to the next
+    */
+   matX_view (T *data, std::size_t rows, std::size_t cols, std::size_t ld)
+   : _data (data), _rows (rows), _cols (cols), _ld (ld)
+   {
+      assert (("Leading dimension too small\n" && ld >= rows));
+   }
+
+   template <typename U>
+   requires std::is_same_v<const U, T>
+   matX_view (const matX_view<U> &m)
+   : matX_view (m.data (), m.rows (), m.cols (), m.ld ())
+   {
+   }
+
+   template <std::size_t _cols, std::size_t _rows>
+   matX_view (mat<value_type, _cols, _rows> &m)
+   : matX_view (&m[0][0], _rows, _cols, _rows)
+   {
+   }
+
+   template <std::size_t _cols, std::size_t _rows>
+   requires std::is_const_v<T>
+   matX_view (const mat<value_type, _cols, _rows> &m)
+   : matX_view (&m[0][0], _rows, _cols, _rows)
+   {
+   }
+
+   inline auto data () const -> T *
+   {
+      return _data;
+   }
+
+   inline auto rows () const -> std::size_t
+   {
+      return _rows;
+   }
+
+   inline auto cols () const -> std::size_t
+   {
+      return _cols;
+   }
+
+   inline auto ld () const -> std::size_t
+   {
+      return _ld;
+   }
+
+   /* the start of a column, so m[col][row] works like with mat
+    */
+   inline auto operator[] (std::size_t col) const -> T *
+   {
+      assert (("Column out of range\n" && col < _cols));
+      return _data + col * _ld;
+   }
+
+   inline auto col (std::size_t col) const -> vecX_view<T>
+   {
+      assert (("Column out of range\n" && col < _cols));
+      return vecX_view<T> (_data + col * _ld, _rows);
+   }
+
+   inline auto row (std::size_t row) const -> vecX_view<T>
+   {
+      assert (("Row out of range\n" && row < _rows));
+      return vecX_view<T> (_data + row, _cols, _ld);
+   }
+
+   /* rows x cols elements, starting at (row, col)
+    */
+   inline auto block (std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) const -> matX_view
+   {
+      assert (("Block out of range\n" && row + rows <= _rows && col + cols <= _cols));
+      return matX_view (_data + col * _ld + row, rows, cols, _ld);
+   }
+
+ private:
+   T          *_data = nullptr;
+   std::size_t _rows = 0;
+   std::size_t _cols = 0;
+   std::size_t _ld   = 0;
+};
+
+/* Owning types
+ * ------------
+ */
+template <typename T>
+class vecX
+{
+ public:
+   typedef T value_type;
+
+   vecX () = default;
+
+   /* zero-initialized
+    */
+   explicit vecX (std::size_t size)
+   : _data (size, T {})
+   {
+   }
+
+   vecX (std::size_t size, T val)
+   : _data (size, val)
+   {
+   }
+
+   template <std::size_t n>
+   vecX (const vec<T, n> &v)
+   : _data (&v[0], &v[0] + n)
+   {
+   }
+
+   /* copies the elements of a view
+    */
+   explicit vecX (vecX_view<const T> v)
+   : _data (v.size ())
+   {
+      for (std::size_t i = 0; i < v.size (); i++) {
+         _data[i] = v[i];
+      }
+   }
+
+   template <std::size_t n>
+   inline auto to_vec () const -> vec<T, n>
+   {
+      assert (("Size mismatch\n" && n == size ()));
+      vec<T, n> result = {};
+      for (std::size_t i = 0; i < n; i++) {
+         result[i] = _data[i];
+      }
+      return result;
+   }
+
+   inline auto size () const -> std::size_t
+   {
+      return _data.size ();
+   }
+
+   inline auto data () -> T *
+   {
+      return _data.data ();
+   }
+
+   inline auto data () const -> const T *
+   {
+      return _data.data ();
+   }
+
+   inline auto operator[] (std::size_t idx) -> T &
+   {
+      assert (("Index out of range\n" && idx < size ()));
+      return _data[idx];
+   }
+
+   inline auto operator[] (std::size_t idx) const -> const T &
+   {
+      assert (("Index out of range\n" && idx < size ()));
+      return _data[idx];
+   }
+
+   inline auto view () -> vecX_view<T>
+   {
+      return vecX_view<T> (data (), size ());
+   }
+
+   inline auto view () const -> vecX_view<const T>
+   {
+      return vecX_view<const T> (data (), size ());
+   }
+
+   inline operator vecX_view<T> ()
+   {
+      return view ();
+   }
+
+   inline operator vecX_view<const T> () const
+   {
+      return view ();
+   }
+
+   inline auto slice (std::size_t offset, std::size_t count) -> vecX_view<T>
+   {
+      return view ().slice (offset, count);
+   }
+
+   inline auto slice (std::size_t offset, std::size_t count) const -> vecX_view<const T>
+   {
+      return view ().slice (offset, count);
+   }
+
+   inline auto operator+= (vecX_view<const T> v) -> vecX &
+   {
+      assert (("Size mismatch\n" && v.size () == size ()));
+      for (std::size_t i = 0; i < size (); i++)
+         _data[i] += v[i];
+      return *this;
+   }
+
+   inline auto operator-= (vecX_view<const T> v) -> vecX &
+   {
+      assert (("Size mismatch\n" && v.size () == size ()));
+      for (std::size_t i = 0; i < size (); i++)
+         _data[i] -= v[i];
+      return *this;
+   }
+
+   inline auto operator*= (T scalar) -> vecX &
+   {
+      T *__restrict a = _data.data ();
+      for (std::size_t i = 0; i < size (); i++)
+         a[i] *= scalar;
+      return *this;
+   }
+
+   inline auto operator/= (T scalar) -> vecX &
+   {
+      T *__restrict a = _data.data ();
+      for (std::size_t i = 0; i < size (); i++)
+         a[i] /= scalar;
+      return *this;
+   }
+
+ private:
+   std::vector<T, aligned_allocator<T>> _data;
+};
+
+template <typename T>
+class matX
+{
+ public:
+   typedef T value_type;
+
+   // elements of T per cache-line, the columns are padded to it
+   static constexpr std::size_t lanes = 64 / sizeof (T) ? 64 / sizeof (T) : 1;
+
+   matX () = default;
+
+   /* zero-initialized, unlike mat there is no sensible default-size for
+    * an identity. Use matX::identity () for that
+    */
+   matX (std::size_t rows, std::size_t cols)
+   : _rows (rows), _cols (cols), _ld ((rows + lanes - 1) / lanes * lanes), _data (_ld * cols, T {})
+   {
+   }
+
+   static inline auto identity (std::size_t n) -> matX
+   {
+      matX result (n, n);
+      for (std::size_t i = 0; i < n; i++) {
+         result[i][i] = 1;
+      }
+      return result;
+   }
+
+   template <std::size_t _c, std::size_t _r>
+   matX (const mat<T, _c, _r> &m)
+   : matX (_r, _c)
+   {
+      for (std::size_t j = 0; j < _c; j++) {
+         for (std::size_t i = 0; i < _r; i++) {
+            (*this)[j][i] = m[j][i];
+         }
+      }
+   }
+
+   /* copies the elements of a view
+    */
+   explicit matX (matX_view<const T> m)
+   : matX (m.rows (), m.cols ())
+   {
+      for (std::size_t j = 0; j < _cols; j++) {
+         for (std::size_t i = 0; i < _rows; i++) {
+            (*this)[j][i] = m[j][i];
+         }
+      }
+   }
+
+   template <std::size_t _c, std::size_t _r>
+   inline auto to_mat () const -> mat<T, _c, _r>
+   {
+      assert (("Size mismatch\n" && _c == _cols && _r == _rows));
+      mat<T, _c, _r> result;
+      for (std::size_t j = 0; j < _c; j++) {
+         for (std::size_t i = 0; i < _r; i++) {
+            result[j][i] = (*this)[j][i];
+         }
+      }
+      return result;
+   }
+
+   inline auto rows () const -> std::size_t
+   {
+      return _rows;
+   }
+
+   inline auto cols () const -> std::size_t
+   {
+      return _cols;
+   }
+
+   inline auto ld () const -> std::size_t
+   {
+      return _ld;
+   }
+
+   inline auto data () -> T *
+   {
+      return _data.data ();
+   }
+
+   inline auto data () const -> const T *
+   {
+      return _data.data ();
+   }
+
+   /* the start of a column, so m[col][row] works like with mat
+    */
+   inline auto operator[] (std::size_t col) -> T *
+   {
+      assert (("Column out of range\n" && col < _cols));
+      return _data.data () + col * _ld;
+   }
+
+   inline auto operator[] (std::size_t col) const -> const T *
+   {
+      assert (("Column out of range\n" && col < _cols));
+      return _data.data () + col * _ld;
+   }
+
+   inline auto view () -> matX_view<T>
+   {
+      return matX_view<T> (data (), _rows, _cols, _ld);
+   }
+
+   inline auto view () const -> matX_view<const T>
+   {
+      return matX_view<const T> (data (), _rows, _cols, _ld);
+   }
+
+   inline operator matX_view<T> ()
+   {
+      return view ();
+   }
+
+   inline operator matX_view<const T> () const
+   {
+      return view ();
+   }
+
+   inline auto col (std::size_t col) -> vecX_view<T>
+   {
+      return view ().col (col);
+   }
+
+   inline auto col (std::size_t col) const -> vecX_view<const T>
+   {
+      return view ().col (col);
+   }
+
+   inline auto row (std::size_t row) -> vecX_view<T>
+   {
+      return view ().row (row);
+   }
+
+   inline auto row (std::size_t row) const -> vecX_view<const T>
+   {
+      return view ().row (row);
+   }
+
+   inline auto block (std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) -> matX_view<T>
+   {
+      return view ().block (row, col, rows, cols);
+   }
+
+   inline auto block (std::size_t row, std::size_t col, std::size_t rows, std::size_t cols) const
+      -> matX_view<const T>
+   {
+      return view ().block (row, col, rows, cols);
+   }
+
+ private:
+   std::size_t                          _rows = 0;
+   std::size_t                          _cols = 0;
+   std::size_t                          _ld   = 0;
+   std::vector<T, aligned_allocator<T>> _data;
+};
+
+typedef vecX<float>  vecXf;
+typedef vecX<double> vecXd;
+typedef matX<float>  matXf;
+typedef matX<double> matXd;
+
+/* Kernels
+ * -------
+ * BLAS-style, T is deduced from alpha only, so vecX/matX, views and
+ * fixed-size vec/mat can all be passed where a view is expected. The
+ * output must not overlap the inputs.
+ */
+template <typename T>
+using vecX_of = vecX_view<std::type_identity_t<T>>;
+
+template <typename T>
+using matX_of = matX_view<std::type_identity_t<T>>;
+
+/* x . y, on raw strided arrays
+ */
+template <typename T>
+inline auto dot_kernel (std::size_t n, const T *x, std::size_t sx, const T *y, std::size_t sy) -> T
+{
+   std::size_t i   = 0;
+   T           sum = 0;
+   if constexpr (gemm_lanes<T>::width != 0) {
+      typedef gemm_lanes<T>       lanes;
+      typedef typename lanes::reg reg;
+      constexpr std::size_t       w = lanes::width;
+
+      if (sx == 1 && sy == 1) {
+         // four independent sums, so the adds don't wait on each other
+         reg acc[4] = { lanes::zero (), lanes::zero (), lanes::zero (), lanes::zero () };
+         for (; i + 4 * w <= n; i += 4 * w) {
+            for (std::size_t l = 0; l < 4; l++) {
+               acc[l] = lanes::fmadd (lanes::load (x + i + l * w), lanes::load (y + i + l * w), acc[l]);
+            }
+         }
+         T part[w];
+         lanes::store (part, lanes::add (lanes::add (acc[0], acc[1]), lanes::add (acc[2], acc[3])));
+         for (std::size_t l = 0; l < w; l++) {
+            sum += part[l];
+         }
+      }
+   }
+   for (; i < n; i++) {
+      sum += x[i * sx] * y[i * sy];
+   }
+   return sum;
+}
+
+template <typename T>
+inline auto dot (vecX_view<T> x, vecX_view<T> y) -> std::remove_const_t<T>
+{
+   assert (("Size mismatch\n" && x.size () == y.size ()));
+   return dot_kernel<std::remove_const_t<T>> (x.size (), x.data (), x.stride (), y.data (), y.stride ());
+}
+
+template <typename T>
+inline auto dot (const vecX<T> &x, const vecX<T> &y) -> T
+{
+   return dot (x.view (), y.view ());
+}
+
+/* y += alpha * x
+ */
+template <typename T>
+inline void axpy (T alpha, vecX_of<const T> x, vecX_of<T> y)
+{
+   assert (("Size mismatch\n" && x.size () == y.size ()));
+   const std::size_t n = x.size ();
+   if (x.stride () == 1 && y.stride () == 1) {
+      const T *__restrict xp = x.data ();
+      T *__restrict yp       = y.data ();
+      for (std::size_t i = 0; i < n; i++)
+         yp[i] += alpha * xp[i];
+   } else {
+      for (std::size_t i = 0; i < n; i++)
+         y[i] += alpha * x[i];
+   }
+}
+
+/* y = beta * y, beta = 0 clears y even if it holds nan
+ */
+template <typename T>
+inline void scale (T beta, vecX_of<T> y)
+{
+   for (std::size_t i = 0; i < y.size (); i++) {
+      y[i] = beta == 0 ? T (0) : beta * y[i];
+   }
+}
+
+/* y = alpha * A * x + beta * y
+ * A is walked down its columns, four at a time, and y is kept in L1 by
+ * going over the rows in blocks
+ */
+template <typename T>
+inline void gemv (T alpha, matX_of<const T> a, vecX_of<const T> x, std::type_identity_t<T> beta, vecX_of<T> y)
+{
+   assert (("Size mismatch\n" && a.cols () == x.size () && a.rows () == y.size ()));
+   const std::size_t m = a.rows (), n = a.cols ();
+   if (beta != 1) {
+      scale (beta, y);
+   }
+   if (y.stride () != 1) {
+      for (std::size_t j = 0; j < n; j++) {
+         axpy (alpha * x[j], a.col (j), y);
+      }
+      return;
+   }
+
+   constexpr std::size_t block = 4096 / sizeof (T);
+   for (std::size_t ib = 0; ib < m; ib += block) {
+      const std::size_t mb = m - ib < block ? m - ib : block;
+      T *__restrict yp     = y.data () + ib;
+      std::size_t j        = 0;
+      for (; j + 4 <= n; j += 4) {
+         const T *a0 = a[j] + ib, *a1 = a[j + 1] + ib, *a2 = a[j + 2] + ib, *a3 = a[j + 3] + ib;
+         const T  x0 = alpha * x[j], x1 = alpha * x[j + 1], x2 = alpha * x[j + 2], x3 = alpha * x[j + 3];
+         for (std::size_t i = 0; i < mb; i++)
+            yp[i] += a0[i] * x0 + a1[i] * x1 + a2[i] * x2 + a3[i] * x3;
+      }
+      for (; j < n; j++) {
+         const T *aj = a[j] + ib;
+         const T  xj = alpha * x[j];
+         for (std::size_t i = 0; i < mb; i++)
+            yp[i] += aj[i] * xj;
+      }
+   }
+}
+
+/* C = alpha * A * B + beta * C
+ * the blocked kernel from gemm.hpp. The columns of C are independent, so
+ * they are split between the threads, each with enough of them to be
+ * worth a thread
+ */
+template <typename T>
+inline void gemm (T alpha, matX_of<const T> a, matX_of<const T> b, std::type_identity_t<T> beta, matX_of<T> c)
+{
+   assert (("Size mismatch\n" && a.cols () == b.rows () && a.rows () == c.rows () && b.cols () == c.cols ()));
+   const std::size_t m = a.rows (), n = b.cols (), k = a.cols ();
+   const std::size_t nr = gemm_blocking<T>::nr;
+
+   // about a million multiply-adds per thread at least
+   const std::size_t per_col = m * k > 0 ? m * k : 1;
+   std::size_t       grain   = ((std::size_t (1) << 20) / per_col + nr - 1) / nr * nr;
+   grain                     = grain < nr ? nr : grain;
+
+   parallel_for (n, grain, [&] (std::size_t begin, std::size_t end) {
+      for (std::size_t j = begin; j < end; j++) {
+         if (beta != 1) {
+            scale (beta, c.col (j));
+         }
+      }
+      gemm_accumulate (m, end - begin, k, alpha, a.data (), a.ld (), b[begin], b.ld (), c[begin], c.ld ());
+   });
+}
+
+/* Operators
+ * ---------
+ */
+/* a temporary operand is reused for the result, so a + b + c allocates
+ * once
+ */
+template <typename T>
+inline auto operator+ (const vecX<T> &v1, const vecX<T> &v2) -> vecX<T>
+{
+   vecX<T> result = v1;
+   result += v2;
+   return result;
+}
+
+template <typename T>
+inline auto operator+ (vecX<T> &&v1, const vecX<T> &v2) -> vecX<T>
+{
+   return std::move (v1 += v2);
+}
+
+template <typename T>
+inline auto operator+ (const vecX<T> &v1, vecX<T> &&v2) -> vecX<T>
+{
+   return std::move (v2 += v1);
+}
+
+template <typename T>
+inline auto operator+ (vecX<T> &&v1, vecX<T> &&v2) -> vecX<T>
+{
+   return std::move (v1 += v2);
+}
+
+template <typename T>
+inline auto operator- (const vecX<T> &v1, const vecX<T> &v2) -> vecX<T>
+{
+   vecX<T> result = v1;
+   result -= v2;
+   return result;
+}
+
+template <typename T>
+inline auto operator- (vecX<T> &&v1, const vecX<T> &v2) -> vecX<T>
+{
+   return std::move (v1 -= v2);
+}
+
+template <typename T>
+inline auto operator* (const vecX<T> &v, std::type_identity_t<T> scalar) -> vecX<T>
+{
+   vecX<T> result = v;
+   result *= scalar;
+   return result;
+}
+
+template <typename T>
+inline auto operator* (vecX<T> &&v, std::type_identity_t<T> scalar) -> vecX<T>
+{
+   return std::move (v *= scalar);
+}
+
+template <typename T>
+inline auto operator* (std::type_identity_t<T> scalar, const vecX<T> &v) -> vecX<T>
+{
+   vecX<T> result = v;
+   result *= scalar;
+   return result;
+}
+
+template <typename T>
+inline auto operator* (std::type_identity_t<T> scalar, vecX<T> &&v) -> vecX<T>
+{
+   return std::move (v *= scalar);
+}
+
+template <typename T>
+inline auto operator/ (const vecX<T> &v, std::type_identity_t<T> scalar) -> vecX<T>
+{
+   vecX<T> result = v;
+   result /= scalar;
+   return result;
+}
+
+template <typename T>
+inline auto operator/ (vecX<T> &&v, std::type_identity_t<T> scalar) -> vecX<T>
+{
+   return std::move (v /= scalar);
+}
+
+template <typename T>
+inline auto operator* (const matX<T> &m, const vecX<T> &v) -> vecX<T>
+{
+   vecX<T> result (m.rows ());
+   gemv (T (1), m, v, T (0), result);
+   return result;
+}
+
+template <typename T>
+inline auto operator* (const matX<T> &m1, const matX<T> &m2) -> matX<T>
+{
+   matX<T> result (m1.rows (), m2.cols ());
+   gemm (T (1), m1, m2, T (0), result);
+   return result;
+}
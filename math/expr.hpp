@@ -0,0 +1,440 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "simd.hpp"
+
+/* expression templates for vector arithmetic.
+ * opt-in: define MRN_MATH_EXPR_TEMPLATES before including vector.hpp,
+ * which then includes this header instead of its own binary operators.
+ * a * s + b * t - c doesn't compute anything, it builds a small tree of
+ * nodes. Only when that tree is assigned to a vec, it is evaluated in a
+ * single pass over the elements without any temporary vectors. float
+ * vectors go through SSE 4 elements at a time, vec4 in one register.
+ * The nodes hold references to the vectors they read, so don't keep an
+ * expression around with auto: vec3 r = a + b; is fine, auto r = a + b;
+ * dangles as soon as a or b go away.
+ */
+
+template <typename T, std::size_t n>
+class vec;
+
+template <typename A>
+struct is_vec : std::false_type
+{
+};
+
+template <typename T, std::size_t n>
+struct is_vec<vec<T, n>> : std::true_type
+{
+};
+
+/* every expression node derives from this, so the operators below can
+ * tell them apart from scalars
+ */
+struct vec_expr_tag
+{
+};
+
+template <typename E>
+concept vec_expression = std::is_base_of_v<vec_expr_tag, E>;
+
+template <typename A>
+concept vec_operand = is_vec<A>::value || vec_expression<A>;
+
+template <vec_expression E>
+constexpr auto eval (const E &e) -> vec<typename E::value_type, E::size>;
+
+/* Operations
+ * ----------
+ * the element-wise operations, with an SSE-version for vec4
+ */
+struct expr_add
+{
+   template <typename T>
+   static constexpr auto apply (const T &a, const T &b) -> T
+   {
+      return a + b;
+   }
+#ifdef MRN_SIMD_SSE2
+   static inline auto apply (__m128 a, __m128 b) -> __m128
+   {
+      return _mm_add_ps (a, b);
+   }
+#endif
+};
+
+struct expr_sub
+{
+   template <typename T>
+   static constexpr auto apply (const T &a, const T &b) -> T
+   {
+      return a - b;
+   }
+#ifdef MRN_SIMD_SSE2
+   static inline auto apply (__m128 a, __m128 b) -> __m128
+   {
+      return _mm_sub_ps (a, b);
+   }
+#endif
+};
+
+struct expr_mul
+{
+   template <typename T>
+   static constexpr auto apply (const T &a, const T &b) -> T
+   {
+      return a * b;
+   }
+#ifdef MRN_SIMD_SSE2
+   static inline auto apply (__m128 a, __m128 b) -> __m128
+   {
+      return _mm_mul_ps (a, b);
+   }
+#endif
+};
+
+struct expr_div
+{
+   template <typename T>
+   static constexpr auto apply (const T &a, const T &b) -> T
+   {
+      return a / b;
+   }
+#ifdef MRN_SIMD_SSE2
+   static inline auto apply (__m128 a, __m128 b) -> __m128
+   {
+      return _mm_div_ps (a, b);
+   }
+#endif
+};
+
+/* Nodes
+ * -----
+ * every node has value_type, size, operator[] for a single element and
+ * simd4(idx) for the 4 elements from idx in an SSE-register
+ */
+
+/* leaf: a vector, by reference
+ */
+template <typename T, std::size_t n>
+struct vec_ref : vec_expr_tag
+{
+   typedef T                    value_type;
+   static constexpr std::size_t size = n;
+
+   const vec<T, n> &v;
+
+   constexpr auto operator[] (std::size_t idx) const -> const T &
+   {
+      return v[idx];
+   }
+
+#ifdef MRN_SIMD_SSE2
+   inline auto simd4 (std::size_t idx) const -> __m128
+   {
+      if constexpr (n == 4) {
+         return v.simd;
+      } else {
+         return _mm_loadu_ps (&v[idx]);
+      }
+   }
+#endif
+};
+
+/* leaf: a scalar, by value
+ */
+template <typename T, std::size_t n>
+struct vec_scalar : vec_expr_tag
+{
+   typedef T                    value_type;
+   static constexpr std::size_t size = n;
+
+   T s;
+
+   constexpr auto operator[] (std::size_t) const -> const T &
+   {
+      return s;
+   }
+
+#ifdef MRN_SIMD_SSE2
+   inline auto simd4 (std::size_t) const -> __m128
+   {
+      return _mm_set1_ps (s);
+   }
+#endif
+};
+
+template <typename Op, typename L, typename R>
+struct vec_binary : vec_expr_tag
+{
+   typedef typename L::value_type value_type;
+   static constexpr std::size_t   size = L::size;
+
+   L l;
+   R r;
+
+   constexpr auto operator[] (std::size_t idx) const -> value_type
+   {
+      return Op::apply (value_type (l[idx]), value_type (r[idx]));
+   }
+
+#ifdef MRN_SIMD_SSE2
+   inline auto simd4 (std::size_t idx) const -> __m128
+   {
+      return Op::apply (l.simd4 (idx), r.simd4 (idx));
+   }
+#endif
+
+   constexpr operator vec<value_type, size> () const
+   {
+      return eval (*this);
+   }
+};
+
+template <typename E>
+struct vec_negate : vec_expr_tag
+{
+   typedef typename E::value_type value_type;
+   static constexpr std::size_t   size = E::size;
+
+   E e;
+
+   constexpr auto operator[] (std::size_t idx) const -> value_type
+   {
+      return -value_type (e[idx]);
+   }
+
+#ifdef MRN_SIMD_SSE2
+   inline auto simd4 (std::size_t idx) const -> __m128
+   {
+      return _mm_sub_ps (_mm_setzero_ps (), e.simd4 (idx));
+   }
+#endif
+
+   constexpr operator vec<value_type, size> () const
+   {
+      return eval (*this);
+   }
+};
+
+/* Building the tree
+ * -----------------
+ */
+template <typename A>
+struct operand_traits
+{
+   typedef typename A::value_type value_type;
+   static constexpr std::size_t   size = A::size;
+};
+
+template <typename T, std::size_t n>
+struct operand_traits<vec<T, n>>
+{
+   typedef T                    value_type;
+   static constexpr std::size_t size = n;
+};
+
+/* the node an operand turns into: vectors are referenced, expressions
+ * copied (they are just references themselves) and scalars converted
+ * to T
+ */
+template <typename T, std::size_t n, typename A>
+constexpr auto as_node (const A &a)
+{
+   if constexpr (is_vec<A>::value) {
+      return vec_ref<T, n> { {}, a };
+   } else if constexpr (vec_expression<A>) {
+      return a;
+   } else {
+      return vec_scalar<T, n> { {}, T (a) };
+   }
+}
+
+/* two vectors or expressions of the same type, or one of them and a
+ * scalar convertible to their element-type
+ */
+template <typename A, typename B>
+concept expr_operands =
+   (vec_operand<A> && vec_operand<B>
+    && std::is_same_v<typename operand_traits<A>::value_type, typename operand_traits<B>::value_type>
+    && operand_traits<A>::size == operand_traits<B>::size)
+   || (vec_operand<A> && !vec_operand<B> && std::is_convertible_v<B, typename operand_traits<A>::value_type>)
+   || (!vec_operand<A> && vec_operand<B> && std::is_convertible_v<A, typename operand_traits<B>::value_type>);
+
+template <typename Op, typename A, typename B>
+constexpr auto make_binary (const A &a, const B &b)
+{
+   typedef std::conditional_t<vec_operand<A>, A, B> V;
+   typedef typename operand_traits<V>::value_type   T;
+   constexpr std::size_t                            n = operand_traits<V>::size;
+
+   auto l = as_node<T, n> (a);
+   auto r = as_node<T, n> (b);
+   return vec_binary<Op, decltype (l), decltype (r)> { {}, l, r };
+}
+
+template <typename A, typename B>
+requires expr_operands<A, B>
+constexpr auto operator+ (const A &a, const B &b)
+{
+   return make_binary<expr_add> (a, b);
+}
+
+template <typename A, typename B>
+requires expr_operands<A, B>
+constexpr auto operator- (const A &a, const B &b)
+{
+   return make_binary<expr_sub> (a, b);
+}
+
+template <typename A, typename B>
+requires expr_operands<A, B>
+constexpr auto operator* (const A &a, const B &b)
+{
+   return make_binary<expr_mul> (a, b); // Hadamard Product
+}
+
+template <typename A, typename B>
+requires expr_operands<A, B>
+constexpr auto operator/ (const A &a, const B &b)
+{
+   return make_binary<expr_div> (a, b);
+}
+
+/* negating a plain vector stays eager, see vector.hpp
+ */
+template <vec_expression E>
+constexpr auto operator- (const E &e) -> vec_negate<E>
+{
+   return vec_negate<E> { {}, e };
+}
+
+/* Evaluation
+ * ----------
+ */
+template <vec_expression E>
+constexpr auto eval (const E &e) -> vec<typename E::value_type, E::size>
+{
+   typedef typename E::value_type T;
+   vec<T, E::size>                result = {};
+   std::size_t                    i      = 0;
+#ifdef MRN_SIMD_SSE2
+   if constexpr (std::is_same_v<T, float> && E::size >= 4) {
+      if (!std::is_constant_evaluated ()) {
+         if constexpr (E::size == 4) {
+            result.simd = e.simd4 (0);
+            return result;
+         }
+         for (; i + 4 <= E::size; i += 4) {
+            _mm_storeu_ps (&result[i], e.simd4 (i));
+         }
+      }
+   }
+#endif
+   for (; i < E::size; i++) {
+      result[i] = e[i];
+   }
+   return result;
+}
+
+/* compound assignment with an expression on the right, fused into
+ * a single loop as well
+ */
+template <typename T, std::size_t n, vec_expression E>
+requires std::is_same_v<typename E::value_type, T> && (E::size == n)
+constexpr auto operator+= (vec<T, n> &v, const E &e) -> vec<T, n> &
+{
+   for (std::size_t i = 0; i < n; i++)
+      v[i] += e[i];
+   return v;
+}
+
+template <typename T, std::size_t n, vec_expression E>
+requires std::is_same_v<typename E::value_type, T> && (E::size == n)
+constexpr auto operator-= (vec<T, n> &v, const E &e) -> vec<T, n> &
+{
+   for (std::size_t i = 0; i < n; i++)
+      v[i] -= e[i];
+   return v;
+}
+
+template <typename T, std::size_t n, vec_expression E>
+requires std::is_same_v<typename E::value_type, T> && (E::size == n)
+constexpr auto operator*= (vec<T, n> &v, const E &e) -> vec<T, n> &
+{
+   for (std::size_t i = 0; i < n; i++)
+      v[i] *= e[i];
+   return v;
+}
+
+template <typename T, std::size_t n, vec_expression E>
+requires std::is_same_v<typename E::value_type, T> && (E::size == n)
+constexpr auto operator/= (vec<T, n> &v, const E &e) -> vec<T, n> &
+{
+   for (std::size_t i = 0; i < n; i++)
+      v[i] /= e[i];
+   return v;
+}
+
+/* Vector functions on expressions
+ * -------------------------------
+ * these need the whole vector anyway, so the expression is evaluated
+ * first
+ */
+template <typename A>
+constexpr auto as_vec (const A &a)
+{
+   if constexpr (vec_expression<A>) {
+      return eval (a);
+   } else {
+      return a;
+   }
+}
+
+template <vec_expression E>
+constexpr auto len (const E &e)
+{
+   return len (eval (e));
+}
+
+template <vec_expression E>
+constexpr auto len2 (const E &e)
+{
+   return len2 (eval (e));
+}
+
+template <vec_expression E>
+constexpr auto norm (const E &e)
+{
+   return norm (eval (e));
+}
+
+template <typename A, typename B>
+requires (vec_expression<A> || vec_expression<B>) && vec_operand<A> && vec_operand<B>
+constexpr auto dot (const A &a, const B &b)
+{
+   return dot (as_vec (a), as_vec (b));
+}
+
+template <typename A, typename B>
+requires (vec_expression<A> || vec_expression<B>) && vec_operand<A> && vec_operand<B>
+constexpr auto dist (const A &a, const B &b)
+{
+   return dist (as_vec (a), as_vec (b));
+}
+
+template <typename A, typename B>
+requires (vec_expression<A> || vec_expression<B>) && vec_operand<A> && vec_operand<B>
+constexpr auto dist2 (const A &a, const B &b)
+{
+   return dist2 (as_vec (a), as_vec (b));
+}
+
+template <typename A, typename B>
+requires (vec_expression<A> || vec_expression<B>) && vec_operand<A> && vec_operand<B>
+constexpr auto cross (const A &a, const B &b)
+{
+   return cross (as_vec (a), as_vec (b));
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "aabb.hpp"
+
+/* view frusta and culling.
+ * A frustum is 6 planes (n, d) with the normals n pointing inwards: a
+ * point p is inside a plane if dot (n, p) + d >= 0, and inside the
+ * frustum if it is inside all of them. The planes are extracted from a
+ * view-projection matrix after Gribb and Hartmann and normalized, so the
+ * plane-equation is the signed distance.
+ * The batched functions cull spheres (a vec4_soa of center and radius)
+ * and boxes (an aabb_soa) 8 at a time in simd_float8 lanes. As soon as
+ * all 8 are outside one plane the rest of the planes are skipped.
+ */
+
+class frustum
+{
+ public:
+   // left, right, bottom, top, near, far
+   vec4 planes[6];
+
+   /* the planes of the clip-space volume of m, -w <= x, y, z <= w. With
+    * zero_to_one the depth-range is 0 <= z <= w (D3D or glClipControl),
+    * which also covers reversed-Z. A plane at infinity (e.g. the far plane
+    * of an infinite projection) has no normal and keeps everything
+    */
+   static auto from_mat (const mat4 &m, bool zero_to_one = false) -> frustum
+   {
+      vec4 rows[4];
+      for (std::size_t i = 0; i < 4; i++) {
+         rows[i] = vec4 (m[0][i], m[1][i], m[2][i], m[3][i]);
+      }
+      frustum f;
+      f.planes[0] = rows[3] + rows[0];
+      f.planes[1] = rows[3] - rows[0];
+      f.planes[2] = rows[3] + rows[1];
+      f.planes[3] = rows[3] - rows[1];
+      f.planes[4] = zero_to_one ? rows[2] : rows[3] + rows[2];
+      f.planes[5] = rows[3] - rows[2];
+      for (vec4 &p : f.planes) {
+         const float l = len (vec3 (p.x, p.y, p.z));
+         p             = l > 0 ? p / l : vec4 (0, 0, 0, 1);
+      }
+      return f;
+   }
+};
+
+/* Tests against a frustum
+ * -----------------------
+ * conservative: a sphere or box that only touches a plane counts as
+ * visible, and so does one near a corner of the frustum that is outside
+ * two planes in different places but no single one completely
+ */
+inline auto distance (const vec4 &plane, const vec3 &p) -> float
+{
+   return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+}
+
+inline auto contains (const frustum &f, const vec3 &p) -> bool
+{
+   for (const vec4 &plane : f.planes) {
+      if (distance (plane, p) < 0) {
+         return false;
+      }
+   }
+   return true;
+}
+
+inline auto visible (const frustum &f, const vec3 &center, float radius) -> bool
+{
+   for (const vec4 &plane : f.planes) {
+      if (distance (plane, center) < -radius) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/* the box is outside a plane if its center is further out than its
+ * extent reaches along the normal
+ */
+inline auto visible (const frustum &f, const aabbf &b) -> bool
+{
+   if (empty (b)) {
+      return false;
+   }
+   const vec3 c = center (b), e = extent (b);
+   for (const vec4 &plane : f.planes) {
+      const float r = std::abs (plane.x) * e.x + std::abs (plane.y) * e.y + std::abs (plane.z) * e.z;
+      if (distance (plane, c) < -r) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/* Batched culling
+ * ---------------
+ * cull_mask() sets one bit per visible instance, bit i % 8 of byte
+ * i / 8. cull_indices() appends the indices of the visible ones instead.
+ * Both return how many are visible.
+ * cache is optional, one byte per 8 instances that stays with the same
+ * instances from frame to frame. It remembers the plane that culled the
+ * 8 of them last time, which is tried first: in a coherent scene it
+ * usually culls them again, after a single plane
+ */
+
+struct frustum_x8
+{
+   vec4x8 planes[6];
+   vec3x8 abs_normals[6];
+
+   explicit frustum_x8 (const frustum &f)
+   {
+      for (std::size_t p = 0; p < 6; p++) {
+         for (std::size_t c = 0; c < 4; c++) {
+            planes[p][c] = simd_float8 (f.planes[p][c]);
+            if (c < 3) {
+               abs_normals[p][c] = simd_float8 (std::abs (f.planes[p][c]));
+            }
+         }
+      }
+   }
+};
+
+inline auto distance (const vec4x8 &plane, const vec3x8 &p) -> simd_float8
+{
+   return fmadd (plane.x, p.x, fmadd (plane.y, p.y, fmadd (plane.z, p.z, plane.w)));
+}
+
+/* runs the 8 instances at every i through the planes, the cached one
+ * first. load (i) gets the 8 instances, inside (instances, p) is the
+ * mask of those inside plane p, emit (i, bits) gets the visible ones
+ */
+template <typename Load, typename Inside, typename Emit>
+inline void cull_packets (std::size_t count, std::size_t padded, std::vector<std::uint8_t> *cache, Load &&load,
+                          Inside &&inside, Emit &&emit)
+{
+   if (cache) {
+      cache->resize (padded / 8, 0);
+   }
+   for (std::size_t i = 0; i < padded; i += 8) {
+      const auto instances = load (i);
+      simd_mask8 visible   = true;
+      if (cache) {
+         visible = inside (instances, (*cache)[i / 8]);
+      }
+      for (std::size_t p = 0; p < 6 && any (visible); p++) {
+         visible = visible & inside (instances, p);
+         if (cache && none (visible)) {
+            (*cache)[i / 8] = std::uint8_t (p);
+         }
+      }
+      int bits = visible.bits ();
+      if (i + 8 > count) {
+         bits &= count > i ? (1 << (count - i)) - 1 : 0;
+      }
+      emit (i, bits);
+   }
+}
+
+/* spheres as center and radius
+ */
+template <typename Emit>
+inline void cull_spheres (const frustum &f, const vec4_soa &spheres, std::vector<std::uint8_t> *cache, Emit &&emit)
+{
+   const frustum_x8 fx (f);
+   cull_packets (
+     spheres.size (), spheres.padded_size (), cache,
+     [&] (std::size_t i) {
+        return vec4x8 (simd_float8::load (spheres.stream (0) + i), simd_float8::load (spheres.stream (1) + i),
+                       simd_float8::load (spheres.stream (2) + i), simd_float8::load (spheres.stream (3) + i));
+     },
+     [&] (const vec4x8 &s, std::size_t p) {
+        return distance (fx.planes[p], vec3x8 (s.x, s.y, s.z)) >= -s.w;
+     },
+     emit);
+}
+
+/* the empty padding of an aabb_soa has a NaN center, which is never
+ * inside
+ */
+template <typename Emit>
+inline void cull_boxes (const frustum &f, const aabb_soa &boxes, std::vector<std::uint8_t> *cache, Emit &&emit)
+{
+   struct center_extent
+   {
+      vec3x8 c, e;
+   };
+   const frustum_x8  fx (f);
+   const simd_float8 half (0.5f);
+   cull_packets (
+     boxes.size (), boxes.padded_size (), cache,
+     [&] (std::size_t i) {
+        center_extent b;
+        for (std::size_t k = 0; k < 3; k++) {
+           const simd_float8 lo = simd_float8::load (boxes.min.stream (k) + i);
+           const simd_float8 hi = simd_float8::load (boxes.max.stream (k) + i);
+           b.c[k]               = (lo + hi) * half;
+           b.e[k]               = (hi - lo) * half;
+        }
+        return b;
+     },
+     [&] (const center_extent &b, std::size_t p) {
+        const vec3x8     &n = fx.abs_normals[p];
+        const simd_float8 r = fmadd (n.x, b.e.x, fmadd (n.y, b.e.y, n.z * b.e.z));
+        return distance (fx.planes[p], b.c) >= -r;
+     },
+     emit);
+}
+
+inline auto cull_mask (const frustum &f, const vec4_soa &spheres, std::vector<std::uint8_t> &mask,
+                       std::vector<std::uint8_t> *cache = nullptr) -> std::size_t
+{
+   std::size_t count = 0;
+   mask.resize (spheres.padded_size () / 8);
+   cull_spheres (f, spheres, cache, [&] (std::size_t i, int bits) {
+      mask[i / 8] = std::uint8_t (bits);
+      count += std::popcount (unsigned (bits));
+   });
+   return count;
+}
+
+inline auto cull_mask (const frustum &f, const aabb_soa &boxes, std::vector<std::uint8_t> &mask,
+                       std::vector<std::uint8_t> *cache = nullptr) -> std::size_t
+{
+   std::size_t count = 0;
+   mask.resize (boxes.padded_size () / 8);
+   cull_boxes (f, boxes, cache, [&] (std::size_t i, int bits) {
+      mask[i / 8] = std::uint8_t (bits);
+      count += std::popcount (unsigned (bits));
+   });
+   return count;
+}
+
+inline auto cull_indices (const frustum &f, const vec4_soa &spheres, std::vector<std::uint32_t> &visible,
+                          std::vector<std::uint8_t> *cache = nullptr) -> std::size_t
+{
+   const std::size_t start = visible.size ();
+   cull_spheres (f, spheres, cache, [&] (std::size_t i, int bits) {
+      for (; bits; bits &= bits - 1) {
+         visible.push_back (std::uint32_t (i + std::countr_zero (unsigned (bits))));
+      }
+   });
+   return visible.size () - start;
+}
+
+inline auto cull_indices (const frustum &f, const aabb_soa &boxes, std::vector<std::uint32_t> &visible,
+                          std::vector<std::uint8_t> *cache = nullptr) -> std::size_t
+{
+   const std::size_t start = visible.size ();
+   cull_boxes (f, boxes, cache, [&] (std::size_t i, int bits) {
+      for (; bits; bits &= bits - 1) {
+         visible.push_back (std::uint32_t (i + std::countr_zero (unsigned (bits))));
+      }
+   });
+   return visible.size () - start;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+
+#include "simd.hpp"
+
+/* blocked matrix multiply for the bigger matrices.
+ * all matrices are column-major like mat, given as a pointer to the
+ * first element and the distance between two columns (ld). C = A * B,
+ * with A m x k, B k x n and C m x n. gemm_accumulate() adds alpha * A * B
+ * to C instead, for the BLAS-style kernels in dynamic.hpp.
+ *
+ * C is computed in tiles of mr x nr elements. A tile stays in registers
+ * for a whole run over k: every step loads mr contiguous elements of a
+ * column of A and multiplies them with nr elements of a row of B. The
+ * k-loop is cut into blocks of kc, so the part of A that all tiles of a
+ * row-block share stays in L1/L2 while we walk along the columns of C.
+ */
+
+/* the SIMD-register a tile is built from, for float and double. For
+ * other types there is none, their tiles are plain loops
+ */
+template <typename T>
+struct gemm_lanes
+{
+   static constexpr std::size_t width = 0;
+};
+
+#if defined(MRN_SIMD_AVX)
+template <>
+struct gemm_lanes<float>
+{
+   typedef __m256               reg;
+   static constexpr std::size_t width = 8;
+
+   static inline auto load (const float *p) -> reg { return _mm256_loadu_ps (p); }
+   static inline void store (float *p, reg v) { _mm256_storeu_ps (p, v); }
+   static inline auto add (reg a, reg b) -> reg { return _mm256_add_ps (a, b); }
+   static inline auto set1 (float s) -> reg { return _mm256_set1_ps (s); }
+   static inline auto zero () -> reg { return _mm256_setzero_ps (); }
+#ifdef MRN_SIMD_FMA
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return _mm256_fmadd_ps (a, b, c); }
+#else
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return _mm256_add_ps (_mm256_mul_ps (a, b), c); }
+#endif
+};
+
+template <>
+struct gemm_lanes<double>
+{
+   typedef __m256d              reg;
+   static constexpr std::size_t width = 4;
+
+   static inline auto load (const double *p) -> reg { return _mm256_loadu_pd (p); }
+   static inline void store (double *p, reg v) { _mm256_storeu_pd (p, v); }
+   static inline auto add (reg a, reg b) -> reg { return _mm256_add_pd (a, b); }
+   static inline auto set1 (double s) -> reg { return _mm256_set1_pd (s); }
+   static inline auto zero () -> reg { return _mm256_setzero_pd (); }
+#ifdef MRN_SIMD_FMA
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return _mm256_fmadd_pd (a, b, c); }
+#else
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return _mm256_add_pd (_mm256_mul_pd (a, b), c); }
+#endif
+};
+#elif defined(MRN_SIMD_SSE2)
+template <>
+struct gemm_lanes<float>
+{
+   typedef __m128               reg;
+   static constexpr std::size_t width = 4;
+
+   static inline auto load (const float *p) -> reg { return _mm_loadu_ps (p); }
+   static inline void store (float *p, reg v) { _mm_storeu_ps (p, v); }
+   static inline auto add (reg a, reg b) -> reg { return _mm_add_ps (a, b); }
+   static inline auto set1 (float s) -> reg { return _mm_set1_ps (s); }
+   static inline auto zero () -> reg { return _mm_setzero_ps (); }
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return simd_fmadd (a, b, c); }
+};
+
+template <>
+struct gemm_lanes<double>
+{
+   typedef __m128d              reg;
+   static constexpr std::size_t width = 2;
+
+   static inline auto load (const double *p) -> reg { return _mm_loadu_pd (p); }
+   static inline void store (double *p, reg v) { _mm_storeu_pd (p, v); }
+   static inline auto add (reg a, reg b) -> reg { return _mm_add_pd (a, b); }
+   static inline auto set1 (double s) -> reg { return _mm_set1_pd (s); }
+   static inline auto zero () -> reg { return _mm_setzero_pd (); }
+#ifdef MRN_SIMD_FMA
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return _mm_fmadd_pd (a, b, c); }
+#else
+   static inline auto fmadd (reg a, reg b, reg c) -> reg { return _mm_add_pd (_mm_mul_pd (a, b), c); }
+#endif
+};
+#endif
+
+/* register-blocking: a tile is two registers of rows high and as many
+ * columns wide as leave room for the loads. 16 registers with AVX, 12
+ * with SSE go to the accumulators
+ */
+template <typename T>
+struct gemm_blocking
+{
+   static constexpr std::size_t mr = gemm_lanes<T>::width ? 2 * gemm_lanes<T>::width : 4;
+#ifdef MRN_SIMD_AVX
+   static constexpr std::size_t nr = 6;
+#else
+   static constexpr std::size_t nr = 4;
+#endif
+   // elements of k per block, and rows of A per block
+   static constexpr std::size_t kc = 256;
+   static constexpr std::size_t mc = 128;
+};
+
+/* one full tile: C[0..mr, 0..nr] += alpha * A[0..mr, 0..kc] * B[0..kc, 0..nr]
+ */
+template <typename T, std::size_t mr, std::size_t nr>
+inline void gemm_tile (std::size_t kc, T alpha, const T *__restrict a, std::size_t lda, const T *__restrict b,
+                       std::size_t ldb, T *__restrict c, std::size_t ldc)
+{
+   if constexpr (gemm_lanes<T>::width != 0) {
+      typedef gemm_lanes<T>        lanes;
+      typedef typename lanes::reg  reg;
+      constexpr std::size_t        w = lanes::width;
+      static_assert (mr == 2 * w);
+
+      reg acc[nr][2];
+      for (std::size_t j = 0; j < nr; j++) {
+         acc[j][0] = lanes::zero ();
+         acc[j][1] = lanes::zero ();
+      }
+      for (std::size_t p = 0; p < kc; p++) {
+         const reg a0 = lanes::load (a + p * lda);
+         const reg a1 = lanes::load (a + p * lda + w);
+         for (std::size_t j = 0; j < nr; j++) {
+            const reg bj = lanes::set1 (b[j * ldb + p]);
+            acc[j][0]    = lanes::fmadd (a0, bj, acc[j][0]);
+            acc[j][1]    = lanes::fmadd (a1, bj, acc[j][1]);
+         }
+      }
+      const reg s = lanes::set1 (alpha);
+      for (std::size_t j = 0; j < nr; j++) {
+         lanes::store (c + j * ldc, lanes::fmadd (acc[j][0], s, lanes::load (c + j * ldc)));
+         lanes::store (c + j * ldc + w, lanes::fmadd (acc[j][1], s, lanes::load (c + j * ldc + w)));
+      }
+   } else {
+      T acc[nr][mr] = {};
+      for (std::size_t p = 0; p < kc; p++) {
+         const T *ap = a + p * lda;
+         for (std::size_t j = 0; j < nr; j++) {
+            const T bj = b[j * ldb + p];
+            for (std::size_t i = 0; i < mr; i++) {
+               acc[j][i] += ap[i] * bj;
+            }
+         }
+      }
+      for (std::size_t j = 0; j < nr; j++) {
+         for (std::size_t i = 0; i < mr; i++) {
+            c[j * ldc + i] += alpha * acc[j][i];
+         }
+      }
+   }
+}
+
+/* the partial tiles at the bottom and right edge of C
+ */
+template <typename T>
+inline void gemm_edge (std::size_t m, std::size_t n, std::size_t kc, T alpha, const T *a, std::size_t lda, const T *b,
+                       std::size_t ldb, T *c, std::size_t ldc)
+{
+   for (std::size_t j = 0; j < n; j++) {
+      for (std::size_t p = 0; p < kc; p++) {
+         const T bj = alpha * b[j * ldb + p];
+         for (std::size_t i = 0; i < m; i++) {
+            c[j * ldc + i] += a[p * lda + i] * bj;
+         }
+      }
+   }
+}
+
+/* C += alpha * A * B
+ */
+template <typename T>
+inline void gemm_accumulate (std::size_t m, std::size_t n, std::size_t k, T alpha, const T *a, std::size_t lda,
+                             const T *b, std::size_t ldb, T *c, std::size_t ldc)
+{
+   typedef gemm_blocking<T> blk;
+
+   for (std::size_t pb = 0; pb < k; pb += blk::kc) {
+      const std::size_t kc = k - pb < blk::kc ? k - pb : blk::kc;
+      for (std::size_t ib = 0; ib < m; ib += blk::mc) {
+         const std::size_t mc = m - ib < blk::mc ? m - ib : blk::mc;
+         const T          *ab = a + pb * lda + ib;
+         for (std::size_t j = 0; j < n; j += blk::nr) {
+            const std::size_t nr = n - j < blk::nr ? n - j : blk::nr;
+            const T          *bj = b + j * ldb + pb;
+            T                *cj = c + j * ldc + ib;
+            std::size_t       i  = 0;
+            if (nr == blk::nr) {
+               for (; i + blk::mr <= mc; i += blk::mr) {
+                  gemm_tile<T, blk::mr, blk::nr> (kc, alpha, ab + i, lda, bj, ldb, cj + i, ldc);
+               }
+            }
+            if (i < mc) {
+               gemm_edge (mc - i, nr, kc, alpha, ab + i, lda, bj, ldb, cj + i, ldc);
+            }
+         }
+      }
+   }
+}
+
+/* C = A * B
+ */
+template <typename T>
+inline void gemm (std::size_t m, std::size_t n, std::size_t k, const T *a, std::size_t lda, const T *b,
+                  std::size_t ldb, T *c, std::size_t ldc)
+{
+   for (std::size_t j = 0; j < n; j++) {
+      for (std::size_t i = 0; i < m; i++) {
+         c[j * ldc + i] = T {};
+      }
+   }
+   gemm_accumulate (m, n, k, T (1), a, lda, b, ldb, c, ldc);
+}
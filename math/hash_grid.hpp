@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "morton.hpp"
+#include "packet.hpp"
+#include "parallel.hpp"
+#include "soa.hpp"
+
+/* spatial hash grids.
+ * hash_grid answers fixed-radius neighbour queries over a set of points,
+ * like the particles of a simulation. Space is cut into cubic cells,
+ * every cell that holds points is hashed into one of a power of 2 of
+ * buckets, at least one per point, and the points are counting-sorted by
+ * bucket into flat arrays: the positions in a vec_soa, the cell of each
+ * and their indices in the input, so nothing is allocated per cell.
+ * Within a bucket the points are sorted by cell and then by index, so
+ * the points of a cell are one contiguous range, also when the grid is
+ * built in parallel.
+ * A query visits the cells the sphere overlaps and compares the squared
+ * distances to 8 points of a cell at a time, the cell size should be
+ * about the radius, then that is 27 cells. The cells are wrapped to 21
+ * bits per axis and hashed from their 63-bit Morton code, so points of
+ * different cells in the same bucket are told apart by that code, and
+ * neighbouring cells mostly land in neighbouring buckets.
+ * The grid keeps its buffers from one build to the next, a grid that is
+ * rebuilt every step should be rebuilt in place
+ */
+class hash_grid
+{
+ public:
+   static constexpr std::size_t parallel_grain = 1 << 14;
+
+   hash_grid () = default;
+
+   hash_grid (std::span<const vec3> points, float cell_size)
+   {
+      build (points, cell_size);
+   }
+
+   void build (std::span<const vec3> points, float cell_size)
+   {
+      assert (("The cells need a size\n" && cell_size > 0));
+      assert (("Too many points for a hash grid\n" && points.size () < std::numeric_limits<std::uint32_t>::max () - 8));
+      const std::size_t n = points.size ();
+      _cell_size          = cell_size;
+      _inv                = 1 / cell_size;
+      _bits               = std::max<std::size_t> (std::bit_width (n ? n - 1 : 0), 1);
+      _mask               = (std::uint64_t (1) << _bits) - 1;
+      _start.resize (buckets () + 1);
+      _cells.resize (n);
+      _keys.resize (n);
+      _ids.resize (n);
+      // 8 points can be loaded from any of them
+      _points.resize (n + 7);
+      if (n > parallel_grain && parallel_threads () > 1) {
+         sort<true> (points);
+      } else {
+         sort<false> (points);
+      }
+   }
+
+   auto size () const -> std::size_t
+   {
+      return _ids.size ();
+   }
+
+   auto cell_size () const -> float
+   {
+      return _cell_size;
+   }
+
+   /* f (index, d2) for every point within radius of p, with its index
+    * in the points the grid was built from and its squared distance
+    */
+   template <typename F>
+   void for_each_neighbor (const vec3 &p, float radius, F &&f) const
+   {
+      if (_ids.empty ()) {
+         return;
+      }
+      const vec3x8      q (p.x, p.y, p.z);
+      const simd_float8 r2 (radius * radius);
+      std::int64_t      lo[3], hi[3];
+      found             hits;
+      auto              flush = [&] () {
+         for (std::size_t k = 0; k < hits.count; k++) {
+            f (_ids[hits.slot[k]], hits.d2[k]);
+         }
+         hits.count = 0;
+      };
+      range (p, radius, lo, hi);
+      for (std::int64_t z = lo[2]; z <= hi[2]; z++) {
+         for (std::int64_t y = lo[1]; y <= hi[1]; y++) {
+            for (std::int64_t x = lo[0]; x <= hi[0]; x++) {
+               const auto [first, last] = find (key (x, y, z));
+               for (std::size_t i = first; i < last; i += 8) {
+                  simd_float8 d2;
+                  const int   bits = close_bits (q, r2, i, last, d2);
+                  hits.add (0, i, bits, d2);
+                  if (hits.full ()) {
+                     flush ();
+                  }
+               }
+            }
+         }
+      }
+      flush ();
+   }
+
+   /* f (query, index, d2) for every point within radius of each of the
+    * queries, in parallel: f is called from several threads at once, but
+    * all neighbours of a query on the same one
+    */
+   template <typename F>
+   void for_each_neighbor (std::span<const vec3> queries, float radius, F &&f) const
+   {
+      parallel_for (queries.size (), parallel_grain / 16, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t q = begin; q < end; q++) {
+            for_each_neighbor (queries[q], radius, [&] (std::uint32_t i, float d2) { f (q, i, d2); });
+         }
+      });
+   }
+
+   /* f (i, j, d2) for every pair of points of the grid within radius of
+    * each other, once as (i, j) and once as (j, i), in parallel like the
+    * batched query. The points are taken cell by cell, so the cells
+    * around them are only found once for all points of a cell, and all
+    * calls for i are made on the same thread
+    */
+   template <typename F>
+   void for_each_pair (float radius, F &&f) const
+   {
+      if (_ids.empty ()) {
+         return;
+      }
+      assert (("The radius can't be negative\n" && radius >= 0));
+      const simd_float8  r2 (radius * radius);
+      const std::int64_t span = std::int64_t (std::ceil (radius * _inv));
+      assert (("The radius is too large for the cells\n" && std::uint64_t (2 * span) < wrap));
+      parallel_for (buckets (), parallel_grain / 4, [&] (std::size_t begin, std::size_t end) {
+         found hits;
+         auto  flush = [&] () {
+            for (std::size_t k = 0; k < hits.count; k++) {
+               f (_ids[hits.from[k]], _ids[hits.slot[k]], hits.d2[k]);
+            }
+            hits.count = 0;
+         };
+         for (std::size_t b = begin; b < end; b++) {
+            for (std::size_t first = _start[b], last; first < _start[b + 1]; first = last) {
+               for (last = first + 1; last < _start[b + 1] && _keys[last] == _keys[first]; last++) {
+               }
+               // every point of the cell, grown by the radius
+               std::int64_t lo[3], hi[3];
+               for (std::size_t a = 0; a < 3; a++) {
+                  const std::int64_t c = cell (_points.stream (a)[first]);
+                  lo[a]                = c - span;
+                  hi[a]                = c + span;
+               }
+               for (std::int64_t z = lo[2]; z <= hi[2]; z++) {
+                  for (std::int64_t y = lo[1]; y <= hi[1]; y++) {
+                     for (std::int64_t x = lo[0]; x <= hi[0]; x++) {
+                        const auto [other, other_last] = find (key (x, y, z));
+                        for (std::size_t s = first; s < last; s++) {
+                           const vec3x8 q (_points.x ()[s], _points.y ()[s], _points.z ()[s]);
+                           for (std::size_t i = other; i < other_last; i += 8) {
+                              simd_float8 d2;
+                              int         bits = close_bits (q, r2, i, other_last, d2);
+                              // not the point itself, if it is one of the 8
+                              if (s - i < 8) {
+                                 bits &= ~(1 << (s - i));
+                              }
+                              hits.add (std::uint32_t (s), i, bits, d2);
+                              if (hits.full ()) {
+                                 flush ();
+                              }
+                           }
+                        }
+                     }
+                  }
+               }
+            }
+         }
+         flush ();
+      });
+   }
+
+ private:
+   static constexpr std::uint64_t wrap = (std::uint64_t (1) << morton_bits<std::uint64_t>) - 1;
+
+   float                      _cell_size = 1, _inv = 1;
+   std::size_t                _bits = 1;
+   std::uint64_t              _mask = 1;
+   std::vector<std::uint32_t> _start, _ids;
+   std::vector<std::uint64_t> _cells, _keys;
+   vec_soa<float, 3>          _points;
+
+   /* the neighbours that were found, before f is called for them. All 8
+    * lanes of a test are written, but only the close ones are counted:
+    * a branch on the distance would be as hard to predict as which
+    * points are neighbours
+    */
+   struct found
+   {
+      static constexpr std::size_t capacity = 64;
+
+      std::uint32_t from[capacity], slot[capacity];
+      float         d2[capacity];
+      std::size_t   count = 0;
+
+      void add (std::uint32_t s, std::size_t i, int bits, simd_float8 d2s)
+      {
+         float lanes[8];
+         d2s.store (lanes);
+         for (std::size_t lane = 0; lane < 8; lane++) {
+            from[count] = s;
+            slot[count] = std::uint32_t (i + lane);
+            d2[count]   = lanes[lane];
+            count += (bits >> lane) & 1;
+         }
+      }
+
+      auto full () const -> bool
+      {
+         return count > capacity - 8;
+      }
+   };
+
+   auto buckets () const -> std::size_t
+   {
+      return std::size_t (_mask) + 1;
+   }
+
+   // clamped, so points far outside of the grid still have a cell
+   auto cell (float v) const -> std::int64_t
+   {
+      return std::int64_t (std::clamp (std::floor (v * _inv), -0x1p62f, 0x1p62f));
+   }
+
+   void range (const vec3 &p, float radius, std::int64_t *lo, std::int64_t *hi) const
+   {
+      assert (("The radius can't be negative\n" && radius >= 0));
+      for (std::size_t a = 0; a < 3; a++) {
+         lo[a] = cell (p[a] - radius);
+         hi[a] = cell (p[a] + radius);
+         assert (("The radius is too large for the cells\n" && std::uint64_t (hi[a] - lo[a]) < wrap));
+      }
+   }
+
+   static auto key (std::int64_t x, std::int64_t y, std::int64_t z) -> std::uint64_t
+   {
+      return morton_code (std::uint64_t (x) & wrap, std::uint64_t (y) & wrap, std::uint64_t (z) & wrap);
+   }
+
+   auto key (const vec3 &p) const -> std::uint64_t
+   {
+      return key (cell (p.x), cell (p.y), cell (p.z));
+   }
+
+   /* the low bits of the code pick the bucket within a block of cells
+    * along the Z-curve, which keeps neighbours close, the blocks are
+    * scattered by a multiplicative hash of the high bits
+    */
+   auto bucket (std::uint64_t k) const -> std::size_t
+   {
+      return std::size_t ((k ^ ((k >> _bits) * 0x9e3779b97f4a7c15ull) >> (64 - _bits)) & _mask);
+   }
+
+   /* the range of the points in cell k. Mostly the cell has its bucket
+    * to itself, otherwise the bucket is searched for it
+    */
+   auto find (std::uint64_t k) const -> std::pair<std::size_t, std::size_t>
+   {
+      const std::size_t b = bucket (k);
+      std::size_t       first = _start[b], last = _start[b + 1];
+      if (first == last || (_keys[first] == k && _keys[last - 1] == k)) {
+         return { first, last };
+      }
+      while (first < last && _keys[first] < k) {
+         first++;
+      }
+      std::size_t end = first;
+      while (end < last && _keys[end] == k) {
+         end++;
+      }
+      return { first, end };
+   }
+
+   /* one bit for each of the 8 points at i that is within r2 of q, and
+    * before last, with their squared distances in d2
+    */
+   auto close_bits (const vec3x8 &q, simd_float8 r2, std::size_t i, std::size_t last, simd_float8 &d2) const -> int
+   {
+      const vec3x8 p (simd_float8::load (_points.x () + i), simd_float8::load (_points.y () + i),
+                      simd_float8::load (_points.z () + i));
+      d2 = dist2 (p, q);
+      return (d2 <= r2).bits () & (last - i < 8 ? (1 << (last - i)) - 1 : 0xff);
+   }
+
+   /* counted into _start, which the prefix sum turns into the end of
+    * every bucket, the indices and cells are scattered from the back so
+    * that each bucket ends up at its start, and in the order of the
+    * indices. Buckets of several cells are sorted by cell after that, and
+    * in parallel, where the order depends on the threads, all others by
+    * index. The positions are gathered last
+    */
+   template <bool shared>
+   void sort (std::span<const vec3> points)
+   {
+      const std::size_t n = points.size (), m = buckets ();
+      parallel_for (m + 1, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         std::fill (_start.begin () + begin, _start.begin () + end, 0);
+      });
+      parallel_for (n, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t i = begin; i < end; i++) {
+            _cells[i] = key (points[i]);
+            if constexpr (shared) {
+               std::atomic_ref<std::uint32_t> (_start[bucket (_cells[i])]).fetch_add (1, std::memory_order_relaxed);
+            } else {
+               _start[bucket (_cells[i])]++;
+            }
+         }
+      });
+      scan ();
+      parallel_for (n, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t i = end; i-- > begin;) {
+            std::uint32_t &start = _start[bucket (_cells[i])];
+            std::size_t    s;
+            if constexpr (shared) {
+               s = std::atomic_ref<std::uint32_t> (start).fetch_sub (1, std::memory_order_relaxed) - 1;
+            } else {
+               s = --start;
+            }
+            _ids[s]  = std::uint32_t (i);
+            _keys[s] = _cells[i];
+         }
+      });
+      parallel_for (m, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t b = begin; b < end; b++) {
+            const std::size_t first = _start[b], last = _start[b + 1];
+            if (last - first < 2) {
+               continue;
+            }
+            if (std::any_of (&_keys[first + 1], &_keys[last], [&] (std::uint64_t k) { return k != _keys[first]; })) {
+               std::sort (&_ids[first], &_ids[last], [&] (std::uint32_t i, std::uint32_t j) {
+                  return _cells[i] < _cells[j] || (_cells[i] == _cells[j] && i < j);
+               });
+               for (std::size_t s = first; s < last; s++) {
+                  _keys[s] = _cells[_ids[s]];
+               }
+            } else if (shared) {
+               std::sort (&_ids[first], &_ids[last]);
+            }
+         }
+      });
+      parallel_for (n, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t s = begin; s < end; s++) {
+            const vec3 &p   = points[_ids[s]];
+            _points.x ()[s] = p.x;
+            _points.y ()[s] = p.y;
+            _points.z ()[s] = p.z;
+         }
+      });
+   }
+
+   // inclusive, in blocks of the grain: the sums of the blocks, then the blocks
+   void scan ()
+   {
+      const std::size_t          m = buckets ();
+      std::vector<std::uint32_t> sums ((m + parallel_grain - 1) / parallel_grain);
+      parallel_for (m, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t block = begin; block < end; block += parallel_grain) {
+            std::uint32_t sum = 0;
+            for (std::size_t b = block; b < std::min (block + parallel_grain, end); b++) {
+               sum += _start[b];
+            }
+            sums[block / parallel_grain] = sum;
+         }
+      });
+      std::uint32_t offset = 0;
+      for (std::uint32_t &s : sums) {
+         offset += std::exchange (s, offset);
+      }
+      parallel_for (m, parallel_grain, [&] (std::size_t begin, std::size_t end) {
+         for (std::size_t block = begin; block < end; block += parallel_grain) {
+            std::uint32_t sum = sums[block / parallel_grain];
+            for (std::size_t b = block; b < std::min (block + parallel_grain, end); b++) {
+               sum += _start[b];
+               _start[b] = sum;
+            }
+         }
+      });
+      _start[m] = std::uint32_t (size ());
+   }
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+
+/* transform hierarchies, flattened.
+ * every node has a local matrix relative to its parent, and a world
+ * matrix world (parent) * local. The nodes are kept in one array in
+ * depth-first order: a parent always comes before its children, and the
+ * descendants of a node are the range right after it. update() only
+ * walks the subtrees below nodes whose local matrix changed since the
+ * last update, front to back through memory. Those subtrees don't
+ * depend on each other, so they are spread over threads (see
+ * parallel.hpp).
+ * Nodes are referred to by the handles add() returns, which stay the
+ * same when the array is reordered.
+ */
+
+class transform_hierarchy
+{
+ public:
+   static constexpr std::size_t none = std::numeric_limits<std::size_t>::max ();
+
+   // a subtree bigger than this is split up into its children for the
+   // threads, and the threads take ranges of at least this many nodes
+   static constexpr std::size_t grain = 1024;
+
+   /* add a node below parent (or a new root), its world matrix is valid
+    * after the next update()
+    */
+   auto add (std::size_t parent = none, const mat4 &local = mat4 ()) -> std::size_t
+   {
+      assert (("Invalid parent\n" && (parent == none || parent < _slot.size ())));
+      const std::size_t handle = _slot.size ();
+      _slot.push_back (_parent.size ());
+      _handle.push_back (handle);
+      _parent.push_back (parent == none ? none : _slot[parent]);
+      _end.push_back (0);
+      _local.push_back (local);
+      _world.push_back (local);
+      _dirty.push_back (0);
+      _sorted = false;
+      return handle;
+   }
+
+   auto size () const -> std::size_t
+   {
+      return _slot.size ();
+   }
+
+   void set_local (std::size_t node, const mat4 &local)
+   {
+      const std::size_t s = _slot[node];
+      _local[s]           = local;
+      _dirty[s]           = 1;
+      _changed            = true;
+   }
+
+   auto local (std::size_t node) const -> const mat4 &
+   {
+      return _local[_slot[node]];
+   }
+
+   auto world (std::size_t node) const -> const mat4 &
+   {
+      return _world[_slot[node]];
+   }
+
+   /* the flattened arrays, in depth-first order. slot () is the position
+    * of a node in them, parent_slot () the one of its parent (or none)
+    */
+   auto worlds () const -> const std::vector<mat4> &
+   {
+      return _world;
+   }
+
+   auto slot (std::size_t node) const -> std::size_t
+   {
+      return _slot[node];
+   }
+
+   auto parent_slot (std::size_t s) const -> std::size_t
+   {
+      return _parent[s];
+   }
+
+   /* recompute the world matrices of the changed nodes and everything
+    * below them, returns how many that were
+    */
+   auto update () -> std::size_t
+   {
+      if (!_sorted) {
+         sort ();
+      }
+      if (!_changed) {
+         return 0;
+      }
+
+      // a changed node's subtree is the range up to its _end, changed
+      // nodes inside it are covered already. The flags are cleared as
+      // the nodes are computed
+      _ranges.clear ();
+      std::size_t count = 0;
+      for (std::size_t s = 0; s < _dirty.size ();) {
+         s = std::find (_dirty.begin () + s, _dirty.end (), 1) - _dirty.begin ();
+         if (s < _dirty.size ()) {
+            count += _end[s] - s;
+            split (s);
+            s = _end[s];
+         }
+      }
+      _changed = false;
+
+      parallel_for (_ranges.size (), grain_ranges (count), [this] (std::size_t begin, std::size_t end) {
+         for (std::size_t r = begin; r < end; r++) {
+            for (std::size_t s = _ranges[r].first; s < _ranges[r].second; s++) {
+               compute (s);
+            }
+         }
+      });
+      return count;
+   }
+
+ private:
+   void compute (std::size_t s)
+   {
+      const std::size_t p = _parent[s];
+      _world[s]           = p == none ? _local[s] : _world[p] * _local[s];
+      _dirty[s]           = 0;
+   }
+
+   /* queue the subtree at s. A big one gets its root computed right
+    * away, its children become subtrees of their own
+    */
+   void split (std::size_t s)
+   {
+      _stack.clear ();
+      _stack.push_back (s);
+      while (!_stack.empty ()) {
+         const std::size_t n = _stack.back ();
+         _stack.pop_back ();
+         if (_end[n] - n <= grain) {
+            _ranges.emplace_back (n, _end[n]);
+            continue;
+         }
+         compute (n);
+         for (std::size_t c = n + 1; c < _end[n]; c = _end[c]) {
+            _stack.push_back (c);
+         }
+      }
+   }
+
+   /* ranges per thread-chunk, so that a chunk holds about grain nodes
+    */
+   auto grain_ranges (std::size_t count) const -> std::size_t
+   {
+      return std::max<std::size_t> (1, _ranges.size () * grain / std::max<std::size_t> (count, 1));
+   }
+
+   /* bring the nodes into depth-first order, after adding some. Every
+    * world matrix is recomputed by the next update
+    */
+   void sort ()
+   {
+      const std::size_t n = _slot.size ();
+
+      // children of every node as one array, counting sort by parent
+      std::vector<std::size_t> first (n + 1, 0), children (n);
+      for (std::size_t s = 0; s < n; s++) {
+         first[(_parent[s] == none ? n : _parent[s])]++;
+      }
+      std::size_t sum = 0;
+      for (std::size_t s = 0; s <= n; s++) {
+         sum += std::exchange (first[s], sum);
+      }
+      // the roots are put last, under the pseudo-parent n
+      std::vector<std::size_t> next (first.begin (), first.end ());
+      for (std::size_t s = 0; s < n; s++) {
+         children[next[(_parent[s] == none ? n : _parent[s])]++] = s;
+      }
+
+      std::vector<std::size_t> order, end (n), stack;
+      order.reserve (n);
+      for (std::size_t i = n; i-- > first[n];) {
+         stack.push_back (children[i]);
+      }
+      while (!stack.empty ()) {
+         const std::size_t s = stack.back ();
+         stack.pop_back ();
+         order.push_back (s);
+         for (std::size_t i = first[s + 1]; i-- > first[s];) {
+            stack.push_back (children[i]);
+         }
+      }
+      // one past the last descendant, bottom up
+      std::vector<std::size_t> new_slot (n);
+      for (std::size_t i = 0; i < n; i++) {
+         new_slot[order[i]] = i;
+      }
+      for (std::size_t i = n; i-- > 0;) {
+         const std::size_t s = order[i];
+         end[i]              = std::max (end[i], i + 1);
+         if (_parent[s] != none) {
+            end[new_slot[_parent[s]]] = std::max (end[new_slot[_parent[s]]], end[i]);
+         }
+      }
+
+      std::vector<std::size_t> parent (n), handle (n);
+      std::vector<mat4>        local (n);
+      for (std::size_t i = 0; i < n; i++) {
+         const std::size_t s = order[i];
+         parent[i]           = _parent[s] == none ? none : new_slot[_parent[s]];
+         handle[i]           = _handle[s];
+         local[i]            = _local[s];
+         _slot[handle[i]]    = i;
+      }
+      _parent = std::move (parent);
+      _handle = std::move (handle);
+      _local  = std::move (local);
+      _end    = std::move (end);
+
+      // everything is recomputed
+      std::fill (_dirty.begin (), _dirty.end (), 1);
+      _changed = true;
+      _sorted = true;
+   }
+
+   std::vector<std::size_t> _slot;   // handle -> slot
+   std::vector<std::size_t> _handle; // slot -> handle
+   std::vector<std::size_t> _parent; // slots of the parents
+   std::vector<std::size_t> _end;    // slot after the last descendant
+   std::vector<mat4>        _local;
+   std::vector<mat4>        _world;
+   std::vector<char>        _dirty;
+
+   std::vector<std::pair<std::size_t, std::size_t>> _ranges;
+   std::vector<std::size_t>                          _stack;
+   bool                                              _sorted  = true;
+   bool                                              _changed = false;
+};
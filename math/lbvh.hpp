@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bvh.hpp"
+#include "morton.hpp"
+
+/* linear bounding volume hierarchies (LBVH).
+ * linear_bvh builds the same bvh as the SAH builder in bvh.hpp, only
+ * much faster and with worse trees, for geometry that moves every frame.
+ * The centroids of the primitives are quantized to Morton codes, which
+ * order them along a Z-curve, and sorted with a parallel radix sort. The
+ * tree is the one the bits of the sorted codes imply, a node splits where
+ * the highest bit that differs in its range flips, but it is built from
+ * the bottom up (Apetrei, "Fast and Simple Agglomerative LBVH
+ * Construction"): every leaf walks up towards the root, each step to the
+ * parent whose split between it and its neighbour is lower. The first of
+ * two children to reach an inner node leaves the end of its range there
+ * and stops, the second merges the ranges and boxes and goes on, so the
+ * nodes are emitted and fitted in one pass. Threads share the inner nodes
+ * through an atomic exchange.
+ * Code is std::uint32_t for 30-bit codes, 10 bits per axis, or
+ * std::uint64_t for 63-bit codes, 21 bits per axis, for large scenes
+ * with many primitives close to each other. Every leaf holds one
+ * primitive, indices is in the order of the codes
+ */
+
+/* Radix sort
+ * ----------
+ * a stable LSD radix sort of items by the lowest bits of key (item), in
+ * digits of at most 11 bits, with scratch as the second buffer. The
+ * items are split into one block per thread. Every pass counts the
+ * digits of each block, turns the counts into the offsets where each
+ * block writes each digit, and scatters the blocks in parallel. Passes
+ * in which all keys have the same digit are skipped
+ */
+template <typename T, typename Key>
+inline void radix_sort (std::vector<T> &items, std::vector<T> &scratch, std::size_t bits, Key &&key)
+{
+   const std::size_t n      = items.size ();
+   const std::size_t passes = (bits + 10) / 11;
+   if (n < 2 || passes == 0) {
+      return;
+   }
+   const std::size_t digit_bits = (bits + passes - 1) / passes;
+   const std::size_t buckets    = std::size_t (1) << digit_bits;
+   const std::size_t mask       = buckets - 1;
+   const std::size_t blocks     = std::min (parallel_threads (), (n + bvh::parallel_grain - 1) / bvh::parallel_grain);
+   auto              block_begin = [&] (std::size_t b) { return b * n / blocks; };
+
+   scratch.resize (n);
+   std::vector<std::uint32_t> offsets (blocks * buckets);
+   for (std::size_t pass = 0; pass < passes; pass++) {
+      const std::size_t shift = pass * digit_bits;
+      parallel_for (blocks, 1, [&] (std::size_t first, std::size_t last) {
+         for (std::size_t b = first; b < last; b++) {
+            std::uint32_t *count = &offsets[b * buckets];
+            std::fill (count, count + buckets, 0);
+            for (std::size_t i = block_begin (b); i < block_begin (b + 1); i++) {
+               count[(key (items[i]) >> shift) & mask]++;
+            }
+         }
+      });
+
+      // digit by digit, and within a digit block by block
+      std::uint32_t sum = 0;
+      bool          skip = false;
+      for (std::size_t d = 0; d < buckets && !skip; d++) {
+         const std::uint32_t start = sum;
+         for (std::size_t b = 0; b < blocks; b++) {
+            const std::uint32_t c = offsets[b * buckets + d];
+            offsets[b * buckets + d] = sum;
+            sum += c;
+         }
+         skip = sum - start == n;
+      }
+      if (skip) {
+         continue;
+      }
+
+      parallel_for (blocks, 1, [&] (std::size_t first, std::size_t last) {
+         for (std::size_t b = first; b < last; b++) {
+            std::uint32_t *offset = &offsets[b * buckets];
+            for (std::size_t i = block_begin (b); i < block_begin (b + 1); i++) {
+               scratch[offset[(key (items[i]) >> shift) & mask]++] = items[i];
+            }
+         }
+      });
+      items.swap (scratch);
+   }
+}
+
+/* Building
+ * --------
+ * lbvh_builder keeps its buffers from one build to the next, and
+ * rebuilds into the nodes of the previous tree. Fresh memory costs more
+ * than a build, so a tree that is rebuilt every frame should be rebuilt
+ * with the same builder into the same bvh
+ */
+template <typename Code = std::uint32_t>
+class lbvh_builder
+{
+   static_assert (std::is_same_v<Code, std::uint32_t> || std::is_same_v<Code, std::uint64_t>,
+                  "Morton codes are 32 or 64 bits");
+
+ public:
+   void build (std::span<const aabbf> boxes, bvh &tree)
+   {
+      assert (("Too many primitives for a bvh\n" && boxes.size () < std::numeric_limits<std::uint32_t>::max () / 2));
+      const std::size_t n = boxes.size ();
+      tree.nodes.resize (n ? 2 * n - 1 : 0);
+      tree.indices.resize (n);
+      if (n == 0) {
+         return;
+      }
+      sort (boxes);
+      link (boxes, tree);
+   }
+
+ private:
+   static constexpr std::size_t grain = bvh::parallel_grain;
+
+   struct item
+   {
+      Code          code;
+      std::uint32_t index;
+   };
+
+   std::vector<item>          items, scratch;
+   std::vector<aabbf>         partial;
+   std::vector<std::uint32_t> other_end;
+
+   static constexpr std::uint32_t no_end = ~std::uint32_t (0);
+
+   /* the items by the Morton codes of the centroids of their boxes in
+    * the bounds of all centroids. The centroids are never needed, only
+    * min + max, so the bounds are doubled instead
+    */
+   void sort (std::span<const aabbf> boxes)
+   {
+      const std::size_t n = boxes.size ();
+      partial.assign ((n + grain - 1) / grain, aabbf ());
+      parallel_for (n, grain, [&] (std::size_t begin, std::size_t end) {
+         aabbf b;
+         for (std::size_t i = begin; i < end; i++) {
+            for (std::size_t a = 0; a < 3; a++) {
+               const float c = boxes[i].min[a] + boxes[i].max[a];
+               b.min[a]      = std::min (b.min[a], c);
+               b.max[a]      = std::max (b.max[a], c);
+            }
+         }
+         partial[begin / grain] = b;
+      });
+      aabbf centroids;
+      for (const aabbf &b : partial) {
+         centroids = merge (centroids, b);
+      }
+
+      const Code cells = Code (1) << morton_bits<Code>;
+      vec3       scale;
+      for (std::size_t a = 0; a < 3; a++) {
+         // 0 also if the extent is too small to divide by
+         const float e = centroids.max[a] - centroids.min[a];
+         scale[a]      = e > 0 && cells / e < std::numeric_limits<float>::infinity () ? cells / e : 0;
+      }
+      items.resize (n);
+      other_end.resize (n - 1);
+      parallel_for (n, grain, [&, lo = centroids.min, scale] (std::size_t begin, std::size_t end) {
+         for (std::size_t i = begin; i < end; i++) {
+            if (i + 1 < n) {
+               other_end[i] = no_end;
+            }
+            Code q[3];
+            for (std::size_t a = 0; a < 3; a++) {
+               const float c = boxes[i].min[a] + boxes[i].max[a];
+               q[a]          = std::min (Code ((c - lo[a]) * scale[a]), cells - 1);
+            }
+            items[i] = { morton_code (q[0], q[1], q[2]), std::uint32_t (i) };
+         }
+      });
+      radix_sort (items, scratch, 3 * morton_bits<Code>, [] (const item &i) { return i.code; });
+   }
+
+   /* whether primitives i and i + 1 are split further down the tree
+    * than j and j + 1. The highest bit in which neighbours differ is where
+    * the tree splits them, and of two such bits of the same node, the
+    * higher one is the higher number. Equal codes are told apart by their
+    * positions, as if those were more bits below the codes
+    */
+   auto lower_split (std::size_t i, std::size_t j) const -> bool
+   {
+      const Code x = items[i].code ^ items[i + 1].code, y = items[j].code ^ items[j + 1].code;
+      return x < y || (x == y && (i ^ (i + 1)) < (j ^ (j + 1)));
+   }
+
+   /* all nodes from the leaves up at once (Apetrei, "Fast and Simple
+    * Agglomerative LBVH Construction"). A node of the primitives l to r
+    * is the left child of the node split between r and r + 1, or the
+    * right child of the one split between l - 1 and l, whichever split
+    * is lower. Inner node p is the one split between p and p + 1, its
+    * children are nodes[2p + 1] and nodes[2p + 2]. The root is in
+    * nodes[0], every other node is the child of exactly one inner node,
+    * so they all fit in 2n - 1 nodes.
+    * The first child to arrive at an inner node leaves its end of the
+    * range there and stops, the second takes it, fits the box and goes on
+    */
+   void link (std::span<const aabbf> boxes, bvh &tree)
+   {
+      const std::size_t n = items.size ();
+      if (n > grain && parallel_threads () > 1) {
+         parallel_for (n, grain, [&] (std::size_t begin, std::size_t end) { link<true> (boxes, tree, begin, end); });
+      } else {
+         link<false> (boxes, tree, 0, n);
+      }
+   }
+
+   // the leaves from begin to end, shared if other threads link the rest
+   template <bool shared>
+   void link (std::span<const aabbf> boxes, bvh &tree, std::size_t begin, std::size_t end)
+   {
+      const std::size_t n = items.size ();
+      for (std::size_t i = begin; i < end; i++) {
+         tree.indices[i]     = items[i].index;
+         aabbf         box   = boxes[items[i].index];
+         std::uint32_t first = std::uint32_t (i), count = 1;
+         std::size_t   l = i, r = i;
+         for (;;) {
+            const bool        left   = l == 0 || (r + 1 < n && lower_split (r, l - 1));
+            const bool        root   = l == 0 && r + 1 == n;
+            const std::size_t parent = left ? r : l - 1;
+            bvh_node         &node   = tree.nodes[root ? 0 : 2 * parent + 2 - left];
+            node.min                 = box.min;
+            node.max                 = box.max;
+            node.first               = first;
+            node.count               = count;
+            if (root) {
+               break;
+            }
+            const std::uint32_t mine = std::uint32_t (left ? l : r);
+            std::uint32_t       other;
+            if constexpr (shared) {
+               other = std::atomic_ref<std::uint32_t> (other_end[parent]).exchange (mine, std::memory_order_acq_rel);
+            } else {
+               other = std::exchange (other_end[parent], mine);
+            }
+            if (other == no_end) {
+               break;
+            }
+            box   = merge (box, tree.nodes[2 * parent + 1 + left].bounds ());
+            first = std::uint32_t (2 * parent + 1);
+            count = 0;
+            (left ? r : l) = other;
+         }
+      }
+   }
+};
+
+/* a new tree with a new builder
+ */
+template <typename Code = std::uint32_t>
+inline auto linear_bvh (std::span<const aabbf> boxes) -> bvh
+{
+   bvh tree;
+   lbvh_builder<Code> ().build (boxes, tree);
+   return tree;
+}
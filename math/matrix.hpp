@@ -1,7 +1,204 @@
 #pragma once
 
+#include <type_traits>
+#include <utility>
+
+#include "gemm.hpp"
+#include "scalar.hpp"
 #include "vector.hpp"
 
+#ifdef MRN_SIMD_SSE2
+/* SSE kernels for mat<float, 4, 4>.
+ * the matrix is column-major, so M * v is just the sum of the columns
+ * scaled by the components of v, and M * N does that for every column
+ * of N.
+ */
+inline auto simd_mat4_mul (const vec<float, 4> *cols, __m128 v) -> __m128
+{
+   // two independent chains, so the adds don't wait on each other
+   __m128 lo = _mm_mul_ps (cols[0].simd, simd_splat<0> (v));
+   __m128 hi = _mm_mul_ps (cols[2].simd, simd_splat<2> (v));
+   lo        = simd_fmadd (cols[1].simd, simd_splat<1> (v), lo);
+   hi        = simd_fmadd (cols[3].simd, simd_splat<3> (v), hi);
+   return _mm_add_ps (lo, hi);
+}
+
+inline void simd_mat4_mul (const vec<float, 4> *a, const vec<float, 4> *b, vec<float, 4> *result)
+{
+#ifdef MRN_SIMD_AVX
+   /* two result-columns per iteration: every 128-bit half of the
+    * registers works on its own column of b
+    */
+   const __m256 a0 = _mm256_broadcast_ps (&a[0].simd);
+   const __m256 a1 = _mm256_broadcast_ps (&a[1].simd);
+   const __m256 a2 = _mm256_broadcast_ps (&a[2].simd);
+   const __m256 a3 = _mm256_broadcast_ps (&a[3].simd);
+   for (std::size_t j = 0; j < 4; j += 2) {
+      const __m256 bj = _mm256_loadu_ps (reinterpret_cast<const float *> (&b[j]));
+      __m256       r  = _mm256_mul_ps (a0, _mm256_permute_ps (bj, 0x00));
+#ifdef MRN_SIMD_FMA
+      r = _mm256_fmadd_ps (a1, _mm256_permute_ps (bj, 0x55), r);
+      r = _mm256_fmadd_ps (a2, _mm256_permute_ps (bj, 0xaa), r);
+      r = _mm256_fmadd_ps (a3, _mm256_permute_ps (bj, 0xff), r);
+#else
+      r = _mm256_add_ps (_mm256_mul_ps (a1, _mm256_permute_ps (bj, 0x55)), r);
+      r = _mm256_add_ps (_mm256_mul_ps (a2, _mm256_permute_ps (bj, 0xaa)), r);
+      r = _mm256_add_ps (_mm256_mul_ps (a3, _mm256_permute_ps (bj, 0xff)), r);
+#endif
+      _mm256_storeu_ps (reinterpret_cast<float *> (&result[j]), r);
+   }
+#else
+   for (std::size_t j = 0; j < 4; j++) {
+      result[j].simd = simd_mat4_mul (a, b[j].simd);
+   }
+#endif
+}
+
+/* 2x2 matrices in a single register, as (m00 m01 m10 m11).
+ * the adjugate adj(A) is the inverse of A, times det(A)
+ */
+inline auto simd_mat2_mul (__m128 a, __m128 b) -> __m128
+{
+   return _mm_add_ps (_mm_mul_ps (a, simd_swizzle<0, 3, 0, 3> (b)),
+                      _mm_mul_ps (simd_swizzle<1, 0, 3, 2> (a), simd_swizzle<2, 1, 2, 1> (b)));
+}
+
+// adj(A) * B
+inline auto simd_mat2_adj_mul (__m128 a, __m128 b) -> __m128
+{
+   return _mm_sub_ps (_mm_mul_ps (simd_swizzle<3, 3, 0, 0> (a), b),
+                      _mm_mul_ps (simd_swizzle<1, 1, 2, 2> (a), simd_swizzle<2, 3, 0, 1> (b)));
+}
+
+// A * adj(B)
+inline auto simd_mat2_mul_adj (__m128 a, __m128 b) -> __m128
+{
+   return _mm_sub_ps (_mm_mul_ps (a, simd_swizzle<3, 0, 3, 0> (b)),
+                      _mm_mul_ps (simd_swizzle<1, 0, 3, 2> (a), simd_swizzle<2, 1, 2, 1> (b)));
+}
+
+/* inverse via 2x2 blocks: with M = (A B / C D) every block of the
+ * inverse is a handful of 2x2 products of A, B, C, D and their
+ * adjugates, which is the cofactor-expansion without any redundant
+ * sub-determinant. Since inverse(transpose(M)) = transpose(inverse(M)),
+ * it doesn't matter that the blocks are built from columns.
+ */
+inline void simd_mat4_inverse (const vec<float, 4> *cols, vec<float, 4> *result)
+{
+   const __m128 c0 = cols[0].simd, c1 = cols[1].simd, c2 = cols[2].simd, c3 = cols[3].simd;
+
+   const __m128 a = _mm_movelh_ps (c0, c1);
+   const __m128 b = _mm_movehl_ps (c1, c0);
+   const __m128 c = _mm_movelh_ps (c2, c3);
+   const __m128 d = _mm_movehl_ps (c3, c2);
+
+   // (det(A) det(B) det(C) det(D))
+   const __m128 det_sub = _mm_sub_ps (
+      _mm_mul_ps (_mm_shuffle_ps (c0, c2, _MM_SHUFFLE (2, 0, 2, 0)), _mm_shuffle_ps (c1, c3, _MM_SHUFFLE (3, 1, 3, 1))),
+      _mm_mul_ps (_mm_shuffle_ps (c0, c2, _MM_SHUFFLE (3, 1, 3, 1)), _mm_shuffle_ps (c1, c3, _MM_SHUFFLE (2, 0, 2, 0))));
+   const __m128 det_a = simd_splat<0> (det_sub);
+   const __m128 det_b = simd_splat<1> (det_sub);
+   const __m128 det_c = simd_splat<2> (det_sub);
+   const __m128 det_d = simd_splat<3> (det_sub);
+
+   const __m128 d_c = simd_mat2_adj_mul (d, c);
+   const __m128 a_b = simd_mat2_adj_mul (a, b);
+
+   // adjugates of the result-blocks (X Y / Z W), still without 1 / det(M)
+   __m128 x = _mm_sub_ps (_mm_mul_ps (det_d, a), simd_mat2_mul (b, d_c));
+   __m128 w = _mm_sub_ps (_mm_mul_ps (det_a, d), simd_mat2_mul (c, a_b));
+   __m128 y = _mm_sub_ps (_mm_mul_ps (det_b, c), simd_mat2_mul_adj (d, a_b));
+   __m128 z = _mm_sub_ps (_mm_mul_ps (det_c, b), simd_mat2_mul_adj (a, d_c));
+
+   // det(M) = det(A) det(D) + det(B) det(C) - trace(adj(A) B adj(D) C)
+   __m128 det = _mm_add_ps (_mm_mul_ps (det_a, det_d), _mm_mul_ps (det_b, det_c));
+   det        = _mm_sub_ps (det, simd_hsum (_mm_mul_ps (a_b, simd_swizzle<0, 2, 1, 3> (d_c))));
+
+   // the signs of the adjugate go into the reciprocal
+   const __m128 inv = _mm_div_ps (_mm_setr_ps (1.0f, -1.0f, -1.0f, 1.0f), det);
+   x                = _mm_mul_ps (x, inv);
+   y                = _mm_mul_ps (y, inv);
+   z                = _mm_mul_ps (z, inv);
+   w                = _mm_mul_ps (w, inv);
+
+   // undo the adjugate and the block-layout in one shuffle per column
+   result[0].simd = _mm_shuffle_ps (x, y, _MM_SHUFFLE (1, 3, 1, 3));
+   result[1].simd = _mm_shuffle_ps (x, y, _MM_SHUFFLE (0, 2, 0, 2));
+   result[2].simd = _mm_shuffle_ps (z, w, _MM_SHUFFLE (1, 3, 1, 3));
+   result[3].simd = _mm_shuffle_ps (z, w, _MM_SHUFFLE (0, 2, 0, 2));
+}
+
+/* affine: the rows of the inverse 3x3 part are the cross products of
+ * its columns over the determinant, the translation is rotated back by
+ * that
+ */
+inline void simd_mat4_inverse_affine (const vec<float, 4> *cols, vec<float, 4> *result)
+{
+   const __m128 c0 = cols[0].simd, c1 = cols[1].simd, c2 = cols[2].simd;
+
+   __m128       r0  = simd_cross (c1, c2);
+   __m128       r1  = simd_cross (c2, c0);
+   __m128       r2  = simd_cross (c0, c1);
+   __m128       r3  = _mm_setr_ps (0.0f, 0.0f, 0.0f, 1.0f);
+   const __m128 inv = _mm_div_ps (_mm_set1_ps (1.0f), simd_dot4 (c0, r0));
+   r0               = _mm_mul_ps (r0, inv);
+   r1               = _mm_mul_ps (r1, inv);
+   r2               = _mm_mul_ps (r2, inv);
+   _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+
+   const __m128 t = cols[3].simd;
+   __m128       lo = _mm_mul_ps (r0, simd_splat<0> (t));
+   __m128       hi = _mm_mul_ps (r2, simd_splat<2> (t));
+   lo             = simd_fmadd (r1, simd_splat<1> (t), lo);
+
+   result[0].simd = r0;
+   result[1].simd = r1;
+   result[2].simd = r2;
+   result[3].simd = _mm_sub_ps (r3, _mm_add_ps (lo, hi));
+}
+#endif
+
+/* Projections
+ * -----------
+ * options of the projection-factories, or-ed together. The default is
+ * OpenGL: depth from -1 at the near plane to 1 at the far plane.
+ * zero_to_one is the 0 to 1 depth-range of D3D, Vulkan or
+ * glClipControl. reversed_z maps the near plane to 1 and the far plane
+ * to the bottom of the range, which together with zero_to_one and a
+ * float depth-buffer gives about the same precision at every distance.
+ * infinite_far moves the far plane of a perspective to infinity
+ */
+enum projection_flags : unsigned
+{
+   projection_gl          = 0,
+   projection_zero_to_one = 1 << 0,
+   projection_reversed_z  = 1 << 1,
+   projection_infinite    = 1 << 2,
+};
+
+/* the depth-row (A, B) of a projection: clip z = A z + B w of a point
+ * in view-space. Solved so that the distances z_near and z_far (view
+ * z = -z_near, -z_far) land on the two ends of the depth-range, after
+ * the division by w = -z in a perspective
+ */
+template <typename T>
+constexpr auto projection_depth (T z_near, T z_far, unsigned flags, bool perspective) -> vec<T, 2>
+{
+   const T lo      = flags & projection_zero_to_one ? 0 : -1;
+   const T d_near  = flags & projection_reversed_z ? 1 : lo;
+   const T d_far   = flags & projection_reversed_z ? lo : 1;
+   if (!perspective) {
+      assert (("An orthographic projection can't have an infinite far plane\n" && !(flags & projection_infinite)));
+      const T a = (d_near - d_far) / (z_far - z_near);
+      return vec<T, 2> (a, d_near + a * z_near);
+   }
+   if (flags & projection_infinite) {
+      return vec<T, 2> (-d_far, z_near * (d_near - d_far));
+   }
+   const T a = (d_near * z_near - d_far * z_far) / (z_far - z_near);
+   return vec<T, 2> (a, z_near * (d_near + a));
+}
+
 template <typename T, std::size_t _cols, std::size_t _rows>
 class mat
 {
@@ -9,21 +206,20 @@ class mat
    /* We make our Matrix column-major, because that's what OpenGL
     * does.
     * That is, we should think of our matrix as a concatenation of
-    * columns-vectors
+    * columns-vectors.
+    * Only the columns are stored. A T[][]-view in a union with them
+    * couldn't be read in constant expressions, which only allow the
+    * union-member that was written last
     */
-   union
-   {
-      T data[_cols][_rows];
-      struct
-      {
-         vec<T, _rows> cols[_cols];
-      };
-   };
+   vec<T, _rows> cols[_cols];
 
  public:
-   /* Default-Constructor generates the identity-matrix
+   /* Default-Constructor generates the identity-matrix.
+    * the columns are zero-initialized first, so the vec-unions have an
+    * active member in constant expressions
     */
-   mat ()
+   constexpr mat ()
+   : cols {}
    {
       for (std::size_t x = 0; x < _cols; x++) {
          for (std::size_t y = 0; y < _rows; y++) {
@@ -35,13 +231,14 @@ class mat
    /* Element-wise constructor, pass a list of vectors.
     * note that we have to pass column-vectors
     */
-   mat (const std::initializer_list<std::initializer_list<T>> &vals)
+   constexpr mat (const std::initializer_list<std::initializer_list<T>> &vals)
+   : cols {}
    {
       std::size_t x = 0;
       std::size_t y = 0;
       for (const auto &it_x : vals) {
          for (const auto &it_y : it_x) {
-            data[x][y++] = it_y;
+            cols[x][y++] = it_y;
          }
          y = 0;
          x++;
@@ -51,21 +248,33 @@ class mat
    /* Get a column with the []-operator, then use the []-operator
     * at the vector, so we can use [][] to get a single cell
     */
-   inline auto operator[] (std::size_t col) -> vec<T, _rows> &
+   constexpr auto operator[] (std::size_t col) -> vec<T, _rows> &
+   {
+      return this->cols[col];
+   }
+
+   constexpr auto operator[] (std::size_t col) const -> const vec<T, _rows> &
    {
       return this->cols[col];
    }
 
    /* Get cell via XY-vector, if you want
     */
-   inline auto operator[] (vec2i idx) -> T &
+   constexpr auto operator[] (vec2i idx) -> T &
    {
-      return data[idx.x][idx.y];
+      return cols[idx.x][idx.y];
+   }
+
+   constexpr auto operator[] (vec2i idx) const -> const T &
+   {
+      return cols[idx.x][idx.y];
    }
 
    /* Matrix + Matrix
+    * like the vector-operators: const references, and a temporary on the
+    * left (or on either side for +) holds the result
     */
-   inline auto operator+= (mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows> &
+   constexpr auto operator+= (const mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows> &
    {
       for (std::size_t i = 0; i < _rows; i++) {
          for (std::size_t j = 0; j < _cols; j++) {
@@ -75,14 +284,31 @@ class mat
       return *this;
    }
 
-   inline auto operator+ (mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows>
+   constexpr auto operator+ (const mat<T, _cols, _rows> &m) const & -> mat<T, _cols, _rows>
+   {
+      mat result = *this;
+      result += m;
+      return result;
+   }
+
+   constexpr auto operator+ (const mat<T, _cols, _rows> &m) && -> mat<T, _cols, _rows>
+   {
+      return std::move (*this += m);
+   }
+
+   constexpr auto operator+ (mat<T, _cols, _rows> &&m) const & -> mat<T, _cols, _rows>
+   {
+      return std::move (m += *this);
+   }
+
+   constexpr auto operator+ (mat<T, _cols, _rows> &&m) && -> mat<T, _cols, _rows>
    {
-      return mat (*this) += m;
+      return std::move (*this += m);
    }
 
    /* Matrix - Matrix
     */
-   inline auto operator-= (mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows> &
+   constexpr auto operator-= (const mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows> &
    {
       for (std::size_t i = 0; i < _rows; i++) {
          for (std::size_t j = 0; j < _cols; j++) {
@@ -92,15 +318,29 @@ class mat
       return *this;
    }
 
-   inline auto operator- (mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows>
+   constexpr auto operator- (const mat<T, _cols, _rows> &m) const & -> mat<T, _cols, _rows>
+   {
+      mat result = *this;
+      result -= m;
+      return result;
+   }
+
+   constexpr auto operator- (const mat<T, _cols, _rows> &m) && -> mat<T, _cols, _rows>
    {
-      return mat (*this) -= m;
+      return std::move (*this -= m);
    }
 
    /* Matrix * Vector
     */
-   inline auto operator* (vec<T, _rows> v) -> vec<T, _rows>
+   constexpr auto operator* (const vec<T, _cols> &v) const -> vec<T, _rows>
    {
+#ifdef MRN_SIMD_SSE2
+      if constexpr (std::is_same_v<T, float> && _cols == 4 && _rows == 4) {
+         if (!std::is_constant_evaluated ()) {
+            return vec<T, _rows> (simd_mat4_mul (cols, v.simd));
+         }
+      }
+#endif
       vec<T, _rows> result = {};
       for (std::size_t i = 0; i < _rows; i++) {
          for (std::size_t j = 0; j < _cols; j++) {
@@ -111,13 +351,29 @@ class mat
    }
 
    /* Matrix * Matrix
+    * from 16x16 on, floating-point matrices go through the blocked
+    * kernel in gemm.hpp, the small ones through the plain loops.
     */
    template <std::size_t _o>
-   inline auto operator* (mat<T, _cols, _o> m) -> mat<T, _rows, _o>
+   constexpr auto operator* (const mat<T, _o, _cols> &m) const -> mat<T, _o, _rows>
    {
       mat<T, _o, _rows> result;
-      for (std::size_t i = 0; i < _rows; i++) {
-         for (std::size_t j = 0; j < _cols; j++) {
+#ifdef MRN_SIMD_SSE2
+      if constexpr (std::is_same_v<T, float> && _cols == 4 && _rows == 4 && _o == 4) {
+         if (!std::is_constant_evaluated ()) {
+            simd_mat4_mul (cols, &m[0], &result[0]);
+            return result;
+         }
+      }
+#endif
+      if constexpr (std::is_floating_point_v<T> && _rows >= 16 && _cols >= 16 && _o >= 16) {
+         if (!std::is_constant_evaluated ()) {
+            gemm (_rows, _o, _cols, &cols[0][0], _rows, &m[0][0], _cols, &result[0][0], _rows);
+            return result;
+         }
+      }
+      for (std::size_t j = 0; j < _o; j++) {
+         for (std::size_t i = 0; i < _rows; i++) {
             T value = {};
             for (std::size_t k = 0; k < _cols; k++) {
                value += (*this)[k][i] * m[j][k];
@@ -128,40 +384,49 @@ class mat
       return result;
    }
 
-   static inline auto translate (const T x, const T y, const T z) -> mat<T, 4, 4>
+   /* in-place product, only square matrices keep their size. The product
+    * goes through a temporary, so m may be *this
+    */
+   constexpr auto operator*= (const mat<T, _cols, _rows> &m) -> mat<T, _cols, _rows> &
+   requires (_cols == _rows)
+   {
+      return *this = *this * m;
+   }
+
+   static constexpr auto translate (const T x, const T y, const T z) -> mat<T, 4, 4>
    {
       return mat ({ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { x, y, z, 1 } });
    }
 
-   static inline auto translate (const vec<T, 3> &v) -> mat<T, 4, 4>
+   static constexpr auto translate (const vec<T, 3> &v) -> mat<T, 4, 4>
    {
       return translate (v.x, v.y, v.z);
    }
 
-   static inline auto translate (const T x, const T y) -> mat<T, 3, 3>
+   static constexpr auto translate (const T x, const T y) -> mat<T, 3, 3>
    {
       return mat<T, 3, 3> ({ { 1, 0, 0 }, { 0, 1, 0 }, { x, y, 1 } });
    }
 
-   static inline auto translate (const vec<T, 2> &v) -> mat<T, 3, 3>
+   static constexpr auto translate (const vec<T, 2> &v) -> mat<T, 3, 3>
    {
       return translate (v.x, v.y);
    }
 
-   static inline auto scale (const T x, const T y, const T z) -> mat<T, 4, 4>
+   static constexpr auto scale (const T x, const T y, const T z) -> mat<T, 4, 4>
    {
       return mat ({ { x, 0, 0, 0 }, { 0, y, 0, 0 }, { 0, 0, z, 0 }, { 0, 0, 0, 1 } });
    }
 
-   static inline auto scale (vec<T, 3> &v) -> mat<T, 3, 3>
+   static constexpr auto scale (const vec<T, 3> &v) -> mat<T, 4, 4>
    {
       return scale (v.x, v.y, v.z);
    }
 
-   static inline auto rotate (const vec<T, 3> axis, T rad) -> mat<T, 4, 4>
+   static constexpr auto rotate (const vec<T, 3> axis, T rad) -> mat<T, 4, 4>
    {
-      const float c  = cos (rad);
-      const float s  = sin (rad);
+      const float c  = constexpr_cos (rad);
+      const float s  = constexpr_sin (rad);
       const float ic = 1.0 - c;
       const T &   x  = axis.x;
       const T &   y  = axis.y;
@@ -172,6 +437,59 @@ class mat
                     { x * z * ic + y * s, y * z * ic - x * s, z * z * ic + c, 0 },
                     { 0, 0, 0, 1 } });
    }
+
+   /* view- and projection-matrices in OpenGL conventions: a right-handed
+    * view-space with the camera at the origin looking down -z, and a
+    * clip-space of -w <= x, y <= w. The depth-range and the far plane
+    * depend on flags, see projection_flags. z_near and z_far are
+    * positive distances in front of the camera.
+    * frustum() is glFrustum, the general perspective with the near plane
+    * spanning left..right and bottom..top
+    */
+   static constexpr auto frustum (T left, T right, T bottom, T top, T z_near, T z_far,
+                                  unsigned flags = projection_gl) -> mat<T, 4, 4>
+   {
+      const vec<T, 2> depth = projection_depth (z_near, z_far, flags, true);
+      return mat ({ { 2 * z_near / (right - left), 0, 0, 0 },
+                    { 0, 2 * z_near / (top - bottom), 0, 0 },
+                    { (right + left) / (right - left), (top + bottom) / (top - bottom), depth.x, -1 },
+                    { 0, 0, depth.y, 0 } });
+   }
+
+   // gluPerspective, fovy is the vertical field of view in radians
+   static constexpr auto perspective (T fovy, T aspect, T z_near, T z_far, unsigned flags = projection_gl)
+     -> mat<T, 4, 4>
+   {
+      const T top = z_near * constexpr_sin (fovy / 2) / constexpr_cos (fovy / 2);
+      return frustum (-top * aspect, top * aspect, -top, top, z_near, z_far, flags);
+   }
+
+   // glOrtho, projection_infinite is not allowed
+   static constexpr auto orthographic (T left, T right, T bottom, T top, T z_near, T z_far,
+                                       unsigned flags = projection_gl) -> mat<T, 4, 4>
+   {
+      const vec<T, 2> depth = projection_depth (z_near, z_far, flags, false);
+      return mat ({ { 2 / (right - left), 0, 0, 0 },
+                    { 0, 2 / (top - bottom), 0, 0 },
+                    { 0, 0, depth.x, 0 },
+                    { -(right + left) / (right - left), -(top + bottom) / (top - bottom), depth.y, 1 } });
+   }
+
+   /* gluLookAt: the camera at eye looks at center, up is the rough
+    * direction of the y-axis on screen and must not be parallel to the
+    * direction of view
+    */
+   static constexpr auto look_at (const vec<T, 3> &eye, const vec<T, 3> &center, const vec<T, 3> &up)
+     -> mat<T, 4, 4>
+   {
+      const vec<T, 3> f = norm (center - eye);
+      const vec<T, 3> s = norm (cross (f, up));
+      const vec<T, 3> u = cross (s, f);
+      return mat ({ { s.x, u.x, -f.x, 0 },
+                    { s.y, u.y, -f.y, 0 },
+                    { s.z, u.z, -f.z, 0 },
+                    { -dot (s, eye), -dot (u, eye), dot (f, eye), 1 } });
+   }
 };
 
 typedef mat<float, 4, 4> mat4;
@@ -209,3 +527,235 @@ typedef mat<bool, 4, 2> mat4x2b;
 typedef mat<bool, 4, 3> mat4x3b;
 typedef mat<bool, 2, 4> mat2x4b;
 typedef mat<bool, 2, 3> mat2x3b;
+
+/* Matrix Functions
+ * ----------------
+ */
+template <typename T, std::size_t _cols, std::size_t _rows>
+constexpr auto transpose (const mat<T, _cols, _rows> &m) -> mat<T, _rows, _cols>
+{
+   mat<T, _rows, _cols> result;
+#ifdef MRN_SIMD_SSE2
+   if constexpr (std::is_same_v<T, float> && _cols == 4 && _rows == 4) {
+      if (!std::is_constant_evaluated ()) {
+         __m128 c0 = m[0].simd, c1 = m[1].simd, c2 = m[2].simd, c3 = m[3].simd;
+         _MM_TRANSPOSE4_PS (c0, c1, c2, c3);
+         result[0].simd = c0;
+         result[1].simd = c1;
+         result[2].simd = c2;
+         result[3].simd = c3;
+         return result;
+      }
+   }
+#endif
+   for (std::size_t i = 0; i < _cols; i++) {
+      for (std::size_t j = 0; j < _rows; j++) {
+         result[j][i] = m[i][j];
+      }
+   }
+   return result;
+}
+
+template <typename T>
+constexpr auto determinant (const mat<T, 2, 2> &m) -> T
+{
+   return m[0][0] * m[1][1] - m[1][0] * m[0][1];
+}
+
+template <typename T>
+constexpr auto determinant (const mat<T, 3, 3> &m) -> T
+{
+   return dot (m[0], cross (m[1], m[2]));
+}
+
+/* the 2x2 sub-determinants of the first and the last two columns,
+ * shared by determinant() and inverse() of a 4x4-matrix
+ */
+template <typename T>
+struct mat4_minors
+{
+   T s0, s1, s2, s3, s4, s5;
+   T c0, c1, c2, c3, c4, c5;
+
+   constexpr mat4_minors (const mat<T, 4, 4> &m)
+   : s0 (m[0][0] * m[1][1] - m[1][0] * m[0][1]), s1 (m[0][0] * m[1][2] - m[1][0] * m[0][2]),
+     s2 (m[0][0] * m[1][3] - m[1][0] * m[0][3]), s3 (m[0][1] * m[1][2] - m[1][1] * m[0][2]),
+     s4 (m[0][1] * m[1][3] - m[1][1] * m[0][3]), s5 (m[0][2] * m[1][3] - m[1][2] * m[0][3]),
+     c0 (m[2][0] * m[3][1] - m[3][0] * m[2][1]), c1 (m[2][0] * m[3][2] - m[3][0] * m[2][2]),
+     c2 (m[2][0] * m[3][3] - m[3][0] * m[2][3]), c3 (m[2][1] * m[3][2] - m[3][1] * m[2][2]),
+     c4 (m[2][1] * m[3][3] - m[3][1] * m[2][3]), c5 (m[2][2] * m[3][3] - m[3][2] * m[2][3])
+   {
+   }
+
+   constexpr auto determinant () const -> T
+   {
+      return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+   }
+};
+
+template <typename T>
+constexpr auto determinant (const mat<T, 4, 4> &m) -> T
+{
+   return mat4_minors<T> (m).determinant ();
+}
+
+/* Inverse
+ * the determinant is not checked, a singular matrix gives inf or nan.
+ * Use determinant() first if that can happen
+ */
+template <typename T>
+constexpr auto inverse (const mat<T, 2, 2> &m) -> mat<T, 2, 2>
+{
+   const T inv = T (1) / determinant (m);
+   return mat<T, 2, 2> ({ { m[1][1] * inv, -m[0][1] * inv }, { -m[1][0] * inv, m[0][0] * inv } });
+}
+
+/* the rows of the inverse are the cross products of the columns, over
+ * the determinant
+ */
+template <typename T>
+constexpr auto inverse (const mat<T, 3, 3> &m) -> mat<T, 3, 3>
+{
+   const vec<T, 3> r0  = cross (m[1], m[2]);
+   const vec<T, 3> r1  = cross (m[2], m[0]);
+   const vec<T, 3> r2  = cross (m[0], m[1]);
+   const T         inv = T (1) / dot (m[0], r0);
+
+   mat<T, 3, 3> result;
+   for (std::size_t i = 0; i < 3; i++) {
+      result[i][0] = r0[i] * inv;
+      result[i][1] = r1[i] * inv;
+      result[i][2] = r2[i] * inv;
+   }
+   return result;
+}
+
+template <typename T>
+constexpr auto inverse (const mat<T, 4, 4> &m) -> mat<T, 4, 4>
+{
+   mat<T, 4, 4> result;
+#ifdef MRN_SIMD_SSE2
+   if constexpr (std::is_same_v<T, float>) {
+      if (!std::is_constant_evaluated ()) {
+         simd_mat4_inverse (&m[0], &result[0]);
+         return result;
+      }
+   }
+#endif
+   const mat4_minors<T> k (m);
+   const T              inv = T (1) / k.determinant ();
+
+   result[0][0] = (m[1][1] * k.c5 - m[1][2] * k.c4 + m[1][3] * k.c3) * inv;
+   result[0][1] = (-m[0][1] * k.c5 + m[0][2] * k.c4 - m[0][3] * k.c3) * inv;
+   result[0][2] = (m[3][1] * k.s5 - m[3][2] * k.s4 + m[3][3] * k.s3) * inv;
+   result[0][3] = (-m[2][1] * k.s5 + m[2][2] * k.s4 - m[2][3] * k.s3) * inv;
+
+   result[1][0] = (-m[1][0] * k.c5 + m[1][2] * k.c2 - m[1][3] * k.c1) * inv;
+   result[1][1] = (m[0][0] * k.c5 - m[0][2] * k.c2 + m[0][3] * k.c1) * inv;
+   result[1][2] = (-m[3][0] * k.s5 + m[3][2] * k.s2 - m[3][3] * k.s1) * inv;
+   result[1][3] = (m[2][0] * k.s5 - m[2][2] * k.s2 + m[2][3] * k.s1) * inv;
+
+   result[2][0] = (m[1][0] * k.c4 - m[1][1] * k.c2 + m[1][3] * k.c0) * inv;
+   result[2][1] = (-m[0][0] * k.c4 + m[0][1] * k.c2 - m[0][3] * k.c0) * inv;
+   result[2][2] = (m[3][0] * k.s4 - m[3][1] * k.s2 + m[3][3] * k.s0) * inv;
+   result[2][3] = (-m[2][0] * k.s4 + m[2][1] * k.s2 - m[2][3] * k.s0) * inv;
+
+   result[3][0] = (-m[1][0] * k.c3 + m[1][1] * k.c1 - m[1][2] * k.c0) * inv;
+   result[3][1] = (m[0][0] * k.c3 - m[0][1] * k.c1 + m[0][2] * k.c0) * inv;
+   result[3][2] = (-m[3][0] * k.s3 + m[3][1] * k.s1 - m[3][2] * k.s0) * inv;
+   result[3][3] = (m[2][0] * k.s3 - m[2][1] * k.s1 + m[2][2] * k.s0) * inv;
+   return result;
+}
+
+/* Affine Inverse
+ * for matrices whose last row is (0 ... 0 1), i.e. any combination of
+ * rotation, scale, shear and translation. Only the linear part needs
+ * a real inverse, the translation is just rotated back by it
+ */
+template <typename T>
+constexpr auto inverse_affine (const mat<T, 3, 3> &m) -> mat<T, 3, 3>
+{
+   const T inv = T (1) / (m[0][0] * m[1][1] - m[1][0] * m[0][1]);
+
+   mat<T, 3, 3> result;
+   result[0][0] = m[1][1] * inv;
+   result[0][1] = -m[0][1] * inv;
+   result[1][0] = -m[1][0] * inv;
+   result[1][1] = m[0][0] * inv;
+   result[2][0] = -(result[0][0] * m[2][0] + result[1][0] * m[2][1]);
+   result[2][1] = -(result[0][1] * m[2][0] + result[1][1] * m[2][1]);
+   return result;
+}
+
+template <typename T>
+constexpr auto inverse_affine (const mat<T, 4, 4> &m) -> mat<T, 4, 4>
+{
+   mat<T, 4, 4> result;
+#ifdef MRN_SIMD_SSE2
+   if constexpr (std::is_same_v<T, float>) {
+      if (!std::is_constant_evaluated ()) {
+         simd_mat4_inverse_affine (&m[0], &result[0]);
+         return result;
+      }
+   }
+#endif
+   const vec<T, 3> c0 = vec<T, 3> (m[0][0], m[0][1], m[0][2]);
+   const vec<T, 3> c1 = vec<T, 3> (m[1][0], m[1][1], m[1][2]);
+   const vec<T, 3> c2 = vec<T, 3> (m[2][0], m[2][1], m[2][2]);
+   const vec<T, 3> r0 = cross (c1, c2);
+   const vec<T, 3> r1 = cross (c2, c0);
+   const vec<T, 3> r2 = cross (c0, c1);
+   const T         inv = T (1) / dot (c0, r0);
+
+   for (std::size_t i = 0; i < 3; i++) {
+      result[i][0] = r0[i] * inv;
+      result[i][1] = r1[i] * inv;
+      result[i][2] = r2[i] * inv;
+   }
+   for (std::size_t j = 0; j < 3; j++) {
+      result[3][j] = -(result[0][j] * m[3][0] + result[1][j] * m[3][1] + result[2][j] * m[3][2]);
+   }
+   return result;
+}
+
+/* Inverse of a projection
+ * the factories leave most coefficients 0, so their inverses are just
+ * as sparse and a few divisions instead of a full inverse().
+ * inverse_perspective() is for perspective() and frustum(), with any
+ * flags: clip (X, Y, Z, W) comes from view-space z = -W, and x, y, w
+ * follow from the remaining rows
+ */
+template <typename T>
+constexpr auto inverse_perspective (const mat<T, 4, 4> &m) -> mat<T, 4, 4>
+{
+   const T a = m[0][0], b = m[1][1], c = m[2][0], d = m[2][1];
+   const T A = m[2][2], B = m[3][2];
+   return mat<T, 4, 4> ({ { 1 / a, 0, 0, 0 }, { 0, 1 / b, 0, 0 }, { 0, 0, 0, 1 / B }, { c / a, d / b, -1, A / B } });
+}
+
+template <typename T>
+constexpr auto inverse_orthographic (const mat<T, 4, 4> &m) -> mat<T, 4, 4>
+{
+   const T a = m[0][0], b = m[1][1], A = m[2][2];
+   return mat<T, 4, 4> (
+     { { 1 / a, 0, 0, 0 }, { 0, 1 / b, 0, 0 }, { 0, 0, 1 / A, 0 }, { -m[3][0] / a, -m[3][1] / b, -m[3][2] / A, 1 } });
+}
+
+/* the view-matrix of look_at() is a rotation and a translation, so its
+ * inverse is the transposed rotation and the translation rotated back.
+ * That holds for any rigid transformation
+ */
+template <typename T>
+constexpr auto inverse_look_at (const mat<T, 4, 4> &m) -> mat<T, 4, 4>
+{
+   mat<T, 4, 4> result;
+   for (std::size_t i = 0; i < 3; i++) {
+      for (std::size_t j = 0; j < 3; j++) {
+         result[i][j] = m[j][i];
+      }
+   }
+   for (std::size_t j = 0; j < 3; j++) {
+      result[3][j] = -(m[j][0] * m[3][0] + m[j][1] * m[3][1] + m[j][2] * m[3][2]);
+   }
+   return result;
+}
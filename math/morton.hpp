@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simd.hpp"
+
+/* Morton codes.
+ * the bits of x, y and z interleaved, x in the lowest, which orders
+ * points along a Z-curve: points close to each other mostly have codes
+ * close to each other. Each of x, y and z is in [0, 1024) for a 30-bit
+ * code, in [0, 2097152) for a 63-bit code. The bits are spread with
+ * shifts and masks. Define MRN_MATH_PDEP and compile with BMI2 to use a
+ * single pdep per axis instead, which is faster on Intel and on AMD since
+ * Zen 3, but a lot slower on Zen 1 and 2
+ */
+
+inline auto morton_code (std::uint32_t x, std::uint32_t y, std::uint32_t z) -> std::uint32_t
+{
+#ifdef MRN_SIMD_BMI2
+   return _pdep_u32 (x, 0x09249249u) | _pdep_u32 (y, 0x12492492u) | _pdep_u32 (z, 0x24924924u);
+#else
+   auto spread = [] (std::uint32_t v) {
+      v = (v | v << 16) & 0x030000ffu;
+      v = (v | v << 8) & 0x0300f00fu;
+      v = (v | v << 4) & 0x030c30c3u;
+      return (v | v << 2) & 0x09249249u;
+   };
+   return spread (x) | spread (y) << 1 | spread (z) << 2;
+#endif
+}
+
+inline auto morton_code (std::uint64_t x, std::uint64_t y, std::uint64_t z) -> std::uint64_t
+{
+#ifdef MRN_SIMD_BMI2
+   return _pdep_u64 (x, 0x1249249249249249ull) | _pdep_u64 (y, 0x2492492492492492ull)
+          | _pdep_u64 (z, 0x4924924924924924ull);
+#else
+   auto spread = [] (std::uint64_t v) {
+      v = (v | v << 32) & 0x001f00000000ffffull;
+      v = (v | v << 16) & 0x001f0000ff0000ffull;
+      v = (v | v << 8) & 0x100f00f00f00f00full;
+      v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+      return (v | v << 2) & 0x1249249249249249ull;
+   };
+   return spread (x) | spread (y) << 1 | spread (z) << 2;
+#endif
+}
+
+/* the bits of a code per axis
+ */
+template <typename Code>
+constexpr std::size_t morton_bits = sizeof (Code) == 4 ? 10 : 21;
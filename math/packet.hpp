@@ -0,0 +1,774 @@
+#pragma once
+
+#include <cstdint>
+
+#include "matrix.hpp"
+#include "simd.hpp"
+#include "soa.hpp"
+#include "vector.hpp"
+
+/* SIMD lane types.
+ * simd_float8 is 8 floats that behave like a single float, so it can be
+ * used as T in vec<T, n>: vec<simd_float8, 3> is 8 vec3 in AoSoA layout
+ * and cross(), dot(), norm() ... process all 8 of them in one call.
+ * With AVX every operation is one instruction, without it we fall back
+ * to plain loops over the lanes.
+ * Comparisons are lane-wise and give a simd_mask8 instead of bool.
+ */
+
+class simd_mask8
+{
+ public:
+   simd_mask8 () = default;
+
+   simd_mask8 (bool val)
+   {
+#ifdef MRN_SIMD_AVX
+      v = _mm256_castsi256_ps (_mm256_set1_epi32 (val ? -1 : 0));
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         v[i] = val ? -1 : 0;
+#endif
+   }
+
+   inline auto operator[] (std::size_t idx) const -> bool
+   {
+      assert (("Index out of range\n" && idx < 8));
+      return (bits () >> idx) & 1;
+   }
+
+   /* one bit per lane, lane 0 is the lowest bit
+    */
+   inline auto bits () const -> int
+   {
+#ifdef MRN_SIMD_AVX
+      return _mm256_movemask_ps (v);
+#else
+      int result = 0;
+      for (std::size_t i = 0; i < 8; i++)
+         result |= (v[i] != 0) << i;
+      return result;
+#endif
+   }
+
+#ifdef MRN_SIMD_AVX
+   __m256 v;
+#else
+   std::int32_t v[8];
+#endif
+};
+
+inline auto operator& (simd_mask8 m1, simd_mask8 m2) -> simd_mask8
+{
+#ifdef MRN_SIMD_AVX
+   m1.v = _mm256_and_ps (m1.v, m2.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      m1.v[i] &= m2.v[i];
+#endif
+   return m1;
+}
+
+inline auto operator| (simd_mask8 m1, simd_mask8 m2) -> simd_mask8
+{
+#ifdef MRN_SIMD_AVX
+   m1.v = _mm256_or_ps (m1.v, m2.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      m1.v[i] |= m2.v[i];
+#endif
+   return m1;
+}
+
+inline auto operator^ (simd_mask8 m1, simd_mask8 m2) -> simd_mask8
+{
+#ifdef MRN_SIMD_AVX
+   m1.v = _mm256_xor_ps (m1.v, m2.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      m1.v[i] ^= m2.v[i];
+#endif
+   return m1;
+}
+
+inline auto operator~ (simd_mask8 m) -> simd_mask8
+{
+   return m ^ simd_mask8 (true);
+}
+
+inline auto any (simd_mask8 m) -> bool
+{
+   return m.bits () != 0;
+}
+
+inline auto all (simd_mask8 m) -> bool
+{
+   return m.bits () == 0xff;
+}
+
+inline auto none (simd_mask8 m) -> bool
+{
+   return m.bits () == 0;
+}
+
+class simd_float8
+{
+ public:
+   /* default constructor has no initialization, just like float.
+    * It has to stay trivial, so the type can live in the unions of
+    * vec<T, n>
+    */
+   simd_float8 () = default;
+
+   /* broadcast a single value into all lanes
+    */
+   simd_float8 (float val)
+   {
+#ifdef MRN_SIMD_AVX
+      v = _mm256_set1_ps (val);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         v[i] = val;
+#endif
+   }
+
+   static inline auto load (const float *p) -> simd_float8
+   {
+      simd_float8 result;
+#ifdef MRN_SIMD_AVX
+      result.v = _mm256_loadu_ps (p);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         result.v[i] = p[i];
+#endif
+      return result;
+   }
+
+   inline void store (float *p) const
+   {
+#ifdef MRN_SIMD_AVX
+      _mm256_storeu_ps (p, v);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         p[i] = v[i];
+#endif
+   }
+
+   inline auto operator[] (std::size_t idx) -> float &
+   {
+      assert (("Index out of range\n" && idx < 8));
+      return reinterpret_cast<float *> (this)[idx];
+   }
+
+   inline auto operator[] (std::size_t idx) const -> float
+   {
+      assert (("Index out of range\n" && idx < 8));
+      return reinterpret_cast<const float *> (this)[idx];
+   }
+
+   inline auto operator+= (simd_float8 f) -> simd_float8 &
+   {
+#ifdef MRN_SIMD_AVX
+      v = _mm256_add_ps (v, f.v);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         v[i] += f.v[i];
+#endif
+      return *this;
+   }
+
+   inline auto operator-= (simd_float8 f) -> simd_float8 &
+   {
+#ifdef MRN_SIMD_AVX
+      v = _mm256_sub_ps (v, f.v);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         v[i] -= f.v[i];
+#endif
+      return *this;
+   }
+
+   inline auto operator*= (simd_float8 f) -> simd_float8 &
+   {
+#ifdef MRN_SIMD_AVX
+      v = _mm256_mul_ps (v, f.v);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         v[i] *= f.v[i];
+#endif
+      return *this;
+   }
+
+   inline auto operator/= (simd_float8 f) -> simd_float8 &
+   {
+#ifdef MRN_SIMD_AVX
+      v = _mm256_div_ps (v, f.v);
+#else
+      for (std::size_t i = 0; i < 8; i++)
+         v[i] /= f.v[i];
+#endif
+      return *this;
+   }
+
+#ifdef MRN_SIMD_AVX
+   __m256 v;
+#else
+   float v[8];
+#endif
+};
+
+/* Lane-wise arithmetic
+ */
+inline auto operator- (simd_float8 f) -> simd_float8
+{
+   return simd_float8 (0.0f) -= f;
+}
+
+inline auto operator+ (simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+   return f1 += f2;
+}
+
+inline auto operator- (simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+   return f1 -= f2;
+}
+
+inline auto operator* (simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+   return f1 *= f2;
+}
+
+inline auto operator/ (simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+   return f1 /= f2;
+}
+
+/* a * b + c, a single rounding with FMA
+ */
+inline auto fmadd (simd_float8 a, simd_float8 b, simd_float8 c) -> simd_float8
+{
+#if defined(MRN_SIMD_AVX) && defined(MRN_SIMD_FMA)
+   c.v = _mm256_fmadd_ps (a.v, b.v, c.v);
+#elif defined(MRN_SIMD_AVX)
+   c.v = _mm256_add_ps (_mm256_mul_ps (a.v, b.v), c.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      c.v[i] = a.v[i] * b.v[i] + c.v[i];
+#endif
+   return c;
+}
+
+inline auto sqrt (simd_float8 f) -> simd_float8
+{
+#ifdef MRN_SIMD_AVX
+   f.v = _mm256_sqrt_ps (f.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      f.v[i] = ::sqrtf (f.v[i]);
+#endif
+   return f;
+}
+
+inline auto min (simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+#ifdef MRN_SIMD_AVX
+   f1.v = _mm256_min_ps (f1.v, f2.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      f1.v[i] = f2.v[i] < f1.v[i] ? f2.v[i] : f1.v[i];
+#endif
+   return f1;
+}
+
+inline auto max (simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+#ifdef MRN_SIMD_AVX
+   f1.v = _mm256_max_ps (f1.v, f2.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      f1.v[i] = f2.v[i] > f1.v[i] ? f2.v[i] : f1.v[i];
+#endif
+   return f1;
+}
+
+inline auto abs (simd_float8 f) -> simd_float8
+{
+   return max (f, -f);
+}
+
+/* m ? f1 : f2, per lane
+ */
+inline auto select (simd_mask8 m, simd_float8 f1, simd_float8 f2) -> simd_float8
+{
+#ifdef MRN_SIMD_AVX
+   f2.v = _mm256_blendv_ps (f2.v, f1.v, m.v);
+#else
+   for (std::size_t i = 0; i < 8; i++)
+      f2.v[i] = m.v[i] ? f1.v[i] : f2.v[i];
+#endif
+   return f2;
+}
+
+/* Lane-wise comparison
+ */
+#ifdef MRN_SIMD_AVX
+#define SIMD_FLOAT8_CMP(op, pred)                                   \
+   inline auto operator op (simd_float8 f1, simd_float8 f2)->simd_mask8 \
+   {                                                                \
+      simd_mask8 m;                                                 \
+      m.v = _mm256_cmp_ps (f1.v, f2.v, pred);                       \
+      return m;                                                     \
+   }
+#else
+#define SIMD_FLOAT8_CMP(op, pred)                                   \
+   inline auto operator op (simd_float8 f1, simd_float8 f2)->simd_mask8 \
+   {                                                                \
+      simd_mask8 m;                                                 \
+      for (std::size_t i = 0; i < 8; i++)                           \
+         m.v[i] = f1.v[i] op f2.v[i] ? -1 : 0;                      \
+      return m;                                                     \
+   }
+#endif
+
+SIMD_FLOAT8_CMP (<, _CMP_LT_OQ)
+SIMD_FLOAT8_CMP (<=, _CMP_LE_OQ)
+SIMD_FLOAT8_CMP (>, _CMP_GT_OQ)
+SIMD_FLOAT8_CMP (>=, _CMP_GE_OQ)
+SIMD_FLOAT8_CMP (==, _CMP_EQ_OQ)
+SIMD_FLOAT8_CMP (!=, _CMP_NEQ_UQ)
+
+#undef SIMD_FLOAT8_CMP
+
+/* Half-width lanes
+ * ----------------
+ * simd_float4 and simd_mask4 are the 4-lane counterparts of simd_float8
+ * and simd_mask8, in a single SSE register. For code that has 4 of
+ * something rather than 8, or runs without AVX, where simd_float8 falls
+ * back to loops
+ */
+class simd_mask4
+{
+ public:
+   simd_mask4 () = default;
+
+   simd_mask4 (bool val)
+   {
+#ifdef MRN_SIMD_SSE2
+      v = _mm_castsi128_ps (_mm_set1_epi32 (val ? -1 : 0));
+#else
+      for (std::size_t i = 0; i < 4; i++)
+         v[i] = val ? -1 : 0;
+#endif
+   }
+
+   inline auto operator[] (std::size_t idx) const -> bool
+   {
+      assert (("Index out of range\n" && idx < 4));
+      return (bits () >> idx) & 1;
+   }
+
+   inline auto bits () const -> int
+   {
+#ifdef MRN_SIMD_SSE2
+      return _mm_movemask_ps (v);
+#else
+      int result = 0;
+      for (std::size_t i = 0; i < 4; i++)
+         result |= (v[i] != 0) << i;
+      return result;
+#endif
+   }
+
+#ifdef MRN_SIMD_SSE2
+   __m128 v;
+#else
+   std::int32_t v[4];
+#endif
+};
+
+inline auto operator& (simd_mask4 m1, simd_mask4 m2) -> simd_mask4
+{
+#ifdef MRN_SIMD_SSE2
+   m1.v = _mm_and_ps (m1.v, m2.v);
+#else
+   for (std::size_t i = 0; i < 4; i++)
+      m1.v[i] &= m2.v[i];
+#endif
+   return m1;
+}
+
+inline auto operator| (simd_mask4 m1, simd_mask4 m2) -> simd_mask4
+{
+#ifdef MRN_SIMD_SSE2
+   m1.v = _mm_or_ps (m1.v, m2.v);
+#else
+   for (std::size_t i = 0; i < 4; i++)
+      m1.v[i] |= m2.v[i];
+#endif
+   return m1;
+}
+
+inline auto operator^ (simd_mask4 m1, simd_mask4 m2) -> simd_mask4
+{
+#ifdef MRN_SIMD_SSE2
+   m1.v = _mm_xor_ps (m1.v, m2.v);
+#else
+   for (std::size_t i = 0; i < 4; i++)
+      m1.v[i] ^= m2.v[i];
+#endif
+   return m1;
+}
+
+inline auto operator~ (simd_mask4 m) -> simd_mask4
+{
+#ifdef MRN_SIMD_SSE2
+   m.v = _mm_xor_ps (m.v, simd_mask4 (true).v);
+#else
+   for (std::size_t i = 0; i < 4; i++)
+      m.v[i] = ~m.v[i];
+#endif
+   return m;
+}
+
+inline auto any (simd_mask4 m) -> bool
+{
+   return m.bits () != 0;
+}
+
+inline auto all (simd_mask4 m) -> bool
+{
+   return m.bits () == 0xf;
+}
+
+inline auto none (simd_mask4 m) -> bool
+{
+   return m.bits () == 0;
+}
+
+class simd_float4
+{
+ public:
+   simd_float4 () = default;
+
+   simd_float4 (float val)
+   {
+#ifdef MRN_SIMD_SSE2
+      v = _mm_set1_ps (val);
+#else
+      for (std::size_t i = 0; i < 4; i++)
+         v[i] = val;
+#endif
+   }
+
+   static inline auto load (const float *p) -> simd_float4
+   {
+      simd_float4 result;
+#ifdef MRN_SIMD_SSE2
+      result.v = _mm_loadu_ps (p);
+#else
+      for (std::size_t i = 0; i < 4; i++)
+         result.v[i] = p[i];
+#endif
+      return result;
+   }
+
+   inline void store (float *p) const
+   {
+#ifdef MRN_SIMD_SSE2
+      _mm_storeu_ps (p, v);
+#else
+      for (std::size_t i = 0; i < 4; i++)
+         p[i] = v[i];
+#endif
+   }
+
+   inline auto operator[] (std::size_t idx) -> float &
+   {
+      assert (("Index out of range\n" && idx < 4));
+      return reinterpret_cast<float *> (this)[idx];
+   }
+
+   inline auto operator[] (std::size_t idx) const -> float
+   {
+      assert (("Index out of range\n" && idx < 4));
+      return reinterpret_cast<const float *> (this)[idx];
+   }
+
+#ifdef MRN_SIMD_SSE2
+   __m128 v;
+#else
+   float v[4];
+#endif
+};
+
+/* +, -, *, /, min and max are all the same shape
+ */
+#ifdef MRN_SIMD_SSE2
+#define SIMD_FLOAT4_OP(name, op, intrinsic)                                \
+   inline auto name (simd_float4 f1, simd_float4 f2)->simd_float4 \
+   {                                                                       \
+      f1.v = intrinsic (f1.v, f2.v);                                       \
+      return f1;                                                           \
+   }
+#else
+#define SIMD_FLOAT4_OP(name, op, intrinsic)                                \
+   inline auto name (simd_float4 f1, simd_float4 f2)->simd_float4 \
+   {                                                                       \
+      for (std::size_t i = 0; i < 4; i++)                                  \
+         f1.v[i] = op;                                                     \
+      return f1;                                                           \
+   }
+#endif
+
+SIMD_FLOAT4_OP (operator+, f1.v[i] + f2.v[i], _mm_add_ps)
+SIMD_FLOAT4_OP (operator-, f1.v[i] - f2.v[i], _mm_sub_ps)
+SIMD_FLOAT4_OP (operator*, f1.v[i] * f2.v[i], _mm_mul_ps)
+SIMD_FLOAT4_OP (operator/, f1.v[i] / f2.v[i], _mm_div_ps)
+SIMD_FLOAT4_OP (min, f2.v[i] < f1.v[i] ? f2.v[i] : f1.v[i], _mm_min_ps)
+SIMD_FLOAT4_OP (max, f2.v[i] > f1.v[i] ? f2.v[i] : f1.v[i], _mm_max_ps)
+
+#undef SIMD_FLOAT4_OP
+
+inline auto operator- (simd_float4 f) -> simd_float4
+{
+   return simd_float4 (0.0f) - f;
+}
+
+inline auto fmadd (simd_float4 a, simd_float4 b, simd_float4 c) -> simd_float4
+{
+#ifdef MRN_SIMD_SSE2
+   c.v = simd_fmadd (a.v, b.v, c.v);
+   return c;
+#else
+   return a * b + c;
+#endif
+}
+
+inline auto abs (simd_float4 f) -> simd_float4
+{
+   return max (f, -f);
+}
+
+inline auto select (simd_mask4 m, simd_float4 f1, simd_float4 f2) -> simd_float4
+{
+#ifdef MRN_SIMD_SSE2
+   f2.v = _mm_or_ps (_mm_and_ps (m.v, f1.v), _mm_andnot_ps (m.v, f2.v));
+#else
+   for (std::size_t i = 0; i < 4; i++)
+      f2.v[i] = m.v[i] ? f1.v[i] : f2.v[i];
+#endif
+   return f2;
+}
+
+#ifdef MRN_SIMD_SSE2
+#define SIMD_FLOAT4_CMP(op, intrinsic)                                  \
+   inline auto operator op (simd_float4 f1, simd_float4 f2)->simd_mask4 \
+   {                                                                    \
+      simd_mask4 m;                                                     \
+      m.v = intrinsic (f1.v, f2.v);                                     \
+      return m;                                                         \
+   }
+#else
+#define SIMD_FLOAT4_CMP(op, intrinsic)                                  \
+   inline auto operator op (simd_float4 f1, simd_float4 f2)->simd_mask4 \
+   {                                                                    \
+      simd_mask4 m;                                                     \
+      for (std::size_t i = 0; i < 4; i++)                               \
+         m.v[i] = f1.v[i] op f2.v[i] ? -1 : 0;                          \
+      return m;                                                         \
+   }
+#endif
+
+SIMD_FLOAT4_CMP (<, _mm_cmplt_ps)
+SIMD_FLOAT4_CMP (<=, _mm_cmple_ps)
+SIMD_FLOAT4_CMP (>, _mm_cmpgt_ps)
+SIMD_FLOAT4_CMP (>=, _mm_cmpge_ps)
+SIMD_FLOAT4_CMP (==, _mm_cmpeq_ps)
+SIMD_FLOAT4_CMP (!=, _mm_cmpneq_ps)
+
+#undef SIMD_FLOAT4_CMP
+
+/* Packets of vectors
+ * ------------------
+ */
+typedef vec<simd_float8, 2> vec2x8;
+typedef vec<simd_float8, 3> vec3x8;
+typedef vec<simd_float8, 4> vec4x8;
+
+/* gather 8 consecutive vectors into a packet
+ */
+template <std::size_t n>
+inline auto pack (const vec<float, n> *src) -> vec<simd_float8, n>
+{
+   vec<simd_float8, n> result;
+   for (std::size_t c = 0; c < n; c++) {
+      for (std::size_t i = 0; i < 8; i++) {
+         result[c][i] = reinterpret_cast<const float *> (&src[i])[c];
+      }
+   }
+   return result;
+}
+
+/* load a packet from a SoA-array, starting at element idx. The streams
+ * are padded to the SIMD-width, so a packet at the end never reads past
+ * the storage as long as idx is a multiple of 8
+ */
+template <std::size_t n>
+inline auto pack (const vec_soa<float, n> &soa, std::size_t idx) -> vec<simd_float8, n>
+{
+   assert (("Index out of range\n" && idx + 8 <= soa.padded_size ()));
+   vec<simd_float8, n> result;
+   for (std::size_t c = 0; c < n; c++) {
+      result[c] = simd_float8::load (soa.stream (c) + idx);
+   }
+   return result;
+}
+
+template <std::size_t n>
+inline void unpack (vec<simd_float8, n> p, vec_soa<float, n> &soa, std::size_t idx)
+{
+   assert (("Index out of range\n" && idx + 8 <= soa.padded_size ()));
+   for (std::size_t c = 0; c < n; c++) {
+      p[c].store (soa.stream (c) + idx);
+   }
+}
+
+/* scatter a packet back to 8 consecutive vectors
+ */
+template <std::size_t n>
+inline void unpack (vec<simd_float8, n> p, vec<float, n> *dst)
+{
+   for (std::size_t c = 0; c < n; c++) {
+      for (std::size_t i = 0; i < 8; i++) {
+         dst[i][c] = p[c][i];
+      }
+   }
+}
+
+/* lane i of a packet as a plain vector
+ */
+template <std::size_t n>
+inline auto lane (vec<simd_float8, n> p, std::size_t i) -> vec<float, n>
+{
+   vec<float, n> result;
+   for (std::size_t c = 0; c < n; c++) {
+      result[c] = p[c][i];
+   }
+   return result;
+}
+
+/* Packets of matrices
+ * -------------------
+ * mat<simd_float8, c, r> is 8 matrices, lane i of every element belongs
+ * to the i-th of them. Used to run the scalar matrix-code (inverse(),
+ * determinant(), ...) on 8 matrices at once
+ */
+#ifdef MRN_SIMD_AVX
+/* 8x8 transpose of 8 registers, in place
+ */
+inline void simd_transpose8 (__m256 *r)
+{
+   __m256 t[8], u[8];
+   for (std::size_t i = 0; i < 8; i += 2) {
+      t[i]     = _mm256_unpacklo_ps (r[i], r[i + 1]);
+      t[i + 1] = _mm256_unpackhi_ps (r[i], r[i + 1]);
+   }
+   for (std::size_t i = 0; i < 8; i += 4) {
+      u[i]     = _mm256_shuffle_ps (t[i], t[i + 2], _MM_SHUFFLE (1, 0, 1, 0));
+      u[i + 1] = _mm256_shuffle_ps (t[i], t[i + 2], _MM_SHUFFLE (3, 2, 3, 2));
+      u[i + 2] = _mm256_shuffle_ps (t[i + 1], t[i + 3], _MM_SHUFFLE (1, 0, 1, 0));
+      u[i + 3] = _mm256_shuffle_ps (t[i + 1], t[i + 3], _MM_SHUFFLE (3, 2, 3, 2));
+   }
+   for (std::size_t i = 0; i < 4; i++) {
+      r[i]     = _mm256_permute2f128_ps (u[i], u[i + 4], 0x20);
+      r[i + 4] = _mm256_permute2f128_ps (u[i], u[i + 4], 0x31);
+   }
+}
+#endif
+
+/* gather 8 consecutive matrices into a packet. With AVX every 8
+ * elements of the 8 matrices are one 8x8 transpose
+ */
+template <std::size_t _cols, std::size_t _rows>
+inline auto pack (const mat<float, _cols, _rows> *src) -> mat<simd_float8, _cols, _rows>
+{
+   constexpr std::size_t            count = _cols * _rows;
+   mat<simd_float8, _cols, _rows>   result;
+   simd_float8                     *dst = reinterpret_cast<simd_float8 *> (&result);
+   std::size_t                      e   = 0;
+#ifdef MRN_SIMD_AVX
+   for (; e + 8 <= count; e += 8) {
+      __m256 r[8];
+      for (std::size_t i = 0; i < 8; i++) {
+         r[i] = _mm256_loadu_ps (reinterpret_cast<const float *> (&src[i]) + e);
+      }
+      simd_transpose8 (r);
+      for (std::size_t i = 0; i < 8; i++) {
+         dst[e + i].v = r[i];
+      }
+   }
+#endif
+   for (; e < count; e++) {
+      for (std::size_t i = 0; i < 8; i++) {
+         dst[e][i] = reinterpret_cast<const float *> (&src[i])[e];
+      }
+   }
+   return result;
+}
+
+/* src[idx[i]] into lane i, e.g. the bones of 8 vertices from a palette
+ */
+template <std::size_t _cols, std::size_t _rows>
+inline auto gather (const mat<float, _cols, _rows> *src, const int *idx) -> mat<simd_float8, _cols, _rows>
+{
+   constexpr std::size_t            count = _cols * _rows;
+   mat<simd_float8, _cols, _rows>   result;
+   simd_float8                     *dst = reinterpret_cast<simd_float8 *> (&result);
+   std::size_t                      e   = 0;
+#ifdef MRN_SIMD_AVX
+   for (; e + 8 <= count; e += 8) {
+      __m256 r[8];
+      for (std::size_t i = 0; i < 8; i++) {
+         r[i] = _mm256_loadu_ps (reinterpret_cast<const float *> (&src[idx[i]]) + e);
+      }
+      simd_transpose8 (r);
+      for (std::size_t i = 0; i < 8; i++) {
+         dst[e + i].v = r[i];
+      }
+   }
+#endif
+   for (; e < count; e++) {
+      for (std::size_t i = 0; i < 8; i++) {
+         dst[e][i] = reinterpret_cast<const float *> (&src[idx[i]])[e];
+      }
+   }
+   return result;
+}
+
+/* scatter a packet back to 8 consecutive matrices
+ */
+template <std::size_t _cols, std::size_t _rows>
+inline void unpack (const mat<simd_float8, _cols, _rows> &p, mat<float, _cols, _rows> *dst)
+{
+   constexpr std::size_t count = _cols * _rows;
+   const simd_float8    *src   = reinterpret_cast<const simd_float8 *> (&p);
+   std::size_t           e     = 0;
+#ifdef MRN_SIMD_AVX
+   for (; e + 8 <= count; e += 8) {
+      __m256 r[8];
+      for (std::size_t i = 0; i < 8; i++) {
+         r[i] = src[e + i].v;
+      }
+      simd_transpose8 (r);
+      for (std::size_t i = 0; i < 8; i++) {
+         _mm256_storeu_ps (reinterpret_cast<float *> (&dst[i]) + e, r[i]);
+      }
+   }
+#endif
+   for (; e < count; e++) {
+      for (std::size_t i = 0; i < 8; i++) {
+         reinterpret_cast<float *> (&dst[i])[e] = src[e][i];
+      }
+   }
+}
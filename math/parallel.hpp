@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/* a minimal parallel-for on std::thread.
+ * [0, count) is cut into one contiguous range per thread, each of whole
+ * blocks of grain elements, of which only the very last can be shorter,
+ * and f (begin, end) is called once per range. The calling
+ * thread takes the first range itself, so small inputs never start a
+ * thread at all. Starting threads costs a few microseconds, so only use
+ * this for work that takes a lot longer than that.
+ */
+
+/* upper limit of threads, 0 is one per hardware-thread
+ */
+inline auto parallel_max_threads () -> std::size_t &
+{
+   static std::size_t max_threads = 0;
+   return max_threads;
+}
+
+inline auto parallel_threads () -> std::size_t
+{
+   std::size_t n = parallel_max_threads ();
+   if (n == 0) {
+      n = std::thread::hardware_concurrency ();
+   }
+   return n ? n : 1;
+}
+
+template <typename F>
+inline void parallel_for (std::size_t count, std::size_t grain, F &&f)
+{
+   if (grain == 0) {
+      grain = 1;
+   }
+   const std::size_t threads = std::min (parallel_threads (), (count + grain - 1) / grain);
+   if (threads <= 1) {
+      if (count) {
+         f (std::size_t (0), count);
+      }
+      return;
+   }
+
+   /* whole blocks of the grain, spread evenly over exactly the threads,
+    * so callers can rely on aligned starts
+    */
+   const std::size_t blocks = (count + grain - 1) / grain;
+   auto              begin  = [&] (std::size_t r) { return std::min (r * blocks / threads * grain, count); };
+
+   std::vector<std::thread> workers;
+   workers.reserve (threads - 1);
+   for (std::size_t r = 1; r < threads; r++) {
+      workers.emplace_back ([&f, b = begin (r), e = begin (r + 1)] () { f (b, e); });
+   }
+   f (std::size_t (0), begin (1));
+   for (auto &w : workers) {
+      w.join ();
+   }
+}
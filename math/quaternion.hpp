@@ -0,0 +1,395 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+#include "matrix.hpp"
+#include "packet.hpp"
+#include "scalar.hpp"
+#include "soa.hpp"
+#include "vector.hpp"
+
+/* quaternions for rotations.
+ * a quat<T> is a vec<T, 4> (v) underneath, x, y, z is the vector-part
+ * and w the scalar-part, so (0, 0, 0, 1) is the identity. quat<float>
+ * therefore is a single SSE register, and quat<simd_float8> holds 8
+ * quaternions in the lanes of a vec4x8, which the batched functions at
+ * the end run on.
+ * Only unit quaternions are rotations. The product of two of them is one
+ * again, but the error adds up: norm() the result of long chains.
+ */
+
+template <typename T>
+class quat
+{
+ public:
+   vec<T, 4> v;
+
+   /* identity, like the default mat
+    */
+   constexpr quat () : v (T (0), T (0), T (0), T (1)) {}
+
+   constexpr quat (const T &x, const T &y, const T &z, const T &w) : v (x, y, z, w) {}
+
+   constexpr explicit quat (const vec<T, 4> &v) : v (v) {}
+
+   /* rotation by rad around axis, which has to be normalized. Same
+    * direction as mat<T, 4, 4>::rotate()
+    */
+   static constexpr auto axis_angle (const vec<T, 3> &axis, T rad) -> quat
+   {
+      const T s = constexpr_sin (rad / 2);
+      return quat (axis.x * s, axis.y * s, axis.z * s, constexpr_cos (rad / 2));
+   }
+
+   /* the rotation-part of m, which must not contain a scale. Shepperd's
+    * method: start from the largest of w, x, y, z, so we never divide by
+    * something close to 0
+    */
+   static constexpr auto from_mat (const mat<T, 3, 3> &m) -> quat
+   {
+      // m[column][row]
+      const T trace = m[0][0] + m[1][1] + m[2][2];
+      if (trace > 0) {
+         const T s = constexpr_sqrt (trace + 1) * 2;
+         return quat ((m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s, s / 4);
+      } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+         const T s = constexpr_sqrt (1 + m[0][0] - m[1][1] - m[2][2]) * 2;
+         return quat (s / 4, (m[1][0] + m[0][1]) / s, (m[2][0] + m[0][2]) / s, (m[1][2] - m[2][1]) / s);
+      } else if (m[1][1] > m[2][2]) {
+         const T s = constexpr_sqrt (1 + m[1][1] - m[0][0] - m[2][2]) * 2;
+         return quat ((m[1][0] + m[0][1]) / s, s / 4, (m[2][1] + m[1][2]) / s, (m[2][0] - m[0][2]) / s);
+      } else {
+         const T s = constexpr_sqrt (1 + m[2][2] - m[0][0] - m[1][1]) * 2;
+         return quat ((m[2][0] + m[0][2]) / s, (m[2][1] + m[1][2]) / s, s / 4, (m[0][1] - m[1][0]) / s);
+      }
+   }
+
+   static constexpr auto from_mat (const mat<T, 4, 4> &m) -> quat
+   {
+      mat<T, 3, 3> r;
+      for (std::size_t j = 0; j < 3; j++) {
+         for (std::size_t i = 0; i < 3; i++) {
+            r[j][i] = m[j][i];
+         }
+      }
+      return from_mat (r);
+   }
+
+   constexpr auto operator*= (const quat &q) -> quat &
+   {
+      *this = *this * q;
+      return *this;
+   }
+};
+
+typedef quat<float>       quatf;
+typedef quat<double>      quatd;
+typedef quat<simd_float8> quatx8;
+
+/* Operators for quaternions
+ * -------------------------
+ * q1 * q2 is the Hamilton product: the rotation q2 followed by q1, like
+ * the product of their matrices
+ */
+template <typename T>
+constexpr auto operator* (const quat<T> &q1, const quat<T> &q2) -> quat<T>
+{
+   const vec<T, 4> &a = q1.v;
+   const vec<T, 4> &b = q2.v;
+   return quat<T> (a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                   a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                   a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                   a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+#ifdef MRN_SIMD_SSE2
+/* the same as 4 products of swizzled registers, the sign of w in the
+ * middle two flipped with an xor
+ */
+constexpr auto operator* (const quat<float> &q1, const quat<float> &q2) -> quat<float>
+{
+   if (std::is_constant_evaluated ()) {
+      return operator*<float> (q1, q2);
+   }
+   const __m128 a    = q1.v.simd;
+   const __m128 b    = q2.v.simd;
+   const __m128 sign = _mm_set_ps (-0.0f, 0.0f, 0.0f, 0.0f);
+   __m128       r    = _mm_mul_ps (simd_splat<3> (a), b);
+   r = _mm_add_ps (r, _mm_xor_ps (_mm_mul_ps (simd_swizzle<0, 1, 2, 0> (a), simd_swizzle<3, 3, 3, 0> (b)), sign));
+   r = _mm_add_ps (r, _mm_xor_ps (_mm_mul_ps (simd_swizzle<1, 2, 0, 1> (a), simd_swizzle<2, 0, 1, 1> (b)), sign));
+   r = _mm_sub_ps (r, _mm_mul_ps (simd_swizzle<2, 0, 1, 2> (a), simd_swizzle<1, 2, 0, 2> (b)));
+   return quat<float> (vec<float, 4> (r));
+}
+#endif
+
+/* +, - and the scalar product are only there for blending, the results
+ * are no rotations before they are normalized again
+ */
+template <typename T>
+constexpr auto operator+ (const quat<T> &q1, const quat<T> &q2) -> quat<T>
+{
+   return quat<T> (q1.v + q2.v);
+}
+
+template <typename T>
+constexpr auto operator- (const quat<T> &q1, const quat<T> &q2) -> quat<T>
+{
+   return quat<T> (q1.v - q2.v);
+}
+
+template <typename T>
+constexpr auto operator- (const quat<T> &q) -> quat<T>
+{
+   return quat<T> (-q.v);
+}
+
+template <typename T>
+constexpr auto operator* (const quat<T> &q, std::type_identity_t<T> scalar) -> quat<T>
+{
+   return quat<T> (q.v * scalar);
+}
+
+template <typename T>
+constexpr auto operator* (std::type_identity_t<T> scalar, const quat<T> &q) -> quat<T>
+{
+   return quat<T> (q.v * scalar);
+}
+
+/* Other functions for quaternions
+ * -------------------------------
+ */
+template <typename T>
+constexpr auto dot (const quat<T> &q1, const quat<T> &q2) -> T
+{
+   return dot (q1.v, q2.v);
+}
+
+template <typename T>
+constexpr auto len (const quat<T> &q) -> T
+{
+   return len (q.v);
+}
+
+template <typename T>
+constexpr auto norm (const quat<T> &q) -> quat<T>
+{
+   return quat<T> (norm (q.v));
+}
+
+/* the inverse of a unit quaternion, i.e. the opposite rotation
+ */
+template <typename T>
+constexpr auto conjugate (const quat<T> &q) -> quat<T>
+{
+   return quat<T> (-q.v.x, -q.v.y, -q.v.z, q.v.w);
+}
+
+template <typename T>
+constexpr auto inverse (const quat<T> &q) -> quat<T>
+{
+   return quat<T> (conjugate (q).v / len2 (q.v));
+}
+
+/* q * (v, 0) * conjugate (q), multiplied out: with u the vector-part,
+ * t = 2 * cross (u, v) and v' = v + w * t + cross (u, t). Two cross
+ * products instead of two full quaternion products
+ */
+template <typename T>
+constexpr auto rotate (const quat<T> &q, const vec<T, 3> &v) -> vec<T, 3>
+{
+   const vec<T, 3> u = vec<T, 3> (q.v.x, q.v.y, q.v.z);
+   const vec<T, 3> t = cross (u, v) * T (2);
+   return v + t * q.v.w + cross (u, t);
+}
+
+/* -1 where q1 and q2 are more than 90 degrees apart (d = dot (q1, q2) is
+ * negative), else 1. q and -q are the same rotation, flipping one of
+ * them makes the interpolation take the short way
+ */
+template <typename T>
+constexpr auto quat_shortest_sign (T d) -> T
+{
+   return d < T (0) ? T (-1) : T (1);
+}
+
+inline auto quat_shortest_sign (simd_float8 d) -> simd_float8
+{
+   return select (d < simd_float8 (0.0f), simd_float8 (-1.0f), simd_float8 (1.0f));
+}
+
+/* linear interpolation, normalized. Not constant in speed, but cheap and
+ * good enough between close rotations, e.g. consecutive keyframes
+ */
+template <typename T>
+constexpr auto nlerp (const quat<T> &q1, const quat<T> &q2, std::type_identity_t<T> t) -> quat<T>
+{
+   const T s = quat_shortest_sign (dot (q1.v, q2.v));
+   return norm (quat<T> (q1.v + (q2.v * s - q1.v) * t));
+}
+
+/* the slerp-weights for q1 and q2 from x = cos (angle) >= 0, without any
+ * trigonometry: sin ((1 - t) a) / sin (a) and sin (t a) / sin (a) as
+ * polynomials in x, t (Eberly, "A Fast and Accurate Algorithm for
+ * Computing SLERP"). The error is below 1e-6 up to a = 60 degrees (120
+ * between the rotations) and 3e-5 at the very worst, fine for float
+ * but not for double
+ */
+template <typename T>
+constexpr void slerp_weights (T x, T t, T &w1, T &w2)
+{
+   constexpr float mu    = 1.85298109240830f;
+   constexpr float u[8]  = { 1.0f / (1 * 3),  1.0f / (2 * 5),  1.0f / (3 * 7),  1.0f / (4 * 9),
+                             1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), mu / (8 * 17) };
+   constexpr float v[8]  = { 1.0f / 3,  2.0f / 5,  3.0f / 7,  4.0f / 9,
+                             5.0f / 11, 6.0f / 13, 7.0f / 15, mu * 8 / 17 };
+   const T         xm1   = x - T (1);
+   const T         d     = T (1) - t;
+   const T         t2    = t * t;
+   const T         d2    = d * d;
+   T               c1    = T (1);
+   T               c2    = T (1);
+   for (int i = 7; i >= 0; i--) {
+      c1 = T (1) + (T (u[i]) * d2 - T (v[i])) * xm1 * c1;
+      c2 = T (1) + (T (u[i]) * t2 - T (v[i])) * xm1 * c2;
+   }
+   w1 = d * c1;
+   w2 = t * c2;
+}
+
+/* spherical interpolation, constant angular speed from q1 (t = 0) to
+ * q2 (t = 1). double goes through acos/sin, everything else through
+ * slerp_weights(), which also works on simd_float8
+ */
+template <typename T>
+constexpr auto slerp (const quat<T> &q1, const quat<T> &q2, std::type_identity_t<T> t) -> quat<T>
+{
+   const T d = dot (q1.v, q2.v);
+   const T s = quat_shortest_sign (d);
+   T       w1, w2;
+   if constexpr (std::is_same_v<T, double> || std::is_same_v<T, long double>) {
+      const T x = d * s;
+      // sin (a) is close to 0, the weights are too: nlerp is exact enough
+      if (x > T (1) - T (1e-6)) {
+         return nlerp (q1, q2, t);
+      }
+      const T a     = std::acos (x);
+      const T inv_s = T (1) / std::sin (a);
+      w1            = std::sin ((1 - t) * a) * inv_s;
+      w2            = std::sin (t * a) * inv_s;
+   } else {
+      slerp_weights (d * s, t, w1, w2);
+   }
+   return quat<T> (q1.v * w1 + q2.v * (w2 * s));
+}
+
+/* Conversion to matrices
+ * ----------------------
+ * q has to be normalized
+ */
+template <typename T>
+constexpr auto to_mat3 (const quat<T> &q) -> mat<T, 3, 3>
+{
+   const T x = q.v.x, y = q.v.y, z = q.v.z, w = q.v.w;
+   const T x2 = x + x, y2 = y + y, z2 = z + z;
+   const T xx = x * x2, yy = y * y2, zz = z * z2;
+   const T xy = x * y2, xz = x * z2, yz = y * z2;
+   const T wx = w * x2, wy = w * y2, wz = w * z2;
+
+   mat<T, 3, 3> m;
+   m[0][0] = T (1) - (yy + zz);
+   m[0][1] = xy + wz;
+   m[0][2] = xz - wy;
+   m[1][0] = xy - wz;
+   m[1][1] = T (1) - (xx + zz);
+   m[1][2] = yz + wx;
+   m[2][0] = xz + wy;
+   m[2][1] = yz - wx;
+   m[2][2] = T (1) - (xx + yy);
+   return m;
+}
+
+template <typename T>
+constexpr auto to_mat4 (const quat<T> &q) -> mat<T, 4, 4>
+{
+   const mat<T, 3, 3> r = to_mat3 (q);
+   mat<T, 4, 4>       m;
+   for (std::size_t j = 0; j < 3; j++) {
+      for (std::size_t i = 0; i < 3; i++) {
+         m[j][i] = r[j][i];
+      }
+      m[j][3] = T (0);
+      m[3][j] = T (0);
+   }
+   m[3][3] = T (1);
+   return m;
+}
+
+/* Batched quaternions
+ * -------------------
+ * streams of quaternions as vec4_soa, x, y, z, w one stream each. Every
+ * step loads 8 of them into a quatx8 and runs the functions above on
+ * it, the padding of the streams is computed along, so there is no
+ * scalar tail. out may be one of the inputs
+ */
+inline void batch_multiply (const vec4_soa &q1, const vec4_soa &q2, vec4_soa &out)
+{
+   assert (("Size mismatch\n" && q1.size () == q2.size ()));
+   if (&out != &q1 && &out != &q2) {
+      out.resize (q1.size ());
+   }
+   for (std::size_t i = 0; i < q1.padded_size (); i += 8) {
+      unpack ((quatx8 (pack (q1, i)) * quatx8 (pack (q2, i))).v, out, i);
+   }
+}
+
+inline void batch_rotate (const vec4_soa &q, const vec3_soa &in, vec3_soa &out)
+{
+   assert (("Size mismatch\n" && q.size () == in.size ()));
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   for (std::size_t i = 0; i < in.padded_size (); i += 8) {
+      unpack (rotate (quatx8 (pack (q, i)), pack (in, i)), out, i);
+   }
+}
+
+inline void batch_nlerp (const vec4_soa &q1, const vec4_soa &q2, float t, vec4_soa &out)
+{
+   assert (("Size mismatch\n" && q1.size () == q2.size ()));
+   if (&out != &q1 && &out != &q2) {
+      out.resize (q1.size ());
+   }
+   for (std::size_t i = 0; i < q1.padded_size (); i += 8) {
+      unpack (nlerp (quatx8 (pack (q1, i)), quatx8 (pack (q2, i)), simd_float8 (t)).v, out, i);
+   }
+}
+
+inline void batch_slerp (const vec4_soa &q1, const vec4_soa &q2, float t, vec4_soa &out)
+{
+   assert (("Size mismatch\n" && q1.size () == q2.size ()));
+   if (&out != &q1 && &out != &q2) {
+      out.resize (q1.size ());
+   }
+   for (std::size_t i = 0; i < q1.padded_size (); i += 8) {
+      unpack (slerp (quatx8 (pack (q1, i)), quatx8 (pack (q2, i)), simd_float8 (t)).v, out, i);
+   }
+}
+
+/* q.size () matrices to out. The last, partial packet goes through a
+ * local buffer, out does not have to be padded
+ */
+inline void batch_to_mat4 (const vec4_soa &q, mat4 *out)
+{
+   std::size_t i = 0;
+   for (; i + 8 <= q.size (); i += 8) {
+      unpack (to_mat4 (quatx8 (pack (q, i))), &out[i]);
+   }
+   if (i < q.size ()) {
+      mat4 tail[8];
+      unpack (to_mat4 (quatx8 (pack (q, i))), tail);
+      for (std::size_t j = 0; i + j < q.size (); j++) {
+         out[i + j] = tail[j];
+      }
+   }
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "packet.hpp"
+
+/* rays and ray-triangle intersection.
+ * A ray is the points origin + t * direction with t_min <= t <= t_max.
+ * The direction doesn't have to be normalized, t is in units of its
+ * length. Triangles are hit from both sides.
+ * ray8 is a packet of 8 rays in simd_float8 lanes, for rays that start
+ * close to each other and go in similar directions, like the primary
+ * rays of a tile of pixels
+ */
+
+struct ray
+{
+   vec3  origin, direction;
+   float t_min = 0, t_max = std::numeric_limits<float>::infinity ();
+
+   ray () = default;
+
+   ray (const vec3 &origin, const vec3 &direction, float t_min = 0,
+        float t_max = std::numeric_limits<float>::infinity ())
+   : origin (origin), direction (direction), t_min (t_min), t_max (t_max)
+   {
+   }
+};
+
+/* the closest hit: the distance, the barycentric coordinates of the hit
+ * point, which is (1 - u - v) * a + u * b + v * c, and the primitive. prim
+ * is none if the ray missed
+ */
+struct ray_hit
+{
+   static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max ();
+
+   float         t = std::numeric_limits<float>::infinity (), u = 0, v = 0;
+   std::uint32_t prim = none;
+
+   explicit operator bool () const
+   {
+      return prim != none;
+   }
+};
+
+/* Möller-Trumbore: solves origin + t * direction = a + u * (b - a) + v *
+ * (c - a) with Cramer's rule. Rays in the plane of the triangle miss it.
+ * The comparisons are written so that a NaN anywhere is a miss
+ */
+inline auto intersect (const ray &r, const vec3 &a, const vec3 &b, const vec3 &c, float &t, float &u, float &v)
+  -> bool
+{
+   const vec3  e1  = b - a, e2 = c - a;
+   const vec3  p   = cross (r.direction, e2);
+   const float det = dot (e1, p);
+   if (det == 0) {
+      return false;
+   }
+   const float inv_det = 1 / det;
+   const vec3  s       = r.origin - a;
+   u                   = dot (s, p) * inv_det;
+   if (!(u >= 0 && u <= 1)) {
+      return false;
+   }
+   const vec3 q = cross (s, e1);
+   v            = dot (r.direction, q) * inv_det;
+   if (!(v >= 0 && u + v <= 1)) {
+      return false;
+   }
+   t = dot (e2, q) * inv_det;
+   return t >= r.t_min && t <= r.t_max;
+}
+
+/* Packets of rays
+ * ---------------
+ */
+struct ray8
+{
+   vec3x8      origin, direction;
+   simd_float8 t_min, t_max;
+
+   ray8 () = default;
+
+   explicit ray8 (const ray *rays)
+   {
+      for (std::size_t i = 0; i < 8; i++) {
+         for (std::size_t c = 0; c < 3; c++) {
+            origin[c][i]    = rays[i].origin[c];
+            direction[c][i] = rays[i].direction[c];
+         }
+         t_min[i] = rays[i].t_min;
+         t_max[i] = rays[i].t_max;
+      }
+   }
+
+   auto operator[] (std::size_t i) const -> ray
+   {
+      return ray (vec3 (origin.x[i], origin.y[i], origin.z[i]), vec3 (direction.x[i], direction.y[i], direction.z[i]),
+                  t_min[i], t_max[i]);
+   }
+};
+
+struct ray_hit8
+{
+   simd_float8   t = std::numeric_limits<float>::infinity (), u = 0.0f, v = 0.0f;
+   std::uint32_t prim[8];
+
+   ray_hit8 ()
+   {
+      for (std::uint32_t &p : prim) {
+         p = ray_hit::none;
+      }
+   }
+
+   auto operator[] (std::size_t i) const -> ray_hit
+   {
+      ray_hit hit;
+      if (prim[i] != ray_hit::none) {
+         hit.t    = t[i];
+         hit.u    = u[i];
+         hit.v    = v[i];
+         hit.prim = prim[i];
+      }
+      return hit;
+   }
+};
+
+/* one triangle against 8 rays, the same as above in every lane. t_max is
+ * per lane, usually the closest hit so far. Returns the lanes that hit
+ */
+inline auto intersect (const ray8 &r, const vec3 &a, const vec3 &b, const vec3 &c, simd_float8 t_max,
+                       simd_float8 &t, simd_float8 &u, simd_float8 &v) -> simd_mask8
+{
+   auto splat = [] (const vec3 &p) {
+      return vec3x8 (simd_float8 (p.x), simd_float8 (p.y), simd_float8 (p.z));
+   };
+   const vec3x8      e1 = splat (b - a), e2 = splat (c - a);
+   const vec3x8      p   = cross (r.direction, e2);
+   const simd_float8 det = dot (e1, p);
+   const simd_float8 inv_det = simd_float8 (1.0f) / det;
+   const vec3x8      s       = r.origin - splat (a);
+   const vec3x8      q       = cross (s, e1);
+   u                         = dot (s, p) * inv_det;
+   v                         = dot (r.direction, q) * inv_det;
+   t                         = dot (e2, q) * inv_det;
+   return (det != 0.0f) & (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) & (t >= r.t_min) & (t <= t_max);
+}
+
+/* Packets of triangles
+ * --------------------
+ * 8 triangles in SoA layout, to test one ray against all of them at
+ * once: lane i of a, b and c is triangle i. The packets of a mesh are
+ * padded with NaN triangles, which nothing hits
+ */
+struct triangle8
+{
+   vec3x8 a, b, c;
+};
+
+/* a triangle soup, three vertices per triangle, in packets of 8
+ */
+inline auto pack_triangles (std::span<const vec3> vertices) -> std::vector<triangle8>
+{
+   const std::size_t      count = vertices.size () / 3;
+   std::vector<triangle8> packets ((count + 7) / 8);
+   const float            nan = std::numeric_limits<float>::quiet_NaN ();
+   for (std::size_t i = 0; i < 8 * packets.size (); i++) {
+      triangle8 &p = packets[i / 8];
+      for (std::size_t c = 0; c < 3; c++) {
+         p.a[c][i % 8] = i < count ? vertices[3 * i][c] : nan;
+         p.b[c][i % 8] = i < count ? vertices[3 * i + 1][c] : nan;
+         p.c[c][i % 8] = i < count ? vertices[3 * i + 2][c] : nan;
+      }
+   }
+   return packets;
+}
+
+/* Möller-Trumbore for one ray and 8 triangles. t_max is per lane, so the
+ * closest hit so far in one packet can be kept
+ */
+inline auto intersect (const ray &r, const triangle8 &tri, simd_float8 t_max, simd_float8 &t, simd_float8 &u,
+                       simd_float8 &v) -> simd_mask8
+{
+   const vec3x8      d (simd_float8 (r.direction.x), simd_float8 (r.direction.y), simd_float8 (r.direction.z));
+   const vec3x8      o (simd_float8 (r.origin.x), simd_float8 (r.origin.y), simd_float8 (r.origin.z));
+   const vec3x8      e1 = tri.b - tri.a, e2 = tri.c - tri.a;
+   const vec3x8      p   = cross (d, e2);
+   const simd_float8 det = dot (e1, p);
+   const simd_float8 inv_det = simd_float8 (1.0f) / det;
+   const vec3x8      s       = o - tri.a;
+   const vec3x8      q       = cross (s, e1);
+   u                         = dot (s, p) * inv_det;
+   v                         = dot (d, q) * inv_det;
+   t                         = dot (e2, q) * inv_det;
+   return (det != 0.0f) & (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) & (t >= r.t_min) & (t <= t_max);
+}
+
+/* Watertight intersection
+ * -----------------------
+ * Möller-Trumbore can let a ray slip through the edge between two
+ * triangles, when both round their side of it the wrong way. The
+ * watertight test (Woop, Benthin and Wald, "Watertight Ray/Triangle
+ * Intersection") shears the triangles into the space of the ray, where
+ * it is the z-axis, and decides in 2-D with edge functions. The edge
+ * between two vertices is the same computation in either triangle, with
+ * the vertices in a fixed order, and a ray exactly on it hits both. So a
+ * closed mesh has no holes.
+ * watertight_ray is the part that only depends on the ray
+ */
+struct watertight_ray
+{
+   ray         r;
+   std::size_t kx, ky, kz;
+   float       sx, sy, sz;
+
+   explicit watertight_ray (const ray &r) : r (r)
+   {
+      const vec3 &d = r.direction;
+      kz            = std::abs (d.x) > std::abs (d.y) ? (std::abs (d.x) > std::abs (d.z) ? 0 : 2)
+                                                      : (std::abs (d.y) > std::abs (d.z) ? 1 : 2);
+      kx            = (kz + 1) % 3;
+      ky            = (kx + 1) % 3;
+      // keep the winding, so the sign of the edge functions means the same
+      if (d[kz] < 0) {
+         std::swap (kx, ky);
+      }
+      sx = d[kx] / d[kz];
+      sy = d[ky] / d[kz];
+      sz = 1 / d[kz];
+   }
+};
+
+/* p.x * q.y - p.y * q.x, always with the vertices in the same order
+ * and the sign flipped back, and with an explicit fmadd. Left to itself
+ * the compiler may contract either product into an FMA, differently in
+ * each place this is inlined, and round the two triangles of an edge
+ * differently
+ */
+inline auto edge_function (simd_float8 px, simd_float8 py, simd_float8 qx, simd_float8 qy) -> simd_float8
+{
+   const simd_mask8  swap = (px > qx) | ((px == qx) & (py > qy));
+   const simd_float8 ax = select (swap, qx, px), ay = select (swap, qy, py);
+   const simd_float8 bx = select (swap, px, qx), by = select (swap, py, qy);
+   const simd_float8 e  = fmadd (ax, by, -(ay * bx));
+   return select (swap, -e, e);
+}
+
+inline auto intersect (const watertight_ray &wr, const triangle8 &tri, simd_float8 t_max, simd_float8 &t,
+                       simd_float8 &u, simd_float8 &v) -> simd_mask8
+{
+   const simd_float8 sx = -wr.sx, sy = -wr.sy, sz = wr.sz;
+   const vec3x8      o (simd_float8 (wr.r.origin.x), simd_float8 (wr.r.origin.y), simd_float8 (wr.r.origin.z));
+   const vec3x8      a = tri.a - o, b = tri.b - o, c = tri.c - o;
+
+   // sheared into the space of the ray, a vertex the same in every triangle
+   const simd_float8 ax = fmadd (sx, a[wr.kz], a[wr.kx]), ay = fmadd (sy, a[wr.kz], a[wr.ky]);
+   const simd_float8 bx = fmadd (sx, b[wr.kz], b[wr.kx]), by = fmadd (sy, b[wr.kz], b[wr.ky]);
+   const simd_float8 cx = fmadd (sx, c[wr.kz], c[wr.kx]), cy = fmadd (sy, c[wr.kz], c[wr.ky]);
+
+   // the ray is inside if it is on the same side of all three edges
+   const simd_float8 eu = edge_function (cx, cy, bx, by);
+   const simd_float8 ev = edge_function (ax, ay, cx, cy);
+   const simd_float8 ew = edge_function (bx, by, ax, ay);
+   const simd_float8 zero (0.0f);
+   const simd_mask8  inside = ((eu >= zero) & (ev >= zero) & (ew >= zero)) | ((eu <= zero) & (ev <= zero) & (ew <= zero));
+
+   const simd_float8 det = eu + ev + ew;
+   const simd_float8 z   = eu * (sz * a[wr.kz]) + ev * (sz * b[wr.kz]) + ew * (sz * c[wr.kz]);
+   const simd_float8 inv_det = simd_float8 (1.0f) / det;
+   t                         = z * inv_det;
+   u                         = ev * inv_det;
+   v                         = ew * inv_det;
+   return inside & (det != zero) & (t >= wr.r.t_min) & (t <= t_max);
+}
+
+/* Picking
+ * -------
+ * the closest hit of a ray among all triangles of a mesh in packets,
+ * with prim the index of the triangle
+ */
+template <typename R>
+inline auto closest_hit (const R &r, float t_limit, std::span<const triangle8> triangles) -> ray_hit
+{
+   ray_hit     hit;
+   simd_float8 t_max = t_limit;
+   for (std::size_t i = 0; i < triangles.size (); i++) {
+      simd_float8      t, u, v;
+      const simd_mask8 m = intersect (r, triangles[i], t_max, t, u, v);
+      if (none (m)) {
+         continue;
+      }
+      // the nearest lane, which is also the new limit of all of them
+      int         bits = m.bits ();
+      std::size_t best = std::countr_zero (unsigned (bits));
+      for (bits &= bits - 1; bits; bits &= bits - 1) {
+         const std::size_t l = std::countr_zero (unsigned (bits));
+         best                = t[l] < t[best] ? l : best;
+      }
+      t_max    = t[best];
+      hit.t    = t[best];
+      hit.u    = u[best];
+      hit.v    = v[best];
+      hit.prim = std::uint32_t (8 * i + best);
+   }
+   return hit;
+}
+
+inline auto intersect (const ray &r, std::span<const triangle8> triangles) -> ray_hit
+{
+   return closest_hit (r, r.t_max, triangles);
+}
+
+inline auto intersect (const watertight_ray &r, std::span<const triangle8> triangles) -> ray_hit
+{
+   return closest_hit (r, r.r.t_max, triangles);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <limits>
+#include <math.h>
+#include <type_traits>
+
+/* scalar functions that can be evaluated at compile-time.
+ * sqrt(), sin() and cos() from math.h are not constexpr, so vectors and
+ * matrices couldn't use them in constant expressions. At runtime these
+ * just call the math.h-versions, only the compiler runs the loops below.
+ */
+
+template <typename T>
+constexpr auto constexpr_sqrt (T x) -> T
+{
+   if (!std::is_constant_evaluated ()) {
+      return sqrt (x);
+   }
+   if (x < 0) {
+      return std::numeric_limits<T>::quiet_NaN ();
+   }
+   if (x == 0 || x == std::numeric_limits<T>::infinity ()) {
+      return x;
+   }
+
+   /* newton-iteration in long double, starting above the root. It
+    * decreases monotonically until it hits the root, so we stop as soon
+    * as it doesn't get any smaller. The extra precision makes the final
+    * rounding to T exact
+    */
+   const long double d = x;
+   long double       y = d > 1 ? d : 1;
+   for (;;) {
+      const long double next = 0.5L * (y + d / y);
+      if (next >= y) {
+         return T (y);
+      }
+      y = next;
+   }
+}
+
+/* the argument is first reduced to [-pi, pi]. In that range the first
+ * 15 terms of the taylor-series are enough for double precision
+ */
+constexpr auto constexpr_reduce_angle (long double x) -> long double
+{
+   // 2 * pi in two parts, so the reduction doesn't lose precision
+   constexpr long double two_pi_hi = 6.28318530717958623200e+00L;
+   constexpr long double two_pi_lo = 2.44929359829470635445e-16L;
+
+   const long double k = x / (two_pi_hi + two_pi_lo);
+   const long double r = static_cast<long long> (k < 0 ? k - 0.5L : k + 0.5L);
+   return (x - r * two_pi_hi) - r * two_pi_lo;
+}
+
+template <typename T>
+constexpr auto constexpr_sin (T x) -> T
+{
+   if (!std::is_constant_evaluated ()) {
+      return sin (x);
+   }
+   const long double r    = constexpr_reduce_angle (x);
+   long double       term = r;
+   long double       sum  = r;
+   for (int i = 1; i <= 15; i++) {
+      term *= -r * r / ((2 * i) * (2 * i + 1));
+      sum += term;
+   }
+   return T (sum);
+}
+
+template <typename T>
+constexpr auto constexpr_cos (T x) -> T
+{
+   if (!std::is_constant_evaluated ()) {
+      return cos (x);
+   }
+   const long double r    = constexpr_reduce_angle (x);
+   long double       term = 1;
+   long double       sum  = 1;
+   for (int i = 1; i <= 15; i++) {
+      term *= -r * r / ((2 * i - 1) * (2 * i));
+      sum += term;
+   }
+   return T (sum);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/* SIMD support.
+ * the instruction set is picked at compile-time from the usual compiler
+ * macros (-msse4.1, -mavx, -mfma, ...). x86-64 always has SSE2, so that
+ * is the minimum we vectorize for, everything else is a scalar fallback.
+ * Define MRN_MATH_NO_SIMD to get the plain scalar code everywhere.
+ */
+#if !defined(MRN_MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define MRN_SIMD_SSE2 1
+#include <immintrin.h>
+
+#if defined(__SSE4_1__)
+#define MRN_SIMD_SSE41 1
+#endif
+
+#if defined(__AVX__)
+#define MRN_SIMD_AVX 1
+#endif
+
+#if defined(__FMA__)
+#define MRN_SIMD_FMA 1
+#endif
+
+// only on request, see morton.hpp
+#if defined(MRN_MATH_PDEP) && defined(__BMI2__)
+#define MRN_SIMD_BMI2 1
+#endif
+#endif
+
+#ifdef MRN_SIMD_SSE2
+
+/* a * b + c, fused if the CPU can do it
+ */
+inline auto simd_fmadd (__m128 a, __m128 b, __m128 c) -> __m128
+{
+#ifdef MRN_SIMD_FMA
+   return _mm_fmadd_ps (a, b, c);
+#else
+   return _mm_add_ps (_mm_mul_ps (a, b), c);
+#endif
+}
+
+/* broadcast lane i of v into all 4 lanes
+ */
+template <int i>
+inline auto simd_splat (__m128 v) -> __m128
+{
+   return _mm_shuffle_ps (v, v, _MM_SHUFFLE (i, i, i, i));
+}
+
+/* lanes x, y, z, w of v, in that order
+ */
+template <int x, int y, int z, int w>
+inline auto simd_swizzle (__m128 v) -> __m128
+{
+   return _mm_shuffle_ps (v, v, _MM_SHUFFLE (w, z, y, x));
+}
+
+/* horizontal sum of all 4 lanes, the result is in every lane
+ */
+inline auto simd_hsum (__m128 v) -> __m128
+{
+   __m128 t = _mm_add_ps (v, _mm_shuffle_ps (v, v, _MM_SHUFFLE (2, 3, 0, 1)));
+   return _mm_add_ps (t, _mm_shuffle_ps (t, t, _MM_SHUFFLE (1, 0, 3, 2)));
+}
+
+/* 4-component dot product, the result is in every lane
+ */
+inline auto simd_dot4 (__m128 a, __m128 b) -> __m128
+{
+#ifdef MRN_SIMD_SSE41
+   return _mm_dp_ps (a, b, 0xff);
+#else
+   return simd_hsum (_mm_mul_ps (a, b));
+#endif
+}
+
+/* 3-component cross product, lane 3 of the result is 0
+ */
+inline auto simd_cross (__m128 a, __m128 b) -> __m128
+{
+   __m128 t = _mm_sub_ps (_mm_mul_ps (a, simd_swizzle<1, 2, 0, 3> (b)), _mm_mul_ps (simd_swizzle<1, 2, 0, 3> (a), b));
+   return simd_swizzle<1, 2, 0, 3> (t);
+}
+
+#endif
+
+/* allocator for std::vector that aligns the storage to a cache-line,
+ * which is also the width of an AVX-512 register. So bulk data can
+ * always be loaded with aligned instructions, whatever the CPU.
+ */
+template <typename T, std::size_t align = 64>
+struct aligned_allocator
+{
+   typedef T value_type;
+
+   template <typename U>
+   struct rebind
+   {
+      typedef aligned_allocator<U, align> other;
+   };
+
+   aligned_allocator () = default;
+
+   template <typename U>
+   aligned_allocator (const aligned_allocator<U, align> &)
+   {
+   }
+
+   auto allocate (std::size_t count) -> T *
+   {
+      return static_cast<T *> (::operator new (count * sizeof (T), std::align_val_t (align)));
+   }
+
+   void deallocate (T *p, std::size_t)
+   {
+      ::operator delete (p, std::align_val_t (align));
+   }
+
+   template <typename U>
+   auto operator== (const aligned_allocator<U, align> &) const -> bool
+   {
+      return true;
+   }
+
+   template <typename U>
+   auto operator!= (const aligned_allocator<U, align> &) const -> bool
+   {
+      return false;
+   }
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <span>
+
+#include "dual_quaternion.hpp"
+#include "parallel.hpp"
+#include "soa.hpp"
+
+/* skinning of whole vertex streams.
+ * every vertex has up to 4 influences: stream k of bones is the index
+ * into the palette of the k-th bone, stream k of weights its weight.
+ * The weights of a vertex should sum to 1, unused influences have weight
+ * 0 (their index still has to be valid, 0 is fine). Positions and
+ * normals are SoA-streams, out may be the same stream as in.
+ * The vertices are split into ranges of skin_grain, one thread each (see
+ * parallel.hpp), every thread runs 8 vertices per step in simd_float8
+ * lanes.
+ */
+
+typedef vec_soa<int, 4> skin_bones;
+
+// vertices per thread at least, a multiple of every SoA-width
+constexpr std::size_t skin_grain = 4096;
+
+/* Dual quaternion skinning
+ * ------------------------
+ * the bone transformations are blended as dual quaternions and
+ * normalized, which keeps the result rigid: no volume loss at twisting
+ * joints ("candy-wrapper") like with blended matrices. Every influence
+ * is flipped to the same hemisphere as the first one before blending.
+ * The palette has to hold rotations and translations only
+ */
+
+/* blend the 8 vertices at i. Influences that are 0 in all 8 lanes are
+ * skipped, most vertices have fewer than 4 bones
+ */
+inline auto skin_blend (const dual_quatf *palette, const skin_bones &bones, const vec4_soa &weights, std::size_t i)
+  -> dual_quatx8
+{
+   const dual_quatx8 first = gather (palette, bones.stream (0) + i);
+   dual_quatx8       blend = first * simd_float8::load (weights.stream (0) + i);
+   for (std::size_t k = 1; k < 4; k++) {
+      const simd_float8 w = simd_float8::load (weights.stream (k) + i);
+      if (none (w != simd_float8 (0.0f))) {
+         continue;
+      }
+      const dual_quatx8 dq = gather (palette, bones.stream (k) + i);
+      blend                = blend + dq * (w * quat_shortest_sign (dot (first.real, dq.real)));
+   }
+   return norm (blend);
+}
+
+inline void skin_dual_quat (std::span<const dual_quatf> palette, const skin_bones &bones, const vec4_soa &weights,
+                            const vec3_soa &positions, vec3_soa &out_positions)
+{
+   assert (("Size mismatch\n" && bones.size () == positions.size () && weights.size () == positions.size ()));
+   if (&out_positions != &positions) {
+      out_positions.resize (positions.size ());
+   }
+   parallel_for (positions.padded_size (), skin_grain, [&] (std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; i += 8) {
+         const dual_quatx8 dq = skin_blend (palette.data (), bones, weights, i);
+         unpack (transform_point (dq, pack (positions, i)), out_positions, i);
+      }
+   });
+}
+
+/* normals only go through the rotation, they stay normalized
+ */
+inline void skin_dual_quat (std::span<const dual_quatf> palette, const skin_bones &bones, const vec4_soa &weights,
+                            const vec3_soa &positions, const vec3_soa &normals, vec3_soa &out_positions,
+                            vec3_soa &out_normals)
+{
+   assert (("Size mismatch\n" && bones.size () == positions.size () && weights.size () == positions.size ()
+            && normals.size () == positions.size ()));
+   if (&out_positions != &positions) {
+      out_positions.resize (positions.size ());
+   }
+   if (&out_normals != &normals) {
+      out_normals.resize (normals.size ());
+   }
+   parallel_for (positions.padded_size (), skin_grain, [&] (std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; i += 8) {
+         const dual_quatx8 dq = skin_blend (palette.data (), bones, weights, i);
+         unpack (transform_point (dq, pack (positions, i)), out_positions, i);
+         unpack (rotate (dq.real, pack (normals, i)), out_normals, i);
+      }
+   });
+}
+
+/* Linear blend skinning
+ * ---------------------
+ * the palette matrices of a vertex are blended with its weights and the
+ * vertex is transformed by the result. The palette may contain any
+ * affine transformation, the last row of every matrix is ignored.
+ * Normals go through the blended upper 3x3 and are normalized again,
+ * which is only right for rotations and uniform scales
+ */
+
+/* the top 3 rows of the blended matrices of the 8 vertices at i, as
+ * 12 multiply-adds per influence
+ */
+inline auto skin_blend (const mat4 *palette, const skin_bones &bones, const vec4_soa &weights, std::size_t i)
+  -> mat<simd_float8, 4, 3>
+{
+   mat<simd_float8, 4, 3> blend;
+   {
+      const mat<simd_float8, 4, 4> m = gather (palette, bones.stream (0) + i);
+      const simd_float8            w = simd_float8::load (weights.stream (0) + i);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t r = 0; r < 3; r++) {
+            blend[c][r] = m[c][r] * w;
+         }
+      }
+   }
+   for (std::size_t k = 1; k < 4; k++) {
+      const simd_float8 w = simd_float8::load (weights.stream (k) + i);
+      if (none (w != simd_float8 (0.0f))) {
+         continue;
+      }
+      const mat<simd_float8, 4, 4> m = gather (palette, bones.stream (k) + i);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t r = 0; r < 3; r++) {
+            blend[c][r] = fmadd (m[c][r], w, blend[c][r]);
+         }
+      }
+   }
+   return blend;
+}
+
+inline auto skin_point (const mat<simd_float8, 4, 3> &m, const vec3x8 &p) -> vec3x8
+{
+   vec3x8 result;
+   for (std::size_t r = 0; r < 3; r++) {
+      result[r] = fmadd (m[0][r], p.x, fmadd (m[1][r], p.y, fmadd (m[2][r], p.z, m[3][r])));
+   }
+   return result;
+}
+
+inline auto skin_normal (const mat<simd_float8, 4, 3> &m, const vec3x8 &n) -> vec3x8
+{
+   vec3x8 result;
+   for (std::size_t r = 0; r < 3; r++) {
+      result[r] = fmadd (m[0][r], n.x, fmadd (m[1][r], n.y, m[2][r] * n.z));
+   }
+   return norm (result);
+}
+
+inline void skin_linear (std::span<const mat4> palette, const skin_bones &bones, const vec4_soa &weights,
+                         const vec3_soa &positions, vec3_soa &out_positions)
+{
+   assert (("Size mismatch\n" && bones.size () == positions.size () && weights.size () == positions.size ()));
+   if (&out_positions != &positions) {
+      out_positions.resize (positions.size ());
+   }
+   parallel_for (positions.padded_size (), skin_grain, [&] (std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; i += 8) {
+         const mat<simd_float8, 4, 3> m = skin_blend (palette.data (), bones, weights, i);
+         unpack (skin_point (m, pack (positions, i)), out_positions, i);
+      }
+   });
+}
+
+inline void skin_linear (std::span<const mat4> palette, const skin_bones &bones, const vec4_soa &weights,
+                         const vec3_soa &positions, const vec3_soa &normals, vec3_soa &out_positions,
+                         vec3_soa &out_normals)
+{
+   assert (("Size mismatch\n" && bones.size () == positions.size () && weights.size () == positions.size ()
+            && normals.size () == positions.size ()));
+   if (&out_positions != &positions) {
+      out_positions.resize (positions.size ());
+   }
+   if (&out_normals != &normals) {
+      out_normals.resize (normals.size ());
+   }
+   parallel_for (positions.padded_size (), skin_grain, [&] (std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; i += 8) {
+         const mat<simd_float8, 4, 3> m = skin_blend (palette.data (), bones, weights, i);
+         unpack (skin_point (m, pack (positions, i)), out_positions, i);
+         unpack (skin_normal (m, pack (normals, i)), out_normals, i);
+      }
+   });
+}
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include "simd.hpp"
+#include "vector.hpp"
+
+/* structure-of-arrays vectors.
+ * vec_soa<T, n> holds many n-dimensional vectors, but instead of an
+ * array of vec<T, n> every component gets its own stream: all x, then
+ * all y, ...
+ * Each stream is aligned and padded to a multiple of the SIMD-width,
+ * so the operators below are flat loops the compiler can vectorize
+ * without any scalar head or tail. The padding-lanes take part in the
+ * arithmetic, but they are never visible from the outside.
+ */
+
+#define soa_n vec_soa<T, n>
+template <typename T, std::size_t n>
+class vec_soa
+{
+ public:
+   // elements of T per cache-line (and AVX-512 register)
+   static constexpr std::size_t lanes = 64 / sizeof (T);
+
+   vec_soa () = default;
+
+   explicit vec_soa (std::size_t count)
+   {
+      resize (count);
+   }
+
+   /* single value constructor gives all vectors the same value
+    */
+   vec_soa (std::size_t count, vec<T, n> val)
+   {
+      resize (count);
+      for (std::size_t c = 0; c < n; c++) {
+         T *__restrict s = stream (c);
+         for (std::size_t i = 0; i < _padded; i++) {
+            s[i] = val[c];
+         }
+      }
+   }
+
+   /* convert from an array of vectors
+    */
+   vec_soa (const std::vector<vec<T, n>> &aos)
+   {
+      resize (aos.size ());
+      for (std::size_t i = 0; i < _size; i++) {
+         set (i, aos[i]);
+      }
+   }
+
+   /* convert back to an array of vectors
+    */
+   auto to_aos () const -> std::vector<vec<T, n>>
+   {
+      std::vector<vec<T, n>> aos (_size);
+      for (std::size_t i = 0; i < _size; i++) {
+         aos[i] = get (i);
+      }
+      return aos;
+   }
+
+   inline auto size () const -> std::size_t
+   {
+      return _size;
+   }
+
+   /* length of every stream, including the padding
+    */
+   inline auto padded_size () const -> std::size_t
+   {
+      return _padded;
+   }
+
+   /* resize all streams, existing vectors are kept and new ones are
+    * zero-initialized. The batched functions resize their output on
+    * every call, so the same size must not reallocate
+    */
+   void resize (std::size_t count)
+   {
+      if (count == _size) {
+         return;
+      }
+      const std::size_t padded = (count + lanes - 1) / lanes * lanes;
+
+      std::vector<T, aligned_allocator<T>> data (padded * n, T {});
+      for (std::size_t c = 0; c < n; c++) {
+         for (std::size_t i = 0; i < (count < _size ? count : _size); i++) {
+            data[c * padded + i] = _data[c * _padded + i];
+         }
+      }
+      _data.swap (data);
+      _size   = count;
+      _padded = padded;
+   }
+
+   /* the c-th component of every vector, e.g. stream(0) is all x
+    */
+   inline auto stream (std::size_t c) -> T *
+   {
+      assert (("Component out of range\n" && c < n));
+      return _data.data () + c * _padded;
+   }
+
+   inline auto stream (std::size_t c) const -> const T *
+   {
+      assert (("Component out of range\n" && c < n));
+      return _data.data () + c * _padded;
+   }
+
+   inline auto x () -> T *
+   {
+      return stream (0);
+   }
+
+   inline auto y () -> T *
+   requires (n >= 2)
+   {
+      return stream (1);
+   }
+
+   inline auto z () -> T *
+   requires (n >= 3)
+   {
+      return stream (2);
+   }
+
+   inline auto w () -> T *
+   requires (n >= 4)
+   {
+      return stream (3);
+   }
+
+   inline auto x () const -> const T *
+   {
+      return stream (0);
+   }
+
+   inline auto y () const -> const T *
+   requires (n >= 2)
+   {
+      return stream (1);
+   }
+
+   inline auto z () const -> const T *
+   requires (n >= 3)
+   {
+      return stream (2);
+   }
+
+   inline auto w () const -> const T *
+   requires (n >= 4)
+   {
+      return stream (3);
+   }
+
+   /* gather a single vector
+    */
+   inline auto get (std::size_t idx) const -> vec<T, n>
+   {
+      assert (("Index out of range\n" && idx < _size));
+      vec<T, n> result;
+      for (std::size_t c = 0; c < n; c++) {
+         result[c] = _data[c * _padded + idx];
+      }
+      return result;
+   }
+
+   /* scatter a single vector
+    */
+   inline void set (std::size_t idx, vec<T, n> v)
+   {
+      assert (("Index out of range\n" && idx < _size));
+      for (std::size_t c = 0; c < n; c++) {
+         _data[c * _padded + idx] = v[c];
+      }
+   }
+
+   /* SoA x SoA
+    * since all streams have the same padded length, the whole array
+    * is one flat loop. No __restrict here, v may be *this
+    */
+   inline auto operator+= (const soa_n &v) -> soa_n &
+   {
+      assert (("Size mismatch\n" && v._size == _size));
+      T *      a = _data.data ();
+      const T *b = v._data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] += b[i];
+      return *this;
+   }
+
+   inline auto operator-= (const soa_n &v) -> soa_n &
+   {
+      assert (("Size mismatch\n" && v._size == _size));
+      T *      a = _data.data ();
+      const T *b = v._data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] -= b[i];
+      return *this;
+   }
+
+   inline auto operator*= (const soa_n &v) -> soa_n &
+   {
+      assert (("Size mismatch\n" && v._size == _size));
+      T *      a = _data.data ();
+      const T *b = v._data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] *= b[i];
+      return *this;
+   }
+
+   inline auto operator/= (const soa_n &v) -> soa_n &
+   {
+      assert (("Size mismatch\n" && v._size == _size));
+      T *      a = _data.data ();
+      const T *b = v._data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] /= b[i];
+      return *this;
+   }
+
+   /* SoA x Vector
+    * the same vector is applied to every element
+    */
+   inline auto operator+= (vec<T, n> v) -> soa_n &
+   {
+      for (std::size_t c = 0; c < n; c++) {
+         T *__restrict s = stream (c);
+         for (std::size_t i = 0; i < _padded; i++)
+            s[i] += v[c];
+      }
+      return *this;
+   }
+
+   inline auto operator-= (vec<T, n> v) -> soa_n &
+   {
+      for (std::size_t c = 0; c < n; c++) {
+         T *__restrict s = stream (c);
+         for (std::size_t i = 0; i < _padded; i++)
+            s[i] -= v[c];
+      }
+      return *this;
+   }
+
+   inline auto operator*= (vec<T, n> v) -> soa_n &
+   {
+      for (std::size_t c = 0; c < n; c++) {
+         T *__restrict s = stream (c);
+         for (std::size_t i = 0; i < _padded; i++)
+            s[i] *= v[c];
+      }
+      return *this;
+   }
+
+   inline auto operator/= (vec<T, n> v) -> soa_n &
+   {
+      for (std::size_t c = 0; c < n; c++) {
+         T *__restrict s = stream (c);
+         for (std::size_t i = 0; i < _padded; i++)
+            s[i] /= v[c];
+      }
+      return *this;
+   }
+
+   /* SoA x Scalar
+    */
+   inline auto operator+= (T scalar) -> soa_n &
+   {
+      T *__restrict a = _data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] += scalar;
+      return *this;
+   }
+
+   inline auto operator-= (T scalar) -> soa_n &
+   {
+      T *__restrict a = _data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] -= scalar;
+      return *this;
+   }
+
+   inline auto operator*= (T scalar) -> soa_n &
+   {
+      T *__restrict a = _data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] *= scalar;
+      return *this;
+   }
+
+   inline auto operator/= (T scalar) -> soa_n &
+   {
+      T *__restrict a = _data.data ();
+      for (std::size_t i = 0; i < n * _padded; i++)
+         a[i] /= scalar;
+      return *this;
+   }
+
+ private:
+   std::size_t                          _size   = 0;
+   std::size_t                          _padded = 0;
+   std::vector<T, aligned_allocator<T>> _data;
+};
+
+typedef vec_soa<float, 1> float_soa;
+typedef vec_soa<float, 2> vec2_soa;
+typedef vec_soa<float, 3> vec3_soa;
+typedef vec_soa<float, 4> vec4_soa;
+
+typedef vec_soa<double, 1> double_soa;
+typedef vec_soa<double, 2> vec2d_soa;
+typedef vec_soa<double, 3> vec3d_soa;
+typedef vec_soa<double, 4> vec4d_soa;
+
+/* SoA Operations
+ * --------------
+ * same set as for single vectors, applied to every element.
+ * Functions that give a scalar per vector return a vec_soa<T, 1>.
+ */
+template <typename T, std::size_t n>
+inline auto operator+ (const soa_n &v1, const soa_n &v2) -> soa_n
+{
+   return soa_n (v1) += v2;
+}
+
+template <typename T, std::size_t n>
+inline auto operator- (const soa_n &v1, const soa_n &v2) -> soa_n
+{
+   return soa_n (v1) -= v2;
+}
+
+template <typename T, std::size_t n>
+inline auto operator* (const soa_n &v1, const soa_n &v2) -> soa_n
+{
+   return soa_n (v1) *= v2;
+}
+
+template <typename T, std::size_t n>
+inline auto operator/ (const soa_n &v1, const soa_n &v2) -> soa_n
+{
+   return soa_n (v1) /= v2;
+}
+
+template <typename T, std::size_t n>
+inline auto operator+ (const soa_n &v, std::type_identity_t<T> scalar) -> soa_n
+{
+   return soa_n (v) += scalar;
+}
+
+template <typename T, std::size_t n>
+inline auto operator- (const soa_n &v, std::type_identity_t<T> scalar) -> soa_n
+{
+   return soa_n (v) -= scalar;
+}
+
+template <typename T, std::size_t n>
+inline auto operator* (const soa_n &v, std::type_identity_t<T> scalar) -> soa_n
+{
+   return soa_n (v) *= scalar;
+}
+
+template <typename T, std::size_t n>
+inline auto operator/ (const soa_n &v, std::type_identity_t<T> scalar) -> soa_n
+{
+   return soa_n (v) /= scalar;
+}
+
+template <typename T, std::size_t n>
+inline auto dot (const soa_n &v1, const soa_n &v2) -> vec_soa<T, 1>
+{
+   assert (("Size mismatch\n" && v1.size () == v2.size ()));
+   vec_soa<T, 1> result (v1.size ());
+   T *__restrict r = result.stream (0);
+   for (std::size_t c = 0; c < n; c++) {
+      const T *__restrict a = v1.stream (c);
+      const T *__restrict b = v2.stream (c);
+      for (std::size_t i = 0; i < result.padded_size (); i++) {
+         r[i] += a[i] * b[i];
+      }
+   }
+   return result;
+}
+
+template <typename T, std::size_t n>
+inline auto len2 (const soa_n &v) -> vec_soa<T, 1>
+{
+   return dot (v, v);
+}
+
+template <typename T, std::size_t n>
+inline auto len (const soa_n &v) -> vec_soa<T, 1>
+{
+   vec_soa<T, 1> result = dot (v, v);
+   T *__restrict r      = result.stream (0);
+   for (std::size_t i = 0; i < result.padded_size (); i++) {
+      r[i] = sqrt (r[i]);
+   }
+   return result;
+}
+
+template <typename T, std::size_t n>
+inline auto dist (const soa_n &v1, const soa_n &v2) -> vec_soa<T, 1>
+{
+   return len (v1 - v2);
+}
+
+template <typename T, std::size_t n>
+inline auto dist2 (const soa_n &v1, const soa_n &v2) -> vec_soa<T, 1>
+{
+   return len2 (v1 - v2);
+}
+
+template <typename T, std::size_t n>
+inline auto norm (const soa_n &v) -> soa_n
+{
+   soa_n         result (v);
+   vec_soa<T, 1> length = len (v);
+   const T *__restrict l = length.stream (0);
+   for (std::size_t c = 0; c < n; c++) {
+      T *__restrict s = result.stream (c);
+      for (std::size_t i = 0; i < result.padded_size (); i++) {
+         s[i] /= l[i];
+      }
+   }
+   return result;
+}
+
+/* cross product is only relevant for 3-dimensional vectors
+ */
+template <typename T>
+inline auto cross (const vec_soa<T, 3> &v1, const vec_soa<T, 3> &v2) -> vec_soa<T, 3>
+{
+   assert (("Size mismatch\n" && v1.size () == v2.size ()));
+   vec_soa<T, 3> result (v1.size ());
+   const T *__restrict ax = v1.x ();
+   const T *__restrict ay = v1.y ();
+   const T *__restrict az = v1.z ();
+   const T *__restrict bx = v2.x ();
+   const T *__restrict by = v2.y ();
+   const T *__restrict bz = v2.z ();
+   T *__restrict       rx = result.x ();
+   T *__restrict       ry = result.y ();
+   T *__restrict       rz = result.z ();
+   for (std::size_t i = 0; i < result.padded_size (); i++) {
+      rx[i] = ay[i] * bz[i] - az[i] * by[i];
+      ry[i] = az[i] * bx[i] - ax[i] * bz[i];
+      rz[i] = ax[i] * by[i] - ay[i] * bx[i];
+   }
+   return result;
+}
+
+#undef soa_n
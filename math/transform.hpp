@@ -0,0 +1,332 @@
+#pragma once
+
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+#include "packet.hpp"
+#include "soa.hpp"
+
+/* batched transformations by a mat<T, 4, 4>.
+ * the matrix is only read once per batch: its coefficients go into
+ * locals before the loop, so the loop itself is nothing but
+ * multiply-adds, without copying the matrix or building a vec per
+ * element.
+ * Points are transformed with w = 1, direction-vectors with w = 0 and
+ * normals with the inverse-transpose of the upper 3x3. Normals keep
+ * their length only for rotations, use norm() / batch_norm() if a scale
+ * is involved.
+ * in and out may be the same array, out must be at least as long as in.
+ */
+
+/* T is only deduced from the matrix, so the spans can be built from
+ * std::vector, std::array, ... implicitly
+ */
+template <typename T>
+using span_of = std::span<std::type_identity_t<T>>;
+
+/* the 3x3 inverse-transpose of the upper-left part of m, column-major.
+ * its columns are the cross products of the columns of m, divided by
+ * the determinant
+ */
+template <typename T>
+inline void normal_matrix (const mat<T, 4, 4> &m, T *result)
+{
+   const T *c = reinterpret_cast<const T *> (&m);
+   vec<T, 3> a = vec<T, 3> (c[0], c[1], c[2]);
+   vec<T, 3> b = vec<T, 3> (c[4], c[5], c[6]);
+   vec<T, 3> d = vec<T, 3> (c[8], c[9], c[10]);
+
+   vec<T, 3> bd  = cross (b, d);
+   vec<T, 3> da  = cross (d, a);
+   vec<T, 3> ab  = cross (a, b);
+   T         inv = T (1) / dot (a, bd);
+   for (std::size_t i = 0; i < 3; i++) {
+      result[i]     = bd[i] * inv;
+      result[3 + i] = da[i] * inv;
+      result[6 + i] = ab[i] * inv;
+   }
+}
+
+/* Array of vectors
+ * ----------------
+ */
+template <typename T>
+inline void transform_points (const mat<T, 4, 4> &m, span_of<const vec<T, 3>> in, span_of<vec<T, 3>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   const T *c = reinterpret_cast<const T *> (&m);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const T x = in[i].x, y = in[i].y, z = in[i].z;
+      out[i].x  = c[0] * x + c[4] * y + c[8] * z + c[12];
+      out[i].y  = c[1] * x + c[5] * y + c[9] * z + c[13];
+      out[i].z  = c[2] * x + c[6] * y + c[10] * z + c[14];
+   }
+}
+
+template <typename T>
+inline void transform_vectors (const mat<T, 4, 4> &m, span_of<const vec<T, 3>> in, span_of<vec<T, 3>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   const T *c = reinterpret_cast<const T *> (&m);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const T x = in[i].x, y = in[i].y, z = in[i].z;
+      out[i].x  = c[0] * x + c[4] * y + c[8] * z;
+      out[i].y  = c[1] * x + c[5] * y + c[9] * z;
+      out[i].z  = c[2] * x + c[6] * y + c[10] * z;
+   }
+}
+
+template <typename T>
+inline void transform_normals (const mat<T, 4, 4> &m, span_of<const vec<T, 3>> in, span_of<vec<T, 3>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   T c[9];
+   normal_matrix (m, c);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const T x = in[i].x, y = in[i].y, z = in[i].z;
+      out[i].x  = c[0] * x + c[3] * y + c[6] * z;
+      out[i].y  = c[1] * x + c[4] * y + c[7] * z;
+      out[i].z  = c[2] * x + c[5] * y + c[8] * z;
+   }
+}
+
+/* the vec4 versions ignore the w of the input and write the full
+ * homogeneous result, e.g. for clip-space positions
+ */
+template <typename T>
+inline void transform_points (const mat<T, 4, 4> &m, span_of<const vec<T, 4>> in, span_of<vec<T, 4>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   const T *c = reinterpret_cast<const T *> (&m);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const T x = in[i].x, y = in[i].y, z = in[i].z;
+      out[i].x  = c[0] * x + c[4] * y + c[8] * z + c[12];
+      out[i].y  = c[1] * x + c[5] * y + c[9] * z + c[13];
+      out[i].z  = c[2] * x + c[6] * y + c[10] * z + c[14];
+      out[i].w  = c[3] * x + c[7] * y + c[11] * z + c[15];
+   }
+}
+
+template <typename T>
+inline void transform_vectors (const mat<T, 4, 4> &m, span_of<const vec<T, 4>> in, span_of<vec<T, 4>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   const T *c = reinterpret_cast<const T *> (&m);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const T x = in[i].x, y = in[i].y, z = in[i].z;
+      out[i].x  = c[0] * x + c[4] * y + c[8] * z;
+      out[i].y  = c[1] * x + c[5] * y + c[9] * z;
+      out[i].z  = c[2] * x + c[6] * y + c[10] * z;
+      out[i].w  = c[3] * x + c[7] * y + c[11] * z;
+   }
+}
+
+template <typename T>
+inline void transform_normals (const mat<T, 4, 4> &m, span_of<const vec<T, 4>> in, span_of<vec<T, 4>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   T c[9];
+   normal_matrix (m, c);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const T x = in[i].x, y = in[i].y, z = in[i].z;
+      out[i].x  = c[0] * x + c[3] * y + c[6] * z;
+      out[i].y  = c[1] * x + c[4] * y + c[7] * z;
+      out[i].z  = c[2] * x + c[5] * y + c[8] * z;
+      out[i].w  = 0;
+   }
+}
+
+#ifdef MRN_SIMD_SSE2
+/* vec4 is an SSE register anyway, so the float-versions are one
+ * column-broadcast per component
+ */
+template <>
+inline void transform_points<float> (const mat<float, 4, 4> &m, span_of<const vec<float, 4>> in, span_of<vec<float, 4>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   const float *c     = reinterpret_cast<const float *> (&m);
+   const __m128 c0    = _mm_loadu_ps (c);
+   const __m128 c1    = _mm_loadu_ps (c + 4);
+   const __m128 c2    = _mm_loadu_ps (c + 8);
+   const __m128 c3    = _mm_loadu_ps (c + 12);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const __m128 v  = in[i].simd;
+      __m128       lo = simd_fmadd (c0, simd_splat<0> (v), c3);
+      __m128       hi = _mm_mul_ps (c2, simd_splat<2> (v));
+      lo              = simd_fmadd (c1, simd_splat<1> (v), lo);
+      out[i].simd     = _mm_add_ps (lo, hi);
+   }
+}
+
+template <>
+inline void transform_vectors<float> (const mat<float, 4, 4> &m, span_of<const vec<float, 4>> in, span_of<vec<float, 4>> out)
+{
+   assert (("Output too small\n" && out.size () >= in.size ()));
+   const float *c     = reinterpret_cast<const float *> (&m);
+   const __m128 c0    = _mm_loadu_ps (c);
+   const __m128 c1    = _mm_loadu_ps (c + 4);
+   const __m128 c2    = _mm_loadu_ps (c + 8);
+   for (std::size_t i = 0; i < in.size (); i++) {
+      const __m128 v  = in[i].simd;
+      __m128       lo = _mm_mul_ps (c0, simd_splat<0> (v));
+      __m128       hi = _mm_mul_ps (c2, simd_splat<2> (v));
+      lo              = simd_fmadd (c1, simd_splat<1> (v), lo);
+      out[i].simd     = _mm_add_ps (lo, hi);
+   }
+}
+#endif
+
+/* Structure of arrays
+ * -------------------
+ * whole streams at once, these vectorize without any shuffling
+ */
+template <typename T>
+inline void transform_points (const mat<T, 4, 4> &m, const vec_soa<T, 3> &in, vec_soa<T, 3> &out)
+{
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   const T *c  = reinterpret_cast<const T *> (&m);
+   const T *ix = in.x (), *iy = in.y (), *iz = in.z ();
+   T *      ox = out.x (), *oy = out.y (), *oz = out.z ();
+   for (std::size_t i = 0; i < in.padded_size (); i++) {
+      const T x = ix[i], y = iy[i], z = iz[i];
+      ox[i]     = c[0] * x + c[4] * y + c[8] * z + c[12];
+      oy[i]     = c[1] * x + c[5] * y + c[9] * z + c[13];
+      oz[i]     = c[2] * x + c[6] * y + c[10] * z + c[14];
+   }
+}
+
+template <typename T>
+inline void transform_vectors (const mat<T, 4, 4> &m, const vec_soa<T, 3> &in, vec_soa<T, 3> &out)
+{
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   const T *c  = reinterpret_cast<const T *> (&m);
+   const T *ix = in.x (), *iy = in.y (), *iz = in.z ();
+   T *      ox = out.x (), *oy = out.y (), *oz = out.z ();
+   for (std::size_t i = 0; i < in.padded_size (); i++) {
+      const T x = ix[i], y = iy[i], z = iz[i];
+      ox[i]     = c[0] * x + c[4] * y + c[8] * z;
+      oy[i]     = c[1] * x + c[5] * y + c[9] * z;
+      oz[i]     = c[2] * x + c[6] * y + c[10] * z;
+   }
+}
+
+template <typename T>
+inline void transform_normals (const mat<T, 4, 4> &m, const vec_soa<T, 3> &in, vec_soa<T, 3> &out)
+{
+   if (&out != &in) {
+      out.resize (in.size ());
+   }
+   T c[9];
+   normal_matrix (m, c);
+   const T *ix = in.x (), *iy = in.y (), *iz = in.z ();
+   T *      ox = out.x (), *oy = out.y (), *oz = out.z ();
+   for (std::size_t i = 0; i < in.padded_size (); i++) {
+      const T x = ix[i], y = iy[i], z = iz[i];
+      ox[i]     = c[0] * x + c[3] * y + c[6] * z;
+      oy[i]     = c[1] * x + c[4] * y + c[7] * z;
+      oz[i]     = c[2] * x + c[5] * y + c[8] * z;
+   }
+}
+
+/* Batched inverse
+ * ---------------
+ * count matrices from in to out, which may be the same array. With AVX,
+ * 8 matrices at a time go through the scalar formulas in simd_float8
+ * lanes, the rest one by one
+ */
+template <typename T>
+inline void batch_inverse (const mat<T, 4, 4> *in, mat<T, 4, 4> *out, std::size_t count)
+{
+   std::size_t i = 0;
+#ifdef MRN_SIMD_AVX
+   if constexpr (std::is_same_v<T, float>) {
+      for (; i + 8 <= count; i += 8) {
+         unpack (inverse (pack (&in[i])), &out[i]);
+      }
+   }
+#endif
+   for (; i < count; i++) {
+      out[i] = inverse (in[i]);
+   }
+}
+
+template <typename T>
+inline void batch_inverse_affine (const mat<T, 4, 4> *in, mat<T, 4, 4> *out, std::size_t count)
+{
+   std::size_t i = 0;
+#ifdef MRN_SIMD_AVX
+   if constexpr (std::is_same_v<T, float>) {
+      for (; i + 8 <= count; i += 8) {
+         unpack (inverse_affine (pack (&in[i])), &out[i]);
+      }
+   }
+#endif
+   for (; i < count; i++) {
+      out[i] = inverse_affine (in[i]);
+   }
+}
+
+/* Depth unprojection
+ * ------------------
+ * the view-space positions of a whole depth-buffer, width * height
+ * window-depths from 0 to 1 with row 0 at the bottom (glReadPixels).
+ * Point y * width + x of out is the center of pixel (x, y). proj has to
+ * come from perspective(), frustum() or orthographic(), flags only need
+ * projection_zero_to_one if it was made with it.
+ * Instead of a 4x4 inverse per sample, the rows of the sparse inverse
+ * are folded into per-column and per-row coefficients: a perspective
+ * needs one division for view z, which then scales the x and y of the
+ * pixel, an orthographic projection is linear in the depth
+ */
+template <typename T>
+inline void unproject_depth (const mat<T, 4, 4> &proj, const T *depth, std::size_t width, std::size_t height,
+                             vec_soa<T, 3> &out, unsigned flags = projection_gl)
+{
+   out.resize (width * height);
+   const bool perspective = proj[3][3] == 0;
+   const T    a = proj[0][0], b = proj[1][1], A = proj[2][2], B = proj[3][2];
+   // offsets of ndc x and y, the signs differ between the two kinds
+   const T cx = perspective ? proj[2][0] : -proj[3][0];
+   const T cy = perspective ? proj[2][1] : -proj[3][1];
+
+   // ndc z = ds * depth + d0
+   const T ds = flags & projection_zero_to_one ? 1 : 2;
+   const T d0 = flags & projection_zero_to_one ? 0 : -1;
+
+   // ndc x of the pixel-centers, plus the offset, over the scale
+   std::vector<T> kx (width);
+   for (std::size_t x = 0; x < width; x++) {
+      kx[x] = ((T (2 * x + 1) / T (width) - 1) + cx) / a;
+   }
+
+   T *ox = out.x (), *oy = out.y (), *oz = out.z ();
+   for (std::size_t y = 0; y < height; y++) {
+      const T  ky  = ((T (2 * y + 1) / T (height) - 1) + cy) / b;
+      const T *row = depth + y * width;
+      T       *px = ox + y * width, *py = oy + y * width, *pz = oz + y * width;
+      if (perspective) {
+         // z = -B / (ndc z + A), x = -z (ndc x + c) / a
+         const T s = ds, o = d0 + A;
+         for (std::size_t x = 0; x < width; x++) {
+            const T z = -B / (s * row[x] + o);
+            px[x]     = -z * kx[x];
+            py[x]     = -z * ky;
+            pz[x]     = z;
+         }
+      } else {
+         // z = (ndc z - B) / A
+         const T s = ds / A, o = (d0 - B) / A;
+         for (std::size_t x = 0; x < width; x++) {
+            px[x] = kx[x];
+            py[x] = ky;
+            pz[x] = s * row[x] + o;
+         }
+      }
+   }
+}
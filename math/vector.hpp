@@ -3,6 +3,11 @@
 #include <cassert>
 #include <initializer_list>
 #include <math.h>
+#include <type_traits>
+#include <utility>
+
+#include "scalar.hpp"
+#include "simd.hpp"
 
 /* generic n-dimensional vector class.
  * the vector class can have arbitrary size.
@@ -17,19 +22,19 @@ class vec
  public:
    /* default constructor has no initialization
     */
-   vec () = default;
+   constexpr vec () = default;
 
    /* single value constructor gives all elements
     * the same value
     */
-   vec (const T &val)
+   constexpr vec (const T &val)
    {
       for (std::size_t i = 0; i < n; i++) {
          _data[i] = val;
       }
    }
 
-   vec (const std::initializer_list<T> &vals)
+   constexpr vec (const std::initializer_list<T> &vals)
    {
       std::size_t i = 0;
       for (auto it = vals.begin (); it != vals.end (); ++it) {
@@ -37,62 +42,65 @@ class vec
       }
    }
 
-   ~vec () = default;
+   constexpr auto operator[] (std::size_t idx) -> T &
+   {
+      return this->_data[idx];
+   }
 
-   inline auto operator[] (std::size_t idx) -> T &
+   constexpr auto operator[] (std::size_t idx) const -> const T &
    {
       return this->_data[idx];
    }
 
-   inline auto operator+= (vec_n &v) -> vec_n &
+   constexpr auto operator+= (const vec_n &v) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] += v[i];
       return *this;
    }
 
-   inline auto operator-= (vec_n &v) -> vec_n &
+   constexpr auto operator-= (const vec_n &v) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] -= v[i];
       return *this;
    }
 
-   inline auto operator*= (vec_n &v) -> vec_n &
+   constexpr auto operator*= (const vec_n &v) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] *= v[i];
       return *this;
    }
 
-   inline auto operator/= (vec_n &v) -> vec_n &
+   constexpr auto operator/= (const vec_n &v) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] /= v[i];
       return *this;
    }
 
-   inline auto operator+= (T scalar) -> vec_n &
+   constexpr auto operator+= (T scalar) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] += scalar;
       return *this;
    }
 
-   inline auto operator-= (T scalar) -> vec_n &
+   constexpr auto operator-= (T scalar) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] -= scalar;
       return *this;
    }
-   inline auto operator*= (T scalar) -> vec_n &
+   constexpr auto operator*= (T scalar) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] *= scalar;
       return *this;
    }
 
-   inline auto operator/= (T scalar) -> vec_n &
+   constexpr auto operator/= (T scalar) -> vec_n &
    {
       for (std::size_t i = 0; i < n; i++)
          (*this)[i] /= scalar;
@@ -113,77 +121,99 @@ template <typename T>
 class vec_2
 {
  public:
-   vec () = default;
+   constexpr vec () = default;
 
-   vec (const T &val)
+   constexpr vec (const T &val)
    {
       x = y = val;
    }
 
    // give the specialized case its own constructor
    // so we don't have to use initializer_list-syntax
-   vec (const T &n1, const T &n2)
+   constexpr vec (const T &n1, const T &n2)
    {
       x = n1;
       y = n2;
    }
    // hack this to avoid a visible _data[] field.
    // because we can't have private member inside the union
-   inline auto operator[] (std::size_t idx) -> T &
+   constexpr auto operator[] (std::size_t idx) -> T &
    {
       assert (("Index out of range\n" && idx < 2));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         default:
+            return y;
+         }
+      }
       return *(reinterpret_cast<T *> (this) + idx);
    }
 
-   inline auto operator+= (vec_2 &v) -> vec_2 &
+   constexpr auto operator[] (std::size_t idx) const -> const T &
+   {
+      assert (("Index out of range\n" && idx < 2));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         default:
+            return y;
+         }
+      }
+      return *(reinterpret_cast<const T *> (this) + idx);
+   }
+
+   constexpr auto operator+= (const vec_2 &v) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] += v[i];
       return *this;
    }
 
-   inline auto operator-= (vec_2 &v) -> vec_2 &
+   constexpr auto operator-= (const vec_2 &v) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] -= v[i];
       return *this;
    }
 
-   inline auto operator*= (vec_2 &v) -> vec_2 &
+   constexpr auto operator*= (const vec_2 &v) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] *= v[i];
       return *this;
    }
 
-   inline auto operator/= (vec_2 &v) -> vec_2 &
+   constexpr auto operator/= (const vec_2 &v) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] /= v[i];
       return *this;
    }
 
-   inline auto operator+= (T scalar) -> vec_2 &
+   constexpr auto operator+= (T scalar) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] += scalar;
       return *this;
    }
 
-   inline auto operator-= (T scalar) -> vec_2 &
+   constexpr auto operator-= (T scalar) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] -= scalar;
       return *this;
    }
-   inline auto operator*= (T scalar) -> vec_2 &
+   constexpr auto operator*= (T scalar) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] *= scalar;
       return *this;
    }
 
-   inline auto operator/= (T scalar) -> vec_2 &
+   constexpr auto operator/= (T scalar) -> vec_2 &
    {
       for (std::size_t i = 0; i < 2; i++)
          (*this)[i] /= scalar;
@@ -210,75 +240,101 @@ template <typename T>
 class vec<T, 3>
 {
  public:
-   vec () = default;
+   constexpr vec () = default;
 
-   vec (const T &val)
+   constexpr vec (const T &val)
    {
       x = y = z = val;
    }
 
-   vec (const T &n1, const T &n2, const T &n3)
+   constexpr vec (const T &n1, const T &n2, const T &n3)
    {
       x = n1;
       y = n2;
       z = n3;
    }
 
-   auto operator[] (std::size_t idx) -> T &
+   constexpr auto operator[] (std::size_t idx) -> T &
    {
       assert (("Index out of range\n" && idx < 3));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         case 1:
+            return y;
+         default:
+            return z;
+         }
+      }
       return *(reinterpret_cast<T *> (this) + idx);
    }
 
-   inline auto operator+= (vec_3 &v) -> vec_3 &
+   constexpr auto operator[] (std::size_t idx) const -> const T &
+   {
+      assert (("Index out of range\n" && idx < 3));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         case 1:
+            return y;
+         default:
+            return z;
+         }
+      }
+      return *(reinterpret_cast<const T *> (this) + idx);
+   }
+
+   constexpr auto operator+= (const vec_3 &v) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] += v[i];
       return *this;
    }
 
-   inline auto operator-= (vec_3 &v) -> vec_3 &
+   constexpr auto operator-= (const vec_3 &v) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] -= v[i];
       return *this;
    }
 
-   inline auto operator*= (vec_3 &v) -> vec_3 &
+   constexpr auto operator*= (const vec_3 &v) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] *= v[i];
       return *this;
    }
 
-   inline auto operator/= (vec_3 &v) -> vec_3 &
+   constexpr auto operator/= (const vec_3 &v) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] /= v[i];
       return *this;
    }
 
-   inline auto operator+= (T scalar) -> vec_3 &
+   constexpr auto operator+= (T scalar) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] += scalar;
       return *this;
    }
 
-   inline auto operator-= (T scalar) -> vec_3 &
+   constexpr auto operator-= (T scalar) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] -= scalar;
       return *this;
    }
-   inline auto operator*= (T scalar) -> vec_3 &
+   constexpr auto operator*= (T scalar) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] *= scalar;
       return *this;
    }
 
-   inline auto operator/= (T scalar) -> vec_3 &
+   constexpr auto operator/= (T scalar) -> vec_3 &
    {
       for (std::size_t i = 0; i < 3; i++)
          (*this)[i] /= scalar;
@@ -315,6 +371,9 @@ class vec<T, 3>
       };
    };
 
+   /* vec_3 is still incomplete in here, so these can't be constexpr
+    * yet. Their definitions below are constexpr
+    */
    static const vec_3 UP;
    static const vec_3 DOWN;
    static const vec_3 LEFT;
@@ -324,31 +383,31 @@ class vec<T, 3>
 };
 
 template <typename T>
-const vec_3 vec_3::UP = vec_3 (0.0, 1.0, 0.0);
+constexpr vec_3 vec_3::UP = vec_3 (0.0, 1.0, 0.0);
 template <typename T>
-const vec_3 vec_3::DOWN = vec_3 (0.0, -1.0, 0.0);
+constexpr vec_3 vec_3::DOWN = vec_3 (0.0, -1.0, 0.0);
 template <typename T>
-const vec_3 vec_3::LEFT = vec_3 (-1.0, 0.0, 0.0);
+constexpr vec_3 vec_3::LEFT = vec_3 (-1.0, 0.0, 0.0);
 template <typename T>
-const vec_3 vec_3::RIGHT = vec_3 (1.0, 0.0, 0.0);
+constexpr vec_3 vec_3::RIGHT = vec_3 (1.0, 0.0, 0.0);
 template <typename T>
-const vec_3 vec_3::FORWARD = vec_3 (0.0, 0.0, -1.0);
+constexpr vec_3 vec_3::FORWARD = vec_3 (0.0, 0.0, -1.0);
 template <typename T>
-const vec_3 vec_3::BACK = vec_3 (0.0, 0.0, 1.0);
+constexpr vec_3 vec_3::BACK = vec_3 (0.0, 0.0, 1.0);
 
 #define vec_4 vec<T, 4>
 template <typename T>
 class vec<T, 4>
 {
  public:
-   vec () = default;
+   constexpr vec () = default;
 
-   vec (const T &val)
+   constexpr vec (const T &val)
    {
       x = y = z = w = val;
    }
 
-   vec (const T &n1, const T &n2, const T &n3, const T &n4)
+   constexpr vec (const T &n1, const T &n2, const T &n3, const T &n4)
    {
       x = n1;
       y = n2;
@@ -356,61 +415,91 @@ class vec<T, 4>
       w = n4;
    }
 
-   inline auto operator[] (const std::size_t idx) -> T &
+   constexpr auto operator[] (const std::size_t idx) -> T &
    {
       assert (("Index out of range\n" && idx < 4));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         case 1:
+            return y;
+         case 2:
+            return z;
+         default:
+            return w;
+         }
+      }
       return *(reinterpret_cast<T *> (this) + idx);
    }
 
-   inline auto operator+= (vec_4 &v) -> vec_4 &
+   constexpr auto operator[] (const std::size_t idx) const -> const T &
+   {
+      assert (("Index out of range\n" && idx < 4));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         case 1:
+            return y;
+         case 2:
+            return z;
+         default:
+            return w;
+         }
+      }
+      return *(reinterpret_cast<const T *> (this) + idx);
+   }
+
+   constexpr auto operator+= (const vec_4 &v) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] += v[i];
       return *this;
    }
 
-   inline auto operator-= (vec_4 &v) -> vec_4 &
+   constexpr auto operator-= (const vec_4 &v) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] -= v[i];
       return *this;
    }
 
-   inline auto operator*= (vec_4 &v) -> vec_4 &
+   constexpr auto operator*= (const vec_4 &v) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] *= v[i];
       return *this;
    }
 
-   inline auto operator/= (vec_4 &v) -> vec_4 &
+   constexpr auto operator/= (const vec_4 &v) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] /= v[i];
       return *this;
    }
 
-   inline auto operator+= (T scalar) -> vec_4 &
+   constexpr auto operator+= (T scalar) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] += scalar;
       return *this;
    }
 
-   inline auto operator-= (T scalar) -> vec_4 &
+   constexpr auto operator-= (T scalar) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] -= scalar;
       return *this;
    }
-   inline auto operator*= (T scalar) -> vec_4 &
+   constexpr auto operator*= (T scalar) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] *= scalar;
       return *this;
    }
 
-   inline auto operator/= (T scalar) -> vec_4 &
+   constexpr auto operator/= (T scalar) -> vec_4 &
    {
       for (std::size_t i = 0; i < 4; i++)
          (*this)[i] /= scalar;
@@ -462,6 +551,224 @@ class vec<T, 4>
    };
 };
 
+#ifdef MRN_SIMD_SSE2
+/* SSE-backed vec4.
+ * same interface and component-names as vec<T, 4>, but the union
+ * also holds an __m128. That makes the storage 16-byte aligned and
+ * every operator a single instruction instead of a loop.
+ * It is still a (constrained) partial specialization, so it gets
+ * the same lenient rules for the anonymous structs as vec<T, 4>.
+ */
+template <typename T>
+requires std::is_same_v<T, float>
+class vec_4
+{
+ public:
+   constexpr vec () = default;
+
+   /* the intrinsics can't run at compile-time, there we fill in the
+    * components one by one
+    */
+   constexpr vec (const T &val)
+   {
+      if (std::is_constant_evaluated ()) {
+         x = y = z = w = val;
+      } else {
+         simd = _mm_set1_ps (val);
+      }
+   }
+
+   constexpr vec (const T &n1, const T &n2, const T &n3, const T &n4)
+   {
+      if (std::is_constant_evaluated ()) {
+         x = n1;
+         y = n2;
+         z = n3;
+         w = n4;
+      } else {
+         simd = _mm_setr_ps (n1, n2, n3, n4);
+      }
+   }
+
+   explicit vec (__m128 v)
+   {
+      simd = v;
+   }
+
+   constexpr auto operator[] (const std::size_t idx) -> T &
+   {
+      assert (("Index out of range\n" && idx < 4));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         case 1:
+            return y;
+         case 2:
+            return z;
+         default:
+            return w;
+         }
+      }
+      return *(reinterpret_cast<T *> (this) + idx);
+   }
+
+   constexpr auto operator[] (const std::size_t idx) const -> const T &
+   {
+      assert (("Index out of range\n" && idx < 4));
+      if (std::is_constant_evaluated ()) {
+         switch (idx) {
+         case 0:
+            return x;
+         case 1:
+            return y;
+         case 2:
+            return z;
+         default:
+            return w;
+         }
+      }
+      return *(reinterpret_cast<const T *> (this) + idx);
+   }
+
+   constexpr auto operator+= (const vec_4 &v) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] += v[i];
+      } else {
+         simd = _mm_add_ps (simd, v.simd);
+      }
+      return *this;
+   }
+
+   constexpr auto operator-= (const vec_4 &v) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] -= v[i];
+      } else {
+         simd = _mm_sub_ps (simd, v.simd);
+      }
+      return *this;
+   }
+
+   constexpr auto operator*= (const vec_4 &v) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] *= v[i];
+      } else {
+         simd = _mm_mul_ps (simd, v.simd);
+      }
+      return *this;
+   }
+
+   constexpr auto operator/= (const vec_4 &v) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] /= v[i];
+      } else {
+         simd = _mm_div_ps (simd, v.simd);
+      }
+      return *this;
+   }
+
+   constexpr auto operator+= (T scalar) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] += scalar;
+      } else {
+         simd = _mm_add_ps (simd, _mm_set1_ps (scalar));
+      }
+      return *this;
+   }
+
+   constexpr auto operator-= (T scalar) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] -= scalar;
+      } else {
+         simd = _mm_sub_ps (simd, _mm_set1_ps (scalar));
+      }
+      return *this;
+   }
+
+   constexpr auto operator*= (T scalar) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] *= scalar;
+      } else {
+         simd = _mm_mul_ps (simd, _mm_set1_ps (scalar));
+      }
+      return *this;
+   }
+
+   constexpr auto operator/= (T scalar) -> vec_4 &
+   {
+      if (std::is_constant_evaluated ()) {
+         for (std::size_t i = 0; i < 4; i++)
+            (*this)[i] /= scalar;
+      } else {
+         simd = _mm_div_ps (simd, _mm_set1_ps (scalar));
+      }
+      return *this;
+   }
+
+   /* simd comes last: a zero-initialized vec4 {} activates the first
+    * member, and constant expressions may only read the active one
+    */
+   union
+   {
+      struct
+      {
+         T x;
+         T y;
+         T z;
+         T w;
+      };
+      struct
+      {
+         T r;
+         T g;
+         T b;
+         T a;
+      };
+      struct
+      {
+         T s;
+         T t;
+         T u;
+      };
+      struct
+      {
+         vec<T, 2> xy;
+      };
+      struct
+      {
+         vec<T, 2> uv;
+      };
+      struct
+      {
+         vec<T, 3> xyz;
+      };
+      struct
+      {
+         vec<T, 3> rgb;
+      };
+      struct
+      {
+         vec<T, 3> stu;
+      };
+      __m128 simd;
+   };
+};
+#endif
+
 typedef vec<float, 2> vec2;
 typedef vec<float, 3> vec3;
 typedef vec<float, 4> vec4;
@@ -485,80 +792,197 @@ typedef vec<bool, 4> vec4b;
  * re-write the operators for them for optimal performance
  */
 
+/* All operators take their vectors by const reference. The ones with an
+ * rvalue on the left (or on either side, if the operation commutes)
+ * compute into that temporary and move it out, so a + b + c builds one
+ * result instead of a copy per step.
+ */
+
 /* Negate Vector
+ * the result is zero-initialized, because a constant expression can't
+ * write through operator[] into a union that has no active member yet
  */
 template <typename T, std::size_t n>
-inline auto operator- (vec_n v) -> vec_n
+constexpr auto operator- (const vec_n &v) -> vec_n
 {
-   vec_n result;
+   vec_n result = {};
    for (std::size_t i = 0; i < n; i++) {
-      result = -v[i];
+      result[i] = -v[i];
    }
    return result;
 }
 
+template <typename T, std::size_t n>
+constexpr auto operator- (vec_n &&v) -> vec_n
+{
+   for (std::size_t i = 0; i < n; i++) {
+      v[i] = -v[i];
+   }
+   return std::move (v);
+}
+
+/* with MRN_MATH_EXPR_TEMPLATES defined, expr.hpp replaces the binary
+ * operators below with lazy versions
+ */
+#ifndef MRN_MATH_EXPR_TEMPLATES
 /* Vector x Vector
  */
 template <typename T, std::size_t n>
-inline auto operator+ (vec_n &v1, vec_n &v2) -> vec_n
+constexpr auto operator+ (const vec_n &v1, const vec_n &v2) -> vec_n
+{
+   vec_n result = v1;
+   result += v2;
+   return result;
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator+ (vec_n &&v1, const vec_n &v2) -> vec_n
+{
+   return std::move (v1 += v2);
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator+ (const vec_n &v1, vec_n &&v2) -> vec_n
+{
+   return std::move (v2 += v1);
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator+ (vec_n &&v1, vec_n &&v2) -> vec_n
+{
+   return std::move (v1 += v2);
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator- (const vec_n &v1, const vec_n &v2) -> vec_n
+{
+   vec_n result = v1;
+   result -= v2;
+   return result;
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator- (vec_n &&v1, const vec_n &v2) -> vec_n
+{
+   return std::move (v1 -= v2);
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator* (const vec_n &v1, const vec_n &v2) -> vec_n
+{
+   vec_n result = v1;
+   result *= v2; // Hadamard Product
+   return result;
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator* (vec_n &&v1, const vec_n &v2) -> vec_n
+{
+   return std::move (v1 *= v2);
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator* (const vec_n &v1, vec_n &&v2) -> vec_n
 {
-   return vec_n (v1) += v2;
+   return std::move (v2 *= v1);
 }
 
 template <typename T, std::size_t n>
-inline auto operator- (vec_n v1, vec_n v2) -> vec_n
+constexpr auto operator* (vec_n &&v1, vec_n &&v2) -> vec_n
 {
-   return vec_n (v1) -= v2;
+   return std::move (v1 *= v2);
 }
 
 template <typename T, std::size_t n>
-inline auto operator* (vec_n v1, vec_n v2) -> vec_n
+constexpr auto operator/ (const vec_n &v1, const vec_n &v2) -> vec_n
 {
-   return vec_n (v1) *= v2; // Hadamard Product
+   vec_n result = v1;
+   result /= v2;
+   return result;
 }
 
 template <typename T, std::size_t n>
-inline auto operator/ (vec_n v1, vec_n v2) -> vec_n
+constexpr auto operator/ (vec_n &&v1, const vec_n &v2) -> vec_n
 {
-   return vec_n (v1) /= v2;
+   return std::move (v1 /= v2);
 }
 
 /* Vector x Scalar
+ * the scalar is not deduced, so v * 2 and v * 0.5 both convert to T
  */
 template <typename T, std::size_t n>
-inline auto operator+ (vec_n v, int scalar) -> vec_n
+constexpr auto operator+ (const vec_n &v, std::type_identity_t<T> scalar) -> vec_n
+{
+   vec_n result = v;
+   result += scalar;
+   return result;
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator+ (vec_n &&v, std::type_identity_t<T> scalar) -> vec_n
 {
-   return vec_n (v) += scalar;
+   return std::move (v += scalar);
 }
 
 template <typename T, std::size_t n>
-inline auto operator- (vec_n v, int scalar) -> vec_n
+constexpr auto operator- (const vec_n &v, std::type_identity_t<T> scalar) -> vec_n
 {
-   return vec_n (v) -= scalar;
+   vec_n result = v;
+   result -= scalar;
+   return result;
 }
 
 template <typename T, std::size_t n>
-inline auto operator* (vec_n v, int scalar) -> vec_n
+constexpr auto operator- (vec_n &&v, std::type_identity_t<T> scalar) -> vec_n
 {
-   return vec_n (v) *= scalar;
+   return std::move (v -= scalar);
 }
 
 template <typename T, std::size_t n>
-inline auto operator/ (vec_n v, int scalar) -> vec_n
+constexpr auto operator* (const vec_n &v, std::type_identity_t<T> scalar) -> vec_n
 {
-   return vec_n (v) /= scalar;
+   vec_n result = v;
+   result *= scalar;
+   return result;
 }
 
+template <typename T, std::size_t n>
+constexpr auto operator* (vec_n &&v, std::type_identity_t<T> scalar) -> vec_n
+{
+   return std::move (v *= scalar);
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator/ (const vec_n &v, std::type_identity_t<T> scalar) -> vec_n
+{
+   vec_n result = v;
+   result /= scalar;
+   return result;
+}
+
+template <typename T, std::size_t n>
+constexpr auto operator/ (vec_n &&v, std::type_identity_t<T> scalar) -> vec_n
+{
+   return std::move (v /= scalar);
+}
+#endif
+
 /* Other Functions for vectors
  */
 template <typename T, std::size_t n>
-inline auto len (vec_n v) -> T
+constexpr auto len (const vec_n &v) -> T
 {
    T result = {};
    for (std::size_t i = 0; i < n; i++) {
       result += v[i] * v[i];
    }
-   return sqrt (result);
+   if constexpr (std::is_floating_point_v<T>) {
+      return constexpr_sqrt (result);
+   } else if constexpr (std::is_integral_v<T>) {
+      return T (constexpr_sqrt (double (result)));
+   } else {
+      return sqrt (result);
+   }
 }
 
 /* in many scenarios, only the relative length between 2 vectors is needed.
@@ -566,7 +990,7 @@ inline auto len (vec_n v) -> T
  * cases
  */
 template <typename T, std::size_t n>
-inline auto len2 (vec_n v) -> T
+constexpr auto len2 (const vec_n &v) -> T
 {
    T result = {};
    for (std::size_t i = 0; i < n; i++) {
@@ -576,19 +1000,19 @@ inline auto len2 (vec_n v) -> T
 }
 
 template <typename T, std::size_t n>
-inline auto dist (vec_n v1, vec_n v2) -> T
+constexpr auto dist (const vec_n &v1, const vec_n &v2) -> T
 {
    return len (v1 - v2);
 }
 
 template <typename T, std::size_t n>
-inline auto dist2 (vec_n v1, vec_n v2) -> T
+constexpr auto dist2 (const vec_n &v1, const vec_n &v2) -> T
 {
    return len2 (v1 - v2);
 }
 
 template <typename T, std::size_t n>
-inline auto dot (vec_n v1, vec_n v2) -> T
+constexpr auto dot (const vec_n &v1, const vec_n &v2) -> T
 {
    T result = {};
    for (std::size_t i = 0; i < n; i++) {
@@ -598,9 +1022,9 @@ inline auto dot (vec_n v1, vec_n v2) -> T
 }
 
 template <typename T, std::size_t n>
-inline auto norm (vec_n v) -> vec_n
+constexpr auto norm (const vec_n &v) -> vec_n
 {
-   vec_n result;
+   vec_n result = {};
    T     length = len (v);
    for (std::size_t i = 0; i < n; i++) {
       result[i] = v[i] / length;
@@ -608,10 +1032,48 @@ inline auto norm (vec_n v) -> vec_n
    return result;
 }
 
+#ifdef MRN_SIMD_SSE2
+/* SSE overloads for vec4. they are picked over the templates above
+ * since they are an exact match without template deduction.
+ * At compile-time they hand over to the templates.
+ */
+constexpr auto len (vec<float, 4> v) -> float
+{
+   if (std::is_constant_evaluated ()) {
+      return len<float, 4> (v);
+   }
+   return _mm_cvtss_f32 (_mm_sqrt_ss (simd_dot4 (v.simd, v.simd)));
+}
+
+constexpr auto len2 (vec<float, 4> v) -> float
+{
+   if (std::is_constant_evaluated ()) {
+      return len2<float, 4> (v);
+   }
+   return _mm_cvtss_f32 (simd_dot4 (v.simd, v.simd));
+}
+
+constexpr auto dot (vec<float, 4> v1, vec<float, 4> v2) -> float
+{
+   if (std::is_constant_evaluated ()) {
+      return dot<float, 4> (v1, v2);
+   }
+   return _mm_cvtss_f32 (simd_dot4 (v1.simd, v2.simd));
+}
+
+constexpr auto norm (vec<float, 4> v) -> vec<float, 4>
+{
+   if (std::is_constant_evaluated ()) {
+      return norm<float, 4> (v);
+   }
+   return vec<float, 4> (_mm_div_ps (v.simd, _mm_sqrt_ps (simd_dot4 (v.simd, v.simd))));
+}
+#endif
+
 /* cross product is only relevant for 3-dimensional vectors
  */
 template <typename T>
-inline auto cross (vec_3 v1, vec_3 v2)
+constexpr auto cross (const vec_3 &v1, const vec_3 &v2)
 {
    vec_3 result;
    result.x = v1.y * v2.z - v1.z * v2.y;
@@ -623,11 +1085,15 @@ inline auto cross (vec_3 v1, vec_3 v2)
 /* perpendicular is only defined for 2-D vector
  */
 template <typename T>
-inline auto perpendicular (vec_2 v)
+constexpr auto perpendicular (const vec_2 &v)
 {
    return vec_2 (-v.y, v.x);
 }
 
+#ifdef MRN_MATH_EXPR_TEMPLATES
+#include "expr.hpp"
+#endif
+
 #undef vec_n
 #undef vec_2
 #undef vec_3
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "bvh.hpp"
+#include "ray.hpp"
+
+/* wide bounding volume hierarchies for ray tracing.
+ * A wide_bvh has 4 or 8 children per node, with their boxes in SoA
+ * layout, so a ray is tested against all of them with one slab test in
+ * simd_float4 or simd_float8 lanes. It is made from a binary bvh by
+ * collapsing it: each node takes the children of its biggest inner
+ * children, by surface area, until it has width of them. A node that
+ * ends up with fewer has empty slots, boxes that every ray misses.
+ * The triangles are copied into leaf order, so a leaf is a contiguous
+ * run of them.
+ * With AVX wide_bvh8 is the one to use, without it simd_float8 is a
+ * loop and wide_bvh4 is faster.
+ * Single rays visit the children nearest first and skip everything
+ * behind the closest hit so far. Packets of 8 rays traverse together,
+ * which pays off when they are coherent, and test each child against
+ * all 8 rays at once
+ */
+
+template <std::size_t width>
+class wide_bvh
+{
+   static_assert (width == 4 || width == 8, "a wide bvh is 4 or 8 wide");
+
+ public:
+   typedef std::conditional_t<width == 8, simd_float8, simd_float4> lanes;
+
+   // the child of an empty slot
+   static constexpr std::uint32_t no_child = std::numeric_limits<std::uint32_t>::max ();
+
+   // the deepest tree the traversal has stack for
+   static constexpr std::size_t max_depth = 64;
+
+   /* child[i] is a node if count[i] is 0, otherwise the first of
+    * count[i] triangles. Empty slots have an inverted box
+    */
+   struct alignas (4 * width) node
+   {
+      float         min[3][width], max[3][width];
+      std::uint32_t child[width], count[width];
+   };
+
+   std::vector<node> nodes;
+   // three vertices per triangle, in leaf order
+   std::vector<vec3> triangles;
+   // the triangle each of those was, as the bvh numbers them
+   std::vector<std::uint32_t> prims;
+
+   wide_bvh () = default;
+
+   /* collapses tree, which was built over the triangles of vertices,
+    * either a soup or indexed by indices
+    */
+   wide_bvh (const bvh &tree, std::span<const vec3> vertices, std::span<const std::uint32_t> indices = {})
+   {
+      if (tree.empty ()) {
+         return;
+      }
+      triangles.reserve (3 * tree.indices.size ());
+      prims.reserve (tree.indices.size ());
+      auto vertex = [&] (std::size_t i) -> const vec3 & {
+         return vertices[indices.empty () ? i : indices[i]];
+      };
+
+      struct pending
+      {
+         std::uint32_t binary, wide;
+         std::size_t   depth;
+      };
+      std::vector<pending> stack (1, pending { 0, 0, 1 });
+      nodes.resize (1);
+      while (!stack.empty ()) {
+         const pending p = stack.back ();
+         stack.pop_back ();
+         assert (("Hierarchy too deep to traverse\n" && p.depth <= max_depth));
+
+         // open the biggest inner child until the node is full
+         std::uint32_t slots[width] = { p.binary };
+         std::size_t   used         = 1;
+         if (!tree.nodes[p.binary].leaf ()) {
+            slots[0] = tree.nodes[p.binary].first;
+            slots[1] = tree.nodes[p.binary].first + 1;
+            used     = 2;
+         }
+         while (used < width) {
+            std::size_t best      = width;
+            float       best_area = -1;
+            for (std::size_t i = 0; i < used; i++) {
+               const bvh_node &n = tree.nodes[slots[i]];
+               if (!n.leaf () && surface_area (n.bounds ()) > best_area) {
+                  best      = i;
+                  best_area = surface_area (n.bounds ());
+               }
+            }
+            if (best == width) {
+               break;
+            }
+            const std::uint32_t first = tree.nodes[slots[best]].first;
+            slots[best]               = first;
+            slots[used++]             = first + 1;
+         }
+
+         node w;
+         for (std::size_t i = 0; i < width; i++) {
+            for (std::size_t a = 0; a < 3; a++) {
+               w.min[a][i] = std::numeric_limits<float>::infinity ();
+               w.max[a][i] = -std::numeric_limits<float>::infinity ();
+            }
+            w.child[i] = no_child;
+            w.count[i] = 0;
+         }
+         for (std::size_t i = 0; i < used; i++) {
+            const bvh_node &n = tree.nodes[slots[i]];
+            for (std::size_t a = 0; a < 3; a++) {
+               w.min[a][i] = n.min[a];
+               w.max[a][i] = n.max[a];
+            }
+            if (n.leaf ()) {
+               w.child[i] = std::uint32_t (prims.size ());
+               w.count[i] = n.count;
+               for (std::size_t k = n.first; k < n.first + n.count; k++) {
+                  const std::uint32_t prim = tree.indices[k];
+                  prims.push_back (prim);
+                  triangles.insert (triangles.end (), { vertex (3 * prim), vertex (3 * prim + 1), vertex (3 * prim + 2) });
+               }
+            } else {
+               w.child[i] = std::uint32_t (nodes.size ());
+               nodes.emplace_back ();
+               stack.push_back (pending { slots[i], w.child[i], p.depth + 1 });
+            }
+         }
+         nodes[p.wide] = w;
+      }
+   }
+
+   // a bvh and its wide version over a triangle soup
+   explicit wide_bvh (std::span<const vec3> vertices, std::size_t max_leaf = 4)
+   : wide_bvh (bvh (triangle_bounds (vertices), max_leaf), vertices)
+   {
+   }
+
+   auto empty () const -> bool
+   {
+      return nodes.empty ();
+   }
+
+   /* Single rays
+    * -----------
+    * the closest hit of r, with the triangle as the bvh numbers them
+    */
+   auto intersect (const ray &r) const -> ray_hit
+   {
+      ray_hit hit;
+      float   t_max = r.t_max;
+      traverse (r, t_max, [&] (std::uint32_t first, std::uint32_t count) {
+         for (std::uint32_t i = first; i < first + count; i++) {
+            float t, u, v;
+            if (::intersect (ray (r.origin, r.direction, r.t_min, t_max), triangles[3 * i], triangles[3 * i + 1],
+                             triangles[3 * i + 2], t, u, v)) {
+               t_max    = t;
+               hit.t    = t;
+               hit.u    = u;
+               hit.v    = v;
+               hit.prim = prims[i];
+            }
+         }
+         return false;
+      });
+      return hit;
+   }
+
+   // whether r hits anything at all, for shadow rays
+   auto occluded (const ray &r) const -> bool
+   {
+      bool  hit   = false;
+      float t_max = r.t_max;
+      traverse (r, t_max, [&] (std::uint32_t first, std::uint32_t count) {
+         for (std::uint32_t i = first; i < first + count && !hit; i++) {
+            float t, u, v;
+            hit = ::intersect (r, triangles[3 * i], triangles[3 * i + 1], triangles[3 * i + 2], t, u, v);
+         }
+         return hit;
+      });
+      return hit;
+   }
+
+   /* Packets
+    * -------
+    * the closest hits of all 8 rays
+    */
+   void intersect (const ray8 &r, ray_hit8 &hit) const
+   {
+      simd_float8 t_max = r.t_max;
+      traverse (r, t_max, [&] (std::uint32_t first, std::uint32_t count) {
+         for (std::uint32_t i = first; i < first + count; i++) {
+            simd_float8 t, u, v;
+            const simd_mask8 m =
+              ::intersect (r, triangles[3 * i], triangles[3 * i + 1], triangles[3 * i + 2], t_max, t, u, v);
+            if (any (m)) {
+               t_max = select (m, t, t_max);
+               hit.t = select (m, t, hit.t);
+               hit.u = select (m, u, hit.u);
+               hit.v = select (m, v, hit.v);
+               for (int bits = m.bits (); bits; bits &= bits - 1) {
+                  hit.prim[std::countr_zero (unsigned (bits))] = prims[i];
+               }
+            }
+         }
+      });
+   }
+
+   // the rays that hit anything. A ray is done with its first hit
+   auto occluded (const ray8 &r) const -> simd_mask8
+   {
+      simd_mask8  hit   = false;
+      simd_float8 t_max = r.t_max;
+      traverse (r, t_max, [&] (std::uint32_t first, std::uint32_t count) {
+         for (std::uint32_t i = first; i < first + count; i++) {
+            simd_float8 t, u, v;
+            hit = hit | ::intersect (r, triangles[3 * i], triangles[3 * i + 1], triangles[3 * i + 2], t_max, t, u, v);
+         }
+         // rays that are done get a range that nothing is in
+         t_max = select (hit, simd_float8 (-std::numeric_limits<float>::infinity ()), t_max);
+      });
+      return hit;
+   }
+
+ private:
+   /* the slab test is made conservative by stretching the far distance
+    * by the rounding error it can have, so a ray that hits a triangle
+    * never misses its box (Ize, "Robust BVH Ray Traversal")
+    */
+   static constexpr float robust = 1 + 2 * 3 * std::numeric_limits<float>::epsilon ();
+
+   /* 1 / d, but never infinite: a box a ray is parallel to is then at a
+    * huge distance, instead of a NaN from 0 * inf
+    */
+   static auto reciprocal (float d) -> float
+   {
+      const float inv = 1 / d;
+      return std::isinf (inv) ? std::copysign (std::numeric_limits<float>::max (), d) : inv;
+   }
+
+   template <typename Leaf>
+   void traverse (const ray &r, const float &t_max, Leaf &&leaf) const
+   {
+      if (nodes.empty ()) {
+         return;
+      }
+      /* the planes of the near side of the boxes are the min of the axes
+       * the ray goes up along, the max of the others. Empty slots have
+       * their near side at infinity
+       */
+      lanes origin[3], inv[3];
+      bool  down[3];
+      for (std::size_t a = 0; a < 3; a++) {
+         origin[a] = r.origin[a];
+         inv[a]    = reciprocal (r.direction[a]);
+         down[a]   = std::signbit (r.direction[a]);
+      }
+
+      struct entry
+      {
+         std::uint32_t child, count;
+         float         t;
+      };
+      entry       stack[max_depth * (width - 1) + 1];
+      std::size_t top = 0;
+      stack[top++]    = entry { 0, 0, r.t_min };
+      while (top > 0) {
+         const entry e = stack[--top];
+         if (e.t > t_max) {
+            continue;
+         }
+         if (e.count > 0) {
+            if (leaf (e.child, e.count)) {
+               return;
+            }
+            continue;
+         }
+
+         const node &n      = nodes[e.child];
+         lanes       t_near = r.t_min, t_far = t_max;
+         for (std::size_t a = 0; a < 3; a++) {
+            const lanes lo = lanes::load (down[a] ? n.max[a] : n.min[a]);
+            const lanes hi = lanes::load (down[a] ? n.min[a] : n.max[a]);
+            t_near         = max (t_near, (lo - origin[a]) * inv[a]);
+            t_far          = min (t_far, (hi - origin[a]) * inv[a]);
+         }
+         int   bits = (t_near <= t_far * robust).bits ();
+         float t[width];
+         t_near.store (t);
+
+         // push the hits farthest first, so the nearest is popped next
+         const std::size_t bottom = top;
+         for (; bits; bits &= bits - 1) {
+            const std::size_t i = std::countr_zero (unsigned (bits));
+            std::size_t       k = top++;
+            for (; k > bottom && stack[k - 1].t < t[i]; k--) {
+               stack[k] = stack[k - 1];
+            }
+            stack[k] = entry { n.child[i], n.count[i], t[i] };
+         }
+      }
+   }
+
+   /* the packet version: a child is visited if any of the rays hit its
+    * box, nearest first by the nearest of those rays. The stack keeps
+    * the distances of all of them, so a child all the rays have found a
+    * closer hit than since it was pushed is skipped
+    */
+   template <typename Leaf>
+   void traverse (const ray8 &r, const simd_float8 &t_max, Leaf &&leaf) const
+   {
+      if (nodes.empty ()) {
+         return;
+      }
+      const simd_float8 inf = std::numeric_limits<float>::infinity ();
+      vec3x8            inv;
+      for (std::size_t a = 0; a < 3; a++) {
+         for (std::size_t i = 0; i < 8; i++) {
+            inv[a][i] = reciprocal (r.direction[a][i]);
+         }
+      }
+
+      struct entry
+      {
+         simd_float8   t;
+         std::uint32_t child, count;
+         // the smallest of t, by which the children are ordered
+         float nearest;
+      };
+      entry       stack[max_depth * (width - 1) + 1];
+      std::size_t top = 0;
+      stack[top++]    = entry { r.t_min, 0, 0, 0 };
+      while (top > 0) {
+         const entry e = stack[--top];
+         if (none ((e.t <= t_max) & (e.t != inf))) {
+            continue;
+         }
+         if (e.count > 0) {
+            leaf (e.child, e.count);
+            continue;
+         }
+
+         const node       &n      = nodes[e.child];
+         const std::size_t bottom = top;
+         for (std::size_t i = 0; i < width && n.child[i] != no_child; i++) {
+            simd_float8 t_near = r.t_min, t_far = t_max;
+            for (std::size_t a = 0; a < 3; a++) {
+               const simd_float8 t0 = (simd_float8 (n.min[a][i]) - r.origin[a]) * inv[a];
+               const simd_float8 t1 = (simd_float8 (n.max[a][i]) - r.origin[a]) * inv[a];
+               t_near               = max (t_near, min (t0, t1));
+               t_far                = min (t_far, max (t0, t1));
+            }
+            const simd_mask8 m = t_near <= t_far * robust;
+            if (none (m)) {
+               continue;
+            }
+            // the rays that miss are at infinity
+            const simd_float8 t       = select (m, t_near, inf);
+            float             nearest = t[0];
+            for (std::size_t l = 1; l < 8; l++) {
+               nearest = std::min (nearest, t[l]);
+            }
+            std::size_t k = top++;
+            for (; k > bottom && stack[k - 1].nearest < nearest; k--) {
+               stack[k] = stack[k - 1];
+            }
+            stack[k] = entry { t, n.child[i], n.count[i], nearest };
+         }
+      }
+   }
+};
+
+typedef wide_bvh<4> wide_bvh4;
+typedef wide_bvh<8> wide_bvh8;
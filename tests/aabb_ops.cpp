@@ -0,0 +1,133 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/aabb.hpp"
+#include "checks.hpp"
+
+static void check_box (const aabbf &a, const aabbf &b)
+{
+   check_vec (a.min, b.min);
+   check_vec (a.max, b.max);
+}
+
+static auto make_box (std::size_t i) -> aabbf
+{
+   const vec3 c = vec3 (float (i % 17) - 8.0f, float (i % 13) * 0.5f - 3.0f, float (i % 7) - 3.0f);
+   return aabbf::from_center (c, vec3 (0.25f + (i % 5) * 0.5f, 0.5f, 0.1f + (i % 3)));
+}
+
+/* the bounds of the 8 transformed corners
+ */
+static auto transform_corners (const mat4 &m, const aabbf &b) -> aabbf
+{
+   aabbf result;
+   for (std::size_t k = 0; k < 8; k++) {
+      const vec4 p = m * vec4 (k & 1 ? b.max.x : b.min.x, k & 2 ? b.max.y : b.min.y, k & 4 ? b.max.z : b.min.z, 1);
+      result       = expand (result, vec3 (p.x, p.y, p.z));
+   }
+   return result;
+}
+
+TEST_CASE ("Bounding box functions")
+{
+   const aabbf e;
+   CHECK (empty (e));
+   CHECK (surface_area (e) == 0);
+
+   const aabbf a = aabbf (vec3 (0, 0, 0), vec3 (1, 2, 3));
+   CHECK (!empty (a));
+   CHECK (surface_area (a) == 22);
+   check_vec (center (a), vec3 (0.5f, 1, 1.5f));
+   check_vec (extent (a), vec3 (0.5f, 1, 1.5f));
+   check_box (merge (e, a), a);
+   check_box (expand (e, vec3 (1, 2, 3)), aabbf (vec3 (1, 2, 3), vec3 (1, 2, 3)));
+   check_box (expand (a, vec3 (-1, 5, 1)), aabbf (vec3 (-1, 0, 0), vec3 (1, 5, 3)));
+   check_box (expand (a, 1.0f), aabbf (vec3 (-1, -1, -1), vec3 (2, 3, 4)));
+   check_box (merge (a, aabbf (vec3 (2, -1, 1), vec3 (3, 0, 2))), aabbf (vec3 (0, -1, 0), vec3 (3, 2, 3)));
+
+   CHECK (contains (a, vec3 (1, 2, 3)));
+   CHECK (!contains (a, vec3 (1, 2.5f, 3)));
+   CHECK (overlap (a, aabbf (vec3 (1, 2, 3), vec3 (4, 4, 4))));
+   CHECK (!overlap (a, aabbf (vec3 (1.5f, 0, 0), vec3 (4, 4, 4))));
+   CHECK (!overlap (a, e));
+
+   SUBCASE ("Transform")
+   {
+      for (std::size_t i = 0; i < 8; i++) {
+         const mat4 m = mat4::translate (1.0f + i, -2.0f, 0.5f * i) * mat4::rotate (norm (vec3 (1.0f, i * 0.5f, -1.0f)), i * 0.7f)
+                        * mat4::scale (1.0f + i * 0.1f, 2.0f, 0.5f);
+         check_box (transform (m, make_box (i)), transform_corners (m, make_box (i)));
+         check_box (transform (affine3f (m), make_box (i)), transform_corners (m, make_box (i)));
+      }
+   }
+
+   SUBCASE ("Constant expressions")
+   {
+      constexpr aabbd b = transform (mat4d::translate (1, 2, 3), merge (aabbd (), aabbd (vec3d (0), vec3d (1))));
+      static_assert (b.min.x == 1 && b.max.z == 4);
+   }
+}
+
+TEST_CASE ("Bounding box streams")
+{
+   // not a multiple of 8
+   const std::size_t  count = 203;
+   std::vector<aabbf> boxes;
+   for (std::size_t i = 0; i < count; i++) {
+      boxes.push_back (make_box (i * 3));
+   }
+   aabb_soa soa (boxes);
+   CHECK (soa.size () == count);
+   check_box (soa.get (17), boxes[17]);
+
+   SUBCASE ("Overlaps")
+   {
+      for (std::size_t q = 0; q < 10; q++) {
+         const aabbf                box = make_box (q * 11 + 5);
+         std::vector<std::uint32_t> hits (1, 12345), expected (1, 12345);
+         for (std::size_t i = 0; i < count; i++) {
+            if (overlap (box, boxes[i])) {
+               expected.push_back (std::uint32_t (i));
+            }
+         }
+         CHECK (overlaps (box, soa, hits) == expected.size () - 1);
+         CHECK (hits == expected);
+         CHECK (count_overlaps (box, soa) == expected.size () - 1);
+      }
+      // the empty padding overlaps nothing
+      CHECK (count_overlaps (aabbf (vec3 (-1e30f), vec3 (1e30f)), soa) == count);
+   }
+
+   SUBCASE ("Bounds and transform")
+   {
+      aabbf all;
+      for (const aabbf &b : boxes) {
+         all = merge (all, b);
+      }
+      check_box (bounds (soa), all);
+
+      const mat4 m = mat4::translate (1, 2, 3) * mat4::rotate (norm (vec3 (1, 1, 0)), 0.5f);
+      aabb_soa   out;
+      transform (m, soa, out);
+      aabbf      out_all;
+      for (std::size_t i = 0; i < count; i++) {
+         check_box (out.get (i), transform (m, boxes[i]));
+         out_all = merge (out_all, out.get (i));
+      }
+      // the padding stays empty
+      check_box (bounds (out), out_all);
+      soa.set (5, aabbf ());
+      transform (m, soa, soa);
+      CHECK (empty (soa.get (5)));
+      CHECK (count_overlaps (aabbf (vec3 (-1e30f), vec3 (1e30f)), soa) == count - 1);
+   }
+
+   SUBCASE ("Resize")
+   {
+      soa.resize (count + 5);
+      CHECK (empty (soa.get (count + 2)));
+      CHECK (count_overlaps (aabbf (vec3 (-1e30f), vec3 (1e30f)), soa) == count);
+   }
+}
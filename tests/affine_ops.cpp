@@ -0,0 +1,102 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/affine.hpp"
+#include "checks.hpp"
+
+TEST_CASE ("Affine construction")
+{
+   check_mat (to_mat4 (affine3f ()), mat4 ());
+   check_mat (to_mat4 (affine3f::translate (1, 2, 3)), mat4::translate (1, 2, 3));
+   check_mat (to_mat4 (affine3f::scale (vec3 (1, 2, 3))), mat4::scale (1, 2, 3));
+   check_mat (to_mat4 (affine3f::rotate (norm (vec3 (1, 2, 3)), 0.7f)), mat4::rotate (norm (vec3 (1, 2, 3)), 0.7f));
+
+   affine3f a = affine3f (make_mat (3));
+   check_mat (to_mat4 (a), make_mat (3));
+   check_vec (a.translation (), vec3 (4.0f, -6.0f, 0.5f));
+   check_mat (to_mat4 (affine3f (a.linear (), a.translation ())), make_mat (3));
+   CHECK (sizeof (affine3f) == 48);
+}
+
+TEST_CASE ("Affine operations")
+{
+   for (std::size_t i = 0; i < 8; i++) {
+      affine3f a = affine3f (make_mat (i));
+      affine3f b = affine3f (make_mat (i + 5));
+
+      check_mat (to_mat4 (a * b), make_mat (i) * make_mat (i + 5));
+      affine3f c = a;
+      c *= b;
+      check_mat (to_mat4 (c), to_mat4 (a * b));
+
+      check_mat (to_mat4 (inverse (a)), inverse_affine (make_mat (i)));
+      check_mat (to_mat4 (a * inverse (a)), mat4 ());
+      CHECK (determinant (a) == doctest::Approx (determinant (make_mat (i))).epsilon (1e-5));
+
+      vec3 p  = vec3 (0.5f * i, 2.0f, -1.0f);
+      vec4 mp = make_mat (i) * vec4 (p.x, p.y, p.z, 1);
+      vec4 mv = make_mat (i) * vec4 (p.x, p.y, p.z, 0);
+      check_vec (transform_point (a, p), vec3 (mp.x, mp.y, mp.z));
+      check_vec (transform_vector (a, p), vec3 (mv.x, mv.y, mv.z));
+   }
+
+   SUBCASE ("Constant expressions")
+   {
+      constexpr affine3d a = affine3d::translate (1, 2, 3) * affine3d::scale (2, 2, 2);
+      constexpr vec3d    p = transform_point (inverse (a), vec3d (3, 4, 5));
+      static_assert (p.x == 1 && p.y == 1 && p.z == 1);
+   }
+}
+
+TEST_CASE ("Batched affine transformations")
+{
+   // not a multiple of 8
+   const std::size_t     count = 19;
+   std::vector<affine3f> a, b, r (count);
+   for (std::size_t i = 0; i < count; i++) {
+      a.push_back (affine3f (make_mat (i)));
+      b.push_back (affine3f (make_mat (i * 3 + 1)));
+   }
+
+   SUBCASE ("Compose")
+   {
+      batch_compose (a.data (), b.data (), r.data (), count);
+      for (std::size_t i = 0; i < count; i++) {
+         check_mat (to_mat4 (r[i]), to_mat4 (a[i] * b[i]));
+      }
+      batch_compose (a[4], b.data (), r.data (), count);
+      for (std::size_t i = 0; i < count; i++) {
+         check_mat (to_mat4 (r[i]), to_mat4 (a[4] * b[i]));
+      }
+   }
+
+   SUBCASE ("Inverse")
+   {
+      batch_inverse (a.data (), r.data (), count);
+      for (std::size_t i = 0; i < count; i++) {
+         check_mat (to_mat4 (r[i]), to_mat4 (inverse (a[i])));
+      }
+      // in place
+      batch_inverse (r.data (), r.data (), count);
+      for (std::size_t i = 0; i < count; i++) {
+         check_mat (to_mat4 (r[i]), to_mat4 (a[i]));
+      }
+   }
+
+   SUBCASE ("Streams")
+   {
+      std::vector<vec3> pts;
+      for (std::size_t i = 0; i < count; i++) {
+         pts.push_back (vec3 (i * 0.5f, 1.0f - i, 2.0f));
+      }
+      vec3_soa in (pts), op, ov;
+      transform_points (a[2], in, op);
+      transform_vectors (a[2], in, ov);
+      for (std::size_t i = 0; i < count; i++) {
+         check_vec (op.get (i), transform_point (a[2], pts[i]));
+         check_vec (ov.get (i), transform_vector (a[2], pts[i]));
+      }
+   }
+}
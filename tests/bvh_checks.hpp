@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "doctest.h"
+
+#include "../math/bvh.hpp"
+
+/* the structure of a bvh, checked against the boxes of its primitives
+ * by the tests of every builder
+ */
+
+inline auto same (const aabbf &a, const aabbf &b) -> bool
+{
+   return contains (a, b.min) && contains (a, b.max) && contains (b, a.min) && contains (b, a.max);
+}
+
+inline auto inside (const aabbf &outer, const aabbf &inner) -> bool
+{
+   return contains (outer, inner.min) && contains (outer, inner.max);
+}
+
+/* every primitive in exactly one leaf of at most max_leaf, every box
+ * around everything below it, or its exact union with exact
+ */
+inline void check_tree (const bvh &tree, const std::vector<aabbf> &boxes, std::size_t max_leaf, bool exact = false)
+{
+   REQUIRE (!tree.empty ());
+   REQUIRE (tree.indices.size () == boxes.size ());
+   CHECK (tree.nodes.size () < 2 * boxes.size ());
+
+   std::vector<int>         seen (boxes.size (), 0);
+   std::vector<std::size_t> stack (1, 0);
+   std::size_t              visited = 0, wrong = 0;
+   while (!stack.empty ()) {
+      const bvh_node &node = tree.nodes[stack.back ()];
+      stack.pop_back ();
+      visited++;
+      aabbf box;
+      if (node.leaf ()) {
+         CHECK (node.count <= max_leaf);
+         for (std::size_t i = node.first; i < node.first + node.count; i++) {
+            seen[tree.indices[i]]++;
+            box = merge (box, boxes[tree.indices[i]]);
+         }
+      } else {
+         REQUIRE (node.first + 1 < tree.nodes.size ());
+         box = merge (tree.nodes[node.first].bounds (), tree.nodes[node.first + 1].bounds ());
+         stack.push_back (node.first);
+         stack.push_back (node.first + 1);
+      }
+      wrong += exact ? !same (node.bounds (), box) : !inside (node.bounds (), box);
+   }
+   CHECK (wrong == 0);
+   CHECK (visited == tree.nodes.size ());
+   CHECK (std::count (seen.begin (), seen.end (), 1) == std::ptrdiff_t (boxes.size ()));
+}
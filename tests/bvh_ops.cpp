@@ -0,0 +1,90 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/bvh.hpp"
+#include "bvh_checks.hpp"
+#include "meshes.hpp"
+
+TEST_CASE ("Bounding volume hierarchy")
+{
+   const std::vector<vec3>  vertices = make_sphere (64, 96);
+   const std::vector<aabbf> boxes    = triangle_bounds (vertices);
+   REQUIRE (boxes.size () == 64 * 96 * 2);
+
+   const bvh tree (boxes);
+   check_tree (tree, boxes, 4);
+
+   aabbf all;
+   for (const aabbf &b : boxes) {
+      all = merge (all, b);
+   }
+   CHECK (same (tree.bounds (), all));
+
+   /* a well-built tree over a closed surface costs a small multiple of
+    * the log of the primitives, a single leaf would cost all of them
+    */
+   const float cost = sah_cost (tree);
+   CHECK (cost > 1);
+   CHECK (cost < 100);
+
+   SUBCASE ("Leaf size")
+   {
+      const bvh small (boxes, 1);
+      check_tree (small, boxes, 1);
+      CHECK (small.nodes.size () == 2 * boxes.size () - 1);
+      check_tree (bvh (boxes, 16), boxes, 16);
+   }
+
+   SUBCASE ("Threads")
+   {
+      // big enough for the top to be split and binned in parallel
+      const std::vector<aabbf> many = triangle_bounds (make_sphere (300, 400));
+      parallel_max_threads ()       = 4;
+      const bvh parallel (many);
+      parallel_max_threads () = 1;
+      const bvh serial (many);
+      parallel_max_threads () = 0;
+      check_tree (parallel, many, 4);
+      check_tree (serial, many, 4);
+      CHECK (sah_cost (parallel) == doctest::Approx (sah_cost (serial)).epsilon (0.01));
+   }
+
+   SUBCASE ("Indexed triangles")
+   {
+      std::vector<std::uint32_t> indices (vertices.size ());
+      for (std::size_t i = 0; i < indices.size (); i++) {
+         indices[i] = std::uint32_t (vertices.size () - 1 - i);
+      }
+      const std::vector<aabbf> reversed = triangle_bounds (vertices, indices);
+      REQUIRE (reversed.size () == boxes.size ());
+      CHECK (same (reversed[0], boxes.back ()));
+   }
+}
+
+TEST_CASE ("Degenerate hierarchies")
+{
+   CHECK (bvh (std::vector<aabbf> ()).empty ());
+   CHECK (sah_cost (bvh ()) == 0);
+
+   const std::vector<aabbf> one (1, aabbf (vec3 (0, 0, 0), vec3 (1, 1, 1)));
+   const bvh                single (one);
+   REQUIRE (single.nodes.size () == 1);
+   CHECK (single.nodes[0].count == 1);
+   CHECK (sah_cost (single) == 1);
+
+   // all centroids in one point: split in the middle down to the leaf size
+   std::vector<aabbf> same;
+   for (std::size_t i = 0; i < 100; i++) {
+      same.push_back (aabbf::from_center (vec3 (1, 2, 3), vec3 (0.5f + i * 0.01f)));
+   }
+   check_tree (bvh (same, 4), same, 4);
+
+   // flat boxes, all in the plane z = 0
+   std::vector<aabbf> flat;
+   for (std::size_t i = 0; i < 50; i++) {
+      flat.push_back (aabbf (vec3 (float (i), 0, 0), vec3 (i + 1.0f, 1, 0)));
+   }
+   check_tree (bvh (flat, 2), flat, 2);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "doctest.h"
+
+#include "../math/matrix.hpp"
+
+/* approximate comparisons shared by the tests of the transform types,
+ * and the matrices they are compared against
+ */
+
+template <typename T, std::size_t n>
+void check_vec (const vec<T, n> &a, const vec<T, n> &b, double eps = 1e-5)
+{
+   for (std::size_t i = 0; i < n; i++) {
+      CHECK (a[i] == doctest::Approx (b[i]).epsilon (eps));
+   }
+}
+
+template <typename T, std::size_t n>
+void check_mat (const mat<T, n, n> &a, const mat<T, n, n> &b, double eps = 1e-5)
+{
+   for (std::size_t j = 0; j < n; j++) {
+      check_vec (a[j], b[j], eps);
+   }
+}
+
+/* a rotation and a translation for every i
+ */
+inline auto make_rigid (std::size_t i) -> mat4
+{
+   return mat4::translate (1.0f + i, -2.0f * i, 0.5f) * mat4::rotate (norm (vec3 (1.0f, i * 0.5f, -1.0f)), i * 0.7f - 2.0f);
+}
+
+/* make_rigid (i) after a non-uniform scale
+ */
+inline auto make_mat (std::size_t i) -> mat4
+{
+   return make_rigid (i) * mat4::scale (1.0f + i * 0.1f, 2.0f, 0.5f + i * 0.05f);
+}
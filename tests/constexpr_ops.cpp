@@ -0,0 +1,79 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "../math/constants.hpp"
+#include "../math/matrix.hpp"
+
+/* everything in here is evaluated by the compiler, the test cases only
+ * check that the baked values match the runtime-versions
+ */
+constexpr vec3 up      = vec3::UP;
+constexpr vec3 side    = cross (vec3::FORWARD, vec3::UP);
+constexpr vec4 v4      = vec4 (1, 2, 3, 4) * 2.0f - vec4 (1.0f);
+constexpr mat4 bind    = mat4::translate (1, 2, 3) * mat4::rotate (vec3::UP, pi_2);
+constexpr vec4 baked   = bind * vec4 (1, 0, 0, 1);
+constexpr mat4 scaling = mat4::scale (vec3 (2, 3, 4));
+
+static_assert (up.y == 1);
+static_assert (side.x == 1 && side.y == 0 && side.z == 0);
+static_assert (v4.x == 1 && v4.w == 7);
+static_assert (len (vec3 (3, 4, 0)) == 5);
+static_assert (len (vec4 (2, 0, 0, 0)) == 2);
+static_assert (dot (vec2 (1, 2), vec2 (3, 4)) == 11);
+static_assert (dist2 (vec3i (1, 1, 1), vec3i (2, 3, 4)) == 14);
+static_assert (scaling[1][1] == 3 && scaling[3][3] == 1);
+static_assert (-vec<int, 5> { 1, 2, 3, 4, 5 }[4] == -5);
+
+TEST_CASE ("Compile-time scalar functions")
+{
+   for (float x : { -20.0f, -3.0f, -1.0f, 0.0f, 0.5f, 1.0f, 2.5f, 7.0f, 100.0f }) {
+      CHECK (constexpr_sin (x) == doctest::Approx (sin (x)));
+      CHECK (constexpr_cos (x) == doctest::Approx (cos (x)));
+   }
+
+   constexpr double s1 = constexpr_sin (1.0);
+   constexpr double c1 = constexpr_cos (1.0);
+   constexpr double r2 = constexpr_sqrt (2.0);
+   constexpr float  r9 = constexpr_sqrt (9.0f);
+   CHECK (s1 == doctest::Approx (sin (1.0)).epsilon (1e-15));
+   CHECK (c1 == doctest::Approx (cos (1.0)).epsilon (1e-15));
+   CHECK (r2 == sqrt (2.0));
+   CHECK (r9 == 3.0f);
+}
+
+TEST_CASE ("Baked matrices")
+{
+   mat4 m = mat4::translate (1, 2, 3) * mat4::rotate (vec3::UP, pi_2);
+   for (std::size_t i = 0; i < 4; i++) {
+      for (std::size_t j = 0; j < 4; j++) {
+         CHECK (bind[i][j] == doctest::Approx (m[i][j]));
+      }
+   }
+
+   vec4 v = m * vec4 (1, 0, 0, 1);
+   CHECK (baked.x == doctest::Approx (v.x));
+   CHECK (baked.y == doctest::Approx (v.y));
+   CHECK (baked.z == doctest::Approx (v.z));
+   CHECK (baked.w == doctest::Approx (v.w));
+}
+
+TEST_CASE ("Lookup table")
+{
+   // unit circle in 16 steps, filled in by the compiler
+   constexpr auto circle = [] {
+      struct
+      {
+         vec2 v[16];
+      } table = {};
+      for (std::size_t i = 0; i < 16; i++) {
+         const float a = i * (2 * pi / 16);
+         table.v[i]    = vec2 (constexpr_cos (a), constexpr_sin (a));
+      }
+      return table;
+   }();
+
+   for (std::size_t i = 0; i < 16; i++) {
+      CHECK (len (circle.v[i]) == doctest::Approx (1.0f));
+      CHECK (circle.v[i].x == doctest::Approx (cos (i * (2 * pi / 16))));
+   }
+}
@@ -0,0 +1,130 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <cmath>
+#include <vector>
+
+#include "../math/deforming_bvh.hpp"
+#include "../math/lbvh.hpp"
+#include "bvh_checks.hpp"
+#include "meshes.hpp"
+
+// twisted around y, more the higher up
+static auto twist (const std::vector<vec3> &vertices, float angle) -> std::vector<vec3>
+{
+   std::vector<vec3> result;
+   for (const vec3 &v : vertices) {
+      const float a = angle * v.y, c = std::cos (a), s = std::sin (a);
+      result.push_back (vec3 (c * v.x - s * v.z, v.y, s * v.x + c * v.z));
+   }
+   return result;
+}
+
+/* the tree of d exact after every refit, and its cost kept up to date
+ */
+static void check_tree (const deforming_bvh &d, const std::vector<aabbf> &boxes)
+{
+   check_tree (d.tree (), boxes, 4, true);
+   CHECK (d.cost () == doctest::Approx (sah_cost (d.tree ())).epsilon (1e-4));
+}
+
+TEST_CASE ("Refitting")
+{
+   const std::vector<vec3> vertices = make_sphere (64, 96);
+   deforming_bvh           d (triangle_bounds (vertices));
+   const float             built = d.cost ();
+   CHECK (built == doctest::Approx (sah_cost (d.tree ())));
+   CHECK (d.subtrees () > 8);
+
+   // a little twist keeps the tree good enough
+   const std::vector<vec3> twisted = twist (vertices, 0.1f);
+   d.refit (twisted);
+   check_tree (d, triangle_bounds (twisted));
+   CHECK (d.update (twisted) == 0);
+
+   // back where it was built
+   d.refit (vertices);
+   check_tree (d, triangle_bounds (vertices));
+   CHECK (d.cost () == doctest::Approx (built));
+
+   SUBCASE ("Partial rebuilds")
+   {
+      // the triangles of the top cap scattered within the cap
+      std::vector<vec3> scattered = vertices;
+      lcg               rng (5);
+      for (std::size_t i = 0; i < scattered.size (); i += 3) {
+         if (vertices[i].y > 0.9f) {
+            const std::size_t j = 3 * (rng.bits () % (vertices.size () / 3));
+            if (vertices[j].y > 0.9f) {
+               for (std::size_t k = 0; k < 3; k++) {
+                  std::swap (scattered[i + k], scattered[j + k]);
+               }
+            }
+         }
+      }
+      d.refit (scattered);
+      const float degraded = d.cost ();
+      const std::size_t rebuilt = d.update (scattered);
+      CHECK (rebuilt > 0);
+      CHECK (rebuilt < d.subtrees ());
+      check_tree (d, triangle_bounds (scattered));
+      CHECK (d.cost () < degraded);
+   }
+
+   SUBCASE ("Full rebuild")
+   {
+      // all triangles somewhere else
+      std::vector<vec3> shuffled (vertices.size ());
+      const std::size_t n = vertices.size () / 3;
+      for (std::size_t i = 0; i < n; i++) {
+         for (std::size_t k = 0; k < 3; k++) {
+            shuffled[3 * i + k] = vertices[3 * (i * 7919 % n) + k];
+         }
+      }
+      CHECK (d.update (shuffled) == d.subtrees ());
+      check_tree (d, triangle_bounds (shuffled));
+      CHECK (d.cost () == doctest::Approx (sah_cost (bvh (triangle_bounds (shuffled)))));
+   }
+
+   SUBCASE ("Indexed triangles and boxes")
+   {
+      std::vector<std::uint32_t> indices (vertices.size ());
+      for (std::size_t i = 0; i < indices.size (); i++) {
+         indices[i] = std::uint32_t (i);
+      }
+      d.refit (twisted, indices);
+      check_tree (d, triangle_bounds (twisted));
+      const std::vector<aabbf> boxes = triangle_bounds (vertices);
+      CHECK (d.update (boxes) == 0);
+      check_tree (d, boxes);
+   }
+}
+
+TEST_CASE ("Refitting other trees")
+{
+   // a linear bvh, one primitive per leaf, with rebuilds by the SAH builder
+   const std::vector<vec3> vertices = make_sphere (48, 64);
+   deforming_bvh           d (linear_bvh (triangle_bounds (vertices)));
+   const std::vector<vec3> twisted = twist (vertices, 3.0f);
+   CHECK (d.update (twisted) > 0);
+   check_tree (d, triangle_bounds (twisted));
+
+   // the same with more threads
+   parallel_max_threads () = 4;
+   deforming_bvh parallel (linear_bvh (triangle_bounds (vertices)));
+   parallel.update (twisted);
+   parallel_max_threads () = 0;
+   check_tree (parallel, triangle_bounds (twisted));
+   CHECK (parallel.cost () == doctest::Approx (d.cost ()));
+
+   // small trees are a single subtree
+   const std::vector<vec3> small = make_sphere (4, 6);
+   deforming_bvh           one (triangle_bounds (small));
+   CHECK (one.subtrees () == 1);
+   one.refit (twist (small, 1.0f));
+   check_tree (one, triangle_bounds (twist (small, 1.0f)));
+
+   deforming_bvh nothing;
+   CHECK (nothing.cost () == 0);
+   CHECK (nothing.update (std::vector<aabbf> ()) == 0);
+}
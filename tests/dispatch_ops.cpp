@@ -0,0 +1,111 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/constants.hpp"
+#include "../math/dispatch.hpp"
+
+/* odd count, so every tier also runs its scalar tail
+ */
+static const std::size_t count = 53;
+
+static auto make_vec3 (std::size_t i) -> vec3
+{
+   return vec3 (1.0f + i * 0.5f, -2.0f + i * 0.25f, 3.0f - i * 0.125f);
+}
+
+TEST_CASE ("Dispatch: every supported tier matches the scalar kernels")
+{
+   const simd_tier tiers[] = { simd_tier::scalar, simd_tier::sse2, simd_tier::avx2, simd_tier::avx512 };
+
+   std::vector<vec3> a (count), b (count);
+   std::vector<vec4> v (count);
+   for (std::size_t i = 0; i < count; i++) {
+      a[i] = make_vec3 (i);
+      b[i] = make_vec3 (count - i);
+      v[i] = vec4 (a[i].x, a[i].y, a[i].z, 1.0f);
+   }
+   mat4 m = mat4::translate (1.0f, 2.0f, 3.0f) * mat4::rotate (vec3 (0, 0, 1), pi_4);
+
+   std::vector<vec4>  ref_transform (count);
+   std::vector<float> ref_dot (count);
+   std::vector<vec3>  ref_norm (count), ref_cross (count);
+   scalar_transform (m, v.data (), ref_transform.data (), count);
+   scalar_dot (a.data (), b.data (), ref_dot.data (), count);
+   scalar_norm (a.data (), ref_norm.data (), count);
+   scalar_cross (a.data (), b.data (), ref_cross.data (), count);
+
+   for (simd_tier tier : tiers) {
+      if (!force_simd_tier (tier)) {
+         continue;
+      }
+      CAPTURE (simd_tier_name (tier));
+      CHECK (active_simd_tier () == tier);
+
+      std::vector<vec4>  out_transform (count);
+      std::vector<float> out_dot (count);
+      std::vector<vec3>  out_norm (count), out_cross (count);
+      batch_transform (m, v.data (), out_transform.data (), count);
+      batch_dot (a.data (), b.data (), out_dot.data (), count);
+      batch_norm (a.data (), out_norm.data (), count);
+      batch_cross (a.data (), b.data (), out_cross.data (), count);
+
+      for (std::size_t i = 0; i < count; i++) {
+         for (std::size_t c = 0; c < 4; c++) {
+            CHECK (out_transform[i][c] == doctest::Approx (ref_transform[i][c]));
+         }
+         CHECK (out_dot[i] == doctest::Approx (ref_dot[i]));
+         for (std::size_t c = 0; c < 3; c++) {
+            CHECK (out_norm[i][c] == doctest::Approx (ref_norm[i][c]));
+            CHECK (out_cross[i][c] == doctest::Approx (ref_cross[i][c]));
+         }
+      }
+   }
+}
+
+TEST_CASE ("Dispatch: kernels agree with the vector functions")
+{
+   vec3 a = vec3 (3, 4, 5);
+   vec3 b = vec3 (-3, 6, 10);
+   vec3 c;
+   float d;
+
+   batch_cross (&a, &b, &c, 1);
+   batch_dot (&a, &b, &d, 1);
+
+   CHECK (c.x == 10);
+   CHECK (c.y == -45);
+   CHECK (c.z == 30);
+   CHECK (d == 65);
+}
+
+TEST_CASE ("Dispatch: in-place operation")
+{
+   std::vector<vec3> a (count);
+   for (std::size_t i = 0; i < count; i++) {
+      a[i] = make_vec3 (i);
+   }
+   batch_norm (a.data (), a.data (), count);
+   for (std::size_t i = 0; i < count; i++) {
+      CHECK (len (a[i]) == doctest::Approx (1.0));
+   }
+}
+
+TEST_CASE ("Dispatch: forcing an unsupported tier is refused")
+{
+   CHECK (force_simd_tier (simd_tier::scalar));
+   CHECK (active_simd_tier () == simd_tier::scalar);
+   CHECK (force_simd_tier (detect_simd_tier ()));
+   CHECK (active_simd_tier () == detect_simd_tier ());
+
+   // a tier above the CPU's leaves the active one alone
+   if (detect_simd_tier () < simd_tier::avx512) {
+      CHECK (!force_simd_tier (simd_tier::avx512));
+      CHECK (active_simd_tier () == detect_simd_tier ());
+      CHECK (force_simd_tier (simd_tier::scalar));
+      CHECK (!force_simd_tier (simd_tier::avx512));
+      CHECK (active_simd_tier () == simd_tier::scalar);
+      CHECK (force_simd_tier (detect_simd_tier ()));
+   }
+}
@@ -0,0 +1,59 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "../math/dual_quaternion.hpp"
+#include "checks.hpp"
+
+TEST_CASE ("Dual quaternion construction")
+{
+   dual_quatf e;
+   check_mat (to_mat4 (e), mat4 ());
+
+   for (std::size_t i = 0; i < 8; i++) {
+      const vec3  axis = norm (vec3 (1.0f, i * 0.5f, -1.0f));
+      const float rad  = i * 0.7f - 2.0f;
+      const vec3  t    = vec3 (1.0f + i, -2.0f * i, 0.5f);
+
+      dual_quatf dq = dual_quatf::rigid (quatf::axis_angle (axis, rad), t);
+      check_mat (to_mat4 (dq), make_rigid (i));
+      check_vec (translation (dq), t);
+      check_mat (to_mat4 (dual_quatf::from_mat (make_rigid (i))), make_rigid (i));
+   }
+}
+
+TEST_CASE ("Dual quaternion operations")
+{
+   for (std::size_t i = 0; i < 8; i++) {
+      dual_quatf a = dual_quatf::from_mat (make_rigid (i));
+      dual_quatf b = dual_quatf::from_mat (make_rigid (i + 3));
+
+      check_mat (to_mat4 (a * b), make_rigid (i) * make_rigid (i + 3));
+      check_mat (to_mat4 (a * conjugate (a)), mat4 ());
+
+      vec3 p  = vec3 (0.5f * i, 2.0f, -1.0f);
+      vec4 mp = make_rigid (i) * vec4 (p.x, p.y, p.z, 1);
+      vec4 mv = make_rigid (i) * vec4 (p.x, p.y, p.z, 0);
+      check_vec (transform_point (a, p), vec3 (mp.x, mp.y, mp.z));
+      check_vec (transform_vector (a, p), vec3 (mv.x, mv.y, mv.z));
+
+      // blending a transformation with itself changes nothing
+      check_mat (to_mat4 (norm (a * 0.3f + a * 0.2f)), make_rigid (i));
+   }
+}
+
+TEST_CASE ("Dual quaternion packets")
+{
+   dual_quatf palette[5];
+   for (std::size_t i = 0; i < 5; i++) {
+      palette[i] = dual_quatf::from_mat (make_rigid (i));
+   }
+   const int   idx[8] = { 4, 0, 0, 3, 1, 2, 4, 1 };
+   dual_quatx8 p      = gather (palette, idx);
+   vec3x8      v      = vec3x8 (simd_float8 (1.0f), simd_float8 (-2.0f), simd_float8 (0.5f));
+   vec3x8      r      = transform_point (p, v);
+   for (std::size_t i = 0; i < 8; i++) {
+      check_vec (lane (p.real.v, i), palette[idx[i]].real.v);
+      check_vec (lane (p.dual.v, i), palette[idx[i]].dual.v);
+      check_vec (lane (r, i), transform_point (palette[idx[i]], vec3 (1.0f, -2.0f, 0.5f)));
+   }
+}
@@ -0,0 +1,329 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../math/dynamic.hpp"
+
+/* small integers, so every sum is exact whatever order the kernels add
+ * them in
+ */
+template <typename T>
+static auto make_mat (std::size_t rows, std::size_t cols, std::size_t seed) -> matX<T>
+{
+   matX<T> m (rows, cols);
+   for (std::size_t j = 0; j < cols; j++) {
+      for (std::size_t i = 0; i < rows; i++) {
+         m[j][i] = T (int ((i * 7 + j * 3 + seed) % 11) - 5);
+      }
+   }
+   return m;
+}
+
+template <typename T>
+static auto make_vec (std::size_t size, std::size_t seed) -> vecX<T>
+{
+   vecX<T> v (size);
+   for (std::size_t i = 0; i < size; i++) {
+      v[i] = T (int ((i * 5 + seed) % 13) - 6);
+   }
+   return v;
+}
+
+TEST_CASE ("Dynamic construction")
+{
+   SUBCASE ("Zero and identity")
+   {
+      matXf m = matXf (5, 3);
+      CHECK (m.rows () == 5);
+      CHECK (m.cols () == 3);
+      for (std::size_t j = 0; j < 3; j++) {
+         for (std::size_t i = 0; i < 5; i++) {
+            CHECK (m[j][i] == 0);
+         }
+      }
+
+      matXd e = matXd::identity (4);
+      for (std::size_t j = 0; j < 4; j++) {
+         for (std::size_t i = 0; i < 4; i++) {
+            CHECK (e[j][i] == (i == j ? 1 : 0));
+         }
+      }
+   }
+
+   SUBCASE ("Alignment")
+   {
+      matXf m = matXf (37, 5);
+      CHECK (m.ld () % matXf::lanes == 0);
+      CHECK (m.ld () >= 37);
+      for (std::size_t j = 0; j < 5; j++) {
+         CHECK (reinterpret_cast<std::uintptr_t> (m[j]) % 64 == 0);
+      }
+      vecXd v = vecXd (13);
+      CHECK (reinterpret_cast<std::uintptr_t> (v.data ()) % 64 == 0);
+   }
+
+   SUBCASE ("Fixed-size interop")
+   {
+      mat2x3 f = mat2x3 ({ { 1, 2, 3 }, { 4, 5, 6 } });
+      matXf  m = f;
+      CHECK (m.rows () == 3);
+      CHECK (m.cols () == 2);
+      CHECK (m[1][2] == 6);
+
+      mat2x3 back = m.to_mat<2, 3> ();
+      CHECK (back[0][1] == 2);
+      CHECK (back[1][0] == 4);
+
+      vecXf v = vec3 (1, 2, 3);
+      CHECK (v.size () == 3);
+      vec3 fv = v.to_vec<3> ();
+      CHECK (fv.x == 1);
+      CHECK (fv.y == 2);
+      CHECK (fv.z == 3);
+   }
+}
+
+TEST_CASE ("Dynamic views")
+{
+   matXf m = make_mat<float> (6, 5, 0);
+
+   SUBCASE ("Columns and rows")
+   {
+      vecX_view<float> c = m.col (2);
+      vecX_view<float> r = m.row (3);
+      CHECK (c.size () == 6);
+      CHECK (r.size () == 5);
+      for (std::size_t i = 0; i < 6; i++) {
+         CHECK (c[i] == m[2][i]);
+      }
+      for (std::size_t j = 0; j < 5; j++) {
+         CHECK (r[j] == m[j][3]);
+      }
+
+      // views write through
+      r[1] = 42;
+      CHECK (m[1][3] == 42);
+   }
+
+   SUBCASE ("Blocks and slices")
+   {
+      matX_view<float> b = m.block (1, 2, 3, 2);
+      CHECK (b.rows () == 3);
+      CHECK (b.cols () == 2);
+      CHECK (b[0][0] == m[2][1]);
+      CHECK (b[1][2] == m[3][3]);
+      CHECK (b.data () == &m[2][1]);
+
+      vecX_view<float> s = m.col (4).slice (2, 3);
+      CHECK (s.size () == 3);
+      CHECK (&s[0] == &m[4][2]);
+
+      vecX_view<float> rs = m.row (0).slice (1, 3);
+      CHECK (&rs[2] == &m[3][0]);
+   }
+
+   SUBCASE ("Fixed-size")
+   {
+      mat3 f = mat3 ({ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } });
+      matX_view<float> v = f;
+      CHECK (v.ld () == 3);
+      CHECK (v[2][1] == 8);
+      v[0][0] = 10;
+      CHECK (f[0][0] == 10);
+
+      const vec4 c = vec4 (1, 2, 3, 4);
+      vecX_view<const float> cv = c;
+      CHECK (cv.size () == 4);
+      CHECK (cv[3] == 4);
+   }
+}
+
+TEST_CASE ("Dynamic kernels")
+{
+   SUBCASE ("Dot and axpy")
+   {
+      for (std::size_t n : { 0, 1, 7, 64, 1000 }) {
+         vecXf x = make_vec<float> (n, 0);
+         vecXf y = make_vec<float> (n, 3);
+
+         float expect = 0;
+         for (std::size_t i = 0; i < n; i++) {
+            expect += x[i] * y[i];
+         }
+         CHECK (dot (x, y) == expect);
+
+         vecXf r = y;
+         axpy (2.0f, x, r);
+         for (std::size_t i = 0; i < n; i++) {
+            CHECK (r[i] == y[i] + 2 * x[i]);
+         }
+      }
+
+      // strided: a row of a matrix
+      matXd m = make_mat<double> (9, 11, 1);
+      vecXd v = make_vec<double> (11, 2);
+      double expect = 0;
+      for (std::size_t j = 0; j < 11; j++) {
+         expect += m[j][4] * v[j];
+      }
+      CHECK (dot (m.row (4), v.view ()) == expect);
+   }
+
+   SUBCASE ("Gemv")
+   {
+      for (std::size_t n : { 1, 5, 33, 300 }) {
+         const std::size_t rows = n + 3;
+         matXd a = make_mat<double> (rows, n, 0);
+         vecXd x = make_vec<double> (n, 1);
+         vecXd y = make_vec<double> (rows, 2);
+
+         vecXd r = y;
+         gemv (2.0, a, x, -1.0, r);
+         for (std::size_t i = 0; i < rows; i++) {
+            double expect = -y[i];
+            for (std::size_t j = 0; j < n; j++) {
+               expect += 2 * a[j][i] * x[j];
+            }
+            CHECK (r[i] == expect);
+         }
+
+         vecXd ax = a * x;
+         for (std::size_t i = 0; i < rows; i++) {
+            CHECK (ax[i] == (r[i] + y[i]) / 2);
+         }
+      }
+   }
+
+   SUBCASE ("Gemm")
+   {
+      const std::size_t sizes[][3] = { { 1, 1, 1 }, { 5, 7, 3 }, { 33, 17, 40 }, { 100, 130, 70 }, { 64, 300, 64 } };
+      for (auto s : sizes) {
+         matXf a = make_mat<float> (s[0], s[2], 0);
+         matXf b = make_mat<float> (s[2], s[1], 4);
+         matXf c = make_mat<float> (s[0], s[1], 7);
+
+         matXf r = c;
+         gemm (1.0f, a, b, 2.0f, r);
+         matXf p = a * b;
+         for (std::size_t j = 0; j < s[1]; j++) {
+            for (std::size_t i = 0; i < s[0]; i++) {
+               float expect = 0;
+               for (std::size_t k = 0; k < s[2]; k++) {
+                  expect += a[k][i] * b[j][k];
+               }
+               CHECK (p[j][i] == expect);
+               CHECK (r[j][i] == expect + 2 * c[j][i]);
+            }
+         }
+      }
+   }
+
+   SUBCASE ("Gemm on views")
+   {
+      // C's middle block = A's top rows * B's left columns
+      matXd a = make_mat<double> (20, 18, 1);
+      matXd b = make_mat<double> (18, 25, 2);
+      matXd c = matXd (30, 30);
+      gemm (1.0, a.block (0, 0, 10, 18), b.block (0, 0, 18, 12), 0.0, c.block (5, 5, 10, 12));
+      for (std::size_t j = 0; j < 30; j++) {
+         for (std::size_t i = 0; i < 30; i++) {
+            double expect = 0;
+            if (i >= 5 && i < 15 && j >= 5 && j < 17) {
+               for (std::size_t k = 0; k < 18; k++) {
+                  expect += a[k][i - 5] * b[j - 5][k];
+               }
+            }
+            CHECK (c[j][i] == expect);
+         }
+      }
+   }
+
+   SUBCASE ("Threads")
+   {
+      // big enough to be split, with a column-count that isn't a multiple of the tile
+      parallel_max_threads () = 4;
+      matXf a = make_mat<float> (200, 150, 0);
+      matXf b = make_mat<float> (150, 203, 5);
+      matXf p = a * b;
+      parallel_max_threads () = 1;
+      matXf q = a * b;
+      parallel_max_threads () = 0;
+      for (std::size_t j = 0; j < 203; j++) {
+         for (std::size_t i = 0; i < 200; i++) {
+            CHECK (p[j][i] == q[j][i]);
+         }
+      }
+   }
+}
+
+TEST_CASE ("Dynamic operators")
+{
+   vecXf a = make_vec<float> (10, 0);
+   vecXf b = make_vec<float> (10, 1);
+
+   vecXf sum  = a + b;
+   vecXf diff = a - b;
+   vecXf s1   = a * 2;
+   vecXf s2   = 2 * a;
+   vecXf q    = a / 2;
+   for (std::size_t i = 0; i < 10; i++) {
+      CHECK (sum[i] == a[i] + b[i]);
+      CHECK (diff[i] == a[i] - b[i]);
+      CHECK (s1[i] == a[i] * 2);
+      CHECK (s2[i] == a[i] * 2);
+      CHECK (q[i] == a[i] / 2);
+   }
+}
+
+TEST_CASE ("Dynamic operators on temporaries")
+{
+   vecXf a = make_vec<float> (100, 0);
+   vecXf b = make_vec<float> (100, 1);
+
+   // the temporary's storage becomes the result
+   vecXf        t = a + b;
+   const float *p = t.data ();
+   vecXf        u = std::move (t) * 2 - a;
+   CHECK (u.data () == p);
+   vecXf v = a + std::move (u);
+   CHECK (v.data () == p);
+   for (std::size_t i = 0; i < 100; i++) {
+      CHECK (v[i] == 2 * (a[i] + b[i]));
+   }
+}
+
+TEST_CASE ("Parallel ranges")
+{
+   // one range per thread up to the limit, aligned to the grain and without gaps
+   struct run
+   {
+      std::size_t limit, count, grain;
+   };
+   for (const run &r : { run { 2, 2500, 1000 }, run { 16, 16500, 1000 }, run { 16, 17000, 1000 },
+                         run { 3, 10, 1 }, run { 4, 3, 1 }, run { 8, 100, 0 }, run { 1, 5000, 10 } }) {
+      parallel_max_threads () = r.limit;
+      std::mutex                                       lock;
+      std::vector<std::pair<std::size_t, std::size_t>> ranges;
+      parallel_for (r.count, r.grain, [&] (std::size_t begin, std::size_t end) {
+         std::lock_guard<std::mutex> guard (lock);
+         ranges.emplace_back (begin, end);
+      });
+      const std::size_t grain = std::max<std::size_t> (r.grain, 1);
+      CHECK (ranges.size () == std::min (r.limit, (r.count + grain - 1) / grain));
+      std::sort (ranges.begin (), ranges.end ());
+      std::size_t next = 0;
+      for (const auto &[begin, end] : ranges) {
+         CHECK (begin == next);
+         CHECK (begin % grain == 0);
+         CHECK (begin < end);
+         next = end;
+      }
+      CHECK (next == r.count);
+   }
+   parallel_max_threads () = 0;
+}
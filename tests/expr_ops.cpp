@@ -0,0 +1,136 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#define MRN_MATH_EXPR_TEMPLATES
+#include "../math/vector.hpp"
+
+// expressions are constexpr as well
+static_assert (eval (vec3 (1, 2, 3) * 2.0f + vec3 (1.0f)).z == 7);
+static_assert (eval (vec4 (1, 2, 3, 4) - vec4 (1.0f)).w == 3);
+
+TEST_CASE ("Expressions are lazy")
+{
+   vec3 a = vec3 (1, 2, 3);
+   vec3 b = vec3 (4, 5, 6);
+
+   static_assert (vec_expression<decltype (a + b)>);
+   static_assert (vec_expression<decltype (a * 2.0f + b)>);
+   static_assert (vec_expression<decltype (-(a - b))>);
+   static_assert (!vec_expression<decltype (eval (a + b))>);
+   static_assert (sizeof (a * 2.0f + b) < 2 * sizeof (vec3) + sizeof (float) + 2 * sizeof (void *));
+
+   // the expression reads a and b only when it is evaluated
+   auto e = a + b;
+   a.x    = 10;
+   vec3 r = e;
+   CHECK (r.x == 14);
+}
+
+TEST_CASE ("Expression evaluation")
+{
+   SUBCASE ("3-dimensional vector")
+   {
+      vec3 a = vec3 (1, 2, 3);
+      vec3 b = vec3 (-5, 10, 3);
+      vec3 c = vec3 (0.5, 0.25, 2);
+
+      vec3 r = a * 2.0f + b * 3 - c;
+      CHECK (r.x == doctest::Approx (-13.5));
+      CHECK (r.y == doctest::Approx (33.75));
+      CHECK (r.z == doctest::Approx (13));
+
+      r = (a + b) / (c * 2);
+      CHECK (r.x == doctest::Approx (-4));
+      CHECK (r.y == doctest::Approx (24));
+      CHECK (r.z == doctest::Approx (1.5));
+
+      r = -(a - b);
+      CHECK (r.x == -6);
+      CHECK (r.y == 8);
+      CHECK (r.z == 0);
+   }
+
+   SUBCASE ("4-dimensional vector")
+   {
+      vec4 a = vec4 (1, 2, 3, 4);
+      vec4 b = vec4 (-5, 10, 3, 1000);
+
+      vec4 r = a * 0.5f + b / 2 - 1;
+      CHECK (r.x == doctest::Approx (-3));
+      CHECK (r.y == doctest::Approx (5));
+      CHECK (r.z == doctest::Approx (2));
+      CHECK (r.w == doctest::Approx (501));
+   }
+
+   SUBCASE ("N-dimensional vector")
+   {
+      vec<float, 6> a = { 1, 2, 3, 4, 5, 6 };
+      vec<float, 6> b = { -5, 10, 3, 1000, -1000, 0 };
+
+      vec<float, 6> r = 2.0f * a + b;
+      CHECK (r[0] == -3);
+      CHECK (r[3] == 1008);
+      CHECK (r[5] == 12);
+   }
+
+   SUBCASE ("Large vector")
+   {
+      // 4 elements at a time, and the 3 left over one by one
+      vec<float, 19> a, b;
+      for (std::size_t i = 0; i < 19; i++) {
+         a[i] = i * 0.5f;
+         b[i] = 10.0f - i;
+      }
+      vec<float, 19> r = -(a * 2.0f + b / 4) - 1;
+      for (std::size_t i = 0; i < 19; i++) {
+         CHECK (r[i] == doctest::Approx (-(i * 1.0f + (10.0f - i) / 4) - 1));
+      }
+   }
+
+   SUBCASE ("Integer vector")
+   {
+      vec3i a = vec3i (1, 2, 3);
+      vec3i r = a * 2 + a;
+      CHECK (r.x == 3);
+      CHECK (r.z == 9);
+   }
+}
+
+TEST_CASE ("Compound assignment with expressions")
+{
+   vec4 a = vec4 (1, 2, 3, 4);
+   vec4 b = vec4 (4, 3, 2, 1);
+
+   a += b * 2.0f;
+   CHECK (a.x == 9);
+   CHECK (a.w == 6);
+
+   a -= a - b;
+   CHECK (a.x == 4);
+   CHECK (a.w == 1);
+
+   a *= b + 1;
+   CHECK (a.x == 20);
+   CHECK (a.w == 2);
+
+   a /= b * 0.5f;
+   CHECK (a.x == 10);
+   CHECK (a.w == 4);
+}
+
+TEST_CASE ("Vector functions take expressions")
+{
+   vec3 a = vec3 (3, 4, 5);
+   vec3 b = vec3 (-3, 6, 10);
+
+   CHECK (len (a - b) == doctest::Approx (8.0622));
+   CHECK (dist (a, b) == doctest::Approx (8.0622));
+   CHECK (dist2 (a * 1.0f, b) == doctest::Approx (65.0));
+   CHECK (len (norm (a + b)) == doctest::Approx (1.0));
+   CHECK (dot (a + b, b) == doctest::Approx (dot (vec3 (0, 10, 15), b)));
+
+   vec3 c = cross (a * 1.0f, b);
+   CHECK (c.x == 10);
+   CHECK (c.y == -45);
+   CHECK (c.z == 30);
+}
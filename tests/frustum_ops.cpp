@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/frustum.hpp"
+
+static auto make_spheres (std::size_t count) -> vec4_soa
+{
+   vec4_soa spheres (count);
+   for (std::size_t i = 0; i < count; i++) {
+      spheres.set (i, vec4 ((i * 7919) % 200 * 0.5f - 50.0f, (i * 104729) % 200 * 0.5f - 50.0f,
+                            (i * 1299709) % 200 * 0.5f - 50.0f, 0.5f + i % 4));
+   }
+   return spheres;
+}
+
+TEST_CASE ("Frustum planes")
+{
+   const frustum f = frustum::from_mat (mat4::perspective (1.5707964f, 1.0f, 1.0f, 100.0f));
+   CHECK (contains (f, vec3 (0, 0, -10)));
+   CHECK (!contains (f, vec3 (0, 0, -0.5f)));
+   CHECK (!contains (f, vec3 (0, 0, -101)));
+   CHECK (!contains (f, vec3 (11, 0, -10)));
+   CHECK (contains (f, vec3 (9, -9, -10)));
+
+   // normalized, so the planes give distances
+   CHECK (distance (f.planes[4], vec3 (0, 0, -10)) == doctest::Approx (9));
+   CHECK (distance (f.planes[5], vec3 (0, 0, -10)) == doctest::Approx (90));
+   CHECK (distance (f.planes[0], vec3 (0, 0, -10)) == doctest::Approx (10 * std::sqrt (0.5f)));
+
+   CHECK (visible (f, vec3 (0, 0, -0.5f), 0.6f));
+   CHECK (!visible (f, vec3 (0, 0, -0.5f), 0.4f));
+   CHECK (visible (f, aabbf (vec3 (9.5f, 0, -10), vec3 (20, 1, -9))));
+   CHECK (!visible (f, aabbf (vec3 (11, 0, -10), vec3 (20, 1, -9))));
+   CHECK (!visible (f, aabbf ()));
+
+   SUBCASE ("Depth from 0 to 1")
+   {
+      const mat4    p = mat4::perspective (1.5707964f, 1.0f, 1.0f, 100.0f, projection_zero_to_one);
+      const frustum d = frustum::from_mat (p, true);
+      CHECK (distance (d.planes[4], vec3 (0, 0, -10)) == doctest::Approx (9));
+      CHECK (distance (d.planes[5], vec3 (0, 0, -10)) == doctest::Approx (90));
+
+      // reversed-Z swaps the near and the far plane
+      const frustum r = frustum::from_mat (
+        mat4::perspective (1.5707964f, 1.0f, 1.0f, 100.0f, projection_zero_to_one | projection_reversed_z), true);
+      CHECK (distance (r.planes[4], vec3 (0, 0, -10)) == doctest::Approx (90));
+      CHECK (distance (r.planes[5], vec3 (0, 0, -10)) == doctest::Approx (9));
+   }
+
+   SUBCASE ("Infinite far plane")
+   {
+      const frustum i = frustum::from_mat (mat4::perspective (1.5707964f, 1.0f, 1.0f, 100.0f, projection_infinite));
+      CHECK (contains (i, vec3 (0, 0, -1e6f)));
+      CHECK (!contains (i, vec3 (0, 0, -0.5f)));
+   }
+}
+
+TEST_CASE ("Batched culling")
+{
+   // not a multiple of 8
+   const std::size_t count   = 1003;
+   const vec4_soa    spheres = make_spheres (count);
+   std::vector<aabbf> boxes;
+   for (std::size_t i = 0; i < count; i++) {
+      const vec4 s = spheres.get (i);
+      boxes.push_back (aabbf::from_center (vec3 (s.x, s.y, s.z), vec3 (s.w, 0.5f * s.w, 2.0f)));
+   }
+   const aabb_soa soa (boxes);
+
+   std::vector<std::uint8_t> sphere_cache, box_cache;
+   for (std::size_t frame = 0; frame < 4; frame++) {
+      const mat4 view_proj = mat4::perspective (1.0f, 1.5f, 0.5f, 60.0f) * mat4::rotate (vec3 (0, 1, 0), frame * 0.3f)
+                             * mat4::translate (0, 0, -10.0f);
+      const frustum f = frustum::from_mat (view_proj);
+
+      std::vector<std::uint32_t> expected_spheres, expected_boxes;
+      for (std::size_t i = 0; i < count; i++) {
+         const vec4 s = spheres.get (i);
+         if (visible (f, vec3 (s.x, s.y, s.z), s.w)) {
+            expected_spheres.push_back (std::uint32_t (i));
+         }
+         if (visible (f, boxes[i])) {
+            expected_boxes.push_back (std::uint32_t (i));
+         }
+      }
+      CHECK (expected_spheres.size () > 0);
+      CHECK (expected_spheres.size () < count);
+
+      std::vector<std::uint32_t> indices;
+      CHECK (cull_indices (f, spheres, indices) == expected_spheres.size ());
+      CHECK (indices == expected_spheres);
+      indices.clear ();
+      CHECK (cull_indices (f, spheres, indices, &sphere_cache) == expected_spheres.size ());
+      CHECK (indices == expected_spheres);
+      indices.clear ();
+      CHECK (cull_indices (f, soa, indices, &box_cache) == expected_boxes.size ());
+      CHECK (indices == expected_boxes);
+
+      std::vector<std::uint8_t> mask;
+      CHECK (cull_mask (f, spheres, mask, &sphere_cache) == expected_spheres.size ());
+      std::size_t n = 0;
+      for (std::size_t i = 0; i < count; i++) {
+         if ((mask[i / 8] >> (i % 8)) & 1) {
+            CHECK (expected_spheres[n++] == i);
+         }
+      }
+      CHECK (n == expected_spheres.size ());
+      CHECK (cull_mask (f, soa, mask) == expected_boxes.size ());
+   }
+}
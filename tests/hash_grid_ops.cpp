@@ -0,0 +1,155 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "../math/hash_grid.hpp"
+#include "meshes.hpp"
+
+static lcg rng (2468);
+
+// uniform in a cube, and in a few tight clusters
+static auto make_points (std::size_t n, bool clustered) -> std::vector<vec3>
+{
+   std::vector<vec3> points (n);
+   for (std::size_t i = 0; i < n; i++) {
+      points[i] = clustered ? vec3 (float (i % 5)) * 3.0f + rng.signed_vec3 () * 0.2f : rng.signed_vec3 () * 4.0f;
+   }
+   return points;
+}
+
+typedef std::vector<std::pair<std::uint32_t, float>> neighbors;
+
+static auto brute_force (const std::vector<vec3> &points, const vec3 &p, float radius) -> neighbors
+{
+   neighbors found;
+   for (std::size_t i = 0; i < points.size (); i++) {
+      if (dist2 (points[i], p) <= radius * radius) {
+         found.emplace_back (std::uint32_t (i), dist2 (points[i], p));
+      }
+   }
+   return found;
+}
+
+static auto query (const hash_grid &grid, const vec3 &p, float radius) -> neighbors
+{
+   neighbors found;
+   grid.for_each_neighbor (p, radius, [&] (std::uint32_t i, float d2) { found.emplace_back (i, d2); });
+   std::sort (found.begin (), found.end ());
+   return found;
+}
+
+TEST_CASE ("Neighbors")
+{
+   for (bool clustered : { false, true }) {
+      const std::vector<vec3> points = make_points (3000, clustered);
+      const hash_grid         grid (points, 0.3f);
+      REQUIRE (grid.size () == points.size ());
+      CHECK (grid.cell_size () == 0.3f);
+
+      // smaller than, as large as, and larger than the cells
+      for (float radius : { 0.1f, 0.3f, 0.7f }) {
+         for (std::size_t k = 0; k < 50; k++) {
+            const vec3 p = k % 2 ? points[k * 37] : rng.signed_vec3 () * 5.0f;
+            CHECK (query (grid, p, radius) == brute_force (points, p, radius));
+         }
+      }
+   }
+}
+
+TEST_CASE ("Far away points")
+{
+   // so many cells apart that they wrap around, and all in the same cell
+   std::vector<vec3> points;
+   for (float base : { -3e5f, 0.0f, 2e5f }) {
+      for (std::size_t i = 0; i < 200; i++) {
+         points.push_back (vec3 (base, -base, base * 0.5f) + rng.signed_vec3 ());
+      }
+   }
+   for (std::size_t i = 0; i < 100; i++) {
+      points.push_back (vec3 (0.25f));
+   }
+   const hash_grid grid (points, 0.01f);
+   for (std::size_t k = 0; k < points.size (); k += 7) {
+      CHECK (query (grid, points[k], 0.03f) == brute_force (points, points[k], 0.03f));
+   }
+   CHECK (query (grid, vec3 (0.25f), 0).size () == 100);
+}
+
+TEST_CASE ("Batches and pairs")
+{
+   const std::vector<vec3> points = make_points (40000, false), queries = make_points (2000, true);
+   const float             radius = 0.15f;
+
+   auto batch = [&] (const hash_grid &grid) {
+      std::vector<neighbors> found (queries.size ());
+      grid.for_each_neighbor (queries, radius, [&] (std::size_t q, std::uint32_t i, float d2) {
+         found[q].emplace_back (i, d2);
+      });
+      return found;
+   };
+   auto pairs = [&] (const hash_grid &grid) {
+      std::vector<neighbors> found (points.size ());
+      grid.for_each_pair (radius, [&] (std::uint32_t i, std::uint32_t j, float d2) {
+         // every cell is taken by one thread, so only one of them adds to i
+         found[i].emplace_back (j, d2);
+      });
+      for (neighbors &n : found) {
+         std::sort (n.begin (), n.end ());
+      }
+      return found;
+   };
+
+   const std::size_t threads = parallel_max_threads ();
+   parallel_max_threads ()   = 1;
+   const hash_grid single (points, radius);
+   const auto      expected = batch (single);
+   const auto      expected_pairs = pairs (single);
+   parallel_max_threads () = 4;
+   hash_grid grid (points, radius);
+   CHECK (batch (grid) == expected);
+   CHECK (pairs (grid) == expected_pairs);
+   // rebuilt in place, from other points and back
+   grid.build (queries, radius * 2);
+   CHECK (grid.size () == queries.size ());
+   grid.build (points, radius);
+   CHECK (batch (grid) == expected);
+   parallel_max_threads () = threads;
+
+   std::size_t count = 0;
+   for (std::size_t q = 0; q < queries.size (); q++) {
+      neighbors sorted = expected[q];
+      std::sort (sorted.begin (), sorted.end ());
+      CHECK (sorted == brute_force (points, queries[q], radius));
+      count += sorted.size ();
+   }
+   CHECK (count > 500);
+
+   std::size_t total = 0;
+   for (std::size_t i = 0; i < points.size (); i += 97) {
+      neighbors others = brute_force (points, points[i], radius);
+      others.erase (std::find_if (others.begin (), others.end (), [&] (const auto &n) { return n.first == i; }));
+      CHECK (expected_pairs[i] == others);
+   }
+   for (const neighbors &n : expected_pairs) {
+      total += n.size ();
+   }
+   CHECK (total % 2 == 0);
+}
+
+TEST_CASE ("Empty grid")
+{
+   hash_grid grid;
+   CHECK (grid.size () == 0);
+   std::size_t calls = 0;
+   grid.for_each_neighbor (vec3 (0.0f), 1, [&] (std::uint32_t, float) { calls++; });
+   grid.for_each_pair (1, [&] (std::uint32_t, std::uint32_t, float) { calls++; });
+
+   grid.build (std::vector<vec3> (), 0.5f);
+   CHECK (grid.size () == 0);
+   grid.for_each_neighbor (vec3 (0.0f), 1, [&] (std::uint32_t, float) { calls++; });
+   grid.for_each_pair (1, [&] (std::uint32_t, std::uint32_t, float) { calls++; });
+   CHECK (calls == 0);
+}
@@ -0,0 +1,88 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/hierarchy.hpp"
+#include "checks.hpp"
+
+static auto make_local (std::size_t i) -> mat4
+{
+   return mat4::translate (0.1f * (i % 7), 0.2f, -0.1f * (i % 3)) * mat4::rotate (norm (vec3 (1.0f, i % 5, 2.0f)), i * 0.01f)
+          * mat4::scale (1.0f + (i % 3) * 0.01f, 1.0f, 1.0f);
+}
+
+/* world matrices the plain way, parents always have smaller handles
+ */
+static void check_worlds (const transform_hierarchy &h, const std::vector<std::size_t> &parents)
+{
+   std::vector<mat4> world (parents.size ());
+   for (std::size_t i = 0; i < parents.size (); i++) {
+      world[i] = parents[i] == transform_hierarchy::none ? h.local (i) : world[parents[i]] * h.local (i);
+      check_mat (h.world (i), world[i], 1e-4);
+   }
+}
+
+TEST_CASE ("Transform hierarchy")
+{
+   // deeper than the grain, with two roots
+   const std::size_t        count = transform_hierarchy::grain * 5 + 3;
+   transform_hierarchy      h;
+   std::vector<std::size_t> parents;
+   for (std::size_t i = 0; i < count; i++) {
+      const std::size_t p = i == 0 || i == count / 2 ? transform_hierarchy::none : (i * 7919) % i;
+      parents.push_back (p);
+      CHECK (h.add (p, make_local (i)) == i);
+   }
+   parallel_max_threads () = 3;
+
+   CHECK (h.update () == count);
+   CHECK (h.update () == 0);
+   check_worlds (h, parents);
+
+   SUBCASE ("Depth-first order")
+   {
+      for (std::size_t i = 0; i < count; i++) {
+         const std::size_t s = h.slot (i);
+         CHECK (&h.worlds ()[s] == &h.world (i));
+         if (parents[i] != transform_hierarchy::none) {
+            CHECK (h.parent_slot (s) == h.slot (parents[i]));
+            CHECK (h.parent_slot (s) < s);
+         }
+      }
+   }
+
+   SUBCASE ("Changed subtrees only")
+   {
+      // a leaf
+      h.set_local (count - 1, mat4::translate (1, 2, 3));
+      CHECK (h.update () == 1);
+      check_worlds (h, parents);
+
+      // a root, twice, and a node below it
+      h.set_local (0, mat4::rotate (vec3 (0, 1, 0), 0.5f));
+      h.set_local (0, mat4::rotate (vec3 (0, 1, 0), 0.25f));
+      h.set_local (5, mat4::scale (2, 2, 2));
+      const std::size_t updated = h.update ();
+      CHECK (updated > transform_hierarchy::grain);
+      CHECK (updated < count);
+      check_worlds (h, parents);
+
+      for (std::size_t i = 0; i < count; i += 17) {
+         h.set_local (i, make_local (i * 3));
+      }
+      h.update ();
+      check_worlds (h, parents);
+   }
+
+   SUBCASE ("Adding nodes")
+   {
+      parents.push_back (3);
+      CHECK (h.add (3, mat4::translate (0, 1, 0)) == count);
+      parents.push_back (count);
+      h.add (count, mat4::translate (0, 0, 1));
+      h.set_local (7, mat4::scale (0.5f, 0.5f, 0.5f));
+      CHECK (h.update () == count + 2);
+      check_worlds (h, parents);
+   }
+}
@@ -0,0 +1,117 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/lbvh.hpp"
+#include "bvh_checks.hpp"
+#include "meshes.hpp"
+
+static lcg rng (99);
+
+TEST_CASE ("Morton codes")
+{
+   CHECK (morton_code (1u, 0u, 0u) == 1);
+   CHECK (morton_code (0u, 1u, 0u) == 2);
+   CHECK (morton_code (0u, 0u, 1u) == 4);
+   CHECK (morton_code (1023u, 1023u, 1023u) == (1u << 30) - 1);
+   const std::uint64_t zero = 0, top = 2097151;
+   CHECK (morton_code (std::uint64_t (1) << 20, zero, zero) == std::uint64_t (1) << 60);
+   CHECK (morton_code (top, top, top) == (std::uint64_t (1) << 63) - 1);
+
+   for (std::size_t k = 0; k < 100; k++) {
+      const std::uint64_t x = rng.bits () % 2097152, y = rng.bits () % 2097152, z = rng.bits () % 2097152;
+      std::uint64_t       expected = 0;
+      for (std::size_t b = 0; b < 21; b++) {
+         expected |= (x >> b & 1) << 3 * b | (y >> b & 1) << (3 * b + 1) | (z >> b & 1) << (3 * b + 2);
+      }
+      CHECK (morton_code (x, y, z) == expected);
+      CHECK (morton_code (std::uint32_t (x % 1024), std::uint32_t (y % 1024), std::uint32_t (z % 1024))
+             == (expected & ((1u << 30) - 1)));
+   }
+}
+
+TEST_CASE ("Radix sort")
+{
+   // pairs, to see that it's stable
+   std::vector<std::uint64_t> items;
+   for (std::size_t i = 0; i < 300000; i++) {
+      items.push_back (std::uint64_t (rng.bits () % 5000) << 32 | i);
+   }
+   auto key = [] (std::uint64_t item) { return item >> 32; };
+   std::vector<std::uint64_t> expected = items;
+   std::stable_sort (expected.begin (), expected.end (),
+                     [&] (std::uint64_t a, std::uint64_t b) { return key (a) < key (b); });
+
+   std::vector<std::uint64_t> scratch;
+   for (std::size_t threads : { 1, 4 }) {
+      parallel_max_threads ()          = threads;
+      std::vector<std::uint64_t> mine = items;
+      // more bits than the keys have, the passes over the zeros are skipped
+      radix_sort (mine, scratch, 30, key);
+      CHECK (mine == expected);
+   }
+   parallel_max_threads () = 0;
+
+   std::vector<std::uint64_t> none;
+   radix_sort (none, scratch, 30, key);
+   CHECK (none.empty ());
+}
+
+TEST_CASE_TEMPLATE ("Linear bounding volume hierarchy", Code, std::uint32_t, std::uint64_t)
+{
+   const std::vector<aabbf> boxes = triangle_bounds (make_sphere (64, 96));
+   const bvh                tree  = linear_bvh<Code> (boxes);
+   check_tree (tree, boxes, 1, true);
+
+   /* worse than SAH, but not by much on a surface
+    */
+   const float cost = sah_cost (tree);
+   CHECK (cost > sah_cost (bvh (boxes)));
+   CHECK (cost < 2 * sah_cost (bvh (boxes)));
+
+   SUBCASE ("Threads")
+   {
+      // the same tree, however many threads build it
+      const std::vector<aabbf> many = triangle_bounds (make_sphere (300, 400));
+      parallel_max_threads ()       = 4;
+      const bvh parallel            = linear_bvh<Code> (many);
+      parallel_max_threads ()       = 1;
+      const bvh serial              = linear_bvh<Code> (many);
+      parallel_max_threads ()       = 0;
+      check_tree (parallel, many, 1, true);
+      REQUIRE (parallel.nodes.size () == serial.nodes.size ());
+      CHECK (parallel.indices == serial.indices);
+      std::size_t equal = 0;
+      for (std::size_t i = 0; i < serial.nodes.size (); i++) {
+         const bvh_node &a = parallel.nodes[i], &b = serial.nodes[i];
+         equal += a.first == b.first && a.count == b.count && same (a.bounds (), b.bounds ());
+      }
+      CHECK (equal == serial.nodes.size ());
+   }
+}
+
+TEST_CASE ("Degenerate linear hierarchies")
+{
+   CHECK (linear_bvh (std::vector<aabbf> ()).empty ());
+
+   const std::vector<aabbf> one (1, aabbf (vec3 (0, 0, 0), vec3 (1, 1, 1)));
+   const bvh                single = linear_bvh (one);
+   REQUIRE (single.nodes.size () == 1);
+   CHECK (single.nodes[0].count == 1);
+   CHECK (single.indices[0] == 0);
+
+   // all centroids in one point, every code the same
+   std::vector<aabbf> same;
+   for (std::size_t i = 0; i < 100; i++) {
+      same.push_back (aabbf::from_center (vec3 (1, 2, 3), vec3 (0.5f + i * 0.01f)));
+   }
+   check_tree (linear_bvh (same), same, 1, true);
+
+   // flat boxes, all in the plane z = 0
+   std::vector<aabbf> flat;
+   for (std::size_t i = 0; i < 50; i++) {
+      flat.push_back (aabbf (vec3 (float (i), 0, 0), vec3 (i + 1.0f, 1, 0)));
+   }
+   check_tree (linear_bvh<std::uint64_t> (flat), flat, 1, true);
+}
@@ -1,6 +1,8 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
+#include <cmath>
+
 #include "../math/constants.hpp"
 #include "../math/matrix.hpp"
 
@@ -130,6 +132,33 @@ TEST_CASE ("Matrix - Matrix")
    CHECK (result[3][3] == doctest::Approx (-14.77f));
 }
 
+TEST_CASE ("Operators on const and temporary matrices")
+{
+   const mat3 a = mat3 ({ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } });
+   const mat3 b = mat3 ({ { 2, 0, 0 }, { 0, 2, 0 }, { 1, 1, 1 } });
+
+   mat3 r1 = (a + b) + a;
+   mat3 r2 = a + (b - a);
+   mat3 r3 = (a - b) - a;
+   for (std::size_t j = 0; j < 3; j++) {
+      for (std::size_t i = 0; i < 3; i++) {
+         CHECK (r1[j][i] == 2 * a[j][i] + b[j][i]);
+         CHECK (r2[j][i] == b[j][i]);
+         CHECK (r3[j][i] == -b[j][i]);
+      }
+   }
+
+   mat3 m = a;
+   m *= b;
+   m *= m;
+   mat3 p = (a * b) * (a * b);
+   for (std::size_t j = 0; j < 3; j++) {
+      for (std::size_t i = 0; i < 3; i++) {
+         CHECK (m[j][i] == p[j][i]);
+      }
+   }
+}
+
 TEST_CASE ("Matrix * Vector")
 {
    vec4 v = vec4 (-1.0, 2.0, 4.5, 1.0);
@@ -182,6 +211,51 @@ TEST_CASE ("Matrix * Matrix")
    CHECK (result[3][3] == doctest::Approx (2.282f));
 }
 
+/* the blocked multiply against the plain loops. Small integers keep
+ * every sum exact, whatever order the kernel adds them in
+ */
+template <typename T, std::size_t c, std::size_t r, std::size_t o>
+static void check_product ()
+{
+   mat<T, c, r> a;
+   mat<T, o, c> b;
+   for (std::size_t j = 0; j < c; j++) {
+      for (std::size_t i = 0; i < r; i++) {
+         a[j][i] = T (int ((i * 7 + j * 3) % 11) - 5);
+      }
+   }
+   for (std::size_t j = 0; j < o; j++) {
+      for (std::size_t i = 0; i < c; i++) {
+         b[j][i] = T (int ((i * 5 + j) % 13) - 6);
+      }
+   }
+
+   mat<T, o, r> result = a * b;
+   for (std::size_t j = 0; j < o; j++) {
+      for (std::size_t i = 0; i < r; i++) {
+         T value = 0;
+         for (std::size_t k = 0; k < c; k++) {
+            value += a[k][i] * b[j][k];
+         }
+         CHECK (result[j][i] == value);
+      }
+   }
+}
+
+TEST_CASE ("Large Matrix * Matrix")
+{
+   check_product<float, 16, 16, 16> ();
+   check_product<float, 64, 64, 64> ();
+   check_product<double, 32, 32, 32> ();
+   // partial tiles at the edges
+   check_product<float, 17, 33, 20> ();
+   check_product<double, 19, 37, 23> ();
+   // more than one block along k
+   check_product<float, 260, 20, 18> ();
+   // too small for the blocked kernel, but not square
+   check_product<float, 2, 3, 4> ();
+}
+
 TEST_CASE ("Translation-Matrix")
 {
    vec4 v  = vec4 (-1.0, 2.0, 4.5, 1.0);
@@ -280,3 +354,229 @@ TEST_CASE ("Rotation-Matrix")
       CHECK (result.w == 1.0f);
    }
 }
+
+/* m * inverse(m) has to be the identity
+ */
+template <typename T, std::size_t n>
+static void check_identity (mat<T, n, n> m, double eps = 1e-5)
+{
+   for (std::size_t i = 0; i < n; i++) {
+      for (std::size_t j = 0; j < n; j++) {
+         CHECK (m[i][j] == doctest::Approx (i == j ? 1.0 : 0.0).epsilon (eps).scale (1));
+      }
+   }
+}
+
+TEST_CASE ("Transpose")
+{
+   mat4 m = mat4 ({ { 3.0, 2.0, -2.0, 0.5 },
+                    { 0.0, 1.0, 5.0, 1.0 },
+                    { 5.5, 13.0, 37.0, 23.0 },
+                    { 1.1, 1.2, 1.3, -1.4 } });
+
+   mat4 t = transpose (m);
+   for (std::size_t i = 0; i < 4; i++) {
+      for (std::size_t j = 0; j < 4; j++) {
+         CHECK (t[i][j] == m[j][i]);
+      }
+   }
+
+   mat2x3 r  = mat2x3 ({ { 1, 2, 3 }, { 4, 5, 6 } });
+   mat<float, 3, 2> rt = transpose (r);
+   CHECK (rt[0][1] == 4);
+   CHECK (rt[2][0] == 3);
+   CHECK (rt[2][1] == 6);
+}
+
+TEST_CASE ("Determinant")
+{
+   mat4 m4 = mat4 ({ { 3.0, 2.0, -2.0, 0.5 },
+                     { 0.0, 1.0, 5.0, 1.0 },
+                     { 5.5, 13.0, 37.0, 23.0 },
+                     { 1.1, 1.2, 1.3, -1.4 } });
+   mat3 m3 = mat3 ({ { 2, 1, 0 }, { 1, 3, 1 }, { 0, 1, 4 } });
+   mat2 m2 = mat2 ({ { 2, 1 }, { 1, 3 } });
+
+   CHECK (determinant (m4) == doctest::Approx (48.375));
+   CHECK (determinant (m3) == doctest::Approx (18));
+   CHECK (determinant (m2) == doctest::Approx (5));
+   CHECK (determinant (mat4::scale (2, 3, 4)) == doctest::Approx (24));
+   CHECK (determinant (mat4::rotate (norm (vec3 (1, 2, 3)), 0.5f)) == doctest::Approx (1));
+}
+
+TEST_CASE ("Inverse")
+{
+   SUBCASE ("4x4")
+   {
+      mat4 m = mat4 ({ { 3.0, 2.0, -2.0, 0.5 },
+                       { 0.0, 1.0, 5.0, 1.0 },
+                       { 5.5, 13.0, 37.0, 23.0 },
+                       { 1.1, 1.2, 1.3, -1.4 } });
+      mat4 i = inverse (m);
+      check_identity (m * i);
+      check_identity (i * m);
+
+      // the SIMD-path against the scalar one
+      mat4d md = mat4d ({ { 3.0, 2.0, -2.0, 0.5 },
+                          { 0.0, 1.0, 5.0, 1.0 },
+                          { 5.5, 13.0, 37.0, 23.0 },
+                          { 1.1, 1.2, 1.3, -1.4 } });
+      mat4d id = inverse (md);
+      check_identity (md * id, 1e-12);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t r = 0; r < 4; r++) {
+            CHECK (i[c][r] == doctest::Approx (id[c][r]));
+         }
+      }
+   }
+
+   SUBCASE ("3x3")
+   {
+      mat3 m = mat3 ({ { 2, 1, 0 }, { 1, 3, 1 }, { 0, 1, 4 } });
+      check_identity (m * inverse (m));
+      check_identity (inverse (m) * m);
+   }
+
+   SUBCASE ("2x2")
+   {
+      mat2 m = mat2 ({ { 2, 1 }, { -1, 3 } });
+      check_identity (m * inverse (m));
+      check_identity (inverse (m) * m);
+   }
+}
+
+TEST_CASE ("Affine inverse")
+{
+   SUBCASE ("4x4")
+   {
+      mat4 m = mat4::translate (3.0, -4.5, 10.0) * mat4::rotate (vec3 (1, 2, 3), pi_4)
+               * mat4::scale (2.0, 0.5, 1.5);
+      mat4 i = inverse_affine (m);
+      check_identity (m * i);
+
+      mat4 g = inverse (m);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t r = 0; r < 4; r++) {
+            CHECK (i[c][r] == doctest::Approx (g[c][r]).scale (1));
+         }
+      }
+
+      // moving a point there and back
+      vec4 v = vec4 (-1.0, 2.0, 4.5, 1.0);
+      vec4 p = i * (m * v);
+      CHECK (p.x == doctest::Approx (v.x));
+      CHECK (p.y == doctest::Approx (v.y));
+      CHECK (p.z == doctest::Approx (v.z));
+      CHECK (p.w == doctest::Approx (1.0));
+   }
+
+   SUBCASE ("3x3")
+   {
+      mat3 m  = mat3::translate (2.0, -3.0);
+      m[0][0] = 2.0;
+      m[0][1] = 0.5;
+      m[1][1] = 4.0;
+      check_identity (m * inverse_affine (m));
+   }
+}
+
+/* ndc depth of the point at distance z in front of the camera
+ */
+static auto ndc_depth (const mat4d &p, double z) -> double
+{
+   const vec4d c = p * vec4d (0, 0, -z, 1);
+   return c.z / c.w;
+}
+
+TEST_CASE ("Projection-Matrix")
+{
+   SUBCASE ("Perspective")
+   {
+      // the classic gluPerspective-matrix
+      const double f = 1 / std::tan (0.5);
+      const mat4d  p = mat4d::perspective (1.0, 1.5, 0.5, 100.0);
+      CHECK (p[0][0] == doctest::Approx (f / 1.5));
+      CHECK (p[1][1] == doctest::Approx (f));
+      CHECK (p[2][2] == doctest::Approx (-100.5 / 99.5));
+      CHECK (p[2][3] == -1);
+      CHECK (p[3][2] == doctest::Approx (-100.0 / 99.5));
+      CHECK (p[3][3] == 0);
+      check_identity (p * inverse_perspective (p), 1e-12);
+
+      const mat4d fr = mat4d::frustum (-1, 2, -0.5, 1.5, 1, 10);
+      const vec4d c  = fr * vec4d (2, 1.5, -1, 1);
+      CHECK (c.x / c.w == doctest::Approx (1));
+      CHECK (c.y / c.w == doctest::Approx (1));
+      check_identity (fr * inverse_perspective (fr), 1e-12);
+      check_identity (inverse_perspective (fr) * fr, 1e-12);
+   }
+
+   SUBCASE ("Depth ranges")
+   {
+      const unsigned flags[] = { projection_gl, projection_zero_to_one, projection_reversed_z,
+                                 projection_zero_to_one | projection_reversed_z };
+      const double   ends[][2] = { { -1, 1 }, { 0, 1 }, { 1, -1 }, { 1, 0 } };
+      for (std::size_t i = 0; i < 4; i++) {
+         const mat4d p = mat4d::perspective (1.0, 1.0, 0.5, 100.0, flags[i]);
+         CHECK (ndc_depth (p, 0.5) == doctest::Approx (ends[i][0]));
+         CHECK (ndc_depth (p, 100.0) == doctest::Approx (ends[i][1]));
+         check_identity (p * inverse_perspective (p), 1e-12);
+
+         const mat4d inf = mat4d::perspective (1.0, 1.0, 0.5, 100.0, flags[i] | projection_infinite);
+         CHECK (ndc_depth (inf, 0.5) == doctest::Approx (ends[i][0]));
+         CHECK (ndc_depth (inf, 1e12) == doctest::Approx (ends[i][1]));
+         CHECK (inf[2][2] == -ends[i][1]);
+         check_identity (inf * inverse_perspective (inf), 1e-12);
+
+         const mat4d o = mat4d::orthographic (-2, 1, -1, 3, 0.5, 100.0, flags[i]);
+         CHECK (ndc_depth (o, 0.5) == doctest::Approx (ends[i][0]));
+         CHECK (ndc_depth (o, 100.0) == doctest::Approx (ends[i][1]));
+         check_identity (o * inverse_orthographic (o), 1e-12);
+         check_identity (inverse_orthographic (o) * o, 1e-12);
+      }
+   }
+
+   SUBCASE ("Orthographic")
+   {
+      const mat4 o = mat4::orthographic (-2, 1, -1, 3, 0.5, 100.0f);
+      const vec4 c = o * vec4 (-2, 3, -10, 1);
+      CHECK (c.x == doctest::Approx (-1));
+      CHECK (c.y == doctest::Approx (1));
+      CHECK (c.w == 1);
+
+      // against the general inverse
+      const mat4 i = inverse_orthographic (o), g = inverse (o);
+      for (std::size_t col = 0; col < 4; col++) {
+         for (std::size_t r = 0; r < 4; r++) {
+            CHECK (i[col][r] == doctest::Approx (g[col][r]).scale (1));
+         }
+      }
+   }
+
+   SUBCASE ("Look at")
+   {
+      const vec3 eye = vec3 (1, 2, 3), center = vec3 (-2, 0.5f, 1);
+      const mat4 v   = mat4::look_at (eye, center, vec3 (0, 1, 0));
+      const vec4 e   = v * vec4 (eye.x, eye.y, eye.z, 1);
+      const vec4 c   = v * vec4 (center.x, center.y, center.z, 1);
+      CHECK (len (vec3 (e.x, e.y, e.z)) == doctest::Approx (0).scale (1));
+      CHECK (c.x == doctest::Approx (0).scale (1));
+      CHECK (c.y == doctest::Approx (0).scale (1));
+      CHECK (c.z == doctest::Approx (-len (center - eye)));
+      CHECK (determinant (v) == doctest::Approx (1));
+      // up stays up
+      CHECK ((v * vec4 (0, 1, 0, 0)).y > 0);
+      check_identity (v * inverse_look_at (v));
+      check_identity (inverse_look_at (v) * v);
+   }
+
+   SUBCASE ("Constant expressions")
+   {
+      constexpr mat4d p = mat4d::perspective (1.5, 1.0, 1.0, 10.0, projection_zero_to_one | projection_reversed_z);
+      constexpr mat4d i = inverse_perspective (p);
+      static_assert (p[2][3] == -1 && p[3][3] == 0);
+      static_assert (i[2][3] * p[3][2] == 1);
+      constexpr mat4d v = mat4d::look_at (vec3d (0, 0, 5), vec3d (0, 0, 0), vec3d (0, 1, 0));
+      static_assert (v[3][2] == -5 && inverse_look_at (v)[3][2] == 5);
+   }
+}
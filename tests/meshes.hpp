@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../math/vector.hpp"
+
+/* generated geometry shared by the tests of the bvhs and ray queries,
+ * and the random numbers to make it with. The benchmarks use them too
+ */
+
+/* a linear congruential generator: the same numbers on every platform,
+ * with every standard library
+ */
+class lcg
+{
+ public:
+   explicit lcg (std::uint32_t seed)
+      : _seed (seed)
+   {}
+
+   auto bits () -> std::uint32_t
+   {
+      _seed = _seed * 1664525u + 1013904223u;
+      return _seed;
+   }
+
+   // uniform in [0, 1)
+   auto unit () -> float
+   {
+      return (bits () >> 8) * (1.0f / 16777216.0f);
+   }
+
+   // uniform in [-1, 1)
+   auto signed_unit () -> float
+   {
+      return (bits () >> 8) * (2.0f / 16777216.0f) - 1.0f;
+   }
+
+   // in the cube from -1 to 1, x first
+   auto signed_vec3 () -> vec3
+   {
+      const float x = signed_unit (), y = signed_unit ();
+      return vec3 (x, y, signed_unit ());
+   }
+
+ private:
+   std::uint32_t _seed;
+};
+
+/* a sphere of 2 * rings * segments triangles, as a soup, with bumps of
+ * height bump and frequency waves along theta and phi
+ */
+inline auto make_sphere (std::size_t rings, std::size_t segments, float bump = 0.1f, int theta_waves = 5,
+                         int phi_waves = 3) -> std::vector<vec3>
+{
+   auto point = [&] (std::size_t r, std::size_t s) {
+      const float theta = 3.14159265f * r / rings, phi = 6.2831853f * s / segments;
+      const float radius = 1.0f + bump * std::sin (theta_waves * theta) * std::cos (phi_waves * phi);
+      return vec3 (std::sin (theta) * std::cos (phi), std::cos (theta), std::sin (theta) * std::sin (phi)) * radius;
+   };
+   std::vector<vec3> vertices;
+   vertices.reserve (rings * segments * 6);
+   for (std::size_t r = 0; r < rings; r++) {
+      for (std::size_t s = 0; s < segments; s++) {
+         const vec3 a = point (r, s), b = point (r + 1, s), c = point (r + 1, s + 1), d = point (r, s + 1);
+         vertices.insert (vertices.end (), { a, b, c, a, c, d });
+      }
+   }
+   return vertices;
+}
@@ -0,0 +1,150 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "../math/packet.hpp"
+
+static auto make_vec3 (std::size_t i) -> vec3
+{
+   return vec3 (1.0f + i * 1.5f, -2.0f + i * 0.75f, 3.0f - i * 0.5f);
+}
+
+TEST_CASE ("Packet lanes")
+{
+   float in[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+   float out[8];
+
+   simd_float8 f = simd_float8::load (in);
+   f             = f * simd_float8 (2.0f) + 1.0f;
+   f.store (out);
+
+   for (std::size_t i = 0; i < 8; i++) {
+      CHECK (out[i] == 2 * i + 1);
+      CHECK (f[i] == 2 * i + 1);
+   }
+   CHECK (sqrt (simd_float8 (16.0f))[3] == 4);
+   CHECK ((-f)[7] == -15);
+}
+
+TEST_CASE ("Packet comparison masks")
+{
+   float       in[8] = { -3, 1, -2, 5, 0, 7, -1, 4 };
+   simd_float8 f     = simd_float8::load (in);
+
+   simd_mask8 neg = f < 0.0f;
+   CHECK (neg.bits () == 0b01000101);
+   CHECK (neg[0]);
+   CHECK (!neg[1]);
+   CHECK ((f >= 0.0f).bits () == 0b10111010);
+   CHECK ((f == 0.0f).bits () == 0b00010000);
+   CHECK ((~neg).bits () == 0b10111010);
+   CHECK (any (neg));
+   CHECK (!all (neg));
+   CHECK (none (neg & (f > 0.0f)));
+   CHECK (all (neg | (f >= 0.0f)));
+
+   simd_float8 a = abs (f);
+   simd_float8 s = select (neg, simd_float8 (0.0f), f);
+   for (std::size_t i = 0; i < 8; i++) {
+      CHECK (a[i] == (in[i] < 0 ? -in[i] : in[i]));
+      CHECK (s[i] == (in[i] < 0 ? 0 : in[i]));
+   }
+}
+
+TEST_CASE ("Half-width packets")
+{
+   float       in[4] = { -3, 1, -2, 5 };
+   float       out[4];
+   simd_float4 f = simd_float4::load (in);
+   fmadd (f, simd_float4 (2.0f), 1.0f).store (out);
+
+   simd_mask4 neg = f < 0.0f;
+   CHECK (neg.bits () == 0b0101);
+   CHECK (neg[2]);
+   CHECK (!neg[3]);
+   CHECK ((~neg).bits () == 0b1010);
+   CHECK ((neg ^ (f < 2.0f)).bits () == 0b0010);
+   CHECK (all (neg | (f >= 0.0f)));
+   CHECK (none (neg & (f > 0.0f)));
+
+   const simd_float4 lo = min (f, simd_float4 (0.0f)), hi = max (f, simd_float4 (0.0f));
+   const simd_float4 s  = select (neg, -f, f / 2.0f);
+   for (std::size_t i = 0; i < 4; i++) {
+      CHECK (out[i] == 2 * in[i] + 1);
+      CHECK (abs (f)[i] == std::abs (in[i]));
+      CHECK (lo[i] == (in[i] < 0 ? in[i] : 0));
+      CHECK (hi[i] == (in[i] > 0 ? in[i] : 0));
+      CHECK (s[i] == (in[i] < 0 ? -in[i] : in[i] / 2));
+   }
+}
+
+TEST_CASE ("Packet vectors match the scalar functions")
+{
+   vec3 a[8], b[8];
+   for (std::size_t i = 0; i < 8; i++) {
+      a[i] = make_vec3 (i);
+      b[i] = make_vec3 (7 - i) * 2;
+   }
+   vec3x8 pa = pack (a);
+   vec3x8 pb = pack (b);
+
+   vec3x8      c = cross (pa, pb);
+   simd_float8 d = dot (pa, pb);
+   simd_float8 l = len (pa);
+   vec3x8      n = norm (pa);
+   vec3x8      s = pa + pb;
+   vec3x8      m = -pa;
+
+   vec3 unpacked[8];
+   unpack (c, unpacked);
+
+   for (std::size_t i = 0; i < 8; i++) {
+      vec3 rc = cross (a[i], b[i]);
+      CHECK (unpacked[i].x == doctest::Approx (rc.x));
+      CHECK (unpacked[i].y == doctest::Approx (rc.y));
+      CHECK (unpacked[i].z == doctest::Approx (rc.z));
+      CHECK (d[i] == doctest::Approx (dot (a[i], b[i])));
+      CHECK (l[i] == doctest::Approx (len (a[i])));
+      CHECK (len (lane (n, i)) == doctest::Approx (1.0));
+      CHECK (lane (s, i).y == doctest::Approx ((a[i] + b[i]).y));
+      CHECK (lane (m, i).z == -a[i].z);
+   }
+}
+
+TEST_CASE ("Packet from SoA")
+{
+   std::vector<vec3> aos (13);
+   for (std::size_t i = 0; i < aos.size (); i++) {
+      aos[i] = make_vec3 (i);
+   }
+   vec3_soa soa = vec3_soa (aos);
+
+   for (std::size_t i = 0; i < soa.size (); i += 8) {
+      vec3x8 p = pack (soa, i);
+      p *= 2;
+      unpack (p, soa, i);
+   }
+   for (std::size_t i = 0; i < aos.size (); i++) {
+      CHECK (soa.get (i).x == 2 * aos[i].x);
+      CHECK (soa.get (i).z == 2 * aos[i].z);
+   }
+}
+
+TEST_CASE ("Packet of matrices")
+{
+   mat3 m[8], back[8];
+   for (std::size_t i = 0; i < 8; i++) {
+      m[i] = mat3 ({ { 2.0f + i, 1, 0 }, { 1, 3, 1 }, { 0, 1, 4.0f - i } });
+   }
+
+   mat<simd_float8, 3, 3> p = pack (m);
+   simd_float8            d = determinant (p);
+   unpack (p, back);
+   for (std::size_t i = 0; i < 8; i++) {
+      CHECK (d[i] == doctest::Approx (determinant (m[i])));
+      for (std::size_t c = 0; c < 3; c++) {
+         for (std::size_t r = 0; r < 3; r++) {
+            CHECK (back[i][c][r] == m[i][c][r]);
+         }
+      }
+   }
+}
@@ -0,0 +1,208 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <cmath>
+#include <vector>
+
+#include "../math/quaternion.hpp"
+#include "checks.hpp"
+
+/* a unit quaternion for every i, spread over all axes and angles
+ */
+static auto make_quat (std::size_t i) -> quatf
+{
+   vec3 axis = norm (vec3 (1.0f + i * 0.3f, -2.0f + i * 0.7f, 0.5f - i * 0.2f));
+   return quatf::axis_angle (axis, -3.0f + i * 0.45f);
+}
+
+/* q and -q are the same rotation
+ */
+static void check_rotation (const quatf &a, const quatf &b)
+{
+   quatf s = dot (a, b) < 0 ? -b : b;
+   check_vec (a.v, s.v);
+}
+
+TEST_CASE ("Quaternion construction")
+{
+   quatf e;
+   CHECK (e.v.w == 1);
+   CHECK (e.v.x == 0);
+   check_mat (to_mat4 (e), mat4 ());
+
+   SUBCASE ("Axis and angle")
+   {
+      for (std::size_t i = 0; i < 14; i++) {
+         vec3  axis = norm (vec3 (1.0f, -2.0f + i * 0.5f, 0.5f));
+         float rad  = -3.0f + i * 0.45f;
+         check_mat (to_mat4 (quatf::axis_angle (axis, rad)), mat4::rotate (axis, rad));
+      }
+   }
+
+   SUBCASE ("From matrices")
+   {
+      // the four branches: small angles, and half-turns around x, y and z
+      const vec3 axes[] = { norm (vec3 (1, 2, 3)), vec3 (1, 0.1f, 0), vec3 (0.1f, 1, 0), vec3 (0, 0.1f, 1) };
+      for (vec3 a : axes) {
+         for (float rad : { 0.3f, 3.1f }) {
+            quatf q = quatf::axis_angle (norm (a), rad);
+            check_rotation (quatf::from_mat (to_mat3 (q)), q);
+            check_rotation (quatf::from_mat (to_mat4 (q)), q);
+         }
+      }
+   }
+}
+
+TEST_CASE ("Quaternion operators")
+{
+   SUBCASE ("Product")
+   {
+      for (std::size_t i = 0; i < 10; i++) {
+         quatf a = make_quat (i);
+         quatf b = make_quat (i + 7);
+         check_mat (to_mat4 (a * b), to_mat4 (a) * to_mat4 (b));
+
+         // the SSE product against the plain one in double
+         quatd ad = quatd (a.v.x, a.v.y, a.v.z, a.v.w);
+         quatd bd = quatd (b.v.x, b.v.y, b.v.z, b.v.w);
+         quatd pd = ad * bd;
+         quatf p  = a;
+         p *= b;
+         check_vec (vec4d (p.v.x, p.v.y, p.v.z, p.v.w), pd.v);
+      }
+   }
+
+   SUBCASE ("Conjugate and inverse")
+   {
+      quatf a = make_quat (3);
+      check_vec ((a * conjugate (a)).v, quatf ().v);
+
+      quatf s = a * 2.0f;
+      check_vec ((s * inverse (s)).v, quatf ().v);
+      check_vec (inverse (a).v, conjugate (a).v);
+   }
+
+   SUBCASE ("Rotate vectors")
+   {
+      for (std::size_t i = 0; i < 10; i++) {
+         quatf q = make_quat (i);
+         vec3  v = vec3 (1.0f - i, 2.0f, 0.5f * i);
+         vec4  r = to_mat4 (q) * vec4 (v.x, v.y, v.z, 0);
+         check_vec (rotate (q, v), vec3 (r.x, r.y, r.z));
+      }
+   }
+
+   SUBCASE ("Constant expressions")
+   {
+      constexpr quatd q = quatd::axis_angle (vec3d (0, 0, 1), 3.14159265358979 / 2);
+      constexpr vec3d v = rotate (q * conjugate (q) * q, vec3d (1, 0, 0));
+      static_assert (v.y > 0.999999 && v.y < 1.000001);
+      CHECK (v.x == doctest::Approx (0));
+   }
+}
+
+TEST_CASE ("Quaternion interpolation")
+{
+   const vec3 axis = norm (vec3 (1, 1, 0));
+
+   SUBCASE ("Endpoints and short path")
+   {
+      quatf a = make_quat (2);
+      quatf b = make_quat (5);
+      check_vec (nlerp (a, b, 0.0f).v, a.v);
+      check_vec (slerp (a, b, 0.0f).v, a.v);
+      check_rotation (nlerp (a, b, 1.0f), b);
+      check_rotation (slerp (a, b, 1.0f), b);
+
+      // -b is the same rotation, the result must not go the long way
+      check_rotation (slerp (a, -b, 0.5f), slerp (a, b, 0.5f));
+      check_rotation (nlerp (a, -b, 0.5f), nlerp (a, b, 0.5f));
+   }
+
+   SUBCASE ("Constant speed")
+   {
+      quatf a = quatf::axis_angle (axis, 0.2f);
+      quatf b = quatf::axis_angle (axis, 2.9f);
+      for (float t : { 0.1f, 0.25f, 0.5f, 0.8f }) {
+         check_rotation (slerp (a, b, t), quatf::axis_angle (axis, 0.2f + t * 2.7f));
+      }
+      const vec3d axisd = norm (vec3d (1, 1, 0));
+      quatd       ad    = quatd::axis_angle (axisd, 0.2);
+      quatd       bd    = quatd::axis_angle (axisd, 2.9);
+      check_vec (slerp (ad, bd, 0.3).v, quatd::axis_angle (axisd, 0.2 + 0.3 * 2.7).v, 1e-12);
+      // nearly the same rotation
+      check_vec (slerp (ad, ad, 0.5).v, ad.v, 1e-12);
+   }
+
+   SUBCASE ("Polynomial slerp against the exact one")
+   {
+      for (std::size_t i = 0; i < 30; i++) {
+         quatf a = make_quat (i);
+         quatf b = make_quat (i * 3 + 1);
+         quatd ad = quatd (a.v.x, a.v.y, a.v.z, a.v.w);
+         quatd bd = quatd (b.v.x, b.v.y, b.v.z, b.v.w);
+         for (float t : { 0.0f, 0.3f, 0.5f, 0.77f, 1.0f }) {
+            quatf r = slerp (a, b, t);
+            quatd e = slerp (ad, bd, double (t));
+            for (std::size_t c = 0; c < 4; c++) {
+               CHECK (std::abs (r.v[c] - e.v[c]) < 3e-5);
+            }
+         }
+      }
+   }
+}
+
+TEST_CASE ("Batched quaternions")
+{
+   // not a multiple of 8, the last packet is partial
+   const std::size_t  count = 21;
+   std::vector<vec4>  qa, qb;
+   std::vector<vec3>  va;
+   for (std::size_t i = 0; i < count; i++) {
+      qa.push_back (make_quat (i).v);
+      qb.push_back (make_quat (i * 2 + 5).v);
+      va.push_back (vec3 (1.0f + i, -0.5f * i, 2.0f));
+   }
+   vec4_soa a (qa), b (qb);
+   vec3_soa v (va);
+
+   SUBCASE ("Multiply and rotate")
+   {
+      vec4_soa p;
+      batch_multiply (a, b, p);
+      vec3_soa r;
+      batch_rotate (a, v, r);
+      CHECK (p.size () == count);
+      CHECK (r.size () == count);
+      for (std::size_t i = 0; i < count; i++) {
+         check_vec (p.get (i), (quatf (qa[i]) * quatf (qb[i])).v);
+         check_vec (r.get (i), rotate (quatf (qa[i]), va[i]));
+      }
+
+      // in place
+      batch_multiply (a, b, a);
+      for (std::size_t i = 0; i < count; i++) {
+         check_vec (a.get (i), p.get (i));
+      }
+   }
+
+   SUBCASE ("Interpolation")
+   {
+      vec4_soa n, s;
+      batch_nlerp (a, b, 0.35f, n);
+      batch_slerp (a, b, 0.35f, s);
+      for (std::size_t i = 0; i < count; i++) {
+         check_vec (n.get (i), nlerp (quatf (qa[i]), quatf (qb[i]), 0.35f).v);
+         check_vec (s.get (i), slerp (quatf (qa[i]), quatf (qb[i]), 0.35f).v);
+      }
+   }
+
+   SUBCASE ("To matrices")
+   {
+      std::vector<mat4> m (count);
+      batch_to_mat4 (a, m.data ());
+      for (std::size_t i = 0; i < count; i++) {
+         check_mat (m[i], to_mat4 (quatf (qa[i])));
+      }
+   }
+}
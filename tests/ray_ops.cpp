@@ -0,0 +1,124 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/ray.hpp"
+#include "meshes.hpp"
+
+static lcg rng (4321);
+
+TEST_CASE ("Ray and triangle")
+{
+   const vec3 a (-1, -1, 0), b (1, -1, 0), c (-1, 1, 0);
+   float      t, u, v;
+
+   CHECK (intersect (ray (vec3 (-0.5f, 0, 2), vec3 (0, 0, -1)), a, b, c, t, u, v));
+   CHECK (t == 2);
+   CHECK (u == doctest::Approx (0.25f));
+   CHECK (v == doctest::Approx (0.5f));
+
+   // from behind, and with a longer direction
+   CHECK (intersect (ray (vec3 (-0.5f, 0, -2), vec3 (0, 0, 4)), a, b, c, t, u, v));
+   CHECK (t == 0.5f);
+
+   CHECK (!intersect (ray (vec3 (0.5f, 0.5f, 2), vec3 (0, 0, -1)), a, b, c, t, u, v));
+   CHECK (!intersect (ray (vec3 (-0.5f, 0, 2), vec3 (0, 0, 1)), a, b, c, t, u, v));
+   CHECK (!intersect (ray (vec3 (-0.5f, 0, 2), vec3 (0, 0, -1), 0, 1.5f), a, b, c, t, u, v));
+   CHECK (!intersect (ray (vec3 (-0.5f, 0, 2), vec3 (0, 0, -1), 2.5f), a, b, c, t, u, v));
+   // in the plane of the triangle
+   CHECK (!intersect (ray (vec3 (-3, 0, 0), vec3 (1, 0, 0)), a, b, c, t, u, v));
+}
+
+TEST_CASE ("Packed triangles")
+{
+   // not a multiple of 8
+   std::vector<vec3> vertices;
+   for (std::size_t i = 0; i < 101; i++) {
+      const vec3 center = rng.signed_vec3 () * 4.0f;
+      vertices.insert (vertices.end (), { center + rng.signed_vec3 (), center + rng.signed_vec3 (), center + rng.signed_vec3 () });
+   }
+   const std::vector<triangle8> packets = pack_triangles (vertices);
+   REQUIRE (packets.size () == 13);
+
+   std::size_t hits = 0;
+   for (std::size_t k = 0; k < 200; k++) {
+      const ray r (rng.signed_vec3 () * 8.0f, rng.signed_vec3 (), 0, k % 2 ? 100.0f : 8.0f);
+
+      ray_hit expected;
+      for (std::size_t i = 0; i < vertices.size () / 3; i++) {
+         float      t = 0, u = 0, v = 0;
+         const bool hit = intersect (r, vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2], t, u, v);
+         simd_float8       pt, pu, pv;
+         const simd_mask8  m = intersect (r, packets[i / 8], simd_float8 (r.t_max), pt, pu, pv);
+         CHECK (m[i % 8] == hit);
+         if (hit) {
+            CHECK (pt[i % 8] == doctest::Approx (t));
+            CHECK (pu[i % 8] == doctest::Approx (u));
+            CHECK (pv[i % 8] == doctest::Approx (v));
+            if (t < expected.t) {
+               expected.t    = t;
+               expected.prim = std::uint32_t (i);
+            }
+         }
+      }
+      hits += bool (expected);
+
+      const ray_hit closest    = intersect (r, packets);
+      const ray_hit watertight = intersect (watertight_ray (r), packets);
+      CHECK (closest.prim == expected.prim);
+      CHECK (watertight.prim == expected.prim);
+      if (expected) {
+         CHECK (closest.t == doctest::Approx (expected.t));
+         CHECK (watertight.t == doctest::Approx (expected.t));
+         CHECK (watertight.u == doctest::Approx (closest.u).epsilon (1e-4));
+         CHECK (watertight.v == doctest::Approx (closest.v).epsilon (1e-4));
+      }
+   }
+   CHECK (hits > 10);
+}
+
+TEST_CASE ("Watertight edges")
+{
+   /* a bumpy grid of 2 triangles per cell, all wound the same way, and
+    * rays through its vertices and the middle of its edges. The rays are
+    * steeper than the grid, so they can't graze it, and must hit it at
+    * the latest where they go through. The grid is turned to face each
+    * axis in turn
+    */
+   const std::size_t n = 8;
+   for (std::size_t axis = 0; axis < 3; axis++) {
+      auto turn = [&] (const vec3 &v) {
+         return vec3 (v[(axis + 2) % 3], v[(axis + 1) % 3], v[axis]);
+      };
+      auto vertex = [&] (std::size_t x, std::size_t y) {
+         return turn (vec3 (x * 0.1f, y * 0.1f, 0.01f * ((x * 7 + y * 3) % 5)));
+      };
+      std::vector<vec3> vertices;
+      std::vector<ray>  rays;
+      for (std::size_t y = 0; y < n; y++) {
+         for (std::size_t x = 0; x < n; x++) {
+            const vec3 a = vertex (x, y), b = vertex (x + 1, y), c = vertex (x + 1, y + 1), d = vertex (x, y + 1);
+            vertices.insert (vertices.end (), { a, b, c, a, c, d });
+            if (x > 0 && y > 0) {
+               for (const vec3 &target : { a, (a + b) * 0.5f, (a + c) * 0.5f, (a + d) * 0.5f }) {
+                  const float dx = rng.signed_unit (), dy = rng.signed_unit ();
+                  const vec3  offset = turn (vec3 (dx * 0.25f, dy * 0.25f, 0.75f + rng.signed_unit () * 0.25f));
+                  rays.push_back (ray (target + offset, -offset));
+                  rays.push_back (ray (target - offset, offset));
+               }
+            }
+         }
+      }
+      const std::vector<triangle8> packets = pack_triangles (vertices);
+
+      for (const ray &r : rays) {
+         const ray_hit hit = intersect (watertight_ray (r), packets);
+         REQUIRE (hit);
+         CHECK (hit.t <= doctest::Approx (1));
+         CHECK (hit.u >= 0);
+         CHECK (hit.v >= 0);
+         CHECK (hit.u + hit.v <= doctest::Approx (1));
+      }
+   }
+}
@@ -0,0 +1,133 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <cmath>
+#include <vector>
+
+#include "../math/skinning.hpp"
+#include "checks.hpp"
+
+/* every vertex gets 1 to 4 bones, weights summing to 1
+ */
+static void make_influences (std::size_t count, int palette, skin_bones &bones, vec4_soa &weights)
+{
+   bones.resize (count);
+   weights.resize (count);
+   for (std::size_t i = 0; i < count; i++) {
+      const std::size_t used = 1 + i % 4;
+      float             w[4] = {}, sum = 0;
+      int               b[4] = {};
+      for (std::size_t k = 0; k < used; k++) {
+         w[k] = 1.0f + (i * 7 + k * 3) % 5;
+         b[k] = int ((i * 13 + k * 5) % palette);
+         sum += w[k];
+      }
+      bones.set (i, vec4i (b[0], b[1], b[2], b[3]));
+      weights.set (i, vec4 (w[0] / sum, w[1] / sum, w[2] / sum, w[3] / sum));
+   }
+}
+
+TEST_CASE ("Dual quaternion skinning")
+{
+   std::vector<dual_quatf> palette;
+   for (std::size_t i = 0; i < 13; i++) {
+      palette.push_back (dual_quatf::rigid (quatf::axis_angle (norm (vec3 (1.0f, i * 0.4f, -0.5f)), i * 0.5f - 3.0f),
+                                            vec3 (i * 0.25f, 1.0f, -2.0f)));
+   }
+
+   // more than one thread's range, and not a multiple of the packets
+   const std::size_t count = skin_grain * 2 + 37;
+   skin_bones        bones;
+   vec4_soa          weights;
+   make_influences (count, 13, bones, weights);
+
+   vec3_soa pos (count), nrm (count);
+   for (std::size_t i = 0; i < count; i++) {
+      pos.set (i, vec3 (i * 0.001f, 1.0f - i * 0.0005f, 0.25f));
+      nrm.set (i, norm (vec3 (1.0f, i % 3 - 1.0f, 0.5f)));
+   }
+
+   parallel_max_threads () = 3;
+   vec3_soa out_pos, out_nrm, only_pos;
+   skin_dual_quat (palette, bones, weights, pos, nrm, out_pos, out_nrm);
+   skin_dual_quat (palette, bones, weights, pos, only_pos);
+   parallel_max_threads () = 0;
+
+   CHECK (out_pos.size () == count);
+   CHECK (out_nrm.size () == count);
+   for (std::size_t i = 0; i < count; i++) {
+      const vec4i b = bones.get (i);
+      const vec4  w = weights.get (i);
+
+      // one vertex at a time
+      dual_quatf blend = palette[b[0]] * w[0];
+      for (std::size_t k = 1; k < 4; k++) {
+         const float s = dot (palette[b[0]].real, palette[b[k]].real) < 0 ? -1.0f : 1.0f;
+         blend         = blend + palette[b[k]] * (w[k] * s);
+      }
+      blend = norm (blend);
+
+      check_vec (out_pos.get (i), transform_point (blend, pos.get (i)), 1e-4);
+      check_vec (only_pos.get (i), out_pos.get (i), 1e-4);
+      check_vec (out_nrm.get (i), transform_vector (blend, nrm.get (i)), 1e-4);
+   }
+}
+
+TEST_CASE ("Dual quaternion skinning keeps volume")
+{
+   // two bones twisted by +-90 degrees around x, the vertex between them
+   const vec3              x       = vec3 (1, 0, 0);
+   std::vector<dual_quatf> palette = { dual_quatf::rigid (quatf::axis_angle (x, 1.5707963f), vec3 (0)),
+                                       dual_quatf::rigid (quatf::axis_angle (x, -1.5707963f), vec3 (0)) };
+   skin_bones              bones (1);
+   vec4_soa                weights (1);
+   bones.set (0, vec4i (0, 1, 0, 0));
+   weights.set (0, vec4 (0.5f, 0.5f, 0, 0));
+
+   vec3_soa pos (1, vec3 (2.0f, 1.0f, 0.0f)), out;
+   skin_dual_quat (palette, bones, weights, pos, out);
+
+   // blended matrices would collapse it onto the axis, y = 0
+   check_vec (out.get (0), vec3 (2.0f, 1.0f, 0.0f), 1e-4);
+}
+
+TEST_CASE ("Linear blend skinning")
+{
+   std::vector<mat4> palette;
+   for (std::size_t i = 0; i < 11; i++) {
+      palette.push_back (mat4::translate (i * 0.25f, 1.0f, -2.0f) * mat4::rotate (norm (vec3 (1.0f, i * 0.4f, -0.5f)), i * 0.5f)
+                         * mat4::scale (1.0f + i * 0.1f, 1.0f + i * 0.1f, 1.0f + i * 0.1f));
+   }
+
+   const std::size_t count = skin_grain + 13;
+   skin_bones        bones;
+   vec4_soa          weights;
+   make_influences (count, 11, bones, weights);
+
+   vec3_soa pos (count), nrm (count);
+   for (std::size_t i = 0; i < count; i++) {
+      pos.set (i, vec3 (i * 0.001f, 1.0f - i * 0.0005f, 0.25f));
+      nrm.set (i, norm (vec3 (1.0f, i % 3 - 1.0f, 0.5f)));
+   }
+
+   parallel_max_threads () = 2;
+   vec3_soa out_pos, out_nrm, only_pos;
+   skin_linear (palette, bones, weights, pos, nrm, out_pos, out_nrm);
+   skin_linear (palette, bones, weights, pos, only_pos);
+   parallel_max_threads () = 0;
+
+   for (std::size_t i = 0; i < count; i++) {
+      const vec4i b = bones.get (i);
+      const vec4  w = weights.get (i);
+      const vec3  p = pos.get (i), n = nrm.get (i);
+
+      vec4 rp = vec4 (0), rn = vec4 (0);
+      for (std::size_t k = 0; k < 4; k++) {
+         rp += palette[b[k]] * vec4 (p.x, p.y, p.z, 1) * w[k];
+         rn += palette[b[k]] * vec4 (n.x, n.y, n.z, 0) * w[k];
+      }
+      check_vec (out_pos.get (i), vec3 (rp.x, rp.y, rp.z), 1e-4);
+      check_vec (only_pos.get (i), out_pos.get (i), 1e-4);
+      check_vec (out_nrm.get (i), norm (vec3 (rn.x, rn.y, rn.z)), 1e-4);
+   }
+}
@@ -0,0 +1,162 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <cstdint>
+
+#include "../math/soa.hpp"
+
+static auto make_aos (std::size_t count) -> std::vector<vec3>
+{
+   std::vector<vec3> aos (count);
+   for (std::size_t i = 0; i < count; i++) {
+      aos[i] = vec3 (1.0f + i, 2.0f - i, 0.5f * i);
+   }
+   return aos;
+}
+
+TEST_CASE ("SoA construction")
+{
+   SUBCASE ("Single Value")
+   {
+      vec3_soa v = vec3_soa (20, vec3 (1, 2, 3));
+
+      CHECK (v.size () == 20);
+      CHECK (v.padded_size () % vec3_soa::lanes == 0);
+      CHECK (v.padded_size () >= 20);
+      for (std::size_t i = 0; i < v.size (); i++) {
+         CHECK (v.x ()[i] == 1);
+         CHECK (v.y ()[i] == 2);
+         CHECK (v.z ()[i] == 3);
+      }
+   }
+
+   SUBCASE ("Alignment")
+   {
+      vec4_soa v = vec4_soa (5);
+
+      for (std::size_t c = 0; c < 4; c++) {
+         CHECK (reinterpret_cast<std::uintptr_t> (v.stream (c)) % 64 == 0);
+      }
+   }
+
+   SUBCASE ("Round trip through AoS")
+   {
+      std::vector<vec3> aos = make_aos (37);
+      vec3_soa          v   = vec3_soa (aos);
+      std::vector<vec3> back = v.to_aos ();
+
+      REQUIRE (back.size () == aos.size ());
+      for (std::size_t i = 0; i < aos.size (); i++) {
+         CHECK (back[i].x == aos[i].x);
+         CHECK (back[i].y == aos[i].y);
+         CHECK (back[i].z == aos[i].z);
+      }
+   }
+
+   SUBCASE ("Resize keeps elements")
+   {
+      vec3_soa v = vec3_soa (make_aos (5));
+      v.resize (40);
+
+      CHECK (v.get (4).x == 5);
+      CHECK (v.get (4).y == -2);
+      CHECK (v.get (39).z == 0);
+   }
+}
+
+TEST_CASE ("SoA arithmetic")
+{
+   vec3_soa v1 = vec3_soa (33, vec3 (1, 2, 3));
+   vec3_soa v2 = vec3_soa (33, vec3 (-5, 10, 3));
+
+   SUBCASE ("Addition")
+   {
+      v1 += v2;
+      CHECK (v1.get (32).x == -4);
+      CHECK (v1.get (32).y == 12);
+      CHECK (v1.get (32).z == 6);
+   }
+
+   SUBCASE ("Subtraction")
+   {
+      vec3 r = (v1 - v2).get (0);
+      CHECK (r.x == 6);
+      CHECK (r.y == -8);
+      CHECK (r.z == 0);
+   }
+
+   SUBCASE ("Multiplication")
+   {
+      vec3 r = (v1 * v2).get (17);
+      CHECK (r.x == -5);
+      CHECK (r.y == 20);
+      CHECK (r.z == 9);
+   }
+
+   SUBCASE ("Division")
+   {
+      v1 /= v2;
+      CHECK (v1.get (1).x == doctest::Approx (-0.2));
+      CHECK (v1.get (1).y == doctest::Approx (0.2));
+      CHECK (v1.get (1).z == doctest::Approx (1.0));
+   }
+
+   SUBCASE ("Vector")
+   {
+      v1 += vec3 (1, 1, 1);
+      v1 *= vec3 (2, 3, 4);
+      CHECK (v1.get (5).x == 4);
+      CHECK (v1.get (5).y == 9);
+      CHECK (v1.get (5).z == 16);
+   }
+
+   SUBCASE ("Scalar")
+   {
+      v1 *= 2.0f;
+      v1 -= 1.0f;
+      CHECK (v1.get (5).x == 1);
+      CHECK (v1.get (5).y == 3);
+      CHECK (v1.get (5).z == 5);
+
+      const vec3 r = ((v1 + 1.0f) * 0.5f - 2.0f).get (32);
+      CHECK (r.x == -1);
+      CHECK (r.y == 0);
+      CHECK (r.z == 1);
+
+      // integer scalars convert to T
+      const vec3 h = (v1 * 2 / 4 + 1 - 1).get (5);
+      CHECK (h.x == 0.5f);
+      CHECK (h.z == 2.5f);
+   }
+}
+
+TEST_CASE ("SoA functions match the vector functions")
+{
+   std::vector<vec3> a = make_aos (45);
+   std::vector<vec3> b = make_aos (45);
+   for (std::size_t i = 0; i < b.size (); i++) {
+      b[i] = vec3 (b[i].z, -1.5f * b[i].x, b[i].y + 3);
+   }
+   vec3_soa sa = vec3_soa (a);
+   vec3_soa sb = vec3_soa (b);
+
+   float_soa d  = dot (sa, sb);
+   float_soa l  = len (sa);
+   float_soa l2 = len2 (sa);
+   float_soa ds = dist (sa, sb);
+   vec3_soa  n  = norm (sa);
+   vec3_soa  c  = cross (sa, sb);
+
+   for (std::size_t i = 0; i < a.size (); i++) {
+      CHECK (d.stream (0)[i] == doctest::Approx (dot (a[i], b[i])));
+      CHECK (l.stream (0)[i] == doctest::Approx (len (a[i])));
+      CHECK (l2.stream (0)[i] == doctest::Approx (len2 (a[i])));
+      CHECK (ds.stream (0)[i] == doctest::Approx (dist (a[i], b[i])));
+      CHECK (len (n.get (i)) == doctest::Approx (1.0));
+
+      vec3 r = cross (a[i], b[i]);
+      CHECK (c.get (i).x == doctest::Approx (r.x));
+      CHECK (c.get (i).y == doctest::Approx (r.y));
+      CHECK (c.get (i).z == doctest::Approx (r.z));
+   }
+}
@@ -0,0 +1,180 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/constants.hpp"
+#include "../math/transform.hpp"
+
+static auto make_matrix () -> mat4
+{
+   return mat4::translate (3.0, -4.5, 10.0) * mat4::rotate (norm (vec3 (1, 2, 3)), pi_4)
+          * mat4::scale (2.0, 0.5, 1.5);
+}
+
+static auto make_points (std::size_t count) -> std::vector<vec3>
+{
+   std::vector<vec3> points (count);
+   for (std::size_t i = 0; i < count; i++) {
+      points[i] = vec3 (1.0f + i, 2.0f - 0.5f * i, 0.25f * i);
+   }
+   return points;
+}
+
+TEST_CASE ("Transform arrays of vec3")
+{
+   mat4              m  = make_matrix ();
+   std::vector<vec3> in = make_points (19);
+   std::vector<vec3> points (in.size ()), vectors (in.size ()), normals (in.size ());
+
+   transform_points (m, in, points);
+   transform_vectors (m, in, vectors);
+   transform_normals (m, in, normals);
+
+   for (std::size_t i = 0; i < in.size (); i++) {
+      vec4 p = m * vec4 (in[i].x, in[i].y, in[i].z, 1);
+      vec4 v = m * vec4 (in[i].x, in[i].y, in[i].z, 0);
+
+      CHECK (points[i].x == doctest::Approx (p.x));
+      CHECK (points[i].y == doctest::Approx (p.y));
+      CHECK (points[i].z == doctest::Approx (p.z));
+      CHECK (vectors[i].x == doctest::Approx (v.x));
+      CHECK (vectors[i].y == doctest::Approx (v.y));
+      CHECK (vectors[i].z == doctest::Approx (v.z));
+
+      // a transformed normal stays perpendicular to transformed tangents
+      vec3 tangent = cross (in[i], vec3 (0, 0, 1));
+      vec3 t[1];
+      transform_vectors (m, std::span<const vec3> (&tangent, 1), t);
+      CHECK (dot (normals[i], t[0]) == doctest::Approx (dot (in[i], tangent)).epsilon (1e-4));
+   }
+}
+
+TEST_CASE ("Transform arrays of vec4")
+{
+   mat4              m  = make_matrix ();
+   std::vector<vec3> p3 = make_points (7);
+   std::vector<vec4> in (p3.size ());
+   for (std::size_t i = 0; i < in.size (); i++) {
+      in[i] = vec4 (p3[i].x, p3[i].y, p3[i].z, 42);
+   }
+   std::vector<vec4> points (in.size ()), vectors (in.size ());
+
+   transform_points (m, in, points);
+   transform_vectors (m, in, vectors);
+
+   for (std::size_t i = 0; i < in.size (); i++) {
+      vec4 p = m * vec4 (in[i].x, in[i].y, in[i].z, 1);
+      vec4 v = m * vec4 (in[i].x, in[i].y, in[i].z, 0);
+      for (std::size_t c = 0; c < 4; c++) {
+         CHECK (points[i][c] == doctest::Approx (p[c]));
+         CHECK (vectors[i][c] == doctest::Approx (v[c]));
+      }
+   }
+}
+
+TEST_CASE ("Transform in place")
+{
+   mat4              m   = mat4::translate (1, 2, 3);
+   std::vector<vec3> pts = make_points (5);
+   std::vector<vec3> ref = pts;
+
+   transform_points (m, pts, pts);
+   for (std::size_t i = 0; i < pts.size (); i++) {
+      CHECK (pts[i].x == ref[i].x + 1);
+      CHECK (pts[i].y == ref[i].y + 2);
+      CHECK (pts[i].z == ref[i].z + 3);
+   }
+}
+
+TEST_CASE ("Transform SoA streams")
+{
+   mat4              m   = make_matrix ();
+   std::vector<vec3> aos = make_points (21);
+   vec3_soa          in  = vec3_soa (aos);
+   vec3_soa          points, vectors, normals;
+
+   transform_points (m, in, points);
+   transform_vectors (m, in, vectors);
+   transform_normals (m, in, normals);
+
+   std::vector<vec3> ref_p (aos.size ()), ref_v (aos.size ()), ref_n (aos.size ());
+   transform_points (m, aos, ref_p);
+   transform_vectors (m, aos, ref_v);
+   transform_normals (m, aos, ref_n);
+
+   REQUIRE (points.size () == aos.size ());
+   for (std::size_t i = 0; i < aos.size (); i++) {
+      for (std::size_t c = 0; c < 3; c++) {
+         CHECK (points.get (i)[c] == doctest::Approx (ref_p[i][c]));
+         CHECK (vectors.get (i)[c] == doctest::Approx (ref_v[i][c]));
+         CHECK (normals.get (i)[c] == doctest::Approx (ref_n[i][c]));
+      }
+   }
+}
+
+TEST_CASE ("Batched inverse")
+{
+   // 19 matrices: two full packets of 8 and a scalar tail
+   std::vector<mat4> m (19), inv (19), aff (19);
+   for (std::size_t i = 0; i < m.size (); i++) {
+      m[i] = mat4::translate (i * 0.5f, 1, -2) * mat4::rotate (vec3 (1, i, 3), i * 0.1f)
+             * mat4::scale (1 + i * 0.1f, 2, 0.5);
+   }
+
+   batch_inverse (m.data (), inv.data (), m.size ());
+   batch_inverse_affine (m.data (), aff.data (), m.size ());
+   for (std::size_t i = 0; i < m.size (); i++) {
+      mat4 ref = inverse (m[i]);
+      for (std::size_t c = 0; c < 4; c++) {
+         for (std::size_t r = 0; r < 4; r++) {
+            CHECK (inv[i][c][r] == doctest::Approx (ref[c][r]).scale (1));
+            CHECK (aff[i][c][r] == doctest::Approx (ref[c][r]).scale (1));
+         }
+      }
+   }
+
+   // in place
+   batch_inverse (inv.data (), inv.data (), inv.size ());
+   for (std::size_t i = 0; i < m.size (); i++) {
+      CHECK (inv[i][3][0] == doctest::Approx (m[i][3][0]).scale (1));
+      CHECK (inv[i][1][2] == doctest::Approx (m[i][1][2]).scale (1));
+   }
+}
+
+TEST_CASE ("Unproject depth")
+{
+   // an odd size, so the rows don't line up with the SoA-padding
+   const std::size_t width = 37, height = 11;
+   const mat4        projections[] = {
+      mat4::perspective (1.0f, 1.5f, 0.5f, 50.0f),
+      mat4::perspective (1.0f, 1.5f, 0.5f, 50.0f, projection_zero_to_one | projection_reversed_z | projection_infinite),
+      mat4::frustum (-1, 2, -0.5f, 1.5f, 1, 10, projection_zero_to_one),
+      mat4::orthographic (-4, 4, -2, 3, 0.5f, 50.0f),
+   };
+   const unsigned flags[] = { projection_gl, projection_zero_to_one, projection_zero_to_one, projection_gl };
+
+   std::vector<float> depth (width * height);
+   for (std::size_t i = 0; i < depth.size (); i++) {
+      depth[i] = 0.05f + 0.9f * ((i * 7919) % 101) / 100.0f;
+   }
+
+   for (std::size_t k = 0; k < 4; k++) {
+      const bool zero_to_one = flags[k] & projection_zero_to_one;
+      const mat4 inv         = inverse (projections[k]);
+      vec3_soa   out;
+      unproject_depth (projections[k], depth.data (), width, height, out, flags[k]);
+      REQUIRE (out.size () == width * height);
+      for (std::size_t y = 0; y < height; y++) {
+         for (std::size_t x = 0; x < width; x++) {
+            const float d = depth[y * width + x];
+            const vec4  p = inv * vec4 ((x + 0.5f) / width * 2 - 1, (y + 0.5f) / height * 2 - 1,
+                                        zero_to_one ? d : d * 2 - 1, 1);
+            const vec3  v = out.get (y * width + x);
+            CHECK (v.x == doctest::Approx (p.x / p.w).epsilon (1e-4));
+            CHECK (v.y == doctest::Approx (p.y / p.w).epsilon (1e-4));
+            CHECK (v.z == doctest::Approx (p.z / p.w).epsilon (1e-4));
+         }
+      }
+   }
+}
@@ -645,3 +645,81 @@ TEST_CASE ("Vector perpendicular")
 
    CHECK (std::acos (dot (v1, v2)) == pi_2);
 }
+
+TEST_CASE ("Vector SIMD storage")
+{
+#ifdef MRN_SIMD_SSE2
+   CHECK (alignof (vec4) == 16);
+#endif
+   vec4 v1 = vec4 (1, 2, 3, 4);
+   vec4 v2 = vec4 (4, 3, 2, 1);
+
+   v1 += v2;
+   v1 *= 2.0f;
+
+   CHECK (v1.xyz.x == 10);
+   CHECK (v1.xyz.y == 10);
+   CHECK (v1.xyz.z == 10);
+   CHECK (v1.w == 10);
+   CHECK (len2 (v1) == 400);
+   CHECK (dot (v1, v2) == 100);
+   CHECK (norm (v1).x == doctest::Approx (0.5));
+}
+
+TEST_CASE ("Vector negation")
+{
+   vec3          v1 = -vec3 (1, -2, 3);
+   vec<float, 5> v2 = -vec<float, 5> ({ 1, 2, 3, 4, 5 });
+
+   CHECK (v1.x == -1);
+   CHECK (v1.y == 2);
+   CHECK (v1.z == -3);
+   CHECK (v2[0] == -1);
+   CHECK (v2[4] == -5);
+}
+
+TEST_CASE ("Vector x fractional scalar")
+{
+   vec3 v = vec3 (2, 4, 6);
+
+   vec3 half = v * 0.5f;
+   vec3 sum  = v + 0.5;
+
+   CHECK (half.x == 1);
+   CHECK (half.y == 2);
+   CHECK (half.z == 3);
+   CHECK (sum.x == 2.5);
+}
+
+TEST_CASE ("Operators on const and temporary vectors")
+{
+   const vec3 a = vec3 (1, 2, 3);
+   const vec3 b = vec3 (4, 5, 6);
+   const vec4 c = vec4 (1, 2, 3, 4);
+
+   vec3 acc = vec3 (0, 0, 0);
+   acc += a;
+   acc -= b;
+   acc *= a;
+   CHECK (acc.x == -3);
+   CHECK (acc.y == -6);
+   CHECK (acc.z == -9);
+
+   // temporaries on the left, the right and both sides
+   vec3 r1 = (a + b) + a;
+   vec3 r2 = a + (b - a);
+   vec3 r3 = (a * 2) * (b / 2) - a;
+   vec3 r4 = -(a + b);
+   CHECK (r1.x == 6);
+   CHECK (r1.z == 12);
+   CHECK (r2.y == 5);
+   CHECK (r3.x == 3);
+   CHECK (r3.z == 15);
+   CHECK (r4.y == -7);
+
+   vec4 r5 = (c + c) * c - c / 1;
+   CHECK (r5.x == 1);
+   CHECK (r5.w == 28);
+   CHECK (dot (a + b, a) == 5 + 14 + 27);
+   CHECK (len (c - c) == 0);
+}
@@ -0,0 +1,132 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include <vector>
+
+#include "../math/wide_bvh.hpp"
+#include "meshes.hpp"
+
+/* rays from all around into the sphere, from its inside out, some of
+ * them along the axes, and some that stop short
+ */
+static auto make_rays (std::size_t count) -> std::vector<ray>
+{
+   std::vector<ray> rays;
+   lcg              rng (777);
+   for (std::size_t i = 0; i < count; i++) {
+      const vec3 from = rng.signed_vec3 () * 3.0f, to = rng.signed_vec3 () * 0.5f;
+      switch (i % 4) {
+      case 0: rays.push_back (ray (from, to - from)); break;
+      case 1: rays.push_back (ray (to, from - to)); break;
+      case 2: rays.push_back (ray (vec3 (from.x, to.y, to.z), vec3 (i % 8 < 4 ? 1.0f : -1.0f, 0, 0))); break;
+      case 3: rays.push_back (ray (from, to - from, 0.1f, 0.5f)); break;
+      }
+   }
+   return rays;
+}
+
+static auto brute_force (const std::vector<vec3> &vertices, const ray &r) -> ray_hit
+{
+   ray_hit hit;
+   ray     nearest = r;
+   for (std::size_t i = 0; i < vertices.size () / 3; i++) {
+      float t, u, v;
+      if (intersect (nearest, vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2], t, u, v)) {
+         nearest.t_max = hit.t = t;
+         hit.u                 = u;
+         hit.v                 = v;
+         hit.prim              = std::uint32_t (i);
+      }
+   }
+   return hit;
+}
+
+/* where two triangles share an edge either one is the closest, as long
+ * as it is hit at the same distance. Packets round differently with FMA
+ */
+static void check_hit (const std::vector<vec3> &vertices, const ray &r, const ray_hit &hit, const ray_hit &expected)
+{
+   REQUIRE (bool (hit) == bool (expected));
+   if (hit) {
+      CHECK (hit.t == doctest::Approx (expected.t));
+      float      t, u, v;
+      const vec3 *tri = &vertices[3 * hit.prim];
+      CHECK (intersect (r, tri[0], tri[1], tri[2], t, u, v));
+      CHECK (hit.t == doctest::Approx (t));
+      CHECK (hit.u == doctest::Approx (u));
+      CHECK (hit.v == doctest::Approx (v));
+   }
+}
+
+TEST_CASE_TEMPLATE ("Wide bounding volume hierarchy", T, wide_bvh4, wide_bvh8)
+{
+   const std::vector<vec3> vertices = make_sphere (24, 40);
+   const std::vector<ray>  rays     = make_rays (400);
+   const T                 tree (vertices);
+   REQUIRE (!tree.empty ());
+   CHECK (tree.prims.size () == vertices.size () / 3);
+
+   SUBCASE ("Closest hit")
+   {
+      std::size_t hits = 0;
+      for (const ray &r : rays) {
+         const ray_hit expected = brute_force (vertices, r);
+         check_hit (vertices, r, tree.intersect (r), expected);
+         CHECK (tree.occluded (r) == bool (expected));
+         hits += bool (expected);
+      }
+      CHECK (hits > rays.size () / 2);
+      CHECK (hits < rays.size ());
+   }
+
+   SUBCASE ("Packets")
+   {
+      for (std::size_t i = 0; i < rays.size (); i += 8) {
+         const ray8 packet (&rays[i]);
+         ray_hit8   hits;
+         tree.intersect (packet, hits);
+         const simd_mask8 occluded = tree.occluded (packet);
+         for (std::size_t k = 0; k < 8; k++) {
+            const ray_hit expected = brute_force (vertices, rays[i + k]);
+            check_hit (vertices, rays[i + k], hits[k], expected);
+            CHECK (occluded[k] == bool (expected));
+         }
+      }
+   }
+
+   SUBCASE ("Indexed triangles")
+   {
+      // the same sphere, with the corners of every quad shared
+      std::vector<vec3>          unique;
+      std::vector<std::uint32_t> indices;
+      for (std::size_t i = 0; i < vertices.size (); i += 6) {
+         const std::uint32_t base = std::uint32_t (unique.size ());
+         unique.insert (unique.end (), { vertices[i], vertices[i + 1], vertices[i + 2], vertices[i + 5] });
+         indices.insert (indices.end (), { base, base + 1, base + 2, base, base + 2, base + 3 });
+      }
+      const T indexed (bvh (triangle_bounds (unique, indices)), unique, indices);
+      for (std::size_t i = 0; i < rays.size (); i += 7) {
+         check_hit (vertices, rays[i], indexed.intersect (rays[i]), brute_force (vertices, rays[i]));
+      }
+   }
+}
+
+TEST_CASE_TEMPLATE ("Small wide hierarchies", T, wide_bvh4, wide_bvh8)
+{
+   const std::vector<vec3> one = { vec3 (-1, -1, 0), vec3 (1, -1, 0), vec3 (0, 1, 0) };
+   const T                 tree (one);
+   REQUIRE (tree.nodes.size () == 1);
+
+   const ray_hit hit = tree.intersect (ray (vec3 (0, 0, 5), vec3 (0, 0, -1)));
+   CHECK (hit);
+   CHECK (hit.t == 5);
+   CHECK (hit.prim == 0);
+   CHECK (!tree.intersect (ray (vec3 (0, 0, 5), vec3 (0, 0, -1), 0, 4)));
+   CHECK (!tree.intersect (ray (vec3 (0, 0, 5), vec3 (0, 0, 1))));
+   CHECK (!tree.occluded (ray (vec3 (3, 0, 5), vec3 (0, 0, -1))));
+
+   const T nothing (std::vector<vec3> {});
+   CHECK (nothing.empty ());
+   CHECK (!nothing.intersect (ray (vec3 (0, 0, 5), vec3 (0, 0, -1))));
+   CHECK (!nothing.occluded (ray (vec3 (0, 0, 5), vec3 (0, 0, -1))));
+}